@@ -42,6 +42,11 @@ typedef unsigned short sa_family_t;
 #define __func__ __FUNCTION__
 #endif
 
+/* sendmmsg and recvmmsg are GNU extensions in glibc */
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
 #include <sys/types.h>
 #include <sys/stat.h>
 
@@ -113,6 +118,15 @@ typedef unsigned short sa_family_t;
 #define HAVE_EPOLL
 #endif
 
+#ifdef HAVE_LINUX_IO_URING_H
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#if defined(IORING_FEAT_EXT_ARG) && \
+  defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define HAVE_IO_URING
+#endif
+#endif
+
 #ifndef _WIN32
 #include <sys/param.h>
 #include <sys/time.h>
@@ -173,7 +187,14 @@ typedef unsigned short sa_family_t;
 #endif
 
 #if defined(__linux__)
+#ifdef HAVE_LINUX_IF_PACKET_H
+#include <linux/if_packet.h>
+#else
 #include <netpacket/packet.h>
+#endif
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
 #include <net/ethernet.h>
 #include <net/if_arp.h>
 #include <linux/types.h>
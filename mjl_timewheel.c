@@ -0,0 +1,537 @@
+/*
+ * hierarchical timing wheel routines
+ * by Matthew Luckie
+ *
+ * Adapted from the cascading timer wheel described by Varghese and Lauck
+ * in "Hashed and Hierarchical Timing Wheels".
+ *
+ * Copyright (C) 2026 Matthew Luckie. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Matthew Luckie ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL Matthew Luckie BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+#include <sys/types.h>
+#include <sys/time.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#if defined(DMALLOC)
+#include <dmalloc.h>
+#endif
+
+#include "mjl_timewheel.h"
+
+/*
+ * the wheel has a cursor that advances one millisecond tick at a time.
+ * the first level has a slot for each of the next 256 ticks.  each of the
+ * four levels above it has 64 slots, each slot covering 64 times the
+ * span of a slot in the level below.  when the cursor reaches the start
+ * of a slot in a higher level, the items in that slot are cascaded down.
+ * items further than 2^32 ticks (about 49 days) away are parked in the
+ * furthest slot, and placed again when that slot is cascaded.
+ */
+#define TW_L0_BITS 8
+#define TW_L0_SIZE (1 << TW_L0_BITS)
+#define TW_L0_MASK (TW_L0_SIZE - 1)
+#define TW_LN_BITS 6
+#define TW_LN_SIZE (1 << TW_LN_BITS)
+#define TW_LN_MASK (TW_LN_SIZE - 1)
+#define TW_LN      4
+#define TW_SHIFT(i) (TW_L0_BITS + ((i) * TW_LN_BITS))
+#define TW_SPAN    ((uint64_t)1 << TW_SHIFT(TW_LN))
+
+#define TW_LEVEL_DUE 0xff
+
+typedef struct timewheel_slot
+{
+  timewheel_node_t *head;
+  timewheel_node_t *tail;
+  uint8_t           level;
+  uint8_t           index;
+} timewheel_slot_t;
+
+struct timewheel_node
+{
+  void                  *item;
+  struct timeval         tv;
+  uint64_t               tick;
+  timewheel_slot_t      *slot;
+  timewheel_node_t      *prev;
+  timewheel_node_t      *next;
+};
+
+struct timewheel
+{
+  timewheel_slot_t       l0[TW_L0_SIZE];
+  timewheel_slot_t       ln[TW_LN][TW_LN_SIZE];
+  uint64_t               l0_map[TW_L0_SIZE / 64];
+  uint64_t               ln_map[TW_LN];
+  timewheel_slot_t       due;
+  uint64_t               tick;
+  int                    count;
+  timewheel_onremove_t   onremove;
+};
+
+static uint64_t tv_tick(const struct timeval *tv)
+{
+  return ((uint64_t)tv->tv_sec * 1000) + (tv->tv_usec / 1000);
+}
+
+static void tick_tv(struct timeval *tv, uint64_t tick)
+{
+  tv->tv_sec  = (time_t)(tick / 1000);
+  tv->tv_usec = (tick % 1000) * 1000;
+  return;
+}
+
+static int tv_cmp(const struct timeval *a, const struct timeval *b)
+{
+  if(a->tv_sec  < b->tv_sec)  return -1;
+  if(a->tv_sec  > b->tv_sec)  return  1;
+  if(a->tv_usec < b->tv_usec) return -1;
+  if(a->tv_usec > b->tv_usec) return  1;
+  return 0;
+}
+
+static int bit_ctz(uint64_t x)
+{
+  int i = 0;
+  assert(x != 0);
+  if((x & 0xffffffffULL) == 0) { x >>= 32; i += 32; }
+  if((x & 0xffffULL) == 0)     { x >>= 16; i += 16; }
+  if((x & 0xffULL) == 0)       { x >>= 8;  i += 8;  }
+  if((x & 0xfULL) == 0)        { x >>= 4;  i += 4;  }
+  if((x & 0x3ULL) == 0)        { x >>= 2;  i += 2;  }
+  if((x & 0x1ULL) == 0)        { i += 1; }
+  return i;
+}
+
+/*
+ * bit_next
+ *
+ * return the first bit set in the map at or after from, or -1.
+ */
+static int bit_next(const uint64_t *map, int words, int from)
+{
+  uint64_t x;
+  int w = from / 64;
+
+  if(w >= words)
+    return -1;
+  x = map[w] & (~0ULL << (from % 64));
+  for(;;)
+    {
+      if(x != 0)
+	return (w * 64) + bit_ctz(x);
+      if(++w >= words)
+	break;
+      x = map[w];
+    }
+
+  return -1;
+}
+
+static void slot_map_set(timewheel_t *tw, timewheel_slot_t *slot)
+{
+  if(slot->level == 0)
+    tw->l0_map[slot->index / 64] |= (1ULL << (slot->index % 64));
+  else if(slot->level != TW_LEVEL_DUE)
+    tw->ln_map[slot->level-1] |= (1ULL << slot->index);
+  return;
+}
+
+static void slot_map_clr(timewheel_t *tw, timewheel_slot_t *slot)
+{
+  if(slot->level == 0)
+    tw->l0_map[slot->index / 64] &= ~(1ULL << (slot->index % 64));
+  else if(slot->level != TW_LEVEL_DUE)
+    tw->ln_map[slot->level-1] &= ~(1ULL << slot->index);
+  return;
+}
+
+static void slot_push(timewheel_t *tw, timewheel_slot_t *slot,
+		      timewheel_node_t *node)
+{
+  node->slot = slot;
+  node->next = NULL;
+  node->prev = slot->tail;
+  if(slot->tail != NULL)
+    slot->tail->next = node;
+  else
+    {
+      slot->head = node;
+      slot_map_set(tw, slot);
+    }
+  slot->tail = node;
+  return;
+}
+
+static void slot_unlink(timewheel_t *tw, timewheel_node_t *node)
+{
+  timewheel_slot_t *slot = node->slot;
+
+  if(node->prev != NULL)
+    node->prev->next = node->next;
+  else
+    slot->head = node->next;
+
+  if(node->next != NULL)
+    node->next->prev = node->prev;
+  else
+    slot->tail = node->prev;
+
+  if(slot->head == NULL)
+    slot_map_clr(tw, slot);
+
+  node->slot = NULL;
+  node->prev = NULL;
+  node->next = NULL;
+  return;
+}
+
+/*
+ * tw_slot
+ *
+ * figure out which slot an item expiring at the given tick belongs in,
+ * relative to the current position of the cursor.
+ */
+static timewheel_slot_t *tw_slot(timewheel_t *tw, uint64_t tick)
+{
+  uint64_t delta;
+  int i;
+
+  if(tick < tw->tick)
+    tick = tw->tick;
+  delta = tick - tw->tick;
+
+  if(delta < TW_L0_SIZE)
+    return &tw->l0[tick & TW_L0_MASK];
+
+  if(delta >= TW_SPAN)
+    tick = tw->tick + TW_SPAN - 1;
+
+  for(i=0; i<TW_LN-1; i++)
+    if(delta < ((uint64_t)1 << TW_SHIFT(i+1)))
+      break;
+
+  return &tw->ln[i][(tick >> TW_SHIFT(i)) & TW_LN_MASK];
+}
+
+/*
+ * tw_cascade
+ *
+ * the cursor has reached the start of a block of ticks covered by the
+ * first level.  move the items out of the higher level slots that
+ * have become current.
+ */
+static void tw_cascade(timewheel_t *tw)
+{
+  timewheel_slot_t *slot;
+  timewheel_node_t *node, *next;
+  int i, j;
+
+  for(i=0; i<TW_LN; i++)
+    {
+      j = (tw->tick >> TW_SHIFT(i)) & TW_LN_MASK;
+      slot = &tw->ln[i][j];
+      node = slot->head;
+      slot->head = slot->tail = NULL;
+      slot_map_clr(tw, slot);
+      while(node != NULL)
+	{
+	  next = node->next;
+	  slot_push(tw, tw_slot(tw, node->tick), node);
+	  node = next;
+	}
+      if(j != 0)
+	break;
+    }
+
+  return;
+}
+
+/*
+ * tw_advance
+ *
+ * move the cursor forward to the tick for now.  everything in a slot for
+ * an earlier tick has expired, and is moved to the due list.
+ */
+static void tw_advance(timewheel_t *tw, uint64_t now)
+{
+  timewheel_slot_t *slot;
+  timewheel_node_t *node;
+  uint64_t next;
+  int i;
+
+  while(tw->tick < now)
+    {
+      slot = &tw->l0[tw->tick & TW_L0_MASK];
+      if(slot->head != NULL)
+	{
+	  for(node = slot->head; node != NULL; node = node->next)
+	    node->slot = &tw->due;
+	  if(tw->due.tail != NULL)
+	    {
+	      tw->due.tail->next = slot->head;
+	      slot->head->prev = tw->due.tail;
+	    }
+	  else tw->due.head = slot->head;
+	  tw->due.tail = slot->tail;
+	  slot->head = slot->tail = NULL;
+	  slot_map_clr(tw, slot);
+	}
+
+      /* skip over empty slots, stopping at the start of the next block */
+      next = (tw->tick | TW_L0_MASK) + 1;
+      if((tw->tick & TW_L0_MASK) != TW_L0_MASK &&
+	 (i = bit_next(tw->l0_map, TW_L0_SIZE / 64,
+		       (tw->tick & TW_L0_MASK) + 1)) != -1)
+	next = (tw->tick & ~((uint64_t)TW_L0_MASK)) + i;
+      if(next > now)
+	next = now;
+      tw->tick = next;
+
+      if((tw->tick & TW_L0_MASK) == 0)
+	tw_cascade(tw);
+    }
+
+  return;
+}
+
+static void tw_node_free(timewheel_t *tw, timewheel_node_t *node)
+{
+  void *item = node->item;
+  free(node);
+  tw->count--;
+  if(tw->onremove != NULL)
+    tw->onremove(item);
+  return;
+}
+
+static timewheel_node_t *tw_slot_min(timewheel_slot_t *slot)
+{
+  timewheel_node_t *node, *min = slot->head;
+  for(node = min->next; node != NULL; node = node->next)
+    if(tv_cmp(&node->tv, &min->tv) < 0)
+      min = node;
+  return min;
+}
+
+/*
+ * tw_any
+ *
+ * return the first node found in the wheel, regardless of its time.
+ */
+static timewheel_node_t *tw_any(timewheel_t *tw)
+{
+  int i, j;
+
+  if(tw->due.head != NULL)
+    return tw->due.head;
+  if((j = bit_next(tw->l0_map, TW_L0_SIZE / 64, 0)) != -1)
+    return tw->l0[j].head;
+  for(i=0; i<TW_LN; i++)
+    if((j = bit_next(&tw->ln_map[i], 1, 0)) != -1)
+      return tw->ln[i][j].head;
+  return NULL;
+}
+
+void *timewheel_remove(timewheel_t *tw, const struct timeval *now)
+{
+  timewheel_node_t *node;
+  void *item;
+
+  if(tw->count == 0)
+    {
+      /* an empty wheel can move its cursor without doing any work */
+      if(now != NULL && tv_tick(now) > tw->tick)
+	tw->tick = tv_tick(now);
+      return NULL;
+    }
+
+  if(now == NULL)
+    {
+      node = tw_any(tw);
+    }
+  else
+    {
+      tw_advance(tw, tv_tick(now));
+      if((node = tw->due.head) == NULL)
+	{
+	  /* items in the slot for the current tick may not be due yet */
+	  for(node = tw->l0[tw->tick & TW_L0_MASK].head; node != NULL;
+	      node = node->next)
+	    if(tv_cmp(&node->tv, now) <= 0)
+	      break;
+	}
+    }
+
+  if(node == NULL)
+    return NULL;
+
+  item = node->item;
+  slot_unlink(tw, node);
+  tw_node_free(tw, node);
+  return item;
+}
+
+int timewheel_head_time(timewheel_t *tw, struct timeval *tv)
+{
+  timewheel_node_t *node;
+  struct timeval x;
+  uint64_t v;
+  int i, c, j, set = 0;
+
+  if(tw->count == 0)
+    return 0;
+
+  if(tw->due.head != NULL)
+    {
+      memcpy(tv, &tw->due.head->tv, sizeof(struct timeval));
+      return 1;
+    }
+
+  /* the first level slots for the rest of the current block */
+  if((j = bit_next(tw->l0_map, TW_L0_SIZE / 64, tw->tick & TW_L0_MASK)) != -1)
+    {
+      node = tw_slot_min(&tw->l0[j]);
+      memcpy(tv, &node->tv, sizeof(struct timeval));
+      return 1;
+    }
+
+  /* the first level slots that have wrapped into the next block */
+  if((j = bit_next(tw->l0_map, TW_L0_SIZE / 64, 0)) != -1)
+    {
+      node = tw_slot_min(&tw->l0[j]);
+      memcpy(tv, &node->tv, sizeof(struct timeval));
+      set = 1;
+    }
+
+  /*
+   * the start of the first occupied slot in each higher level is when
+   * its items will be cascaded down, so it is a lower bound.
+   */
+  for(i=0; i<TW_LN; i++)
+    {
+      if(tw->ln_map[i] == 0)
+	continue;
+      c = (tw->tick >> TW_SHIFT(i)) & TW_LN_MASK;
+      if(c == TW_LN_MASK || (j = bit_next(&tw->ln_map[i], 1, c+1)) == -1)
+	j = bit_next(&tw->ln_map[i], 1, 0);
+      v = (tw->tick >> TW_SHIFT(i)) + ((j - c - 1) & TW_LN_MASK) + 1;
+      tick_tv(&x, v << TW_SHIFT(i));
+      if(set == 0 || tv_cmp(&x, tv) < 0)
+	{
+	  memcpy(tv, &x, sizeof(struct timeval));
+	  set = 1;
+	}
+    }
+
+  return set;
+}
+
+timewheel_node_t *timewheel_insert(timewheel_t *tw, const struct timeval *tv,
+				   void *ptr)
+{
+  timewheel_node_t *node;
+
+  if((node = malloc(sizeof(timewheel_node_t))) == NULL)
+    return NULL;
+  node->item = ptr;
+  node->tick = tv_tick(tv);
+  memcpy(&node->tv, tv, sizeof(struct timeval));
+
+  slot_push(tw, tw_slot(tw, node->tick), node);
+  tw->count++;
+  return node;
+}
+
+void timewheel_delete(timewheel_t *tw, timewheel_node_t *node)
+{
+  slot_unlink(tw, node);
+  tw_node_free(tw, node);
+  return;
+}
+
+int timewheel_count(const timewheel_t *tw)
+{
+  return tw->count;
+}
+
+void *timewheel_node_item(const timewheel_node_t *node)
+{
+  return node->item;
+}
+
+void timewheel_onremove(timewheel_t *tw, timewheel_onremove_t onremove)
+{
+  tw->onremove = onremove;
+  return;
+}
+
+timewheel_t *timewheel_alloc(const struct timeval *now)
+{
+  timewheel_t *tw;
+  int i, j;
+
+  if((tw = malloc(sizeof(timewheel_t))) == NULL)
+    return NULL;
+  memset(tw, 0, sizeof(timewheel_t));
+
+  for(i=0; i<TW_L0_SIZE; i++)
+    tw->l0[i].index = i;
+  for(i=0; i<TW_LN; i++)
+    {
+      for(j=0; j<TW_LN_SIZE; j++)
+	{
+	  tw->ln[i][j].level = i + 1;
+	  tw->ln[i][j].index = j;
+	}
+    }
+  tw->due.level = TW_LEVEL_DUE;
+  tw->tick = tv_tick(now);
+
+  return tw;
+}
+
+void timewheel_free(timewheel_t *tw, timewheel_free_t free_func)
+{
+  timewheel_node_t *node;
+
+  if(tw == NULL)
+    return;
+
+  while((node = tw_any(tw)) != NULL)
+    {
+      slot_unlink(tw, node);
+      if(free_func != NULL)
+	free_func(node->item);
+      free(node);
+      tw->count--;
+    }
+
+  free(tw);
+  return;
+}
@@ -0,0 +1,69 @@
+/*
+ * hierarchical timing wheel routines
+ * by Matthew Luckie
+ *
+ * Copyright (C) 2026 Matthew Luckie. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Matthew Luckie ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL Matthew Luckie BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+#ifndef __MJL_TIMEWHEEL_H
+#define __MJL_TIMEWHEEL_H
+
+/*
+ * a timewheel holds items keyed by the time at which they expire.
+ * insert and delete are O(1); items are bucketed by millisecond, and
+ * timewheel_remove only returns an item once its exact time has passed.
+ * the wheel's clock starts at the time passed to timewheel_alloc, and
+ * moves forward each time timewheel_remove is called.
+ */
+typedef struct timewheel timewheel_t;
+typedef struct timewheel_node timewheel_node_t;
+
+typedef void (*timewheel_free_t)(void *ptr);
+typedef void (*timewheel_onremove_t)(void *ptr);
+
+timewheel_t *timewheel_alloc(const struct timeval *now);
+void timewheel_free(timewheel_t *tw, timewheel_free_t free_func);
+void timewheel_onremove(timewheel_t *tw, timewheel_onremove_t onremove);
+
+timewheel_node_t *timewheel_insert(timewheel_t *tw, const struct timeval *tv,
+				   void *ptr);
+void timewheel_delete(timewheel_t *tw, timewheel_node_t *node);
+
+/*
+ * return an item whose time is at or before now, or any item if now is
+ * NULL.  returns NULL if there is no such item.
+ */
+void *timewheel_remove(timewheel_t *tw, const struct timeval *now);
+
+/*
+ * report a time no later than the time of the earliest item in the wheel.
+ * the time reported is exact if the item expires in the next 256ms.
+ */
+int timewheel_head_time(timewheel_t *tw, struct timeval *tv);
+
+int timewheel_count(const timewheel_t *tw);
+void *timewheel_node_item(const timewheel_node_t *node);
+
+#endif /* __MJL_TIMEWHEEL_H */
@@ -36,8 +36,16 @@
 #include "scamper_list.h"
 #include "scamper_icmpext.h"
 #include "scamper_dealias.h"
+#include "scamper_dealias_ipidseq.h"
+#include "scamper_slab.h"
 #include "utils.h"
 
+/* number of ipids copied out of the probes at a time for sequence checks */
+#define DEALIAS_IPIDSEQ_BUF 128
+
+static scamper_slab_t *probe_slab = NULL;
+static scamper_slab_t *reply_slab = NULL;
+
 int scamper_dealias_ipid(const scamper_dealias_probe_t **probes,
 			 uint32_t probec, scamper_dealias_ipid_t *ipid)
 {
@@ -231,6 +239,23 @@ static void dealias_bump_free(void *data)
   return;
 }
 
+static void dealias_midar_free(void *data)
+{
+  scamper_dealias_midar_t *midar = (scamper_dealias_midar_t *)data;
+  uint32_t i;
+
+  if(midar->probedefs != NULL)
+    {
+      for(i=0; i<midar->probedefc; i++)
+	dealias_probedef_free(&midar->probedefs[i]);
+      free(midar->probedefs);
+    }
+  if(midar->sets != NULL)
+    free(midar->sets);
+  free(midar);
+  return;
+}
+
 const char *scamper_dealias_probedef_method_tostr(const scamper_dealias_probedef_t *d,
 						  char *b, size_t l)
 {
@@ -266,8 +291,7 @@ void scamper_dealias_probedef_free(scamper_dealias_probedef_t *probedef)
 
 scamper_dealias_probe_t *scamper_dealias_probe_alloc(void)
 {
-  size_t size = sizeof(scamper_dealias_probe_t);
-  return (scamper_dealias_probe_t *)malloc_zero(size);
+  return scamper_slab_get(&probe_slab, sizeof(scamper_dealias_probe_t));
 }
 
 void scamper_dealias_probe_free(scamper_dealias_probe_t *probe)
@@ -284,21 +308,20 @@ void scamper_dealias_probe_free(scamper_dealias_probe_t *probe)
       free(probe->replies);
     }
 
-  free(probe);
+  scamper_slab_put(&probe_slab, probe);
   return;
 }
 
 scamper_dealias_reply_t *scamper_dealias_reply_alloc(void)
 {
-  size_t size = sizeof(scamper_dealias_reply_t);
-  return (scamper_dealias_reply_t *)malloc_zero(size);
+  return scamper_slab_get(&reply_slab, sizeof(scamper_dealias_reply_t));
 }
 
 void scamper_dealias_reply_free(scamper_dealias_reply_t *reply)
 {
   if(reply->src != NULL)
     scamper_addr_free(reply->src);
-  free(reply);
+  scamper_slab_put(&reply_slab, reply);
   return;
 }
 
@@ -430,36 +453,18 @@ int scamper_dealias_bump_alloc(scamper_dealias_t *dealias)
   return -1;
 }
 
-static uint16_t dealias_ipid16_diff(uint16_t a, uint16_t b)
-{
-  if(a <= b)
-    return b - a;
-  return (0xFFFFUL - a) + b + 1;
-}
-
-static int dealias_ipid16_inseq2(uint16_t a, uint16_t b, uint16_t fudge)
+int scamper_dealias_midar_alloc(scamper_dealias_t *dealias)
 {
-  if(a == b || dealias_ipid16_diff(a, b) > fudge)
+  if((dealias->data = malloc_zero(sizeof(scamper_dealias_midar_t))) != NULL)
     return 0;
-  return 1;
+  return -1;
 }
 
-static int dealias_ipid16_inseq3(uint32_t a,uint32_t b,uint32_t c,uint32_t f)
+static uint16_t dealias_ipid16_diff(uint16_t a, uint16_t b)
 {
-  if(a == b || b == c || a == c)
-    return 0;
-
-  if(a > b)
-    b += 0x10000;
-  if(a > c)
-    c += 0x10000;
-
-  if(a > b || b > c)
-    return 0;
-  if(f != 0 && (b - a > f || c - b > f))
-    return 0;
-
-  return 1;
+  if(a <= b)
+    return b - a;
+  return (0xFFFFUL - a) + b + 1;
 }
 
 static uint32_t dealias_ipid32_diff(uint32_t a, uint32_t b)
@@ -469,31 +474,6 @@ static uint32_t dealias_ipid32_diff(uint32_t a, uint32_t b)
   return (0xFFFFFFFFUL - a) + b + 1;
 }
 
-static int dealias_ipid32_inseq2(uint32_t a, uint32_t b, uint32_t fudge)
-{
-  if(a == b || dealias_ipid32_diff(a, b) > fudge)
-    return 0;
-  return 1;
-}
-
-static int dealias_ipid32_inseq3(uint64_t a,uint64_t b,uint64_t c,uint64_t f)
-{
-  if(a == b || b == c || a == c)
-    return 0;
-
-  if(a > b)
-    b += 0x100000000ULL;
-  if(a > c)
-    c += 0x100000000ULL;
-
-  if(a > b || b > c)
-    return 0;
-  if(f != 0 && (b - a > f || c - b > f))
-    return 0;
-
-  return 1;
-}
-
 static int dealias_ipid16_bo(scamper_dealias_probe_t **probes, int probec)
 {
   scamper_dealias_probe_t **s = NULL;
@@ -540,8 +520,9 @@ static int dealias_ipid16_bo(scamper_dealias_probe_t **probes, int probec)
 static int dealias_ipid16_inseq(scamper_dealias_probe_t **probes,
 				int probec, uint16_t fudge, int bs)
 {
-  uint16_t a, b, c;
-  int i;
+  uint32_t ipids[DEALIAS_IPIDSEQ_BUF];
+  uint16_t u16;
+  int i, j, n;
 
   /*
    * do a preliminary check to see if the ipids could be in sequence with
@@ -553,30 +534,26 @@ static int dealias_ipid16_inseq(scamper_dealias_probe_t **probes,
       if(fudge == 0)
 	return 1;
 
-      a = probes[0]->replies[0]->ipid;
-      b = probes[1]->replies[0]->ipid;
-      if(bs != 0)
+      for(i=0; i<2; i++)
 	{
-	  a = byteswap16(a);
-	  b = byteswap16(b);
+	  u16 = probes[i]->replies[0]->ipid;
+	  ipids[i] = bs != 0 ? byteswap16(u16) : u16;
 	}
-      if(dealias_ipid16_inseq2(a, b, fudge) != 0)
-	return 1;
-      return 0;
+      return scamper_dealias_ipidseq_inseq2(ipids[0], ipids[1],
+					    0xFFFF, fudge);
     }
 
-  for(i=0; i+2<probec; i++)
+  /* copy the ipids out in blocks that overlap by two samples */
+  for(i=0; i+2<probec; i+=n-2)
     {
-      a = probes[i+0]->replies[0]->ipid;
-      b = probes[i+1]->replies[0]->ipid;
-      c = probes[i+2]->replies[0]->ipid;
-      if(bs != 0)
+      if((n = probec - i) > DEALIAS_IPIDSEQ_BUF)
+	n = DEALIAS_IPIDSEQ_BUF;
+      for(j=0; j<n; j++)
 	{
-	  a = byteswap16(a);
-	  b = byteswap16(b);
-	  c = byteswap16(c);
+	  u16 = probes[i+j]->replies[0]->ipid;
+	  ipids[j] = bs != 0 ? byteswap16(u16) : u16;
 	}
-      if(dealias_ipid16_inseq3(a, b, c, fudge) == 0)
+      if(scamper_dealias_ipidseq_inseq(ipids, n, 0xFFFF, fudge) == 0)
 	return 0;
     }
 
@@ -629,8 +606,8 @@ static int dealias_ipid32_bo(scamper_dealias_probe_t **probes, int probec)
 static int dealias_ipid32_inseq(scamper_dealias_probe_t **probes,
 				int probec, uint16_t fudge, int bs)
 {
-  uint32_t a, b, c;
-  int i;
+  uint32_t ipids[DEALIAS_IPIDSEQ_BUF], u32;
+  int i, j, n;
 
   /*
    * do a preliminary check to see if the ipids could be in sequence with
@@ -642,30 +619,26 @@ static int dealias_ipid32_inseq(scamper_dealias_probe_t **probes,
       if(fudge == 0)
 	return 1;
 
-      a = probes[0]->replies[0]->ipid32;
-      b = probes[1]->replies[0]->ipid32;
-      if(bs != 0)
+      for(i=0; i<2; i++)
 	{
-	  a = byteswap32(a);
-	  b = byteswap32(b);
+	  u32 = probes[i]->replies[0]->ipid32;
+	  ipids[i] = bs != 0 ? byteswap32(u32) : u32;
 	}
-      if(dealias_ipid32_inseq2(a, b, fudge) != 0)
-	return 1;
-      return 0;
+      return scamper_dealias_ipidseq_inseq2(ipids[0], ipids[1],
+					    0xFFFFFFFF, fudge);
     }
 
-  for(i=0; i+2<probec; i++)
+  /* copy the ipids out in blocks that overlap by two samples */
+  for(i=0; i+2<probec; i+=n-2)
     {
-      a = probes[i+0]->replies[0]->ipid32;
-      b = probes[i+1]->replies[0]->ipid32;
-      c = probes[i+2]->replies[0]->ipid32;
-      if(bs != 0)
+      if((n = probec - i) > DEALIAS_IPIDSEQ_BUF)
+	n = DEALIAS_IPIDSEQ_BUF;
+      for(j=0; j<n; j++)
 	{
-	  a = byteswap32(a);
-	  b = byteswap32(b);
-	  c = byteswap32(c);
+	  u32 = probes[i+j]->replies[0]->ipid32;
+	  ipids[j] = bs != 0 ? byteswap32(u32) : u32;
 	}
-      if(dealias_ipid32_inseq3(a, b, c, fudge) == 0)
+      if(scamper_dealias_ipidseq_inseq(ipids, n, 0xFFFFFFFF, fudge) == 0)
 	return 0;
     }
 
@@ -737,6 +710,23 @@ int scamper_dealias_radargun_probedefs_alloc(scamper_dealias_radargun_t *rg,
   return 0;
 }
 
+int scamper_dealias_midar_probedefs_alloc(scamper_dealias_midar_t *midar,
+					  uint32_t probedefc)
+{
+  size_t len = probedefc * sizeof(scamper_dealias_probedef_t);
+  if((midar->probedefs = malloc_zero(len)) == NULL)
+    return -1;
+  return 0;
+}
+
+int scamper_dealias_midar_sets_alloc(scamper_dealias_midar_t *midar)
+{
+  size_t len = midar->probedefc * sizeof(uint32_t);
+  if((midar->sets = malloc_zero(len)) == NULL)
+    return -1;
+  return 0;
+}
+
 typedef struct dealias_resolv
 {
   scamper_dealias_probe_t **probes;
@@ -1013,6 +1003,7 @@ const char *scamper_dealias_method_tostr(const scamper_dealias_t *d, char *b, si
     "radargun",
     "prefixscan",
     "bump",
+    "midar",
   };
   if(d->method >= sizeof(m) / sizeof(char *) || m[d->method] == NULL)
     {
@@ -1047,6 +1038,7 @@ void scamper_dealias_free(scamper_dealias_t *dealias)
     dealias_radargun_free,
     dealias_prefixscan_free,
     dealias_bump_free,
+    dealias_midar_free,
   };
 
   uint32_t i;
@@ -1070,7 +1062,7 @@ void scamper_dealias_free(scamper_dealias_t *dealias)
   if(dealias->data != NULL)
     {
       assert(dealias->method != 0);
-      assert(dealias->method <= 5);
+      assert(dealias->method <= 6);
       func[dealias->method-1](dealias->data);
     }
 
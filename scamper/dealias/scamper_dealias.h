@@ -34,6 +34,7 @@
 #define SCAMPER_DEALIAS_METHOD_RADARGUN   3
 #define SCAMPER_DEALIAS_METHOD_PREFIXSCAN 4
 #define SCAMPER_DEALIAS_METHOD_BUMP       5
+#define SCAMPER_DEALIAS_METHOD_MIDAR      6
 
 #define SCAMPER_DEALIAS_PROBEDEF_METHOD_ICMP_ECHO     1
 #define SCAMPER_DEALIAS_PROBEDEF_METHOD_TCP_ACK       2
@@ -117,6 +118,9 @@
 #define SCAMPER_DEALIAS_METHOD_IS_BUMP(d) ( \
  (d)->method == SCAMPER_DEALIAS_METHOD_BUMP)
 
+#define SCAMPER_DEALIAS_METHOD_IS_MIDAR(d) ( \
+ (d)->method == SCAMPER_DEALIAS_METHOD_MIDAR)
+
 #define SCAMPER_DEALIAS_RESULT_IS_NONE(d) ( \
  (d)->result == SCAMPER_DEALIAS_RESULT_NONE)
 
@@ -292,6 +296,47 @@ typedef struct scamper_dealias_bump
   uint8_t                       attempts;
 } scamper_dealias_bump_t;
 
+/*
+ * scamper_dealias_midar
+ *
+ * resolve aliases among a set of IP addresses in the four stages of
+ * MIDAR, which was first defined in the following paper:
+ *
+ *   Internet-Scale IPv4 Alias Resolution with MIDAR.  Ken Keys, Young
+ *   Hyun, Matthew Luckie, and kc claffy.  IEEE/ACM Transactions on
+ *   Networking, 21(2), pages 383-399, 2013.
+ *
+ * the estimation stage probes every address to find those that assign
+ * IP-ID values from a counter, and how quickly.  the discovery stage
+ * probes those addresses in order of velocity, and tests each against
+ * the addresses that follow it with overlapping velocity.  the
+ * elimination and corroboration stages probe the candidate sets again,
+ * and only sets where every pair passes in the final stage are kept.
+ * each stage sends attempts rounds of probes; the seq value of each
+ * probe divided by attempts identifies the stage it was sent in.
+ *
+ * probedefs    : structures defining the form of a probe packet
+ * attempts     : number of rounds of probes in each stage
+ * wait_probe   : minimum length of time (ms) to wait between probes
+ * wait_timeout : minimum length of time (sec) to wait for a response
+ * window       : most addresses each address is compared with in discovery
+ * fudge        : how far IP-ID values out of order may be, 0 if any
+ * sets         : the alias set each probedef was placed in, zero if none
+ * setc         : the number of alias sets
+ */
+typedef struct scamper_dealias_midar
+{
+  scamper_dealias_probedef_t   *probedefs;
+  uint32_t                      probedefc;
+  uint16_t                      attempts;
+  uint16_t                      wait_probe;
+  uint8_t                       wait_timeout;
+  uint16_t                      window;
+  uint16_t                      fudge;
+  uint32_t                     *sets;
+  uint32_t                      setc;
+} scamper_dealias_midar_t;
+
 typedef struct scamper_dealias
 {
   scamper_list_t               *list;
@@ -341,6 +386,7 @@ int scamper_dealias_mercator_alloc(scamper_dealias_t *);
 int scamper_dealias_radargun_alloc(scamper_dealias_t *);
 int scamper_dealias_prefixscan_alloc(scamper_dealias_t *);
 int scamper_dealias_bump_alloc(scamper_dealias_t *);
+int scamper_dealias_midar_alloc(scamper_dealias_t *);
 
 /*
  * scamper_dealias_ipid_inseq
@@ -373,6 +419,10 @@ int scamper_dealias_radargun_fudge(scamper_dealias_t *,
 int scamper_dealias_radargun_probedefs_alloc(scamper_dealias_radargun_t *,
 					     uint32_t);
 
+int scamper_dealias_midar_probedefs_alloc(scamper_dealias_midar_t *,
+					  uint32_t);
+int scamper_dealias_midar_sets_alloc(scamper_dealias_midar_t *);
+
 #define SCAMPER_DEALIAS_IPID_UNKNOWN   0
 #define SCAMPER_DEALIAS_IPID_ZERO      1
 #define SCAMPER_DEALIAS_IPID_CONST     2
@@ -38,6 +38,7 @@
 #include "scamper_list.h"
 #include "scamper_icmpext.h"
 #include "scamper_dealias.h"
+#include "scamper_dealias_ipidseq.h"
 #include "scamper_task.h"
 #include "scamper_icmp_resp.h"
 #include "scamper_fds.h"
@@ -55,12 +56,16 @@
 #include "scamper_options.h"
 #include "scamper_debug.h"
 #include "scamper_dealias_do.h"
+#include "scamper_slab.h"
 #include "mjl_splaytree.h"
 #include "mjl_list.h"
 #include "utils.h"
 
 static scamper_task_funcs_t funcs;
 
+/* slab that dealias_probe_t records are allocated from */
+static scamper_slab_t *dp_slab = NULL;
+
 /* packet buffer for generating the payload of each packet */
 static uint8_t             *pktbuf     = NULL;
 static size_t               pktbuf_len = 0;
@@ -174,6 +179,41 @@ typedef struct dealias_bump
   uint16_t                     bump;
 } dealias_bump_t;
 
+typedef struct dealias_midar
+{
+  uint8_t                      stage;
+  uint32_t                    *order;  /* probedefs to probe in this stage */
+  uint32_t                     orderc;
+  uint32_t                    *lens;   /* lengths of candidate sets in order */
+  uint32_t                     lenc;
+  uint32_t                     i;      /* index into order */
+  uint32_t                     round;  /* round within this stage */
+  uint32_t                     probe0; /* first probe sent in this stage */
+  double                      *vlo;    /* velocity range of each probedef */
+  double                      *vhi;
+} dealias_midar_t;
+
+#define DEALIAS_MIDAR_STAGE_ESTIMATION    0
+#define DEALIAS_MIDAR_STAGE_DISCOVERY     1
+#define DEALIAS_MIDAR_STAGE_ELIMINATION   2
+#define DEALIAS_MIDAR_STAGE_CORROBORATION 3
+
+typedef struct dealias_midar_vel
+{
+  double                       lo;
+  uint32_t                     id;
+} dealias_midar_vel_t;
+
+/* most addresses that each address is compared with in discovery */
+#define DEALIAS_MIDAR_WINDOW 1000
+
+/*
+ * most addresses in a candidate set.  elimination and corroboration
+ * test every pair in a set, and corroboration keeps an n*n matrix of
+ * the results, so the bound keeps each set's work to a few milliseconds
+ */
+#define DEALIAS_MIDAR_SETMAX 100
+
 typedef struct dealias_options
 {
   char                        *addr;
@@ -280,6 +320,12 @@ static int dealias_ally_queue(const scamper_dealias_t *dealias,
   return 0;
 }
 
+static void dealias_probe_free(dealias_probe_t *dp)
+{
+  scamper_slab_put(&dp_slab, dp);
+  return;
+}
+
 static void dealias_queue(scamper_task_t *task)
 {
   static int (*const func[])(const scamper_dealias_t *, dealias_state_t *,
@@ -289,6 +335,7 @@ static void dealias_queue(scamper_task_t *task)
     NULL,
     NULL,
     NULL,
+    NULL,
   };
   scamper_dealias_t *dealias = dealias_getdata(task);
   dealias_state_t *state = dealias_getstate(task);
@@ -309,7 +356,7 @@ static void dealias_queue(scamper_task_t *task)
 	break;
       dlist_node_pop(p->target->probes, p->target_node);
       dlist_head_pop(state->recent_probes);
-      free(p);
+      dealias_probe_free(p);
     }
 
   if(slist_count(state->ptbq) > 0)
@@ -413,7 +460,7 @@ static void dealias_target_free(dealias_target_t *tgt)
   if(tgt == NULL)
     return;
   if(tgt->probes != NULL)
-    dlist_free_cb(tgt->probes, free);
+    dlist_free_cb(tgt->probes, (dlist_free_t)dealias_probe_free);
   if(tgt->addr != NULL)
     scamper_addr_free(tgt->addr);
   free(tgt);
@@ -1645,6 +1692,595 @@ static void dealias_bump_handlereply(scamper_task_t *task,
   return;
 }
 
+static dealias_probedef_t *
+dealias_midar_def(scamper_dealias_t *dealias, dealias_state_t *state)
+{
+  dealias_midar_t *ms = state->methodstate;
+  return state->pds[ms->order[ms->i]];
+}
+
+static int dealias_midar_postprobe(scamper_dealias_t *dealias,
+				   dealias_state_t *state)
+{
+  scamper_dealias_midar_t *midar = dealias->data;
+  dealias_midar_t *ms = state->methodstate;
+  struct timeval *tv = &state->last_tx;
+
+  if(++ms->i == ms->orderc)
+    {
+      ms->i = 0;
+      ms->round++;
+      state->round++;
+
+      /* wait for the last replies before analysing this stage */
+      if(ms->round == midar->attempts)
+	{
+	  timeval_add_s(&state->next_tx, tv, midar->wait_timeout);
+	  return 0;
+	}
+    }
+
+  timeval_add_ms(&state->next_tx, tv, midar->wait_probe);
+  return 0;
+}
+
+static uint32_t dealias_midar_find(uint32_t *parent, uint32_t x)
+{
+  while(parent[x] != x)
+    {
+      parent[x] = parent[parent[x]];
+      x = parent[x];
+    }
+  return x;
+}
+
+static void dealias_midar_union(uint32_t *parent, uint32_t x, uint32_t y)
+{
+  x = dealias_midar_find(parent, x);
+  y = dealias_midar_find(parent, y);
+  if(x < y)
+    parent[y] = x;
+  else if(y < x)
+    parent[x] = y;
+  return;
+}
+
+static int dealias_midar_key_cmp(const void *va, const void *vb)
+{
+  uint64_t a = *((const uint64_t *)va);
+  uint64_t b = *((const uint64_t *)vb);
+  if(a < b) return -1;
+  if(a > b) return  1;
+  return 0;
+}
+
+/*
+ * dealias_midar_group
+ *
+ * replace the probe order with the components of parent that have at
+ * least two members.  the members of each component are probed next to
+ * each other in the next stage, in the order they were probed before.
+ * transitive closure can chain together many addresses, so a component
+ * larger than DEALIAS_MIDAR_SETMAX is split into consecutive candidate
+ * sets of at most that size.
+ */
+static int dealias_midar_group(dealias_midar_t *ms, uint32_t *parent)
+{
+  uint32_t *size = NULL, *order = NULL, *lens = NULL, lenc = 0, c = 0, x, r;
+  uint64_t *keys = NULL;
+
+  if((size = malloc_zero(sizeof(uint32_t) * ms->orderc)) == NULL ||
+     (keys = malloc(sizeof(uint64_t) * ms->orderc)) == NULL)
+    {
+      printerror(__func__, "could not malloc size / keys");
+      goto err;
+    }
+
+  for(x=0; x<ms->orderc; x++)
+    size[dealias_midar_find(parent, x)]++;
+  for(x=0; x<ms->orderc; x++)
+    {
+      r = dealias_midar_find(parent, x);
+      if(size[r] > 1)
+	keys[c++] = ((uint64_t)r << 32) | x;
+    }
+
+  if(c > 0)
+    {
+      qsort(keys, c, sizeof(uint64_t), dealias_midar_key_cmp);
+      if((order = malloc(sizeof(uint32_t) * c)) == NULL ||
+	 (lens = malloc(sizeof(uint32_t) * c)) == NULL)
+	{
+	  printerror(__func__, "could not malloc order / lens");
+	  goto err;
+	}
+      for(x=0; x<c; x++)
+	{
+	  order[x] = ms->order[keys[x] & 0xFFFFFFFF];
+	  if(x == 0 || (keys[x] >> 32) != (keys[x-1] >> 32) ||
+	     lens[lenc-1] == DEALIAS_MIDAR_SETMAX)
+	    lens[lenc++] = 0;
+	  lens[lenc-1]++;
+	}
+    }
+
+  free(ms->order); ms->order = order; ms->orderc = c;
+  if(ms->lens != NULL) free(ms->lens);
+  ms->lens = lens; ms->lenc = lenc;
+  free(size);
+  free(keys);
+  return 0;
+
+ err:
+  if(size != NULL) free(size);
+  if(keys != NULL) free(keys);
+  if(order != NULL) free(order);
+  return -1;
+}
+
+/*
+ * dealias_midar_series
+ *
+ * collect the IP-ID values that each address in the probe order replied
+ * with in this stage.  an address that replied to fewer than half of
+ * the probes is left NULL, as there is too little to test.
+ */
+static int dealias_midar_series(const scamper_dealias_t *dealias,
+				const dealias_midar_t *ms, uint32_t mask,
+				scamper_dealias_ipidseq_t ***out)
+{
+  const scamper_dealias_midar_t *midar = dealias->data;
+  scamper_dealias_ipidseq_t **seqs = NULL;
+  scamper_dealias_probe_t *probe;
+  scamper_dealias_reply_t *reply;
+  uint32_t *pos = NULL, x, p, ipid;
+
+  if((seqs = malloc_zero(sizeof(scamper_dealias_ipidseq_t *) *
+			 ms->orderc)) == NULL ||
+     (pos = malloc(sizeof(uint32_t) * midar->probedefc)) == NULL)
+    {
+      printerror(__func__, "could not malloc seqs / pos");
+      goto err;
+    }
+  for(x=0; x<midar->probedefc; x++)
+    pos[x] = ms->orderc;
+  for(x=0; x<ms->orderc; x++)
+    {
+      pos[ms->order[x]] = x;
+      if((seqs[x] = scamper_dealias_ipidseq_alloc(midar->attempts)) == NULL)
+	{
+	  printerror(__func__, "could not alloc seq");
+	  goto err;
+	}
+    }
+
+  for(x=ms->probe0; x<dealias->probec; x++)
+    {
+      probe = dealias->probes[x];
+      if((p = pos[probe->def->id]) == ms->orderc || probe->replyc != 1)
+	continue;
+      reply = probe->replies[0];
+      if(SCAMPER_DEALIAS_REPLY_FROM_TARGET(probe, reply) == 0)
+	continue;
+      if(SCAMPER_ADDR_TYPE_IS_IPV4(probe->def->dst))
+	ipid = reply->ipid;
+      else if(reply->flags & SCAMPER_DEALIAS_REPLY_FLAG_IPID32)
+	ipid = reply->ipid32;
+      else
+	continue;
+      if(scamper_dealias_ipidseq_add(seqs[p], ipid, mask,
+				     &probe->tx, &reply->rx) != 0)
+	{
+	  printerror(__func__, "could not add ipid");
+	  goto err;
+	}
+    }
+
+  for(x=0; x<ms->orderc; x++)
+    {
+      if(seqs[x]->len * 2 < midar->attempts)
+	{
+	  scamper_dealias_ipidseq_free(seqs[x]);
+	  seqs[x] = NULL;
+	}
+    }
+
+  free(pos);
+  *out = seqs;
+  return 0;
+
+ err:
+  if(pos != NULL) free(pos);
+  if(seqs != NULL)
+    {
+      for(x=0; x<ms->orderc; x++)
+	if(seqs[x] != NULL)
+	  scamper_dealias_ipidseq_free(seqs[x]);
+      free(seqs);
+    }
+  return -1;
+}
+
+static int dealias_midar_vel_cmp(const void *va, const void *vb)
+{
+  const dealias_midar_vel_t *a = va, *b = vb;
+  if(a->lo < b->lo) return -1;
+  if(a->lo > b->lo) return  1;
+  if(a->id < b->id) return -1;
+  if(a->id > b->id) return  1;
+  return 0;
+}
+
+/*
+ * dealias_midar_estimation
+ *
+ * keep the addresses whose IP-ID values increase at a rate where the
+ * counter could not have wrapped between two samples, and order them
+ * by the lower bound of their velocity for the discovery stage.  the
+ * bounds on velocity use the earliest and latest time each IP-ID could
+ * have been assigned, and are widened in case the rate changes.
+ */
+static int dealias_midar_estimation(dealias_midar_t *ms, uint32_t mask,
+				    scamper_dealias_ipidseq_t **seqs)
+{
+  scamper_dealias_ipidseq_t *seq;
+  dealias_midar_vel_t *vels = NULL;
+  uint32_t *ipids = NULL, *order = NULL, x, k, c = 0;
+  int64_t gap, den;
+  double d, lo, hi;
+
+  if((vels = malloc(sizeof(dealias_midar_vel_t) * ms->orderc)) == NULL)
+    {
+      printerror(__func__, "could not malloc vels");
+      goto err;
+    }
+
+  for(x=0; x<ms->orderc; x++)
+    {
+      if((seq = seqs[x]) == NULL || seq->len < 3)
+	continue;
+
+      if(realloc_wrap((void **)&ipids, sizeof(uint32_t) * seq->len) != 0)
+	{
+	  printerror(__func__, "could not realloc ipids");
+	  goto err;
+	}
+      gap = 0;
+      for(k=0; k<seq->len; k++)
+	{
+	  ipids[k] = (uint32_t)seq->ipids[k];
+	  if(k > 0 && seq->tx[k] - seq->tx[k-1] > gap)
+	    gap = seq->tx[k] - seq->tx[k-1];
+	}
+      if(scamper_dealias_ipidseq_inseq(ipids, seq->len, mask, 0) == 0)
+	continue;
+
+      d = (double)(seq->ipids[seq->len-1] - seq->ipids[0]);
+      if((den = seq->tx[seq->len-1] - seq->rx[0]) <= 0)
+	continue;
+      lo = d * 1000000 / (seq->rx[seq->len-1] - seq->tx[0]);
+      hi = d * 1000000 / den;
+      if(hi * gap / 1000000 >= (double)(mask / 2))
+	continue;
+
+      ms->vlo[ms->order[x]] = lo * 0.8;
+      ms->vhi[ms->order[x]] = hi * 1.25;
+      vels[c].lo = ms->vlo[ms->order[x]];
+      vels[c].id = ms->order[x];
+      c++;
+    }
+
+  if(c > 0)
+    {
+      qsort(vels, c, sizeof(dealias_midar_vel_t), dealias_midar_vel_cmp);
+      if((order = malloc(sizeof(uint32_t) * c)) == NULL)
+	{
+	  printerror(__func__, "could not malloc order");
+	  goto err;
+	}
+      for(x=0; x<c; x++)
+	order[x] = vels[x].id;
+    }
+
+  free(ms->order);
+  ms->order = order;
+  ms->orderc = c;
+  free(vels);
+  if(ipids != NULL) free(ipids);
+  return 0;
+
+ err:
+  if(vels != NULL) free(vels);
+  if(ipids != NULL) free(ipids);
+  return -1;
+}
+
+/*
+ * dealias_midar_discovery
+ *
+ * the probe order is sorted by the lower bound of each address's
+ * velocity.  compare each address with those that follow it while their
+ * velocity ranges overlap, up to the window size, and group together
+ * the addresses that pass the monotonic bounds test.
+ */
+static int dealias_midar_discovery(const scamper_dealias_midar_t *midar,
+				   dealias_midar_t *ms, uint32_t mask,
+				   scamper_dealias_ipidseq_t **seqs)
+{
+  uint32_t *parent = NULL, x, y;
+  int rc = -1;
+
+  if((parent = malloc(sizeof(uint32_t) * ms->orderc)) == NULL)
+    {
+      printerror(__func__, "could not malloc parent");
+      goto done;
+    }
+  for(x=0; x<ms->orderc; x++)
+    parent[x] = x;
+
+  for(x=0; x<ms->orderc; x++)
+    {
+      if(seqs[x] == NULL)
+	continue;
+      for(y=x+1; y<ms->orderc && y-x <= midar->window; y++)
+	{
+	  if(ms->vlo[ms->order[y]] > ms->vhi[ms->order[x]])
+	    break;
+	  if(seqs[y] != NULL &&
+	     scamper_dealias_ipidseq_mbt(seqs[x], seqs[y], (uint64_t)mask + 1,
+					 midar->fudge) != 0)
+	    dealias_midar_union(parent, x, y);
+	}
+    }
+
+  rc = dealias_midar_group(ms, parent);
+
+ done:
+  if(parent != NULL) free(parent);
+  return rc;
+}
+
+/*
+ * dealias_midar_elimination
+ *
+ * test every pair of addresses within each candidate set, and keep the
+ * groups of addresses that are connected by pairs that pass.
+ */
+static int dealias_midar_elimination(const scamper_dealias_midar_t *midar,
+				     dealias_midar_t *ms, uint32_t mask,
+				     scamper_dealias_ipidseq_t **seqs)
+{
+  uint32_t *parent = NULL, s, x, y, l;
+  int rc = -1;
+
+  if((parent = malloc(sizeof(uint32_t) * ms->orderc)) == NULL)
+    {
+      printerror(__func__, "could not malloc parent");
+      goto done;
+    }
+  for(x=0; x<ms->orderc; x++)
+    parent[x] = x;
+
+  s = 0;
+  for(l=0; l<ms->lenc; l++)
+    {
+      for(x=s; x<s+ms->lens[l]; x++)
+	{
+	  if(seqs[x] == NULL)
+	    continue;
+	  for(y=x+1; y<s+ms->lens[l]; y++)
+	    if(seqs[y] != NULL &&
+	       scamper_dealias_ipidseq_mbt(seqs[x], seqs[y],
+					   (uint64_t)mask + 1,
+					   midar->fudge) != 0)
+	      dealias_midar_union(parent, x, y);
+	}
+      s += ms->lens[l];
+    }
+
+  rc = dealias_midar_group(ms, parent);
+
+ done:
+  if(parent != NULL) free(parent);
+  return rc;
+}
+
+/*
+ * dealias_midar_corroboration
+ *
+ * an alias set is only reported if every pair of addresses in it passes
+ * the monotonic bounds test.  within each candidate set, repeatedly drop
+ * the address that fails with the most others until the remainder all
+ * pass, report the remainder, and start again with the dropped addresses.
+ * with n at most DEALIAS_MIDAR_SETMAX, each set takes O(n^2) tests and
+ * O(n^3) steps in the worst case.
+ */
+static int dealias_midar_corroboration(scamper_dealias_midar_t *midar,
+				       dealias_midar_t *ms, uint32_t mask,
+				       scamper_dealias_ipidseq_t **seqs)
+{
+  uint8_t *pass = NULL, *left = NULL, *in = NULL;
+  uint32_t *fails = NULL, s, l, n, x, y, m, worst, leftc;
+  int rc = -1;
+
+  s = 0;
+  for(l=0; l<ms->lenc; l++)
+    {
+      n = ms->lens[l];
+      if(realloc_wrap((void **)&pass, n * n) != 0 ||
+	 realloc_wrap((void **)&left, n) != 0 ||
+	 realloc_wrap((void **)&in, n) != 0 ||
+	 realloc_wrap((void **)&fails, sizeof(uint32_t) * n) != 0)
+	{
+	  printerror(__func__, "could not realloc pairwise state");
+	  goto done;
+	}
+
+      for(x=0; x<n; x++)
+	{
+	  left[x] = seqs[s+x] != NULL ? 1 : 0;
+	  for(y=x+1; y<n; y++)
+	    {
+	      pass[(x*n)+y] = pass[(y*n)+x] =
+		(seqs[s+x] != NULL && seqs[s+y] != NULL &&
+		 scamper_dealias_ipidseq_mbt(seqs[s+x], seqs[s+y],
+					     (uint64_t)mask + 1,
+					     midar->fudge) != 0) ? 1 : 0;
+	    }
+	}
+
+      for(;;)
+	{
+	  leftc = 0;
+	  for(x=0; x<n; x++)
+	    {
+	      in[x] = left[x];
+	      leftc += left[x];
+	    }
+	  if(leftc < 2)
+	    break;
+
+	  for(x=0; x<n; x++)
+	    {
+	      fails[x] = 0;
+	      if(in[x] == 0)
+		continue;
+	      for(y=0; y<n; y++)
+		if(y != x && in[y] != 0 && pass[(x*n)+y] == 0)
+		  fails[x]++;
+	    }
+
+	  for(;;)
+	    {
+	      worst = n;
+	      for(x=0; x<n; x++)
+		if(in[x] != 0 && fails[x] > 0 &&
+		   (worst == n || fails[x] > fails[worst]))
+		  worst = x;
+	      if(worst == n)
+		break;
+	      in[worst] = 0;
+	      for(y=0; y<n; y++)
+		if(in[y] != 0 && y != worst && pass[(worst*n)+y] == 0)
+		  fails[y]--;
+	    }
+
+	  m = 0;
+	  for(x=0; x<n; x++)
+	    {
+	      if(in[x] == 0)
+		continue;
+	      left[x] = 0;
+	      m++;
+	    }
+	  if(m < 2)
+	    continue;
+
+	  if(midar->sets == NULL &&
+	     scamper_dealias_midar_sets_alloc(midar) != 0)
+	    {
+	      printerror(__func__, "could not alloc sets");
+	      goto done;
+	    }
+	  midar->setc++;
+	  for(x=0; x<n; x++)
+	    if(in[x] != 0)
+	      midar->sets[ms->order[s+x]] = midar->setc;
+	}
+
+      s += n;
+    }
+  rc = 0;
+
+ done:
+  if(pass != NULL) free(pass);
+  if(left != NULL) free(left);
+  if(in != NULL) free(in);
+  if(fails != NULL) free(fails);
+  return rc;
+}
+
+static void dealias_midar_handletimeout(scamper_task_t *task)
+{
+  scamper_dealias_t       *dealias = dealias_getdata(task);
+  dealias_state_t         *state   = dealias_getstate(task);
+  scamper_dealias_midar_t *midar   = dealias->data;
+  dealias_midar_t         *ms      = state->methodstate;
+  scamper_dealias_ipidseq_t **seqs = NULL;
+  uint32_t mask, x, orderc;
+  int rc = -1;
+
+  /* keep probing until the rounds for this stage are all sent */
+  if(ms->round < midar->attempts)
+    {
+      dealias_queue(task);
+      return;
+    }
+
+  if(SCAMPER_ADDR_TYPE_IS_IPV4(midar->probedefs[0].dst))
+    mask = 0xFFFF;
+  else
+    mask = 0xFFFFFFFF;
+
+  orderc = ms->orderc;
+  if(dealias_midar_series(dealias, ms, mask, &seqs) != 0)
+    goto err;
+
+  switch(ms->stage)
+    {
+    case DEALIAS_MIDAR_STAGE_ESTIMATION:
+      rc = dealias_midar_estimation(ms, mask, seqs);
+      break;
+    case DEALIAS_MIDAR_STAGE_DISCOVERY:
+      rc = dealias_midar_discovery(midar, ms, mask, seqs);
+      break;
+    case DEALIAS_MIDAR_STAGE_ELIMINATION:
+      rc = dealias_midar_elimination(midar, ms, mask, seqs);
+      break;
+    case DEALIAS_MIDAR_STAGE_CORROBORATION:
+      rc = dealias_midar_corroboration(midar, ms, mask, seqs);
+      break;
+    }
+
+  for(x=0; x<orderc; x++)
+    if(seqs[x] != NULL)
+      scamper_dealias_ipidseq_free(seqs[x]);
+  free(seqs);
+
+  if(rc != 0)
+    goto err;
+
+  if(ms->stage == DEALIAS_MIDAR_STAGE_CORROBORATION)
+    {
+      if(midar->setc > 0)
+	dealias_result(task, SCAMPER_DEALIAS_RESULT_ALIASES);
+      else
+	dealias_result(task, SCAMPER_DEALIAS_RESULT_NOTALIASES);
+      return;
+    }
+
+  /* there needs to be at least two addresses to compare */
+  if(ms->orderc < 2)
+    {
+      if(ms->stage == DEALIAS_MIDAR_STAGE_ESTIMATION)
+	dealias_result(task, SCAMPER_DEALIAS_RESULT_NONE);
+      else
+	dealias_result(task, SCAMPER_DEALIAS_RESULT_NOTALIASES);
+      return;
+    }
+
+  ms->stage++;
+  ms->round  = 0;
+  ms->i      = 0;
+  ms->probe0 = dealias->probec;
+  dealias_queue(task);
+  return;
+
+ err:
+  dealias_handleerror(task, errno);
+  return;
+}
+
 static void do_dealias_handle_dl(scamper_task_t *task, scamper_dl_rec_t *dl)
 {
   static void (*const func[])(scamper_task_t *, scamper_dealias_probe_t *,
@@ -1655,6 +2291,7 @@ static void do_dealias_handle_dl(scamper_task_t *task, scamper_dl_rec_t *dl)
     dealias_radargun_handlereply,
     dealias_prefixscan_handlereply,
     dealias_bump_handlereply,
+    dealias_radargun_handlereply,
   };
   scamper_dealias_probe_t *probe = NULL;
   scamper_dealias_reply_t *reply = NULL;
@@ -1774,6 +2411,8 @@ static void do_dealias_handle_dl(scamper_task_t *task, scamper_dl_rec_t *dl)
       scamper_debug(__func__, "could not add reply to probe");
       goto err;
     }
+  scamper_task_mem_add(task, sizeof(scamper_dealias_reply_t) +
+		       sizeof(scamper_dealias_reply_t *));
 
   if(func[dealias->method-1] != NULL)
     func[dealias->method-1](task, probe, reply, dl);
@@ -1796,6 +2435,7 @@ static void do_dealias_handle_icmp(scamper_task_t *task,scamper_icmp_resp_t *ir)
     NULL, /* radargun */
     dealias_prefixscan_handlereply,
     dealias_bump_handlereply,
+    NULL, /* midar */
   };
   scamper_dealias_probe_t *probe = NULL;
   scamper_dealias_reply_t *reply = NULL;
@@ -1897,6 +2537,8 @@ static void do_dealias_handle_icmp(scamper_task_t *task,scamper_icmp_resp_t *ir)
       scamper_debug(__func__, "could not add reply to probe");
       goto err;
     }
+  scamper_task_mem_add(task, sizeof(scamper_dealias_reply_t) +
+		       sizeof(scamper_dealias_reply_t *));
 
   if(func[dealias->method-1] != NULL)
     func[dealias->method-1](task, probe, reply, NULL);
@@ -1916,6 +2558,7 @@ static void do_dealias_handle_timeout(scamper_task_t *task)
     dealias_radargun_handletimeout,
     dealias_prefixscan_handletimeout,
     dealias_bump_handletimeout,
+    dealias_midar_handletimeout,
   };
   scamper_dealias_t *dealias = dealias_getdata(task);
   func[dealias->method-1](task);
@@ -1935,7 +2578,7 @@ static int dealias_state_probe(dealias_state_t *state,
   dealias_probe_t *dp = NULL;
 
   /* allocate a structure to record this probe's details */
-  if((dp = malloc_zero(sizeof(dealias_probe_t))) == NULL)
+  if((dp = scamper_slab_get(&dp_slab, sizeof(dealias_probe_t))) == NULL)
     {
       printerror(__func__, "could not malloc dealias_probe_t");
       goto err;
@@ -1960,7 +2603,7 @@ static int dealias_state_probe(dealias_state_t *state,
   return 0;
 
  err:
-  if(dp != NULL) free(dp);
+  if(dp != NULL) dealias_probe_free(dp);
   return -1;
 }
 
@@ -2096,6 +2739,45 @@ static void dealias_bump_free(void *data)
   return;
 }
 
+static void dealias_midar_free(void *data)
+{
+  dealias_midar_t *ms = data;
+  if(ms->order != NULL) free(ms->order);
+  if(ms->lens != NULL) free(ms->lens);
+  if(ms->vlo != NULL) free(ms->vlo);
+  if(ms->vhi != NULL) free(ms->vhi);
+  free(ms);
+  return;
+}
+
+static int dealias_midar_alloc(scamper_dealias_midar_t *midar,
+			       dealias_state_t *state)
+{
+  dealias_midar_t *ms = NULL;
+  uint32_t i;
+
+  if((ms = malloc_zero(sizeof(dealias_midar_t))) == NULL)
+    {
+      printerror(__func__, "could not malloc ms");
+      return -1;
+    }
+  state->methodstate = ms;
+
+  /* the estimation stage probes every address */
+  if((ms->order = malloc(sizeof(uint32_t) * midar->probedefc)) == NULL ||
+     (ms->vlo = malloc_zero(sizeof(double) * midar->probedefc)) == NULL ||
+     (ms->vhi = malloc_zero(sizeof(double) * midar->probedefc)) == NULL)
+    {
+      printerror(__func__, "could not malloc order / velocity");
+      return -1;
+    }
+  for(i=0; i<midar->probedefc; i++)
+    ms->order[i] = i;
+  ms->orderc = midar->probedefc;
+
+  return 0;
+}
+
 static void dealias_state_free(scamper_dealias_t *dealias,
 			       dealias_state_t *state)
 {
@@ -2115,6 +2797,8 @@ static void dealias_state_free(scamper_dealias_t *dealias,
 	dealias_radargun_free(state->methodstate);
       else if(SCAMPER_DEALIAS_METHOD_IS_BUMP(dealias))
 	dealias_bump_free(state->methodstate);
+      else if(SCAMPER_DEALIAS_METHOD_IS_MIDAR(dealias))
+	dealias_midar_free(state->methodstate);
     }
 
   if(state->targets != NULL)
@@ -2147,6 +2831,7 @@ static void do_dealias_probe(scamper_task_t *task)
     dealias_radargun_postprobe,
     dealias_prefixscan_postprobe,
     dealias_bump_postprobe,
+    dealias_midar_postprobe,
   };
   static dealias_probedef_t *(*const def_func[])(scamper_dealias_t *,
 						 dealias_state_t *) = {
@@ -2155,6 +2840,7 @@ static void do_dealias_probe(scamper_task_t *task)
     dealias_radargun_def,
     dealias_prefixscan_def,
     dealias_bump_def,
+    dealias_midar_def,
   };
   scamper_dealias_t *dealias = dealias_getdata(task);
   dealias_state_t *state = dealias_getstate(task);
@@ -2300,6 +2986,8 @@ static void do_dealias_probe(scamper_task_t *task)
       scamper_debug(__func__, "could not add probe to dealias data");
       goto err;
     }
+  scamper_task_mem_add(task, sizeof(scamper_dealias_probe_t) +
+		       sizeof(scamper_dealias_probe_t *));
 
   /* figure out how long to wait until sending the next probe */
   timeval_cpy(&state->last_tx, &probe.pr_tx);
@@ -2378,6 +3066,8 @@ static int dealias_arg_param_validate(int optid, char *param, long long *out)
 	tmp = SCAMPER_DEALIAS_METHOD_PREFIXSCAN;
       else if(strcasecmp(param, "bump") == 0)
 	tmp = SCAMPER_DEALIAS_METHOD_BUMP;
+      else if(strcasecmp(param, "midar") == 0)
+	tmp = SCAMPER_DEALIAS_METHOD_MIDAR;
       else
 	return -1;
       break;
@@ -2829,33 +3519,28 @@ static int dealias_alloc_ally(scamper_dealias_t *d, dealias_options_t *o)
   return -1;
 }
 
-static int dealias_alloc_radargun(scamper_dealias_t *d, dealias_options_t *o)
+/*
+ * dealias_alloc_probedefs
+ *
+ * build the probedefs for a method that probes a list of addresses.
+ * the user either specifies a probedef for each address, or a list of
+ * addresses with at most one probedef to use as a template.
+ */
+static int dealias_alloc_probedefs(dealias_options_t *o,
+				   scamper_dealias_probedef_t **out,
+				   uint32_t *outc)
 {
-  scamper_dealias_radargun_t *rg;
-  scamper_dealias_probedef_t *pd = NULL, pd0;
+  scamper_dealias_probedef_t *pd = NULL, *pdp, pd0;
   slist_t *pd_list = NULL;
   slist_node_t *sn;
-  uint32_t i, probedefc;
-  uint8_t flags = 0;
+  uint32_t i, probedefc = 0;
   char *a1, *a2;
-  int j, pdc = 0;
+  int pdc = 0;
 
   memset(&pd0, 0, sizeof(pd0));
 
-  if(o->xs != NULL || o->dport != 0 || o->sport != 0 ||
-     o->ttl != 0 || o->nobs != 0 || o->replyc != 0 || o->inseq != 0)
-    {
-      scamper_debug(__func__, "invalid parameters for radargun");
-      goto err;
-    }
-
   if(o->probedefs != NULL)
     pdc = slist_count(o->probedefs);
-  if(o->wait_probe == 0) o->wait_probe   = 150;
-  if(o->attempts == 0)   o->attempts     = 30;
-  if(o->wait_round == 0) o->wait_round   = pdc * o->wait_probe;
-  if(o->shuffle != 0)
-    flags |= SCAMPER_DEALIAS_RADARGUN_FLAG_SHUFFLE;
 
   if(pdc == 0)
     {
@@ -2868,7 +3553,7 @@ static int dealias_alloc_radargun(scamper_dealias_t *d, dealias_options_t *o)
     {
       if(dealias_probedef_args(&pd0, (char *)slist_head_item(o->probedefs))!=0)
 	{
-	  scamper_debug(__func__, "could not parse radargun probedef 0");
+	  scamper_debug(__func__, "could not parse probedef 0");
 	  goto err;
 	}
       if(pd0.dst != NULL || o->addr == NULL)
@@ -2882,9 +3567,10 @@ static int dealias_alloc_radargun(scamper_dealias_t *d, dealias_options_t *o)
     {
       if((pd = malloc_zero(pdc * sizeof(scamper_dealias_probedef_t))) == NULL)
 	{
-	  scamper_debug(__func__, "could not malloc radargun pd");
+	  printerror(__func__, "could not malloc pd");
 	  goto err;
 	}
+      probedefc = pdc;
 
       i = 0;
       for(sn=slist_head_node(o->probedefs); sn != NULL; sn=slist_node_next(sn))
@@ -2892,7 +3578,7 @@ static int dealias_alloc_radargun(scamper_dealias_t *d, dealias_options_t *o)
 	  if(dealias_probedef_args(&pd[i], (char *)slist_node_item(sn)) != 0 ||
 	     pd[i].dst == NULL)
 	    {
-	      scamper_debug(__func__, "could not parse radargun def %d", i);
+	      scamper_debug(__func__, "could not parse def %d", i);
 	      goto err;
 	    }
 	  if(i != 0 && pd[0].dst->type != pd[i].dst->type)
@@ -2903,7 +3589,6 @@ static int dealias_alloc_radargun(scamper_dealias_t *d, dealias_options_t *o)
 	  pd[i].id = i;
 	  i++;
 	}
-      probedefc = i;
     }
   else if(pdc < 2 && o->addr != NULL)
     {
@@ -2920,31 +3605,90 @@ static int dealias_alloc_radargun(scamper_dealias_t *d, dealias_options_t *o)
 	  if(pd0.dst == NULL)
 	    goto err;
 	  pd0.id = i++;
-	  if((pd = memdup(&pd0, sizeof(pd0))) == NULL ||
-	     slist_tail_push(pd_list, pd) == NULL)
+	  if((pdp = memdup(&pd0, sizeof(pd0))) == NULL)
 	    goto err;
 	  pd0.dst = NULL;
+	  if(slist_tail_push(pd_list, pdp) == NULL)
+	    {
+	      scamper_dealias_probedef_free(pdp);
+	      goto err;
+	    }
 	  if(a2 == NULL)
 	    break;
 	  a1 = a2;
 	}
+
       probedefc = slist_count(pd_list);
+      pd = malloc_zero(probedefc * sizeof(scamper_dealias_probedef_t));
+      if(pd == NULL)
+	{
+	  printerror(__func__, "could not malloc pd");
+	  probedefc = 0;
+	  goto err;
+	}
+      i = 0;
+      while((pdp = slist_head_pop(pd_list)) != NULL)
+	{
+	  memcpy(&pd[i++], pdp, sizeof(scamper_dealias_probedef_t));
+	  free(pdp);
+	}
+      slist_free(pd_list); pd_list = NULL;
     }
   else goto err;
 
-  if(scamper_dealias_radargun_alloc(d) != 0)
+  *out = pd;
+  *outc = probedefc;
+  return 0;
+
+ err:
+  if(pd != NULL)
     {
-      scamper_debug(__func__, "could not alloc radargun structure");
+      for(i=0; i<probedefc; i++)
+	if(pd[i].dst != NULL)
+	  scamper_addr_free(pd[i].dst);
+      free(pd);
+    }
+  if(pd_list != NULL)
+    slist_free_cb(pd_list, (slist_free_t)scamper_dealias_probedef_free);
+  if(pd0.dst != NULL)
+    scamper_addr_free(pd0.dst);
+  return -1;
+}
+
+static int dealias_alloc_radargun(scamper_dealias_t *d, dealias_options_t *o)
+{
+  scamper_dealias_radargun_t *rg;
+  scamper_dealias_probedef_t *pd = NULL;
+  uint32_t i, probedefc = 0;
+  uint8_t flags = 0;
+  int pdc = 0;
+
+  if(o->xs != NULL || o->dport != 0 || o->sport != 0 ||
+     o->ttl != 0 || o->nobs != 0 || o->replyc != 0 || o->inseq != 0)
+    {
+      scamper_debug(__func__, "invalid parameters for radargun");
       goto err;
     }
-  rg = d->data;
 
-  if(scamper_dealias_radargun_probedefs_alloc(rg, probedefc) != 0)
+  if(o->probedefs != NULL)
+    pdc = slist_count(o->probedefs);
+  if(o->wait_probe == 0) o->wait_probe   = 150;
+  if(o->attempts == 0)   o->attempts     = 30;
+  if(o->wait_round == 0) o->wait_round   = pdc * o->wait_probe;
+  if(o->shuffle != 0)
+    flags |= SCAMPER_DEALIAS_RADARGUN_FLAG_SHUFFLE;
+
+  if(dealias_alloc_probedefs(o, &pd, &probedefc) != 0)
+    goto err;
+
+  if(scamper_dealias_radargun_alloc(d) != 0)
     {
-      scamper_debug(__func__, "could not alloc radargun probedefs");
+      scamper_debug(__func__, "could not alloc radargun structure");
       goto err;
     }
+  rg = d->data;
 
+  rg->probedefs    = pd; pd = NULL;
   rg->attempts     = o->attempts;
   rg->wait_probe   = o->wait_probe;
   rg->wait_timeout = o->wait_timeout;
@@ -2952,37 +3696,16 @@ static int dealias_alloc_radargun(scamper_dealias_t *d, dealias_options_t *o)
   rg->probedefc    = probedefc;
   rg->flags        = flags;
 
-  if(pd_list == NULL)
-    {
-      for(j=0; j<pdc; j++)
-	memcpy(&rg->probedefs[j], &pd[j], sizeof(scamper_dealias_probedef_t));
-    }
-  else
-    {
-      i=0;
-      while((pd = slist_head_pop(pd_list)) != NULL)
-	{
-	  memcpy(&rg->probedefs[i], pd, sizeof(scamper_dealias_probedef_t));
-	  free(pd);
-	  i++;
-	}
-      slist_free(pd_list); pd_list = NULL;
-    }
-
   return 0;
 
  err:
   if(pd != NULL)
     {
-      for(j=0; j<pdc; j++)
-	if(pd[j].dst != NULL)
-	  scamper_addr_free(pd[j].dst);
+      for(i=0; i<probedefc; i++)
+	if(pd[i].dst != NULL)
+	  scamper_addr_free(pd[i].dst);
       free(pd);
     }
-  if(pd_list != NULL)
-    slist_free_cb(pd_list, (slist_free_t)scamper_dealias_probedef_free);
-  if(pd0.dst != NULL)
-    scamper_addr_free(pd0.dst);
   return -1;
 }
 
@@ -3188,6 +3911,74 @@ static int dealias_alloc_bump(scamper_dealias_t *d, dealias_options_t *o)
   return -1;
 }
 
+static int dealias_alloc_midar(scamper_dealias_t *d, dealias_options_t *o)
+{
+  scamper_dealias_midar_t *midar;
+  scamper_dealias_probedef_t *pd = NULL;
+  uint32_t i, probedefc = 0;
+
+  if(o->xs != NULL || o->dport != 0 || o->sport != 0 || o->ttl != 0 ||
+     o->nobs != 0 || o->replyc != 0 || o->inseq != 0 || o->shuffle != 0 ||
+     o->wait_round != 0)
+    {
+      scamper_debug(__func__, "invalid parameters for midar");
+      goto err;
+    }
+
+  if(o->wait_probe == 0) o->wait_probe = 10;
+  if(o->attempts == 0)   o->attempts   = 10;
+
+  if(o->attempts < 3)
+    {
+      scamper_debug(__func__, "need at least three attempts for midar");
+      goto err;
+    }
+
+  if(dealias_alloc_probedefs(o, &pd, &probedefc) != 0)
+    goto err;
+
+  if(probedefc < 2)
+    {
+      scamper_debug(__func__, "need at least two addresses for midar");
+      goto err;
+    }
+  for(i=1; i<probedefc; i++)
+    {
+      if(pd[0].dst->type != pd[i].dst->type)
+	{
+	  scamper_debug(__func__, "mixed address families");
+	  goto err;
+	}
+    }
+
+  if(scamper_dealias_midar_alloc(d) != 0)
+    {
+      scamper_debug(__func__, "could not alloc midar structure");
+      goto err;
+    }
+  midar = d->data;
+
+  midar->probedefs    = pd; pd = NULL;
+  midar->probedefc    = probedefc;
+  midar->attempts     = o->attempts;
+  midar->wait_probe   = o->wait_probe;
+  midar->wait_timeout = o->wait_timeout;
+  midar->window       = DEALIAS_MIDAR_WINDOW;
+  midar->fudge        = o->fudge;
+
+  return 0;
+
+ err:
+  if(pd != NULL)
+    {
+      for(i=0; i<probedefc; i++)
+	if(pd[i].dst != NULL)
+	  scamper_addr_free(pd[i].dst);
+      free(pd);
+    }
+  return -1;
+}
+
 
 /*
  * scamper_do_dealias_alloc
@@ -3204,6 +3995,7 @@ void *scamper_do_dealias_alloc(char *str)
     dealias_alloc_radargun,
     dealias_alloc_prefixscan,
     dealias_alloc_bump,
+    dealias_alloc_midar,
   };
   scamper_option_out_t *opts_out = NULL, *opt;
   scamper_dealias_t *dealias = NULL;
@@ -3411,6 +4203,7 @@ scamper_task_t *scamper_do_dealias_alloctask(void *data,
   scamper_dealias_radargun_t    *radargun;
   scamper_dealias_ally_t        *ally;
   scamper_dealias_bump_t        *bump;
+  scamper_dealias_midar_t       *midar;
   dealias_prefixscan_t          *pfstate;
   uint32_t p;
   int i;
@@ -3486,6 +4279,18 @@ scamper_task_t *scamper_do_dealias_alloctask(void *data,
       if(dealias_bump_alloc(state) != 0)
 	goto err;
     }
+  else if(dealias->method == SCAMPER_DEALIAS_METHOD_MIDAR)
+    {
+      midar = dealias->data;
+      for(p=0; p<midar->probedefc; p++)
+	if(probedef2sig(task, &midar->probedefs[p]) != 0)
+	  goto err;
+
+      state->probedefs = midar->probedefs;
+      state->probedefc = midar->probedefc;
+      if(dealias_midar_alloc(midar, state) != 0)
+	goto err;
+    }
   else goto err;
 
   for(p=0; p<state->probedefc; p++)
@@ -3535,6 +4340,7 @@ int scamper_do_dealias_init(void)
   funcs.handle_dl              = do_dealias_handle_dl;
   funcs.write                  = do_dealias_write;
   funcs.task_free              = do_dealias_free;
+  funcs.name                   = "dealias";
   funcs.halt                   = do_dealias_halt;
 
   return 0;
@@ -0,0 +1,244 @@
+/*
+ * scamper_dealias_ipidseq.c
+ *
+ * $Id$
+ *
+ * Copyright (C) 2026 Matthew Luckie
+ * Author: Matthew Luckie
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include "internal.h"
+
+#include "scamper_dealias_ipidseq.h"
+#include "utils.h"
+
+/*
+ * number of triples the inseq kernel checks before deciding whether to
+ * stop.  the loop over a block has no early exit, which allows the
+ * compiler to vectorise it.
+ */
+#define IPIDSEQ_BLOCK 64
+
+int scamper_dealias_ipidseq_inseq2(uint32_t a, uint32_t b,
+				   uint32_t mask, uint32_t fudge)
+{
+  uint32_t d = (b - a) & mask;
+  if(d == 0 || d > fudge)
+    return 0;
+  return 1;
+}
+
+/*
+ * with d1 = b - a and d2 = c - a, both taken modulo the width of the
+ * counter, the three values are increasing when 0 < d1 < d2.  that
+ * covers the cases where the counter wraps between a and b, or between
+ * b and c, and rejects any two values that are the same.
+ */
+int scamper_dealias_ipidseq_inseq3(uint32_t a, uint32_t b, uint32_t c,
+				   uint32_t mask, uint32_t fudge)
+{
+  uint32_t d1 = (b - a) & mask;
+  uint32_t d2 = (c - a) & mask;
+
+  if(d1 == 0 || d1 >= d2)
+    return 0;
+  if(fudge != 0 && (d1 > fudge || d2 - d1 > fudge))
+    return 0;
+  return 1;
+}
+
+int scamper_dealias_ipidseq_inseq(const uint32_t *ipids, size_t len,
+				  uint32_t mask, uint32_t fudge)
+{
+  uint32_t d1, d2, bad, f;
+  size_t i, j, n;
+
+  /* a fudge of zero means no limit, and no step is larger than mask */
+  f = (fudge == 0 || fudge > mask) ? mask : fudge;
+
+  for(i=0; i+2 < len; i += n)
+    {
+      if((n = len - 2 - i) > IPIDSEQ_BLOCK)
+	n = IPIDSEQ_BLOCK;
+      bad = 0;
+      for(j=i; j<i+n; j++)
+	{
+	  d1 = (ipids[j+1] - ipids[j]) & mask;
+	  d2 = (ipids[j+2] - ipids[j]) & mask;
+	  bad |= (d1 == 0) | (d1 >= d2) | (d1 > f) | (d2 - d1 > f);
+	}
+      if(bad != 0)
+	return 0;
+    }
+
+  return 1;
+}
+
+static int64_t timeval_usec(const struct timeval *tv)
+{
+  return ((int64_t)tv->tv_sec * 1000000) + tv->tv_usec;
+}
+
+int scamper_dealias_ipidseq_add(scamper_dealias_ipidseq_t *seq,
+				uint32_t ipid, uint32_t mask,
+				const struct timeval *tx,
+				const struct timeval *rx)
+{
+  uint64_t last;
+  size_t len;
+
+  if(seq->len == seq->size)
+    {
+      len = seq->size * 2;
+      if(len == 0)
+	len = 8;
+      if(realloc_wrap((void **)&seq->ipids, sizeof(uint64_t) * len) != 0 ||
+	 realloc_wrap((void **)&seq->tx, sizeof(int64_t) * len) != 0 ||
+	 realloc_wrap((void **)&seq->rx, sizeof(int64_t) * len) != 0)
+	return -1;
+      seq->size = len;
+    }
+
+  /* move forward from the previous sample, wrapping if necessary */
+  if(seq->len > 0)
+    {
+      last = seq->ipids[seq->len-1];
+      seq->ipids[seq->len] = last + ((ipid - (uint32_t)last) & mask);
+    }
+  else seq->ipids[seq->len] = ipid & mask;
+
+  seq->tx[seq->len] = timeval_usec(tx);
+  seq->rx[seq->len] = timeval_usec(rx);
+  seq->len++;
+
+  return 0;
+}
+
+int scamper_dealias_ipidseq_velocity(const scamper_dealias_ipidseq_t *seq,
+				     double *velocity)
+{
+  double tm = 0, ym = 0, num = 0, den = 0, t, y;
+  size_t i;
+
+  if(seq->len < 2)
+    return -1;
+
+  /* work relative to the first sample to keep the sums small */
+  for(i=0; i<seq->len; i++)
+    {
+      tm += (double)(seq->tx[i] - seq->tx[0]);
+      ym += (double)(seq->ipids[i] - seq->ipids[0]);
+    }
+  tm /= seq->len;
+  ym /= seq->len;
+
+  for(i=0; i<seq->len; i++)
+    {
+      t = (double)(seq->tx[i] - seq->tx[0]) - tm;
+      y = (double)(seq->ipids[i] - seq->ipids[0]) - ym;
+      num += t * y;
+      den += t * t;
+    }
+
+  if(den == 0)
+    return -1;
+
+  *velocity = num * 1000000 / den;
+  return 0;
+}
+
+int scamper_dealias_ipidseq_mbt(const scamper_dealias_ipidseq_t *a,
+				const scamper_dealias_ipidseq_t *b,
+				uint64_t wrap, uint64_t fudge)
+{
+  const scamper_dealias_ipidseq_t *seqs[2];
+  uint64_t off[2], ipid, last_ipid = 0;
+  int64_t last_rx = 0;
+  size_t x[2];
+  int s, last = -1, wrapped = 0;
+
+  seqs[0] = a; seqs[1] = b;
+  off[0] = off[1] = 0;
+  x[0] = x[1] = 0;
+
+  while(x[0] < a->len || x[1] < b->len)
+    {
+      /* take the next sample in transmit order */
+      if(x[1] == b->len || (x[0] < a->len && a->tx[x[0]] <= b->tx[x[1]]))
+	s = 0;
+      else
+	s = 1;
+
+      ipid = seqs[s]->ipids[x[s]];
+
+      if(last != -1 && last != s)
+	{
+	  if(wrapped == 0)
+	    {
+	      if(last_ipid > ipid)
+		off[s] = wrap;
+	      wrapped = 1;
+	    }
+	  ipid += off[s];
+
+	  if(last_ipid >= ipid &&
+	     ((fudge != 0 && last_ipid >= ipid + fudge) ||
+	      seqs[s]->tx[x[s]] > last_rx))
+	    return 0;
+	}
+      else ipid += off[s];
+
+      last_ipid = ipid;
+      last_rx = seqs[s]->rx[x[s]];
+      last = s;
+      x[s]++;
+    }
+
+  return 1;
+}
+
+void scamper_dealias_ipidseq_free(scamper_dealias_ipidseq_t *seq)
+{
+  if(seq == NULL)
+    return;
+  if(seq->ipids != NULL) free(seq->ipids);
+  if(seq->tx != NULL) free(seq->tx);
+  if(seq->rx != NULL) free(seq->rx);
+  free(seq);
+  return;
+}
+
+scamper_dealias_ipidseq_t *scamper_dealias_ipidseq_alloc(size_t size)
+{
+  scamper_dealias_ipidseq_t *seq;
+
+  if((seq = malloc_zero(sizeof(scamper_dealias_ipidseq_t))) == NULL)
+    return NULL;
+  if(size > 0 &&
+     ((seq->ipids = malloc(sizeof(uint64_t) * size)) == NULL ||
+      (seq->tx = malloc(sizeof(int64_t) * size)) == NULL ||
+      (seq->rx = malloc(sizeof(int64_t) * size)) == NULL))
+    {
+      scamper_dealias_ipidseq_free(seq);
+      return NULL;
+    }
+  seq->size = size;
+  return seq;
+}
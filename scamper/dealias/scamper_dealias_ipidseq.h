@@ -0,0 +1,109 @@
+/*
+ * scamper_dealias_ipidseq.h
+ *
+ * $Id$
+ *
+ * Copyright (C) 2026 Matthew Luckie
+ * Author: Matthew Luckie
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __SCAMPER_DEALIAS_IPIDSEQ_H
+#define __SCAMPER_DEALIAS_IPIDSEQ_H
+
+/*
+ * routines to classify IPID time series.  IPID values are passed with
+ * a mask that says how wide the field is: 0xFFFF for the 16-bit IPv4
+ * field, and 0xFFFFFFFF for the 32-bit value in an IPv6 fragment
+ * header.  none of these routines keep state between calls, so they
+ * may be used from many threads at once.
+ */
+
+/*
+ * scamper_dealias_ipidseq_inseq2
+ *
+ * return 1 if b could follow a from the same counter, i.e. it is
+ * different and no more than fudge values ahead.
+ */
+int scamper_dealias_ipidseq_inseq2(uint32_t a, uint32_t b,
+				   uint32_t mask, uint32_t fudge);
+
+/*
+ * scamper_dealias_ipidseq_inseq3
+ *
+ * return 1 if a, b, c are increasing, allowing for the counter to
+ * wrap once.  if fudge is not zero, neither step may be larger.
+ */
+int scamper_dealias_ipidseq_inseq3(uint32_t a, uint32_t b, uint32_t c,
+				   uint32_t mask, uint32_t fudge);
+
+/*
+ * scamper_dealias_ipidseq_inseq
+ *
+ * return 1 if every three consecutive values in the array pass the
+ * inseq3 test.
+ */
+int scamper_dealias_ipidseq_inseq(const uint32_t *ipids, size_t len,
+				  uint32_t mask, uint32_t fudge);
+
+/*
+ * scamper_dealias_ipidseq_t
+ *
+ * a series of IPID samples from one address, in the order the probes
+ * were sent.  the IPID values are unwrapped as they are added so that
+ * they always increase, and times are in microseconds.
+ */
+typedef struct scamper_dealias_ipidseq
+{
+  uint64_t         *ipids;
+  int64_t          *tx;
+  int64_t          *rx;
+  size_t            len;
+  size_t            size;
+} scamper_dealias_ipidseq_t;
+
+scamper_dealias_ipidseq_t *scamper_dealias_ipidseq_alloc(size_t size);
+void scamper_dealias_ipidseq_free(scamper_dealias_ipidseq_t *seq);
+
+int scamper_dealias_ipidseq_add(scamper_dealias_ipidseq_t *seq,
+				uint32_t ipid, uint32_t mask,
+				const struct timeval *tx,
+				const struct timeval *rx);
+
+/*
+ * scamper_dealias_ipidseq_velocity
+ *
+ * least squares estimate of how quickly the counter moves, in values
+ * per second.  returns -1 if there are not two distinct transmit times.
+ */
+int scamper_dealias_ipidseq_velocity(const scamper_dealias_ipidseq_t *seq,
+				     double *velocity);
+
+/*
+ * scamper_dealias_ipidseq_mbt
+ *
+ * monotonic bounds test: merge the two series in transmit order and
+ * return 1 if the samples could have come from one counter.  the second
+ * series to appear is moved up by wrap if its first sample is less
+ * than the sample before it.  samples out of order are allowed if they
+ * are less than fudge apart, or any distance if fudge is zero, when the
+ * probe was sent before the earlier reply was received.
+ */
+int scamper_dealias_ipidseq_mbt(const scamper_dealias_ipidseq_t *a,
+				const scamper_dealias_ipidseq_t *b,
+				uint64_t wrap, uint64_t fudge);
+
+#endif /* __SCAMPER_DEALIAS_IPIDSEQ_H */
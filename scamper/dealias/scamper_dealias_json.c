@@ -69,6 +69,7 @@ static char *dealias_header_tostr(const scamper_dealias_t *dealias)
   scamper_dealias_radargun_t *rg;
   scamper_dealias_prefixscan_t *pf;
   scamper_dealias_bump_t *bump;
+  scamper_dealias_midar_t *midar;
   char buf[512], tmp[64];
   size_t off = 0;
   uint16_t u16;
@@ -156,11 +157,22 @@ static char *dealias_header_tostr(const scamper_dealias_t *dealias)
 		    ", \"wait_probe\":%u, \"bump_limit\":%u, \"attempts\":%u",
 		    bump->wait_probe, bump->bump_limit, bump->attempts);
     }
+  else if(SCAMPER_DEALIAS_METHOD_IS_MIDAR(dealias))
+    {
+      midar = dealias->data;
+      string_concat(buf, sizeof(buf), &off,
+		    ", \"attempts\":%u, \"wait_probe\":%u, \"wait_timeout\":%u",
+		    midar->attempts, midar->wait_probe, midar->wait_timeout);
+      string_concat(buf, sizeof(buf), &off,
+		    ", \"window\":%u, \"fudge\":%u, \"setc\":%u",
+		    midar->window, midar->fudge, midar->setc);
+    }
 
   return strdup(buf);
 }
 
-static char *dealias_probedef_tostr(const scamper_dealias_probedef_t *def)
+static char *dealias_probedef_tostr(const scamper_dealias_probedef_t *def,
+				    uint32_t set)
 {
   char buf[256], tmp[64];
   size_t off = 0;
@@ -185,6 +197,8 @@ static char *dealias_probedef_tostr(const scamper_dealias_probedef_t *def)
 		  def->un.tcp.sport, def->un.tcp.dport, def->un.tcp.flags);
   if(def->mtu > 0)
     string_concat(buf, sizeof(buf), &off, ", \"mtu\":%u", def->mtu);
+  if(set > 0)
+    string_concat(buf, sizeof(buf), &off, ", \"set\":%u", set);
   string_concat(buf, sizeof(buf), &off, "}");
   return strdup(buf);
 }
@@ -197,6 +211,7 @@ static int dealias_probedefs_get(const scamper_dealias_t *dealias,
   scamper_dealias_radargun_t *rg;
   scamper_dealias_prefixscan_t *pf;
   scamper_dealias_bump_t *bump;
+  scamper_dealias_midar_t *midar;
 
   switch(dealias->method)
     {
@@ -225,6 +240,11 @@ static int dealias_probedefs_get(const scamper_dealias_t *dealias,
       *defs = bump->probedefs; *defc = 2;
       break;
 
+    case SCAMPER_DEALIAS_METHOD_MIDAR:
+      midar = dealias->data;
+      *defs = midar->probedefs; *defc = midar->probedefc;
+      break;
+
     default:
       return -1;
     }
@@ -347,6 +367,8 @@ int scamper_file_json_dealias_write(const scamper_file_t *sf,
   int       i, rc       = -1;
   uint32_t  j;
   scamper_dealias_probedef_t *defs = NULL;
+  scamper_dealias_midar_t *midar;
+  uint32_t *sets = NULL;
   int defc = 0;
 
   /* get the header string */
@@ -361,10 +383,15 @@ int scamper_file_json_dealias_write(const scamper_file_t *sf,
      (pd_lens = malloc_zero(sizeof(size_t) * defc)) == NULL)
     goto cleanup;
   len += 16; /* , "probedefs":[] */
+  if(SCAMPER_DEALIAS_METHOD_IS_MIDAR(dealias))
+    {
+      midar = dealias->data;
+      sets = midar->sets;
+    }
   for(i=0; i<defc; i++)
     {
       if(i > 0) len += 2; /* , */
-      pds[i] = dealias_probedef_tostr(&defs[i]);
+      pds[i] = dealias_probedef_tostr(&defs[i], sets != NULL ? sets[i] : 0);
       pd_lens[i] = strlen(pds[i]);
       len += pd_lens[i];
     }
@@ -34,6 +34,59 @@
 #include "scamper_dealias_text.h"
 #include "utils.h"
 
+/*
+ * dealias_midar_write
+ *
+ * write each alias set that midar found on a line of its own, with the
+ * addresses separated by spaces.
+ */
+static int dealias_midar_write(int fd, const scamper_dealias_midar_t *midar)
+{
+  uint32_t *start = NULL, *ids = NULL, i, s;
+  char *buf = NULL, a[64];
+  size_t off, len;
+  int rc = -1;
+
+  if(midar->setc == 0 || midar->sets == NULL)
+    return 0;
+
+  if((start = malloc_zero(sizeof(uint32_t) * (midar->setc + 2))) == NULL ||
+     (ids = malloc(sizeof(uint32_t) * midar->probedefc)) == NULL)
+    goto done;
+
+  /* order the probedefs by the set they were placed in */
+  for(i=0; i<midar->probedefc; i++)
+    if(midar->sets[i] != 0)
+      start[midar->sets[i]+1]++;
+  for(s=1; s<midar->setc+2; s++)
+    start[s] += start[s-1];
+  for(i=0; i<midar->probedefc; i++)
+    if(midar->sets[i] != 0)
+      ids[start[midar->sets[i]]++] = i;
+
+  /* set s is now found between start[s-1] and start[s] */
+  for(s=1; s<=midar->setc; s++)
+    {
+      len = ((start[s] - start[s-1]) * sizeof(a)) + 2;
+      if(realloc_wrap((void **)&buf, len) != 0)
+	goto done;
+      off = 0;
+      for(i=start[s-1]; i<start[s]; i++)
+	string_concat(buf, len, &off, "%s%s", i != start[s-1] ? " " : "",
+		      scamper_addr_tostr(midar->probedefs[ids[i]].dst,
+					 a, sizeof(a)));
+      string_concat(buf, len, &off, "\n");
+      write_wrap(fd, buf, NULL, off);
+    }
+  rc = 0;
+
+ done:
+  if(start != NULL) free(start);
+  if(ids != NULL) free(ids);
+  if(buf != NULL) free(buf);
+  return rc;
+}
+
 int scamper_file_text_dealias_write(const scamper_file_t *sf,
 				    const scamper_dealias_t *dealias)
 {
@@ -60,5 +113,9 @@ int scamper_file_text_dealias_write(const scamper_file_t *sf,
 
       write_wrap(fd, buf, NULL, strlen(buf));
     }
+  else if(SCAMPER_DEALIAS_METHOD_IS_MIDAR(dealias))
+    {
+      return dealias_midar_write(fd, dealias->data);
+    }
   return 0;
 }
@@ -146,6 +146,26 @@ static const warts_var_t dealias_bump_vars[] =
 };
 #define dealias_bump_vars_mfb WARTS_VAR_MFB(dealias_bump_vars)
 
+#define WARTS_DEALIAS_MIDAR_PROBEDEFC    1
+#define WARTS_DEALIAS_MIDAR_ATTEMPTS     2
+#define WARTS_DEALIAS_MIDAR_WAIT_PROBE   3
+#define WARTS_DEALIAS_MIDAR_WAIT_TIMEOUT 4
+#define WARTS_DEALIAS_MIDAR_WINDOW       5
+#define WARTS_DEALIAS_MIDAR_FUDGE        6
+#define WARTS_DEALIAS_MIDAR_SETC         7
+
+static const warts_var_t dealias_midar_vars[] =
+{
+  {WARTS_DEALIAS_MIDAR_PROBEDEFC,    4, -1},
+  {WARTS_DEALIAS_MIDAR_ATTEMPTS,     2, -1},
+  {WARTS_DEALIAS_MIDAR_WAIT_PROBE,   2, -1},
+  {WARTS_DEALIAS_MIDAR_WAIT_TIMEOUT, 1, -1},
+  {WARTS_DEALIAS_MIDAR_WINDOW,       2, -1},
+  {WARTS_DEALIAS_MIDAR_FUDGE,        2, -1},
+  {WARTS_DEALIAS_MIDAR_SETC,         4, -1},
+};
+#define dealias_midar_vars_mfb WARTS_VAR_MFB(dealias_midar_vars)
+
 #define WARTS_DEALIAS_PROBEDEF_DST_GID    1
 #define WARTS_DEALIAS_PROBEDEF_SRC_GID    2
 #define WARTS_DEALIAS_PROBEDEF_ID         3
@@ -900,6 +920,199 @@ static void warts_dealias_radargun_write(const void *data,
   return;
 }
 
+/*
+ * warts_dealias_midar_setcount
+ *
+ * the number of probedefs that were placed in an alias set.  these are
+ * recorded after the probedefs as (probedef id, set id) pairs, as there
+ * can be too many to fit in the record's parameters.
+ */
+static uint32_t warts_dealias_midar_setcount(const scamper_dealias_midar_t *m)
+{
+  uint32_t i, c = 0;
+  if(m->setc == 0 || m->sets == NULL)
+    return 0;
+  for(i=0; i<m->probedefc; i++)
+    if(m->sets[i] != 0)
+      c++;
+  return c;
+}
+
+static int warts_dealias_midar_state(const scamper_file_t *sf,
+				     const void *data,
+				     warts_dealias_data_t *state,
+				     warts_addrtable_t *table, uint32_t *len)
+{
+  const scamper_dealias_midar_t *midar = data;
+  const warts_var_t *var;
+  int max_id = 0;
+  size_t size;
+  uint32_t i;
+
+  if(midar->probedefc == 0)
+    return -1;
+
+  size = midar->probedefc * sizeof(warts_dealias_probedef_t);
+  if((state->probedefs = malloc_zero(size)) == NULL)
+    return -1;
+
+  memset(state->flags, 0, dealias_midar_vars_mfb);
+  state->params_len = 0;
+
+  for(i=0; i<sizeof(dealias_midar_vars)/sizeof(warts_var_t); i++)
+    {
+      var = &dealias_midar_vars[i];
+      if((var->id == WARTS_DEALIAS_MIDAR_FUDGE && midar->fudge == 0) ||
+	 (var->id == WARTS_DEALIAS_MIDAR_SETC && midar->setc == 0))
+	continue;
+
+      flag_set(state->flags, var->id, &max_id);
+      assert(var->size >= 0);
+      state->params_len += var->size;
+    }
+
+  state->flags_len = fold_flags(state->flags, max_id);
+
+  for(i=0; i<midar->probedefc; i++)
+    {
+      if(warts_dealias_probedef_params(sf, &midar->probedefs[i],
+				       &state->probedefs[i], table, len) != 0)
+	{
+	  return -1;
+	}
+    }
+
+  /* increase length required for the midar record */
+  *len += state->flags_len + state->params_len;
+  if(state->params_len != 0) *len += 2;
+
+  /* the number of alias set members, then each member and its set */
+  if(midar->setc != 0)
+    *len += 4 + (warts_dealias_midar_setcount(midar) * 8);
+
+  return 0;
+}
+
+static int warts_dealias_midar_read(scamper_dealias_t *dealias,
+				    warts_state_t *state,
+				    warts_addrtable_t *table,
+				    scamper_dealias_probedef_t **defs,
+				    uint32_t *defc,
+				    uint8_t *buf, uint32_t *off, uint32_t len)
+{
+  scamper_dealias_midar_t *midar;
+  uint32_t probedefc = 0;
+  uint16_t attempts = 0;
+  uint16_t wait_probe = 0;
+  uint8_t  wait_timeout = 0;
+  uint16_t window = 0;
+  uint16_t fudge = 0;
+  uint32_t setc = 0;
+  uint32_t i, c, id, set;
+  warts_param_reader_t handlers[] = {
+    {&probedefc,    (wpr_t)extract_uint32, NULL},
+    {&attempts,     (wpr_t)extract_uint16, NULL},
+    {&wait_probe,   (wpr_t)extract_uint16, NULL},
+    {&wait_timeout, (wpr_t)extract_byte,   NULL},
+    {&window,       (wpr_t)extract_uint16, NULL},
+    {&fudge,        (wpr_t)extract_uint16, NULL},
+    {&setc,         (wpr_t)extract_uint32, NULL},
+  };
+  const int handler_cnt = sizeof(handlers)/sizeof(warts_param_reader_t);
+
+  if(scamper_dealias_midar_alloc(dealias) != 0)
+    return -1;
+
+  if(warts_params_read(buf, off, len, handlers, handler_cnt) != 0)
+    return -1;
+  if(probedefc == 0)
+    return -1;
+
+  midar = dealias->data;
+  if(scamper_dealias_midar_probedefs_alloc(midar, probedefc) != 0)
+    return -1;
+
+  midar->probedefc    = probedefc;
+  midar->attempts     = attempts;
+  midar->wait_probe   = wait_probe;
+  midar->wait_timeout = wait_timeout;
+  midar->window       = window;
+  midar->fudge        = fudge;
+
+  for(i=0; i<probedefc; i++)
+    {
+      if(warts_dealias_probedef_read(&midar->probedefs[i], state, table,
+				     buf, off, len) != 0)
+	return -1;
+    }
+
+  if(setc != 0)
+    {
+      if(scamper_dealias_midar_sets_alloc(midar) != 0 ||
+	 extract_uint32(buf, off, len, &c, NULL) != 0 || c > probedefc)
+	return -1;
+      for(i=0; i<c; i++)
+	{
+	  if(extract_uint32(buf, off, len, &id, NULL) != 0 ||
+	     extract_uint32(buf, off, len, &set, NULL) != 0 ||
+	     id >= probedefc || set == 0 || set > setc)
+	    return -1;
+	  midar->sets[id] = set;
+	}
+      midar->setc = setc;
+    }
+
+  *defs = midar->probedefs;
+  *defc = midar->probedefc;
+  return 0;
+}
+
+static void warts_dealias_midar_write(const void *data,
+				      const scamper_file_t *sf,
+				      warts_addrtable_t *table,
+				      uint8_t *buf, uint32_t *off,
+				      const uint32_t len,
+				      warts_dealias_data_t *state)
+{
+  const scamper_dealias_midar_t *midar = data;
+  warts_param_writer_t handlers[] = {
+    {&midar->probedefc,    (wpw_t)insert_uint32, NULL},
+    {&midar->attempts,     (wpw_t)insert_uint16, NULL},
+    {&midar->wait_probe,   (wpw_t)insert_uint16, NULL},
+    {&midar->wait_timeout, (wpw_t)insert_byte,   NULL},
+    {&midar->window,       (wpw_t)insert_uint16, NULL},
+    {&midar->fudge,        (wpw_t)insert_uint16, NULL},
+    {&midar->setc,         (wpw_t)insert_uint32, NULL},
+  };
+  const int handler_cnt = sizeof(handlers)/sizeof(warts_param_writer_t);
+  uint32_t i, c;
+
+  warts_params_write(buf, off, len,
+		     state->flags, state->flags_len, state->params_len,
+		     handlers, handler_cnt);
+
+  for(i=0; i<midar->probedefc; i++)
+    {
+      warts_dealias_probedef_write(&midar->probedefs[i], &state->probedefs[i],
+				   sf, table, buf, off, len);
+    }
+
+  if(midar->setc != 0)
+    {
+      c = warts_dealias_midar_setcount(midar);
+      insert_uint32(buf, off, len, &c, NULL);
+      for(i=0; i<midar->probedefc; i++)
+	{
+	  if(midar->sets[i] == 0)
+	    continue;
+	  insert_uint32(buf, off, len, &i, NULL);
+	  insert_uint32(buf, off, len, &midar->sets[i], NULL);
+	}
+    }
+
+  return;
+}
+
 static int warts_dealias_bump_state(const scamper_file_t *sf, const void *data,
 				    warts_dealias_data_t *state,
 				    warts_addrtable_t *table, uint32_t *len)
@@ -1571,6 +1784,7 @@ int scamper_file_warts_dealias_read(scamper_file_t *sf, const warts_hdr_t *hdr,
     warts_dealias_radargun_read,
     warts_dealias_prefixscan_read,
     warts_dealias_bump_read,
+    warts_dealias_midar_read,
   };
   scamper_dealias_t *dealias = NULL;
   scamper_dealias_probedef_t *defs;
@@ -1603,7 +1817,7 @@ int scamper_file_warts_dealias_read(scamper_file_t *sf, const warts_hdr_t *hdr,
     goto err;
 
   /* bounds check the type, can only read types we know about */
-  if(dealias->method > 5)
+  if(dealias->method > 6)
     {
       scamper_dealias_free(dealias);
       *dealias_out = NULL;
@@ -1643,12 +1857,10 @@ int scamper_file_warts_dealias_read(scamper_file_t *sf, const warts_hdr_t *hdr,
  done:
   warts_addrtable_free(table);
   *dealias_out = dealias;
-  free(buf);
   return 0;
 
  err:
   if(table != NULL) warts_addrtable_free(table);
-  if(buf != NULL) free(buf);
   if(dealias != NULL) scamper_dealias_free(dealias);
   return -1;
 }
@@ -1680,6 +1892,7 @@ int scamper_file_warts_dealias_write(const scamper_file_t *sf,
     warts_dealias_radargun_state,
     warts_dealias_prefixscan_state,
     warts_dealias_bump_state,
+    warts_dealias_midar_state,
   };
   static void (*const write[])(const void *, const scamper_file_t *,
 			       warts_addrtable_t *, uint8_t *, uint32_t *,
@@ -1689,6 +1902,7 @@ int scamper_file_warts_dealias_write(const scamper_file_t *sf,
     warts_dealias_radargun_write,
     warts_dealias_prefixscan_write,
     warts_dealias_bump_write,
+    warts_dealias_midar_write,
   };
   uint8_t                 *buf = NULL;
   uint8_t                  flags[dealias_vars_mfb];
@@ -52,6 +52,11 @@ static scamper_queue_t *dns4_sq = NULL;
 static scamper_fd_t *dns6_fd = NULL;
 static scamper_queue_t *dns6_sq = NULL;
 static uint16_t dns_id = 1;
+static splaytree_t *cache_tree = NULL;
+static dlist_t *cache_lru = NULL; /* least recently used at the head */
+#ifndef _WIN32
+static int cache_fd = -1;
+#endif
 
 typedef struct host_id
 {
@@ -66,6 +71,29 @@ typedef struct host_pid
   dlist_node_t     *dn;   /* node in hid->list */
 } host_pid_t;
 
+/*
+ * host_cache
+ *
+ * the answer to a PTR or A lookup, kept until its TTL expires so that
+ * later lookups for the same name are answered without a query.  an
+ * entry without answers records that the name has no such records, for
+ * as long as the SOA record in the response allows.  entries are shared
+ * by the cache and by any hostdo waiting to pass the answer on, and are
+ * freed when the last of these lets go.
+ */
+typedef struct host_cache
+{
+  char             *qname;  /* address or name that was looked up */
+  uint16_t          qtype;  /* SCAMPER_HOST_TYPE_PTR or _A */
+  char             *ptr;    /* PTR answer */
+  scamper_addr_t  **a;      /* A answers */
+  int               ac;
+  time_t            expiry; /* when the answer can no longer be used */
+  int               refcnt;
+  splaytree_node_t *tnode;  /* node in cache_tree */
+  dlist_node_t     *lnode;  /* node in cache_lru */
+} host_cache_t;
+
 typedef struct host_state
 {
   char             *qname;
@@ -83,8 +111,13 @@ struct scamper_host_do
     scamper_host_do_a_cb_t a_cb;
   } un;
   dlist_node_t   *node;
+  host_cache_t   *hc;   /* cached answer to pass on */
+  scamper_queue_t *sq;  /* event to pass the cached answer on */
 };
 
+/* the longest time an answer is cached for, regardless of its TTL */
+#define HOST_CACHE_TTL_MAX 86400
+
 #define HOST_OPT_NORECURSE 1
 #define HOST_OPT_RETRIES   2
 #define HOST_OPT_SERVER    3
@@ -217,6 +250,417 @@ static void host_stop(scamper_task_t *task, uint8_t reason)
   return;
 }
 
+static int host_cache_cmp(const host_cache_t *a, const host_cache_t *b)
+{
+  if(a->qtype < b->qtype) return -1;
+  if(a->qtype > b->qtype) return  1;
+  return strcasecmp(a->qname, b->qname);
+}
+
+static void host_cache_unref(host_cache_t *hc)
+{
+  int i;
+
+  if(--hc->refcnt > 0)
+    return;
+
+  if(hc->qname != NULL)
+    free(hc->qname);
+  if(hc->ptr != NULL)
+    free(hc->ptr);
+  if(hc->a != NULL)
+    {
+      for(i=0; i<hc->ac; i++)
+	scamper_addr_free(hc->a[i]);
+      free(hc->a);
+    }
+  free(hc);
+  return;
+}
+
+static void host_cache_remove(host_cache_t *hc)
+{
+  if(hc->tnode != NULL)
+    {
+      splaytree_remove_node(cache_tree, hc->tnode);
+      hc->tnode = NULL;
+    }
+  if(hc->lnode != NULL)
+    {
+      dlist_node_pop(cache_lru, hc->lnode);
+      hc->lnode = NULL;
+    }
+  host_cache_unref(hc);
+  return;
+}
+
+/*
+ * host_cache_find
+ *
+ * return the cached answer for the name, if there is one that has not
+ * expired, and mark it as recently used.
+ */
+static host_cache_t *host_cache_find(const char *qname, uint16_t qtype)
+{
+  host_cache_t fm, *hc;
+  struct timeval now;
+
+  if(cache_tree == NULL)
+    return NULL;
+
+  fm.qname = (char *)qname;
+  fm.qtype = qtype;
+  if((hc = splaytree_find(cache_tree, &fm)) == NULL)
+    return NULL;
+
+  gettimeofday_wrap(&now);
+  if(hc->expiry <= now.tv_sec)
+    {
+      host_cache_remove(hc);
+      return NULL;
+    }
+
+  dlist_node_eject(cache_lru, hc->lnode);
+  dlist_node_tail_push(cache_lru, hc->lnode);
+  return hc;
+}
+
+/*
+ * host_cache_insert
+ *
+ * put the answer in the cache, replacing any previous answer for the
+ * name, and evicting the least recently used answers to stay within the
+ * number of answers the cache may hold.  if the cache may not hold any
+ * answers, the answer is freed.
+ */
+static int host_cache_insert(host_cache_t *hc)
+{
+  host_cache_t *old;
+  int max = scamper_option_dnscache_get();
+
+  if(max == 0)
+    {
+      hc->refcnt = 1;
+      host_cache_unref(hc);
+      return -1;
+    }
+
+  if((old = splaytree_find(cache_tree, hc)) != NULL)
+    host_cache_remove(old);
+  while(dlist_count(cache_lru) >= max &&
+	(old = dlist_head_item(cache_lru)) != NULL)
+    host_cache_remove(old);
+
+  hc->refcnt = 1;
+  if((hc->tnode = splaytree_insert(cache_tree, hc)) == NULL ||
+     (hc->lnode = dlist_tail_push(cache_lru, hc)) == NULL)
+    {
+      printerror(__func__, "could not cache %s", hc->qname);
+      host_cache_remove(hc);
+      return -1;
+    }
+
+  return 0;
+}
+
+/*
+ * host_cache_add
+ *
+ * cache the answer that a completed PTR or A lookup obtained.  the
+ * answer is kept for the smallest TTL of the records that make it up,
+ * or for the negative caching time in the SOA record if there were no
+ * answers.  responses without answers or an SOA record are not cached,
+ * as they may reflect a transient failure of the nameserver.
+ */
+static void host_cache_add(const scamper_host_t *host)
+{
+  const scamper_host_query_t *q = NULL;
+  const scamper_host_rr_t *rr;
+  host_cache_t *hc = NULL;
+  struct timeval now;
+  uint32_t ttl = HOST_CACHE_TTL_MAX;
+  int i, x = 0;
+
+  if(cache_tree == NULL || scamper_option_dnscache_get() == 0 ||
+     host->stop != SCAMPER_HOST_STOP_DONE ||
+     (host->flags & SCAMPER_HOST_FLAG_NORECURSE) != 0 ||
+     host->qclass != SCAMPER_HOST_CLASS_IN ||
+     (host->qtype != SCAMPER_HOST_TYPE_PTR &&
+      host->qtype != SCAMPER_HOST_TYPE_A))
+    return;
+
+  /* find the query whose response completed the lookup */
+  for(i=host->qcount-1; i>=0; i--)
+    {
+      q = host->queries[i];
+      if(q->rx.tv_sec != 0 && (q->ancount == 0 || q->an != NULL))
+	break;
+    }
+  if(i < 0)
+    return;
+
+  for(i=0; i<q->ancount; i++)
+    {
+      rr = q->an[i];
+      if(rr->class != SCAMPER_HOST_CLASS_IN)
+	continue;
+      if(rr->type == host->qtype)
+	x++;
+      else if(rr->type != SCAMPER_HOST_TYPE_CNAME)
+	continue;
+      if(rr->ttl < ttl)
+	ttl = rr->ttl;
+    }
+
+  if(x == 0)
+    {
+      for(i=0; i<q->nscount; i++)
+	{
+	  rr = q->ns[i];
+	  if(rr->type == SCAMPER_HOST_TYPE_SOA && rr->un.soa != NULL)
+	    break;
+	}
+      if(i == q->nscount)
+	return;
+      if(rr->ttl < ttl)
+	ttl = rr->ttl;
+      if(rr->un.soa->minimum < ttl)
+	ttl = rr->un.soa->minimum;
+    }
+
+  if(ttl == 0)
+    return;
+
+  gettimeofday_wrap(&now);
+  if((hc = malloc_zero(sizeof(host_cache_t))) == NULL ||
+     (hc->qname = strdup(host->qname)) == NULL ||
+     (x > 0 && host->qtype == SCAMPER_HOST_TYPE_A &&
+      (hc->a = malloc_zero(sizeof(scamper_addr_t *) * x)) == NULL))
+    {
+      printerror(__func__, "could not alloc hc");
+      goto err;
+    }
+  hc->qtype = host->qtype;
+  hc->expiry = now.tv_sec + ttl;
+
+  for(i=0; i<q->ancount; i++)
+    {
+      rr = q->an[i];
+      if(rr->class != SCAMPER_HOST_CLASS_IN || rr->type != host->qtype)
+	continue;
+      if(rr->type == SCAMPER_HOST_TYPE_A)
+	hc->a[hc->ac++] = scamper_addr_use(rr->un.addr);
+      else if(hc->ptr == NULL && (hc->ptr = strdup(rr->un.str)) == NULL)
+	{
+	  printerror(__func__, "could not strdup ptr");
+	  goto err;
+	}
+    }
+
+  host_cache_insert(hc);
+  return;
+
+ err:
+  if(hc != NULL)
+    {
+      hc->refcnt = 1;
+      host_cache_unref(hc);
+    }
+  return;
+}
+
+/*
+ * host_cache_event
+ *
+ * pass a cached answer to the caller.  this is done from the event
+ * queue, rather than when the caller asks, so that the caller sees the
+ * same sequence of events as if a query had been sent.
+ */
+static int host_cache_event(void *param)
+{
+  scamper_host_do_t *hostdo = param;
+  host_cache_t *hc = hostdo->hc;
+
+  scamper_queue_free(hostdo->sq);
+  hostdo->sq = NULL;
+
+  if(hc->qtype == SCAMPER_HOST_TYPE_PTR)
+    hostdo->un.ptr_cb(hostdo->param, hc->ptr);
+  else
+    hostdo->un.a_cb(hostdo->param, hc->a, hc->ac);
+
+  host_cache_unref(hc);
+  free(hostdo);
+  return 0;
+}
+
+static scamper_host_do_t *host_cache_do(host_cache_t *hc, void *param)
+{
+  scamper_host_do_t *hostdo;
+  struct timeval now;
+
+  if((hostdo = malloc_zero(sizeof(scamper_host_do_t))) == NULL)
+    {
+      printerror(__func__, "could not alloc hostdo");
+      return NULL;
+    }
+
+  gettimeofday_wrap(&now);
+  if((hostdo->sq = scamper_queue_event(&now,host_cache_event,hostdo)) == NULL)
+    {
+      printerror(__func__, "could not queue hostdo");
+      free(hostdo);
+      return NULL;
+    }
+
+  hostdo->param = param;
+  hostdo->hc = hc;
+  hc->refcnt++;
+  return hostdo;
+}
+
+#ifndef _WIN32
+/*
+ * host_cache_line
+ *
+ * load an answer that a previous scamper process saved.  each line has
+ * the query type, the time the answer expires, the name that was looked
+ * up, and the answers, separated by spaces.
+ */
+static int host_cache_line(char *line, void *param)
+{
+  const struct timeval *now = param;
+  scamper_addr_t *sa;
+  host_cache_t *hc = NULL;
+  char *expiry, *qname, *ans, *next;
+  long qtype, lo;
+  size_t len;
+
+  if(line[0] == '\0' || line[0] == '#' ||
+     (expiry = string_nextword(line)) == NULL ||
+     (qname = string_nextword(expiry)) == NULL)
+    return 0;
+  ans = string_nextword(qname);
+
+  if(string_tolong(line, &qtype) != 0 ||
+     (qtype != SCAMPER_HOST_TYPE_PTR && qtype != SCAMPER_HOST_TYPE_A) ||
+     string_tolong(expiry, &lo) != 0 || lo <= now->tv_sec)
+    return 0;
+
+  if((hc = malloc_zero(sizeof(host_cache_t))) == NULL ||
+     (hc->qname = strdup(qname)) == NULL)
+    goto err;
+  hc->qtype = qtype;
+  hc->expiry = lo;
+
+  while(ans != NULL)
+    {
+      next = string_nextword(ans);
+      if(qtype == SCAMPER_HOST_TYPE_PTR)
+	{
+	  if((hc->ptr = strdup(ans)) == NULL)
+	    goto err;
+	  break;
+	}
+      if((sa = scamper_addr_resolve(AF_INET, ans)) == NULL)
+	goto err;
+      len = sizeof(scamper_addr_t *) * (hc->ac + 1);
+      if(realloc_wrap((void **)&hc->a, len) != 0)
+	{
+	  scamper_addr_free(sa);
+	  goto err;
+	}
+      hc->a[hc->ac++] = sa;
+      ans = next;
+    }
+
+  host_cache_insert(hc);
+  return 0;
+
+ err:
+  if(hc != NULL)
+    {
+      hc->refcnt = 1;
+      host_cache_unref(hc);
+    }
+  return 0;
+}
+
+static int host_cache_open(const char *file)
+{
+  struct timeval now;
+  mode_t mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH;
+  int flags = O_RDWR | O_CREAT;
+
+#if defined(WITHOUT_PRIVSEP)
+  cache_fd = open(file, flags, mode);
+#else
+  cache_fd = scamper_privsep_open_file(file, flags, mode);
+#endif
+
+  if(cache_fd == -1)
+    {
+      printerror(__func__, "could not open %s", file);
+      return -1;
+    }
+
+  gettimeofday_wrap(&now);
+  fd_lines(cache_fd, host_cache_line, &now);
+  return 0;
+}
+
+/*
+ * host_cache_save
+ *
+ * write the answers that have not expired to the cache file, least
+ * recently used first, so that they are loaded in the same order.
+ */
+static void host_cache_save(void)
+{
+  struct timeval now;
+  host_cache_t *hc;
+  dlist_node_t *dn;
+  char buf[1024], str[128];
+  size_t off;
+  int i;
+
+  if(ftruncate(cache_fd, 0) != 0 || lseek(cache_fd, 0, SEEK_SET) != 0)
+    {
+      printerror(__func__, "could not truncate cache file");
+      return;
+    }
+
+  gettimeofday_wrap(&now);
+  for(dn=dlist_head_node(cache_lru); dn != NULL; dn=dlist_node_next(dn))
+    {
+      hc = dlist_node_item(dn);
+      if(hc->expiry <= now.tv_sec || strpbrk(hc->qname, " \t") != NULL ||
+	 (hc->ptr != NULL && strpbrk(hc->ptr, " \t") != NULL))
+	continue;
+
+      off = 0;
+      string_concat(buf, sizeof(buf), &off, "%u %ld %s", hc->qtype,
+		    (long)hc->expiry, hc->qname);
+      if(hc->ptr != NULL)
+	string_concat(buf, sizeof(buf), &off, " %s", hc->ptr);
+      for(i=0; i<hc->ac; i++)
+	string_concat(buf, sizeof(buf), &off, " %s",
+		      scamper_addr_tostr(hc->a[i], str, sizeof(str)));
+      if(off + 1 >= sizeof(buf))
+	continue;
+      string_concat(buf, sizeof(buf), &off, "\n");
+
+      if(write_wrap(cache_fd, buf, NULL, off) != 0)
+	{
+	  printerror(__func__, "could not write cache file");
+	  return;
+	}
+    }
+
+  return;
+}
+#endif
+
 static void host_id_free(host_id_t *hid)
 {
   if(hid == NULL)
@@ -1156,6 +1600,11 @@ void scamper_host_do_free(scamper_host_do_t *hostdo)
 	dlist_node_pop(state->cbs, hostdo->node);
     }
 
+  if(hostdo->sq != NULL)
+    scamper_queue_free(hostdo->sq);
+  if(hostdo->hc != NULL)
+    host_cache_unref(hostdo->hc);
+
   free(hostdo);
   return;
 }
@@ -1267,6 +1716,16 @@ scamper_host_do_t *scamper_do_host_do_a(const char *qname, void *param,
   scamper_task_sig_t sig;
   scamper_host_do_t *hostdo;
   scamper_task_t *task;
+  host_cache_t *hc;
+
+  /* answer from the cache if we can */
+  if((hc = host_cache_find(qname, SCAMPER_HOST_TYPE_A)) != NULL)
+    {
+      if((hostdo = host_cache_do(hc, param)) == NULL)
+	return NULL;
+      hostdo->un.a_cb = cb;
+      return hostdo;
+    }
 
   memset(&sig, 0, sizeof(sig));
   sig.sig_type = SCAMPER_TASK_SIG_TYPE_HOST;
@@ -1301,10 +1760,20 @@ scamper_host_do_t *scamper_do_host_do_ptr(scamper_addr_t *ip, void *param,
   scamper_task_sig_t sig;
   scamper_host_do_t *hostdo;
   scamper_task_t *task;
+  host_cache_t *hc;
   char qname[128];
 
   scamper_addr_tostr(ip, qname, sizeof(qname));
 
+  /* answer from the cache if we can */
+  if((hc = host_cache_find(qname, SCAMPER_HOST_TYPE_PTR)) != NULL)
+    {
+      if((hostdo = host_cache_do(hc, param)) == NULL)
+	return NULL;
+      hostdo->un.ptr_cb = cb;
+      return hostdo;
+    }
+
   memset(&sig, 0, sizeof(sig));
   sig.sig_type = SCAMPER_TASK_SIG_TYPE_HOST;
   sig.sig_host_type = SCAMPER_HOST_TYPE_PTR;
@@ -1334,8 +1803,32 @@ void scamper_do_host_free(void *data)
 
 void scamper_do_host_cleanup()
 {
+  host_cache_t *hc;
   int fd;
 
+#ifndef _WIN32
+  if(cache_fd != -1)
+    {
+      host_cache_save();
+      close(cache_fd);
+      cache_fd = -1;
+    }
+#endif
+
+  /* answers still waiting to be passed on are freed by their hostdo */
+  if(cache_lru != NULL)
+    {
+      while((hc = dlist_head_item(cache_lru)) != NULL)
+	host_cache_remove(hc);
+      dlist_free(cache_lru);
+      cache_lru = NULL;
+    }
+  if(cache_tree != NULL)
+    {
+      splaytree_free(cache_tree, NULL);
+      cache_tree = NULL;
+    }
+
   if(dns4_fd != NULL)
     {
       fd = scamper_fd_fd_get(dns4_fd);
@@ -1477,6 +1970,9 @@ static void do_host_free(scamper_task_t *task)
   scamper_host_t *host = host_getdata(task);
   host_state_t *state = host_getstate(task);
 
+  if(host != NULL)
+    host_cache_add(host);
+
   if(state != NULL && state->cbs != NULL && host != NULL)
     {
       if(host->qtype == SCAMPER_HOST_TYPE_PTR)
@@ -1525,11 +2021,15 @@ const scamper_addr_t *scamper_do_host_getns(void)
 int scamper_do_host_init()
 {
   const char *nsip = NULL;
+#ifndef _WIN32
+  const char *file;
+#endif
 
   host_funcs.probe          = do_host_probe;
   host_funcs.handle_timeout = do_host_handle_timeout;
   host_funcs.write          = do_host_write;
   host_funcs.task_free      = do_host_free;
+  host_funcs.name           = "host";
   host_funcs.halt           = do_host_halt;
 
   if((nsip = scamper_option_nameserver_get()) != NULL)
@@ -1542,7 +2042,17 @@ int scamper_do_host_init()
       etc_resolv();
     }
 
-  if((queries = splaytree_alloc((splaytree_cmp_t)host_id_cmp)) == NULL)
+  if((queries = splaytree_alloc((splaytree_cmp_t)host_id_cmp)) == NULL ||
+     (cache_tree = splaytree_alloc((splaytree_cmp_t)host_cache_cmp)) == NULL ||
+     (cache_lru = dlist_alloc()) == NULL)
     return -1;
+
+#ifndef _WIN32
+  if(scamper_option_dnscache_get() != 0 &&
+     (file = scamper_option_dnscache_file_get()) != NULL &&
+     host_cache_open(file) != 0)
+    return -1;
+#endif
+
   return 0;
 }
@@ -831,12 +831,10 @@ int scamper_file_warts_host_read(scamper_file_t *sf, const warts_hdr_t *hdr,
 
   warts_addrtable_free(table);
   *host_out = host;
-  free(buf);
   return 0;
 
  err:
   if(table != NULL) warts_addrtable_free(table);
-  if(buf != NULL) free(buf);
   if(host != NULL) scamper_host_free(host);
   return -1;
 }
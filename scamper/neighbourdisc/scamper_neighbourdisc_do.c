@@ -886,6 +886,7 @@ int scamper_do_neighbourdisc_init()
   nd_funcs.handle_timeout = do_nd_handle_timeout;
   nd_funcs.write          = do_nd_write;
   nd_funcs.task_free      = do_nd_free;
+  nd_funcs.name           = "neighbourdisc";
   nd_funcs.handle_dl      = do_nd_handle_dl;
   nd_funcs.halt           = do_nd_halt;
 
@@ -571,12 +571,10 @@ int scamper_file_warts_neighbourdisc_read(scamper_file_t *sf,
  done:
   warts_addrtable_free(table);
   *nd_out = nd;
-  free(buf);
   return 0;
 
  err:
   if(table != NULL) warts_addrtable_free(table);
-  if(buf != NULL) free(buf);
   if(nd != NULL) scamper_neighbourdisc_free(nd);
   return -1;
 }
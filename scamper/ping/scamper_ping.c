@@ -32,9 +32,12 @@
 #include "scamper_list.h"
 #include "scamper_addr.h"
 #include "scamper_ping.h"
+#include "scamper_slab.h"
 
 #include "utils.h"
 
+static scamper_slab_t *reply_slab = NULL;
+
 char *scamper_ping_method2str(const scamper_ping_t *ping, char *buf, size_t len)
 {
   static char *m[] = {
@@ -136,7 +139,8 @@ int scamper_ping_stats(const scamper_ping_t *ping, scamper_ping_stats_t *stats)
   return 0;
 }
 
-int scamper_ping_setdata(scamper_ping_t *ping, uint8_t *bytes, uint16_t len)
+int scamper_ping_setdata(scamper_ping_t *ping, const uint8_t *bytes,
+			 uint16_t len)
 {
   uint8_t *dup;
 
@@ -259,6 +263,7 @@ void scamper_ping_free(scamper_ping_t *ping)
 
   if(ping->probe_tsps != NULL) scamper_ping_v4ts_free(ping->probe_tsps);
   if(ping->probe_data != NULL) free(ping->probe_data);
+  if(ping->trains != NULL) free(ping->trains);
 
   free(ping);
   return;
@@ -323,6 +328,15 @@ int scamper_ping_replies_alloc(scamper_ping_t *ping, int count)
   return -1;
 }
 
+int scamper_ping_trains_alloc(scamper_ping_t *ping, uint16_t count)
+{
+  size_t size = sizeof(scamper_ping_train_t) * count;
+  if(count == 0 || (ping->trains = malloc_zero(size)) == NULL)
+    return -1;
+  ping->trainc = count;
+  return 0;
+}
+
 void scamper_ping_reply_v4ts_free(scamper_ping_reply_v4ts_t *ts)
 {
   uint8_t i;
@@ -411,7 +425,7 @@ scamper_ping_reply_v4rr_t *scamper_ping_reply_v4rr_alloc(uint8_t rrc)
 
 scamper_ping_reply_t *scamper_ping_reply_alloc(void)
 {
-  return (scamper_ping_reply_t *)malloc_zero(sizeof(scamper_ping_reply_t));
+  return scamper_slab_get(&reply_slab, sizeof(scamper_ping_reply_t));
 }
 
 void scamper_ping_reply_free(scamper_ping_reply_t *reply)
@@ -430,6 +444,6 @@ void scamper_ping_reply_free(scamper_ping_reply_t *reply)
   if(reply->tsreply != NULL)
     scamper_ping_reply_tsreply_free(reply->tsreply);
 
-  free(reply);
+  scamper_slab_put(&reply_slab, reply);
   return;
 }
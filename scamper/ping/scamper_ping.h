@@ -191,6 +191,27 @@ typedef struct scamper_ping_v4ts
   uint8_t          ipc;
 } scamper_ping_v4ts_t;
 
+#define SCAMPER_PING_TRAIN_FLAG_DLTX      0x01 /* gaps from datalink tx */
+
+/*
+ * scamper_ping_train
+ *
+ * if the ping sent its probes in trains, this structure records how
+ * closely the gaps between the probes in one train matched the gap that
+ * was asked for.  the gaps are in microseconds, and the jitter is the
+ * mean absolute difference between each gap and the requested gap.
+ */
+typedef struct scamper_ping_train
+{
+  uint16_t                   probe_id;
+  uint16_t                   probec;
+  uint8_t                    flags;
+  uint32_t                   gap_min;
+  uint32_t                   gap_max;
+  uint32_t                   gap_mean;
+  uint32_t                   jitter;
+} scamper_ping_train_t;
+
 /*
  * scamper_ping_reply
  *
@@ -283,17 +304,22 @@ typedef struct scamper_ping
   uint16_t               reply_pmtu;       /* -M */
   scamper_ping_v4ts_t   *probe_tsps;       /* -T */
   uint32_t               flags;
+  uint16_t               train_size;       /* -n */
+  uint16_t               train_gap;        /* -g, in microseconds */
 
   /* actual data collected with the ping */
   scamper_ping_reply_t **ping_replies;
   uint16_t               ping_sent;
+  scamper_ping_train_t  *trains;
+  uint16_t               trainc;
 } scamper_ping_t;
 
 /* basic routines to allocate and free scamper_ping structures */
 scamper_ping_t *scamper_ping_alloc(void);
 void scamper_ping_free(scamper_ping_t *ping);
 scamper_addr_t *scamper_ping_addr(const void *va);
-int scamper_ping_setdata(scamper_ping_t *ping, uint8_t *bytes, uint16_t len);
+int scamper_ping_setdata(scamper_ping_t *ping, const uint8_t *bytes,
+			 uint16_t len);
 
 /* utility function for allocating an array for recording replies */
 int scamper_ping_replies_alloc(scamper_ping_t *ping, int count);
@@ -316,6 +342,9 @@ void scamper_ping_reply_v4ts_free(scamper_ping_reply_v4ts_t *ts);
 scamper_ping_v4ts_t *scamper_ping_v4ts_alloc(uint8_t ipc);
 void scamper_ping_v4ts_free(scamper_ping_v4ts_t *ts);
 
+/* utility function for allocating an array for recording trains */
+int scamper_ping_trains_alloc(scamper_ping_t *ping, uint16_t count);
+
 typedef struct scamper_ping_stats
 {
   uint32_t nreplies;
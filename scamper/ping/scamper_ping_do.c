@@ -48,6 +48,8 @@
 #include "scamper_options.h"
 #include "scamper_icmp4.h"
 #include "scamper_icmp6.h"
+#include "scamper_slab.h"
+#include "scamper_if.h"
 #include "utils.h"
 
 #define SCAMPER_DO_PING_PROBECOUNT_MIN    1
@@ -92,9 +94,21 @@
 #define SCAMPER_DO_PING_PROBETIMEOUT_DEF    1
 #define SCAMPER_DO_PING_PROBETIMEOUT_MAX    255
 
+#define SCAMPER_DO_PING_TRAINSIZE_MIN     2
+#define SCAMPER_DO_PING_TRAINSIZE_MAX     100
+
+#define SCAMPER_DO_PING_TRAINGAP_MIN      0
+#define SCAMPER_DO_PING_TRAINGAP_DEF      100
+#define SCAMPER_DO_PING_TRAINGAP_MAX      1000
+#define SCAMPER_DO_PING_TRAINDUR_MAX      10000
+#define SCAMPER_DO_PING_TRAINSPIN         100
+
 /* the callback functions registered with the ping task */
 static scamper_task_funcs_t ping_funcs;
 
+/* slab that ping_probe_t records are allocated from */
+static scamper_slab_t *pp_slab = NULL;
+
 /* ICMP ping probes are marked with the process' ID */
 #ifndef _WIN32
 static pid_t pid;
@@ -105,9 +119,13 @@ static DWORD pid;
 typedef struct ping_probe
 {
   struct timeval     tx;
+  struct timeval     dltx;
   uint16_t           ipid;
+  uint8_t            flags;
 } ping_probe_t;
 
+#define PING_PROBE_FLAG_DLTX  0x01 /* dltx is set */
+
 typedef struct ping_state
 {
   ping_probe_t     **probes;
@@ -144,6 +162,8 @@ typedef struct ping_state
 #define PING_OPT_PROBETIMEOUT 19
 #define PING_OPT_PROBETCPACK  20
 #define PING_OPT_RTRADDR      21
+#define PING_OPT_TRAINGAP     22
+#define PING_OPT_TRAINSIZE    23
 
 #define PING_MODE_PROBE       0
 #define PING_MODE_PTB         1
@@ -155,9 +175,11 @@ static const scamper_option_in_t opts[] = {
   {'C', NULL, PING_OPT_PROBEICMPSUM, SCAMPER_OPTION_TYPE_STR},
   {'d', NULL, PING_OPT_PROBEDPORT,   SCAMPER_OPTION_TYPE_NUM},
   {'F', NULL, PING_OPT_PROBESPORT,   SCAMPER_OPTION_TYPE_NUM},
+  {'g', NULL, PING_OPT_TRAINGAP,     SCAMPER_OPTION_TYPE_NUM},
   {'i', NULL, PING_OPT_PROBEWAIT,    SCAMPER_OPTION_TYPE_STR},
   {'m', NULL, PING_OPT_PROBETTL,     SCAMPER_OPTION_TYPE_NUM},
   {'M', NULL, PING_OPT_REPLYPMTU,    SCAMPER_OPTION_TYPE_NUM},
+  {'n', NULL, PING_OPT_TRAINSIZE,    SCAMPER_OPTION_TYPE_NUM},
   {'o', NULL, PING_OPT_REPLYCOUNT,   SCAMPER_OPTION_TYPE_NUM},
   {'O', NULL, PING_OPT_OPTION,       SCAMPER_OPTION_TYPE_STR},
   {'p', NULL, PING_OPT_PATTERN,      SCAMPER_OPTION_TYPE_STR},
@@ -178,10 +200,11 @@ const char *scamper_do_ping_usage(void)
 {
   return
     "ping [-R] [-A tcp-ack] [-B payload] [-c count] [-C icmp-sum]\n"
-    "     [-d dport] [-F sport] [-i wait-probe] [-m ttl] [-M pmtu]\n"
-    "     [-o reply-count] [-O option] [-p pattern] [-P method]\n"
-    "     [-r rtraddr] [-s probe-size] [-S srcaddr]\n"
-    "     [-T timestamp-option] [-U userid] [-W timeout] [-z tos]";
+    "     [-d dport] [-F sport] [-g train-gap] [-i wait-probe] [-m ttl]\n"
+    "     [-M pmtu] [-n train-size] [-o reply-count] [-O option]\n"
+    "     [-p pattern] [-P method] [-r rtraddr] [-s probe-size]\n"
+    "     [-S srcaddr] [-T timestamp-option] [-U userid] [-W timeout]\n"
+    "     [-z tos]";
 }
 
 static scamper_ping_t *ping_getdata(const scamper_task_t *task)
@@ -194,9 +217,87 @@ static ping_state_t *ping_getstate(const scamper_task_t *task)
   return scamper_task_getstate(task);
 }
 
+/*
+ * ping_trains
+ *
+ * summarise the gaps between the probes in each train that was sent.
+ */
+static void ping_trains(scamper_ping_t *ping, const ping_state_t *state)
+{
+  scamper_ping_train_t *train;
+  const ping_probe_t *pp, *prev;
+  uint64_t sum, jitter;
+  uint32_t gap;
+  uint16_t i, j, n;
+  int us, dltx;
+
+  if(ping->train_size == 0 || ping->trains != NULL ||
+     state == NULL || state->seq == 0)
+    return;
+
+  n = (state->seq + ping->train_size - 1) / ping->train_size;
+  if(scamper_ping_trains_alloc(ping, n) != 0)
+    {
+      printerror(__func__, "could not alloc trains");
+      return;
+    }
+
+  for(i=0; i<n; i++)
+    {
+      train = &ping->trains[i];
+      train->probe_id = i * ping->train_size;
+      train->probec = state->seq - train->probe_id;
+      if(train->probec > ping->train_size)
+	train->probec = ping->train_size;
+      /* only use datalink timestamps if every probe in the train has one */
+      train->flags = SCAMPER_PING_TRAIN_FLAG_DLTX;
+      for(j=0; j<train->probec; j++)
+	{
+	  pp = state->probes[train->probe_id + j];
+	  if((pp->flags & PING_PROBE_FLAG_DLTX) == 0)
+	    train->flags &= ~SCAMPER_PING_TRAIN_FLAG_DLTX;
+	}
+      dltx = (train->flags & SCAMPER_PING_TRAIN_FLAG_DLTX) != 0;
+
+      sum = jitter = 0;
+      prev = NULL;
+      for(j=0; j<train->probec; j++)
+	{
+	  pp = state->probes[train->probe_id + j];
+	  if(prev != NULL)
+	    {
+	      if(dltx != 0)
+		us = timeval_diff_us(&pp->dltx, &prev->dltx);
+	      else
+		us = timeval_diff_us(&pp->tx, &prev->tx);
+	      gap = us > 0 ? (uint32_t)us : 0;
+	      if(j == 1 || gap < train->gap_min)
+		train->gap_min = gap;
+	      if(gap > train->gap_max)
+		train->gap_max = gap;
+	      sum += gap;
+	      if(gap > ping->train_gap)
+		jitter += gap - ping->train_gap;
+	      else
+		jitter += ping->train_gap - gap;
+	    }
+	  prev = pp;
+	}
+
+      if(train->probec > 1)
+	{
+	  train->gap_mean = sum / (train->probec - 1);
+	  train->jitter = jitter / (train->probec - 1);
+	}
+    }
+
+  return;
+}
+
 static void ping_stop(scamper_task_t *task, uint8_t reason, uint8_t data)
 {
   scamper_ping_t *ping = ping_getdata(task);
+  ping_trains(ping, ping_getstate(task));
   ping->stop_reason = reason;
   ping->stop_data   = data;
   scamper_task_queue_done(task, 0);
@@ -248,6 +349,109 @@ static uint16_t match_ipid(scamper_task_t *task, uint16_t ipid)
   return seq;
 }
 
+/*
+ * ping_handle_dltx
+ *
+ * a ping that sends trains watches the datalink only to see its probes
+ * leave.  use the datalink's timestamp as the time the probe was sent,
+ * and adjust any replies already received for the probe.
+ */
+static void ping_handle_dltx(scamper_task_t *task, scamper_dl_rec_t *dl)
+{
+  scamper_ping_t       *ping  = ping_getdata(task);
+  ping_state_t         *state = ping_getstate(task);
+  scamper_ping_reply_t *reply;
+  ping_probe_t         *pp;
+  struct timeval        rx;
+  int                   seq = -1;
+  uint16_t              u16;
+
+  if(scamper_addr_raw_cmp(ping->src, dl->dl_ip_src) != 0)
+    return;
+
+  if(SCAMPER_PING_METHOD_IS_ICMP_ECHO(ping))
+    {
+      if(SCAMPER_DL_IS_ICMP_ECHO_REQUEST(dl) == 0 ||
+	 dl->dl_icmp_id != ping->probe_sport)
+	return;
+      seq = dl->dl_icmp_seq;
+      if(seq < ping->probe_dport)
+	seq = seq + 0x10000;
+      seq = seq - ping->probe_dport;
+    }
+  else if(SCAMPER_PING_METHOD_IS_UDP(ping))
+    {
+      if(SCAMPER_DL_IS_UDP(dl) == 0 || dl->dl_udp_sport != ping->probe_sport)
+	return;
+      if(ping->probe_method == SCAMPER_PING_METHOD_UDP_DPORT)
+	{
+	  if(dl->dl_udp_dport < ping->probe_dport)
+	    return;
+	  seq = dl->dl_udp_dport - ping->probe_dport;
+	}
+      else if(dl->dl_udp_dport != ping->probe_dport)
+	return;
+      else if(dl->dl_af == AF_INET)
+	{
+	  for(u16=state->seq; u16 > 0; u16--)
+	    {
+	      if(state->probes[u16-1]->ipid == dl->dl_ip_id)
+		{
+		  seq = u16 - 1;
+		  break;
+		}
+	    }
+	}
+      else return; /* cannot tell which IPv6 probe this was */
+    }
+
+  if(seq < 0 || seq >= state->seq)
+    return;
+  pp = state->probes[seq];
+  if((pp->flags & PING_PROBE_FLAG_DLTX) != 0)
+    return;
+
+  /*
+   * the kernel does not always timestamp the first packet it shows us
+   * when it is sent, so do not use a timestamp after a reply arrived
+   */
+  for(reply = ping->ping_replies[seq]; reply != NULL; reply = reply->next)
+    {
+      timeval_add_tv3(&rx, &reply->tx, &reply->rtt);
+      if(timeval_cmp(&dl->dl_tv, &rx) > 0)
+	return;
+    }
+
+  for(reply = ping->ping_replies[seq]; reply != NULL; reply = reply->next)
+    {
+      timeval_add_tv3(&rx, &reply->tx, &reply->rtt);
+      timeval_cpy(&reply->tx, &dl->dl_tv);
+      timeval_diff_tv(&reply->rtt, &dl->dl_tv, &rx);
+    }
+
+  timeval_cpy(&pp->dltx, &dl->dl_tv);
+  pp->flags |= PING_PROBE_FLAG_DLTX;
+  return;
+}
+
+/*
+ * ping_probe_tx
+ *
+ * return when the probe was sent, preferring the datalink timestamp.
+ * a datalink timestamp after the reply arrived cannot be right, so fall
+ * back to the time recorded before the probe was sent.
+ */
+static const struct timeval *ping_probe_tx(ping_probe_t *pp,
+					   const struct timeval *rx)
+{
+  if((pp->flags & PING_PROBE_FLAG_DLTX) == 0)
+    return &pp->tx;
+  if(timeval_cmp(&pp->dltx, rx) <= 0)
+    return &pp->dltx;
+  pp->flags &= ~PING_PROBE_FLAG_DLTX;
+  return &pp->tx;
+}
+
 static void do_ping_handle_dl(scamper_task_t *task, scamper_dl_rec_t *dl)
 {
   scamper_ping_t       *ping  = ping_getdata(task);
@@ -263,6 +467,12 @@ static void do_ping_handle_dl(scamper_task_t *task, scamper_dl_rec_t *dl)
   if(dl->dl_ip_off != 0)
     return;
 
+  if(ping->train_size != 0)
+    {
+      ping_handle_dltx(task, dl);
+      return;
+    }
+
   if(SCAMPER_DL_IS_ICMP(dl))
     {
       if((ping->flags & SCAMPER_PING_FLAG_DL) == 0)
@@ -501,6 +711,7 @@ static void do_ping_handle_dl(scamper_task_t *task, scamper_dl_rec_t *dl)
 
   /* put the reply into the ping table */
   scamper_ping_reply_append(ping, reply);
+  scamper_task_mem_add(task, sizeof(scamper_ping_reply_t));
 
   /*
    * if only a certain number of replies are required, and we've reached
@@ -522,6 +733,7 @@ static void do_ping_handle_icmp(scamper_task_t *task, scamper_icmp_resp_t *ir)
   ping_state_t              *state = ping_getstate(task);
   scamper_ping_reply_t      *reply = NULL;
   ping_probe_t              *probe;
+  const struct timeval      *tx;
   int                        seq;
   scamper_addr_t             addr;
   uint8_t                    i, rrc = 0, tsc = 0;
@@ -693,8 +905,9 @@ static void do_ping_handle_icmp(scamper_task_t *task, scamper_icmp_resp_t *ir)
     goto err;
 
   /* put together details of the reply */
-  timeval_cpy(&reply->tx, &probe->tx);
-  timeval_diff_tv(&reply->rtt, &probe->tx, &ir->ir_rx);
+  tx = ping_probe_tx(probe, &ir->ir_rx);
+  timeval_cpy(&reply->tx, tx);
+  timeval_diff_tv(&reply->rtt, tx, &ir->ir_rx);
   reply->reply_size  = ir->ir_ip_size;
   reply->probe_id    = seq;
   reply->icmp_type   = ir->ir_icmp_type;
@@ -771,6 +984,7 @@ static void do_ping_handle_icmp(scamper_task_t *task, scamper_icmp_resp_t *ir)
 
   /* put the reply into the ping table */
   scamper_ping_reply_append(ping, reply);
+  scamper_task_mem_add(task, sizeof(scamper_ping_reply_t));
 
   /*
    * if only a certain number of replies are required, and we've reached
@@ -916,7 +1130,7 @@ static void ping_state_free(ping_state_t *state)
     {
       for(i=0; i<state->seq; i++)
 	if(state->probes[i] != NULL)
-	  free(state->probes[i]);
+	  scamper_slab_put(&pp_slab, state->probes[i]);
       free(state->probes);
     }
 
@@ -930,6 +1144,32 @@ static void ping_state_free(ping_state_t *state)
   return;
 }
 
+/*
+ * ping_state_dltx
+ *
+ * a ping that sends trains watches the datalink of the interface with
+ * its source address, so that the gaps between probes are measured with
+ * the time each probe was handed to the interface.  if there is no
+ * datalink, the ping uses the times scamper sent the probes.
+ */
+static void ping_state_dltx(scamper_task_t *task)
+{
+  scamper_ping_t *ping = ping_getdata(task);
+  struct sockaddr_storage sas;
+  int ifindex;
+
+  if(ping->src->type == SCAMPER_ADDR_TYPE_IPV4)
+    sockaddr_compose((struct sockaddr *)&sas, AF_INET, ping->src->addr, 0);
+  else
+    sockaddr_compose((struct sockaddr *)&sas, AF_INET6, ping->src->addr, 0);
+
+  if(scamper_if_getifindex_byaddr((struct sockaddr *)&sas, &ifindex) != 0 ||
+     scamper_task_fd_dl(task, ifindex) == NULL)
+    scamper_debug(__func__, "no datalink, using probe tx timestamps");
+
+  return;
+}
+
 static int ping_state_alloc(scamper_task_t *task)
 {
   scamper_ping_t *ping = ping_getdata(task);
@@ -965,6 +1205,9 @@ static int ping_state_alloc(scamper_task_t *task)
     for(i=0; i<ping->probe_tsps->ipc; i++)
       memcpy(&state->tsps_ips[i], ping->probe_tsps->ips[i]->addr, 4);
 
+  if(ping->train_size != 0)
+    ping_state_dltx(task);
+
   return 0;
 
  err:
@@ -972,203 +1215,302 @@ static int ping_state_alloc(scamper_task_t *task)
 }
 
 /*
- * do_ping_probe
+ * ping_probe_txcb
  *
- * it is time to send a probe for this task.  figure out the form of the
- * probe to send, and then send it.
+ * a probe that was queued to be sent in a batch has been sent.  record
+ * when it was actually sent, or stop the ping if it could not be.
  */
-static void do_ping_probe(scamper_task_t *task)
+static void ping_probe_txcb(void *param, uint32_t id,
+			    const struct timeval *tx, int error)
+{
+  scamper_task_t *task = param;
+  ping_state_t *state = ping_getstate(task);
+
+  if(error != 0)
+    {
+      ping_handleerror(task, error);
+      return;
+    }
+
+  if(state != NULL && id < state->seq && state->probes[id] != NULL)
+    timeval_cpy(&state->probes[id]->tx, tx);
+
+  return;
+}
+
+/*
+ * ping_probe
+ *
+ * build and send the next probe in the ping.  the fields of the probe
+ * that do not change between probes are already filled out.
+ */
+static int ping_probe(scamper_task_t *task, scamper_probe_t *probe,
+		      scamper_probe_ipopt_t *opt)
 {
-  scamper_probe_ipopt_t opt;
-  struct timeval   wait_tv;
   scamper_ping_t  *ping  = ping_getdata(task);
   ping_state_t    *state = ping_getstate(task);
   ping_probe_t    *pp = NULL;
-  scamper_probe_t  probe;
   int              i;
   uint16_t         ipid = 0;
   uint16_t         u16;
   struct timeval   tv;
 
-  if(state == NULL)
-    {
-      if(ping_state_alloc(task) != 0)
-	goto err;
-      state = ping_getstate(task);
-
-      /* timestamp the start time of the ping */
-      gettimeofday_wrap(&ping->start);
-    }
-
-  memset(&probe, 0, sizeof(probe));
-  probe.pr_ip_src = ping->src;
-  probe.pr_ip_dst = ping->dst;
-  probe.pr_rtr = ping->rtr;
-
-  if(ping->flags & SCAMPER_PING_FLAG_DL)
-    probe.pr_flags |= SCAMPER_PROBE_FLAG_DL;
-
-  if(state->mode == PING_MODE_PROBE)
+  if(ping->dst->type == SCAMPER_ADDR_TYPE_IPV4)
     {
-      if(ping->dst->type == SCAMPER_ADDR_TYPE_IPV4)
+      /* select a random IPID value (not zero).  try up to three times */
+      for(i=0; i<3; i++)
 	{
-	  /* select a random IPID value (not zero).  try up to three times */
-	  for(i=0; i<3; i++)
+	  if(random_u16(&ipid) != 0)
 	    {
-	      if(random_u16(&ipid) != 0)
-		{
-		  printerror(__func__, "could not rand ipid");
-		  goto err;
-		}
-	      if(ipid != 0)
-		break;
+	      printerror(__func__, "could not rand ipid");
+	      goto err;
 	    }
+	  if(ipid != 0)
+	    break;
 	}
+    }
 
-      probe.pr_flags    |= SCAMPER_PROBE_FLAG_IPID;
-      probe.pr_ip_tos    = ping->probe_tos;
-      probe.pr_ip_ttl    = ping->probe_ttl;
-      probe.pr_ip_id     = ipid;
-      probe.pr_data      = state->payload;
-      probe.pr_len       = state->payload_len;
+  probe->pr_flags    |= SCAMPER_PROBE_FLAG_IPID;
+  if(ping->train_size != 0)
+    probe->pr_flags  |= SCAMPER_PROBE_FLAG_NOBATCH;
+  probe->pr_ip_tos    = ping->probe_tos;
+  probe->pr_ip_ttl    = ping->probe_ttl;
+  probe->pr_ip_id     = ipid;
+  probe->pr_data      = state->payload;
+  probe->pr_len       = state->payload_len;
 
-      if(ping->dst->type == SCAMPER_ADDR_TYPE_IPV4)
-	probe.pr_ip_off  = IP_DF;
+  if(ping->dst->type == SCAMPER_ADDR_TYPE_IPV4)
+    probe->pr_ip_off  = IP_DF;
 
-      if((ping->flags & SCAMPER_PING_FLAG_SPOOF) != 0)
-	probe.pr_flags |= SCAMPER_PROBE_FLAG_SPOOF;
+  if((ping->flags & SCAMPER_PING_FLAG_SPOOF) != 0)
+    probe->pr_flags |= SCAMPER_PROBE_FLAG_SPOOF;
 
-      if((ping->flags & SCAMPER_PING_FLAG_V4RR) != 0)
+  if((ping->flags & SCAMPER_PING_FLAG_V4RR) != 0)
+    {
+      opt->type = SCAMPER_PROBE_IPOPTS_V4RR;
+      probe->pr_ipopts = opt;
+      probe->pr_ipoptc = 1;
+    }
+  else if((ping->flags & SCAMPER_PING_FLAG_TSONLY) != 0)
+    {
+      opt->type = SCAMPER_PROBE_IPOPTS_V4TSO;
+      probe->pr_ipopts = opt;
+      probe->pr_ipoptc = 1;
+    }
+  else if((ping->flags & SCAMPER_PING_FLAG_TSANDADDR) != 0)
+    {
+      opt->type = SCAMPER_PROBE_IPOPTS_V4TSAA;
+      probe->pr_ipopts = opt;
+      probe->pr_ipoptc = 1;
+    }
+  else if(ping->probe_tsps != NULL)
+    {
+      opt->type = SCAMPER_PROBE_IPOPTS_V4TSPS;
+      opt->opt_v4tsps_ipc = ping->probe_tsps->ipc;
+      memcpy(&opt->opt_v4tsps_ips, &state->tsps_ips,
+	     sizeof(opt->opt_v4tsps_ips));
+      probe->pr_ipopts = opt;
+      probe->pr_ipoptc = 1;
+    }
+
+  if(SCAMPER_PING_METHOD_IS_ICMP(ping))
+    {
+      i = 0;
+      if(SCAMPER_PING_METHOD_IS_ICMP_ECHO(ping))
 	{
-	  opt.type = SCAMPER_PROBE_IPOPTS_V4RR;
-	  probe.pr_ipopts = &opt;
-	  probe.pr_ipoptc = 1;
+	  SCAMPER_PROBE_ICMP_ECHO(probe, ping->probe_sport,
+				  ping->probe_dport + state->seq);
 	}
-      else if((ping->flags & SCAMPER_PING_FLAG_TSONLY) != 0)
+      else if(SCAMPER_PING_METHOD_IS_ICMP_TIME(ping))
 	{
-	  opt.type = SCAMPER_PROBE_IPOPTS_V4TSO;
-	  probe.pr_ipopts = &opt;
-	  probe.pr_ipoptc = 1;
+	  SCAMPER_PROBE_ICMP_TIME(probe, ping->probe_sport,
+				  ping->probe_dport + state->seq);
+	  gettimeofday_wrap(&tv);
+	  bytes_htonl(state->payload,
+		      ((tv.tv_sec % 86400) * 1000) + (tv.tv_usec / 1000));
+	  i += 12;
 	}
-      else if((ping->flags & SCAMPER_PING_FLAG_TSANDADDR) != 0)
+
+      if((ping->flags & SCAMPER_PING_FLAG_ICMPSUM) != 0)
 	{
-	  opt.type = SCAMPER_PROBE_IPOPTS_V4TSAA;
-	  probe.pr_ipopts = &opt;
-	  probe.pr_ipoptc = 1;
+	  probe->pr_icmp_sum = u16 = htons(ping->probe_icmpsum);
+	  if((ping->flags & SCAMPER_PING_FLAG_SPOOF) != 0)
+	    i += 4;
+	  memcpy(state->payload+i, &u16, 2);
+	  if(SCAMPER_ADDR_TYPE_IS_IPV4(ping->dst))
+	    u16 = scamper_icmp4_cksum(probe);
+	  else
+	    u16 = scamper_icmp6_cksum(probe);
+	  memcpy(state->payload+i, &u16, 2);
 	}
-      else if(ping->probe_tsps != NULL)
+    }
+  else if(SCAMPER_PING_METHOD_IS_TCP(ping))
+    {
+      probe->pr_ip_proto  = IPPROTO_TCP;
+      probe->pr_tcp_dport = ping->probe_dport;
+      probe->pr_tcp_sport = ping->probe_sport;
+      probe->pr_tcp_seq   = ping->probe_tcpseq;
+      probe->pr_tcp_ack   = ping->probe_tcpack;
+      probe->pr_tcp_win   = 65535;
+
+      if(ping->probe_method == SCAMPER_PING_METHOD_TCP_ACK)
 	{
-	  opt.type = SCAMPER_PROBE_IPOPTS_V4TSPS;
-	  opt.opt_v4tsps_ipc = ping->probe_tsps->ipc;
-	  memcpy(&opt.opt_v4tsps_ips, &state->tsps_ips,
-		 sizeof(opt.opt_v4tsps_ips));
-	  probe.pr_ipopts = &opt;
-	  probe.pr_ipoptc = 1;
+	  probe->pr_tcp_flags = TH_ACK;
 	}
-
-      if(SCAMPER_PING_METHOD_IS_ICMP(ping))
+      else if(ping->probe_method == SCAMPER_PING_METHOD_TCP_ACK_SPORT)
 	{
-	  i = 0;
-	  if(SCAMPER_PING_METHOD_IS_ICMP_ECHO(ping))
-	    {
-	      SCAMPER_PROBE_ICMP_ECHO(&probe, ping->probe_sport,
-				      ping->probe_dport + state->seq);
-	    }
-	  else if(SCAMPER_PING_METHOD_IS_ICMP_TIME(ping))
-	    {
-	      SCAMPER_PROBE_ICMP_TIME(&probe, ping->probe_sport,
-				      ping->probe_dport + state->seq);
-	      gettimeofday_wrap(&tv);
-	      bytes_htonl(state->payload,
-			  ((tv.tv_sec % 86400) * 1000) + (tv.tv_usec / 1000));
-	      i += 12;
-	    }
-
-	  if((ping->flags & SCAMPER_PING_FLAG_ICMPSUM) != 0)
-	    {
-	      probe.pr_icmp_sum = u16 = htons(ping->probe_icmpsum);
-	      if((ping->flags & SCAMPER_PING_FLAG_SPOOF) != 0)
-		i += 4;
-	      memcpy(state->payload+i, &u16, 2);
-	      if(SCAMPER_ADDR_TYPE_IS_IPV4(ping->dst))
-		u16 = scamper_icmp4_cksum(&probe);
-	      else
-		u16 = scamper_icmp6_cksum(&probe);
-	      memcpy(state->payload+i, &u16, 2);
-	    }
+	  probe->pr_tcp_flags  = TH_ACK;
+	  probe->pr_tcp_sport += state->seq;
 	}
-      else if(SCAMPER_PING_METHOD_IS_TCP(ping))
+      else if(ping->probe_method == SCAMPER_PING_METHOD_TCP_SYN)
 	{
-	  probe.pr_ip_proto  = IPPROTO_TCP;
-	  probe.pr_tcp_dport = ping->probe_dport;
-	  probe.pr_tcp_sport = ping->probe_sport;
-	  probe.pr_tcp_seq   = ping->probe_tcpseq;
-	  probe.pr_tcp_ack   = ping->probe_tcpack;
-	  probe.pr_tcp_win   = 65535;
-
-	  if(ping->probe_method == SCAMPER_PING_METHOD_TCP_ACK)
-	    {
-	      probe.pr_tcp_flags = TH_ACK;
-	    }
-	  else if(ping->probe_method == SCAMPER_PING_METHOD_TCP_ACK_SPORT)
-	    {
-	      probe.pr_tcp_flags  = TH_ACK;
-	      probe.pr_tcp_sport += state->seq;
-	    }
-	  else if(ping->probe_method == SCAMPER_PING_METHOD_TCP_SYN)
-	    {
-	      probe.pr_tcp_flags = TH_SYN;
-	    }
-	  else if(ping->probe_method == SCAMPER_PING_METHOD_TCP_SYNACK)
-	    {
-	      probe.pr_tcp_flags = TH_SYN | TH_ACK;
-	    }
-	  else if(ping->probe_method == SCAMPER_PING_METHOD_TCP_RST)
-	    {
-	      probe.pr_tcp_flags = TH_RST;
-	    }
-	  else if(ping->probe_method == SCAMPER_PING_METHOD_TCP_SYN_SPORT)
-	    {
-	      probe.pr_tcp_flags = TH_SYN;
-	      probe.pr_tcp_sport += state->seq;
-	    }
+	  probe->pr_tcp_flags = TH_SYN;
 	}
-      else if(SCAMPER_PING_METHOD_IS_UDP(ping))
+      else if(ping->probe_method == SCAMPER_PING_METHOD_TCP_SYNACK)
 	{
-	  probe.pr_ip_proto  = IPPROTO_UDP;
-	  probe.pr_udp_sport = ping->probe_sport;
-
-	  if(ping->probe_method == SCAMPER_PING_METHOD_UDP)
-	    probe.pr_udp_dport = ping->probe_dport;
-	  else if(ping->probe_method == SCAMPER_PING_METHOD_UDP_DPORT)
-	    probe.pr_udp_dport = ping->probe_dport + state->seq;
+	  probe->pr_tcp_flags = TH_SYN | TH_ACK;
 	}
-      else
+      else if(ping->probe_method == SCAMPER_PING_METHOD_TCP_RST)
 	{
-	  scamper_debug(__func__,"unknown ping method %d", ping->probe_method);
-	  goto err;
+	  probe->pr_tcp_flags = TH_RST;
 	}
+      else if(ping->probe_method == SCAMPER_PING_METHOD_TCP_SYN_SPORT)
+	{
+	  probe->pr_tcp_flags = TH_SYN;
+	  probe->pr_tcp_sport += state->seq;
+	}
+    }
+  else if(SCAMPER_PING_METHOD_IS_UDP(ping))
+    {
+      probe->pr_ip_proto  = IPPROTO_UDP;
+      probe->pr_udp_sport = ping->probe_sport;
 
-      /*
-       * allocate a ping probe state record before we try and send the probe
-       * as there is no point sending something into the wild that we can't
-       * record
-       */
-      if((pp = malloc_zero(sizeof(ping_probe_t))) == NULL)
+      if(ping->probe_method == SCAMPER_PING_METHOD_UDP)
+	probe->pr_udp_dport = ping->probe_dport;
+      else if(ping->probe_method == SCAMPER_PING_METHOD_UDP_DPORT)
+	probe->pr_udp_dport = ping->probe_dport + state->seq;
+    }
+  else
+    {
+      scamper_debug(__func__,"unknown ping method %d", ping->probe_method);
+      goto err;
+    }
+
+  /*
+   * allocate a ping probe state record before we try and send the probe
+   * as there is no point sending something into the wild that we can't
+   * record
+   */
+  if((pp = scamper_slab_get(&pp_slab, sizeof(ping_probe_t))) == NULL)
+    goto err;
+
+  probe->pr_txcb       = ping_probe_txcb;
+  probe->pr_txcb_param = task;
+  probe->pr_txcb_id    = state->seq;
+  if(scamper_probe_task(probe, task) != 0)
+    {
+      errno = probe->pr_errno;
+      goto err;
+    }
+
+  /* fill out the details of the probe sent */
+  timeval_cpy(&pp->tx, &probe->pr_tx);
+  pp->ipid = ipid;
+  pp->flags = 0;
+  state->probes[state->seq] = pp;
+  state->seq++;
+  ping->ping_sent++;
+  return 0;
+
+ err:
+  if(pp != NULL) scamper_slab_put(&pp_slab, pp);
+  return -1;
+}
+
+/*
+ * ping_train_wait
+ *
+ * the gaps between probes in a train are shorter than the probe queue
+ * and select can honour.  sleep until shortly before the next probe is
+ * due, and spin for the last few microseconds.
+ */
+static void ping_train_wait(const struct timeval *due)
+{
+  struct timeval now;
+#ifndef _WIN32
+  struct timespec ts;
+  int us;
+
+  gettimeofday_wrap(&now);
+  us = timeval_diff_us(due, &now) - SCAMPER_DO_PING_TRAINSPIN;
+  if(us > 0)
+    {
+      ts.tv_sec = 0;
+      ts.tv_nsec = us * 1000;
+      nanosleep(&ts, NULL);
+    }
+#endif
+
+  do
+    {
+      gettimeofday_wrap(&now);
+    }
+  while(timeval_cmp(&now, due) < 0);
+
+  return;
+}
+
+/*
+ * do_ping_probe
+ *
+ * it is time to send a probe for this task.  figure out the form of the
+ * probe to send, and then send it.
+ */
+static void do_ping_probe(scamper_task_t *task)
+{
+  scamper_probe_ipopt_t opt;
+  struct timeval   wait_tv;
+  scamper_ping_t  *ping  = ping_getdata(task);
+  ping_state_t    *state = ping_getstate(task);
+  scamper_probe_t  probe;
+  struct timeval   tv;
+  uint16_t         i;
+
+  if(state == NULL)
+    {
+      if(ping_state_alloc(task) != 0)
 	goto err;
+      state = ping_getstate(task);
 
-      if(scamper_probe_task(&probe, task) != 0)
+      /* timestamp the start time of the ping */
+      gettimeofday_wrap(&ping->start);
+    }
+
+  memset(&probe, 0, sizeof(probe));
+  probe.pr_ip_src = ping->src;
+  probe.pr_ip_dst = ping->dst;
+  probe.pr_rtr = ping->rtr;
+
+  if(ping->flags & SCAMPER_PING_FLAG_DL)
+    probe.pr_flags |= SCAMPER_PROBE_FLAG_DL;
+
+  if(state->mode == PING_MODE_PROBE)
+    {
+      if(ping_probe(task, &probe, &opt) != 0)
+	goto err;
+
+      /* send the rest of the train, spaced from the first probe */
+      if(ping->train_size != 0)
 	{
-	  errno = probe.pr_errno;
-	  goto err;
+	  timeval_cpy(&tv, &probe.pr_tx);
+	  for(i=1; i<ping->train_size && ping->ping_sent<ping->probe_count; i++)
+	    {
+	      timeval_add_us(&wait_tv, &tv, i * ping->train_gap);
+	      ping_train_wait(&wait_tv);
+	      if(ping_probe(task, &probe, &opt) != 0)
+		goto err;
+	    }
 	}
-
-      /* fill out the details of the probe sent */
-      timeval_cpy(&pp->tx, &probe.pr_tx);
-      pp->ipid = ipid;
-      state->probes[state->seq] = pp;
-      state->seq++;
-      ping->ping_sent++;
     }
   else if(state->mode == PING_MODE_PTB)
     {
@@ -1209,7 +1551,6 @@ static void do_ping_probe(scamper_task_t *task)
   return;
 
  err:
-  if(pp != NULL) free(pp);
   ping_handleerror(task, errno);
   return;
 }
@@ -1415,6 +1756,26 @@ static int ping_arg_param_validate(int optid, char *param, long long *out)
 	goto err;
       break;
 
+    /* the gap between probes in a train, in microseconds */
+    case PING_OPT_TRAINGAP:
+      if(string_tollong(param, &tmp) != 0 ||
+	 tmp < SCAMPER_DO_PING_TRAINGAP_MIN ||
+	 tmp > SCAMPER_DO_PING_TRAINGAP_MAX)
+	{
+	  goto err;
+	}
+      break;
+
+    /* the number of probes in a train */
+    case PING_OPT_TRAINSIZE:
+      if(string_tollong(param, &tmp) != 0 ||
+	 tmp < SCAMPER_DO_PING_TRAINSIZE_MIN ||
+	 tmp > SCAMPER_DO_PING_TRAINSIZE_MAX)
+	{
+	  goto err;
+	}
+      break;
+
     default:
       return -1;
     }
@@ -1503,60 +1864,83 @@ static int ping_tsopt(scamper_ping_t *ping, uint32_t *flags, char *tsopt)
 }
 
 /*
- * scamper_do_ping_alloc
- *
- * given a string representing a ping task, parse the parameters and assemble
- * a ping.  return the ping structure so that it is all ready to go.
+ * ping_tmpl
  *
+ * the parameters of a ping command, parsed and checked as far as they
+ * can be without knowing the destination.
  */
-void *scamper_do_ping_alloc(char *str)
+typedef struct ping_tmpl
 {
-  uint16_t  probe_count   = SCAMPER_DO_PING_PROBECOUNT_DEF;
-  uint8_t   probe_wait    = SCAMPER_DO_PING_PROBEWAIT_DEF;
-  uint32_t  probe_wait_us = 0;
-  uint8_t   probe_ttl     = SCAMPER_DO_PING_PROBETTL_DEF;
-  uint8_t   probe_tos     = SCAMPER_DO_PING_PROBETOS_DEF;
-  uint8_t   probe_method  = SCAMPER_DO_PING_PROBEMETHOD_DEF;
-  int       probe_timeout = -1;
-  uint32_t  probe_timeout_us = 0;
-  int       probe_sport   = -1;
-  int       probe_dport   = -1;
-  uint16_t  reply_count   = SCAMPER_DO_PING_REPLYCOUNT_DEF;
-  uint16_t  reply_pmtu    = SCAMPER_DO_PING_REPLYPMTU_DEF;
-  uint16_t  probe_size    = 0; /* unset */
-  uint16_t  pattern_len   = 0;
-  uint16_t  probe_icmpsum = 0;
-  uint32_t  probe_tcpack  = 0;
+  uint16_t  probe_count;
+  uint8_t   probe_wait;
+  uint32_t  probe_wait_us;
+  uint8_t   probe_ttl;
+  uint8_t   probe_tos;
+  uint8_t   probe_method;
+  int       probe_timeout;
+  uint32_t  probe_timeout_us;
+  int       probe_sport;
+  int       probe_dport;
+  uint16_t  reply_count;
+  uint16_t  reply_pmtu;
+  uint16_t  probe_size;
+  uint16_t  pattern_len;
+  uint16_t  probe_icmpsum;
+  uint32_t  probe_tcpack;
+  uint16_t  train_size;
+  int       train_gap;
   uint8_t   pattern[SCAMPER_DO_PING_PATTERN_MAX/2];
-  uint16_t  payload_len   = 0;
-  uint8_t  *payload       = NULL;
-  uint32_t  userid        = 0;
-  uint32_t  flags         = 0;
-  char     *src           = NULL;
-  char     *rtr           = NULL;
-  char     *tsopt         = NULL;
-  int       af;
+  uint16_t  payload_len;
+  uint8_t  *payload;
+  uint32_t  userid;
+  uint32_t  flags;
+  char     *src;
+  char     *rtr;
+  char     *tsopt;
+  uint8_t   probe_tcpack_set;
+} ping_tmpl_t;
+
+static void ping_tmpl_free(ping_tmpl_t *tmpl)
+{
+  if(tmpl->payload != NULL) free(tmpl->payload);
+  if(tmpl->src != NULL) free(tmpl->src);
+  if(tmpl->rtr != NULL) free(tmpl->rtr);
+  if(tmpl->tsopt != NULL) free(tmpl->tsopt);
+  free(tmpl);
+  return;
+}
 
+/*
+ * ping_tmpl_parse
+ *
+ * parse the options in the string.  addr is set to the address that
+ * follows the options, if any.
+ */
+static ping_tmpl_t *ping_tmpl_parse(char *str, char **addr)
+{
   scamper_option_out_t *opts_out = NULL, *opt;
-  scamper_ping_t *ping = NULL;
-  uint16_t cmps = 0; /* calculated minimum probe size */
-  char *addr;
+  ping_tmpl_t *tmpl = NULL;
   size_t size;
   long long tmp = 0;
-  int i, A = 0;
-  uint16_t u16;
+  int i;
 
   /* try and parse the string passed in */
-  if(scamper_options_parse(str, opts, opts_cnt, &opts_out, &addr) != 0)
-    {
-      goto err;
-    }
+  if(scamper_options_parse(str, opts, opts_cnt, &opts_out, addr) != 0)
+    goto err;
 
-  /* if there is no IP address after the options string, then stop now */
-  if(addr == NULL)
-    {
-      goto err;
-    }
+  if((tmpl = malloc_zero(sizeof(ping_tmpl_t))) == NULL)
+    goto err;
+  tmpl->probe_count   = SCAMPER_DO_PING_PROBECOUNT_DEF;
+  tmpl->probe_wait    = SCAMPER_DO_PING_PROBEWAIT_DEF;
+  tmpl->probe_ttl     = SCAMPER_DO_PING_PROBETTL_DEF;
+  tmpl->probe_tos     = SCAMPER_DO_PING_PROBETOS_DEF;
+  tmpl->probe_method  = SCAMPER_DO_PING_PROBEMETHOD_DEF;
+  tmpl->probe_timeout = -1;
+  tmpl->probe_sport   = -1;
+  tmpl->probe_dport   = -1;
+  tmpl->reply_count   = SCAMPER_DO_PING_REPLYCOUNT_DEF;
+  tmpl->reply_pmtu    = SCAMPER_DO_PING_REPLYPMTU_DEF;
+  tmpl->train_gap     = -1;
 
   /* parse the options, do preliminary sanity checks */
   for(opt = opts_out; opt != NULL; opt = opt->next)
@@ -1571,70 +1955,76 @@ void *scamper_do_ping_alloc(char *str)
       switch(opt->id)
 	{
 	case PING_OPT_PROBETCPACK:
-	  probe_tcpack = (uint32_t)tmp;
-	  A = 1;
+	  tmpl->probe_tcpack = (uint32_t)tmp;
+	  tmpl->probe_tcpack_set = 1;
 	  break;
 
 	case PING_OPT_PAYLOAD:
-	  payload_len = (uint16_t)tmp;
-	  if(payload_len == 0 || (payload = malloc_zero(payload_len)) == NULL)
+	  if(tmpl->payload != NULL)
+	    {
+	      free(tmpl->payload);
+	      tmpl->payload = NULL;
+	    }
+	  tmpl->payload_len = (uint16_t)tmp;
+	  if(tmpl->payload_len == 0 ||
+	     (tmpl->payload = malloc_zero(tmpl->payload_len)) == NULL)
 	    goto err;
-	  for(i=0; i<payload_len; i++)
-	    payload[i] = hex2byte(opt->str[i*2], opt->str[(i*2)+1]);
-	  flags |= SCAMPER_PING_FLAG_PAYLOAD;
+	  for(i=0; i<tmpl->payload_len; i++)
+	    tmpl->payload[i] = hex2byte(opt->str[i*2], opt->str[(i*2)+1]);
+	  tmpl->flags |= SCAMPER_PING_FLAG_PAYLOAD;
 	  break;
 
 	case PING_OPT_PROBECOUNT:
-	  probe_count = (uint16_t)tmp;
+	  tmpl->probe_count = (uint16_t)tmp;
 	  break;
 
 	case PING_OPT_PROBEDPORT:
-	  probe_dport = (uint16_t)tmp;
+	  tmpl->probe_dport = (uint16_t)tmp;
 	  break;
 
 	case PING_OPT_PROBESPORT:
-	  probe_sport = (int)tmp;
+	  tmpl->probe_sport = (int)tmp;
 	  break;
 
 	case PING_OPT_PROBEMETHOD:
-	  probe_method = (uint8_t)tmp;
+	  tmpl->probe_method = (uint8_t)tmp;
 	  break;
 
 	/* how long to wait between sending probes */
 	case PING_OPT_PROBEWAIT:
-	  probe_wait    = (uint8_t)(tmp / 1000000);
-	  probe_wait_us = (uint32_t)(tmp % 1000000);
+	  tmpl->probe_wait    = (uint8_t)(tmp / 1000000);
+	  tmpl->probe_wait_us = (uint32_t)(tmp % 1000000);
 	  break;
 
 	/* the ttl to probe with */
 	case PING_OPT_PROBETTL:
-	  probe_ttl = (uint8_t)tmp;
+	  tmpl->probe_ttl = (uint8_t)tmp;
 	  break;
 
 	case PING_OPT_PROBEICMPSUM:
-	  probe_icmpsum = (uint16_t)tmp;
-	  flags |= SCAMPER_PING_FLAG_ICMPSUM;
+	  tmpl->probe_icmpsum = (uint16_t)tmp;
+	  tmpl->flags |= SCAMPER_PING_FLAG_ICMPSUM;
 	  break;
 
 	/* how many unique replies are required before the ping completes */
 	case PING_OPT_REPLYCOUNT:
-	  reply_count = (uint16_t)tmp;
+	  tmpl->reply_count = (uint16_t)tmp;
 	  break;
 
 	case PING_OPT_REPLYPMTU:
-	  reply_pmtu = (uint16_t)tmp;
-	  flags |= SCAMPER_PING_FLAG_DL;
+	  tmpl->reply_pmtu = (uint16_t)tmp;
+	  tmpl->flags |= SCAMPER_PING_FLAG_DL;
 	  break;
 
 	case PING_OPT_OPTION:
 	  if(strcasecmp(opt->str, "spoof") == 0)
-	    flags |= SCAMPER_PING_FLAG_SPOOF;
+	    tmpl->flags |= SCAMPER_PING_FLAG_SPOOF;
 	  else if(strcasecmp(opt->str, "dl") == 0)
-	    flags |= SCAMPER_PING_FLAG_DL;
+	    tmpl->flags |= SCAMPER_PING_FLAG_DL;
 	  else if(strcasecmp(opt->str, "tbt") == 0)
-	    flags |= SCAMPER_PING_FLAG_TBT;
+	    tmpl->flags |= SCAMPER_PING_FLAG_TBT;
 	  else if(strcasecmp(opt->str, "nosrc") == 0)
-	    flags |= SCAMPER_PING_FLAG_NOSRC;
+	    tmpl->flags |= SCAMPER_PING_FLAG_NOSRC;
 	  else
 	    {
 	      scamper_debug(__func__, "unknown option %s", opt->str);
@@ -1647,63 +2037,135 @@ void *scamper_do_ping_alloc(char *str)
 	  size = strlen(opt->str);
 	  if((size % 2) == 0)
 	    {
-	      pattern_len = size/2;
-	      for(i=0; i<pattern_len; i++)
-		pattern[i] = hex2byte(opt->str[i*2], opt->str[(i*2)+1]);
+	      tmpl->pattern_len = size/2;
+	      for(i=0; i<tmpl->pattern_len; i++)
+		tmpl->pattern[i] = hex2byte(opt->str[i*2], opt->str[(i*2)+1]);
 	    }
 	  else
 	    {
-	      pattern_len = (size/2) + 1;
-	      pattern[0] = hex2byte('0', opt->str[0]);
-	      for(i=1; i<pattern_len; i++)
-		pattern[i] = hex2byte(opt->str[(i*2)-1], opt->str[i*2]);
+	      tmpl->pattern_len = (size/2) + 1;
+	      tmpl->pattern[0] = hex2byte('0', opt->str[0]);
+	      for(i=1; i<tmpl->pattern_len; i++)
+		tmpl->pattern[i] = hex2byte(opt->str[(i*2)-1], opt->str[i*2]);
 	    }
 	  break;
 
 	/* the size of each probe */
 	case PING_OPT_PROBESIZE:
-	  probe_size = (uint16_t)tmp;
+	  tmpl->probe_size = (uint16_t)tmp;
 	  break;
 
 	case PING_OPT_USERID:
-	  userid = (uint32_t)tmp;
+	  tmpl->userid = (uint32_t)tmp;
 	  break;
 
 	case PING_OPT_RTRADDR:
-	  if(rtr != NULL)
+	  if(tmpl->rtr != NULL || (tmpl->rtr = strdup(opt->str)) == NULL)
 	    goto err;
-	  rtr = opt->str;
 	  break;
 
 	case PING_OPT_RECORDROUTE:
-	  flags |= SCAMPER_PING_FLAG_V4RR;
+	  tmpl->flags |= SCAMPER_PING_FLAG_V4RR;
 	  break;
 
 	case PING_OPT_SRCADDR:
-	  if(src != NULL)
+	  if(tmpl->src != NULL || (tmpl->src = strdup(opt->str)) == NULL)
 	    goto err;
-	  src = opt->str;
 	  break;
 
 	case PING_OPT_TIMESTAMP:
-	  if(tsopt != NULL)
+	  if(tmpl->tsopt != NULL || (tmpl->tsopt = strdup(opt->str)) == NULL)
 	    goto err;
-	  tsopt = opt->str;
 	  break;
 
 	/* the tos bits to include in each probe */
 	case PING_OPT_PROBETOS:
-	  probe_tos = (uint8_t)tmp;
+	  tmpl->probe_tos = (uint8_t)tmp;
 	  break;
 
 	case PING_OPT_PROBETIMEOUT:
-	  probe_timeout    = (int)(tmp / 1000000);
-	  probe_timeout_us = (uint32_t)(tmp % 1000000);
+	  tmpl->probe_timeout    = (int)(tmp / 1000000);
+	  tmpl->probe_timeout_us = (uint32_t)(tmp % 1000000);
+	  break;
+
+	case PING_OPT_TRAINGAP:
+	  tmpl->train_gap = (int)tmp;
+	  break;
+
+	case PING_OPT_TRAINSIZE:
+	  tmpl->train_size = (uint16_t)tmp;
 	  break;
 	}
     }
   scamper_options_free(opts_out); opts_out = NULL;
 
+  /* only one of these two should be specified */
+  if(tmpl->pattern_len != 0 && tmpl->payload_len != 0)
+    goto err;
+
+  /*
+   * the probes in a train are sent back-to-back, so they must leave on
+   * a regular socket: the datalink might have to look up the framing
+   * first.  a train gap only makes sense with a train.  a train holds
+   * up every other task while it is sent, so bound how long it lasts.
+   */
+  if(tmpl->train_size != 0)
+    {
+      if(tmpl->train_gap == -1)
+	tmpl->train_gap = SCAMPER_DO_PING_TRAINGAP_DEF;
+      if((tmpl->train_size - 1) * tmpl->train_gap >
+	 SCAMPER_DO_PING_TRAINDUR_MAX)
+	goto err;
+      if(tmpl->rtr != NULL || (tmpl->flags & (SCAMPER_PING_FLAG_SPOOF |
+					      SCAMPER_PING_FLAG_DL)) != 0)
+	goto err;
+    }
+  else if(tmpl->train_gap != -1)
+    goto err;
+
+  return tmpl;
+
+ err:
+  if(tmpl != NULL) ping_tmpl_free(tmpl);
+  if(opts_out != NULL) scamper_options_free(opts_out);
+  return NULL;
+}
+
+/*
+ * ping_tmpl_ping
+ *
+ * build a ping to the destination from the template, and do the checks
+ * that depend on the destination.
+ */
+static scamper_ping_t *ping_tmpl_ping(const ping_tmpl_t *tmpl,
+				      const char *addr)
+{
+  uint16_t  probe_count      = tmpl->probe_count;
+  uint8_t   probe_wait       = tmpl->probe_wait;
+  uint32_t  probe_wait_us    = tmpl->probe_wait_us;
+  uint8_t   probe_ttl        = tmpl->probe_ttl;
+  uint8_t   probe_tos        = tmpl->probe_tos;
+  uint8_t   probe_method     = tmpl->probe_method;
+  int       probe_timeout    = tmpl->probe_timeout;
+  uint32_t  probe_timeout_us = tmpl->probe_timeout_us;
+  int       probe_sport      = tmpl->probe_sport;
+  int       probe_dport      = tmpl->probe_dport;
+  uint16_t  reply_count      = tmpl->reply_count;
+  uint16_t  reply_pmtu       = tmpl->reply_pmtu;
+  uint16_t  probe_size       = tmpl->probe_size;
+  uint16_t  pattern_len      = tmpl->pattern_len;
+  uint16_t  probe_icmpsum    = tmpl->probe_icmpsum;
+  uint32_t  probe_tcpack     = tmpl->probe_tcpack;
+  uint16_t  payload_len      = tmpl->payload_len;
+  uint16_t  train_size       = tmpl->train_size;
+  uint32_t  userid           = tmpl->userid;
+  uint32_t  flags            = tmpl->flags;
+  scamper_ping_t *ping = NULL;
+  uint16_t cmps = 0; /* calculated minimum probe size */
+  char *tsopt = NULL;
+  uint16_t u16;
+  int af;
+
   /* allocate the ping object and determine the address to probe */
   if((ping = scamper_ping_alloc()) == NULL)
     {
@@ -1715,15 +2177,11 @@ void *scamper_do_ping_alloc(char *str)
     }
   ping->probe_method = probe_method;
 
-  /* only one of these two should be specified */
-  if(pattern_len != 0 && payload_len != 0)
-    goto err;
-
   /*
    * put together the timestamp option now so we can judge how large the
    * options will be
    */
-  if(tsopt != NULL)
+  if(tmpl->tsopt != NULL)
     {
       if(ping->dst->type != SCAMPER_ADDR_TYPE_IPV4)
 	goto err;
@@ -1731,8 +2189,10 @@ void *scamper_do_ping_alloc(char *str)
       if((flags & SCAMPER_PING_FLAG_V4RR) != 0)
 	goto err;
 
-      if(ping_tsopt(ping, &flags, tsopt) != 0)
+      if((tsopt = strdup(tmpl->tsopt)) == NULL ||
+	 ping_tsopt(ping, &flags, tsopt) != 0)
 	goto err;
+      free(tsopt); tsopt = NULL;
     }
 
   /* ensure the probe size specified is suitable */
@@ -1830,27 +2290,31 @@ void *scamper_do_ping_alloc(char *str)
       goto err;
     }
 
+  /* TCP probes are sent on the datalink, which rules out trains */
+  if(train_size != 0 && SCAMPER_PING_METHOD_IS_TCP(ping))
+    goto err;
+
   af = scamper_addr_af(ping->dst);
   if(af != AF_INET && af != AF_INET6)
     goto err;
 
-  if(src != NULL &&
-     (ping->src = scamper_addr_resolve(af, src)) == NULL)
+  if(tmpl->src != NULL &&
+     (ping->src = scamper_addr_resolve(af, tmpl->src)) == NULL)
     goto err;
 
-  if(rtr != NULL &&
-     (ping->rtr = scamper_addr_resolve(af, rtr)) == NULL)
+  if(tmpl->rtr != NULL &&
+     (ping->rtr = scamper_addr_resolve(af, tmpl->rtr)) == NULL)
     goto err;
 
   /* copy in the data bytes, if any */
   if(pattern_len != 0)
     {
-      if(scamper_ping_setdata(ping, pattern, pattern_len) != 0)
+      if(scamper_ping_setdata(ping, tmpl->pattern, pattern_len) != 0)
 	goto err;
     }
   else if(payload_len != 0)
     {
-      if(scamper_ping_setdata(ping, payload, payload_len) != 0)
+      if(scamper_ping_setdata(ping, tmpl->payload, payload_len) != 0)
 	goto err;
     }
 
@@ -1904,10 +2368,13 @@ void *scamper_do_ping_alloc(char *str)
   ping->reply_pmtu       = reply_pmtu;
   ping->userid           = userid;
   ping->flags            = flags;
+  ping->train_size       = train_size;
+  if(train_size != 0)
+    ping->train_gap      = tmpl->train_gap;
 
   if(SCAMPER_PING_METHOD_IS_TCP(ping))
     {
-      if(A == 0 && random_u32(&probe_tcpack) != 0)
+      if(tmpl->probe_tcpack_set == 0 && random_u32(&probe_tcpack) != 0)
 	goto err;
 
       if(ping->probe_method == SCAMPER_PING_METHOD_TCP_SYN ||
@@ -1929,11 +2396,60 @@ void *scamper_do_ping_alloc(char *str)
 
  err:
   if(ping != NULL) scamper_ping_free(ping);
-  if(payload != NULL) free(payload);
-  if(opts_out != NULL) scamper_options_free(opts_out);
+  if(tsopt != NULL) free(tsopt);
   return NULL;
 }
 
+/*
+ * scamper_do_ping_alloc
+ *
+ * given a string representing a ping task, parse the parameters and assemble
+ * a ping.  return the ping structure so that it is all ready to go.
+ *
+ */
+void *scamper_do_ping_alloc(char *str)
+{
+  scamper_ping_t *ping = NULL;
+  ping_tmpl_t *tmpl;
+  char *addr;
+
+  if((tmpl = ping_tmpl_parse(str, &addr)) == NULL)
+    return NULL;
+
+  /* if there is no IP address after the options string, then stop now */
+  if(addr != NULL)
+    ping = ping_tmpl_ping(tmpl, addr);
+
+  ping_tmpl_free(tmpl);
+  return ping;
+}
+
+void *scamper_do_ping_tmpl_alloc(char *str)
+{
+  ping_tmpl_t *tmpl;
+  char *addr;
+
+  /* a template does not have an address */
+  if((tmpl = ping_tmpl_parse(str, &addr)) != NULL && addr != NULL)
+    {
+      ping_tmpl_free(tmpl);
+      tmpl = NULL;
+    }
+
+  return tmpl;
+}
+
+void *scamper_do_ping_tmpl_data(const void *tmpl, const char *addr)
+{
+  return ping_tmpl_ping(tmpl, addr);
+}
+
+void scamper_do_ping_tmpl_free(void *tmpl)
+{
+  ping_tmpl_free(tmpl);
+  return;
+}
+
 static void do_ping_halt(scamper_task_t *task)
 {
   ping_stop(task, SCAMPER_PING_STOP_HALTED, 0);
@@ -2012,6 +2528,7 @@ int scamper_do_ping_init()
   ping_funcs.handle_dl      = do_ping_handle_dl;
   ping_funcs.write          = do_ping_write;
   ping_funcs.task_free      = do_ping_free;
+  ping_funcs.name           = "ping";
   ping_funcs.halt           = do_ping_halt;
 
 #ifndef _WIN32
@@ -27,6 +27,11 @@
 
 void *scamper_do_ping_alloc(char *str);
 
+/* parse a command without an address once, to build pings from later */
+void *scamper_do_ping_tmpl_alloc(char *str);
+void *scamper_do_ping_tmpl_data(const void *tmpl, const char *addr);
+void scamper_do_ping_tmpl_free(void *tmpl);
+
 scamper_task_t *scamper_do_ping_alloctask(void *data,
 					  scamper_list_t *list,
 					  scamper_cycle_t *cycle);
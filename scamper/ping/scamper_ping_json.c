@@ -91,6 +91,10 @@ static char *ping_header(const scamper_ping_t *ping)
   if(ping->probe_timeout_us != 0)
     string_concat(buf, sizeof(buf), &off,
 		  ", \"timeout_us\":%u", ping->probe_timeout_us);
+  if(ping->train_size != 0)
+    string_concat(buf, sizeof(buf), &off,
+		  ", \"train_size\":%u, \"train_gap\":%u",
+		  ping->train_size, ping->train_gap);
 
   if(SCAMPER_PING_METHOD_IS_UDP(ping) || SCAMPER_PING_METHOD_IS_TCP(ping))
     string_concat(buf, sizeof(buf), &off, ", \"sport\":%u, \"dport\":%u",
@@ -295,6 +299,38 @@ static char *ping_reply(const scamper_ping_t *ping,
   return strdup(buf);
 }
 
+static char *ping_trains(const scamper_ping_t *ping)
+{
+  const scamper_ping_train_t *train;
+  size_t len, off = 0;
+  char *buf;
+  uint16_t i;
+
+  len = 16 + (ping->trainc * 160);
+  if((buf = malloc(len)) == NULL)
+    return NULL;
+
+  string_concat(buf, len, &off, "\"trains\":[");
+  for(i=0; i<ping->trainc; i++)
+    {
+      train = &ping->trains[i];
+      if(i > 0) string_concat(buf, len, &off, ",");
+      string_concat(buf, len, &off,
+		    "{\"probe_id\":%u, \"probes\":%u", train->probe_id,
+		    train->probec);
+      string_concat(buf, len, &off,
+		    ", \"gap_min\":%u, \"gap_max\":%u, \"gap_mean\":%u",
+		    train->gap_min, train->gap_max, train->gap_mean);
+      string_concat(buf, len, &off, ", \"jitter\":%u, \"dltx\":%s}",
+		    train->jitter,
+		    (train->flags & SCAMPER_PING_TRAIN_FLAG_DLTX) != 0 ?
+		    "true" : "false");
+    }
+  string_concat(buf, len, &off, "],");
+
+  return buf;
+}
+
 static char *ping_stats(const scamper_ping_t *ping)
 {
   scamper_ping_stats_t stats;
@@ -345,6 +381,8 @@ int scamper_file_json_ping_write(const scamper_file_t *sf,
   size_t    header_len  = 0;
   char    **replies     = NULL;
   size_t   *reply_lens  = NULL;
+  char     *trains      = NULL;
+  size_t    trains_len  = 0;
   char     *stats       = NULL;
   size_t    stats_len   = 0;
   char     *str         = NULL;
@@ -384,6 +422,12 @@ int scamper_file_json_ping_write(const scamper_file_t *sf,
 	}
     }
   len += 2; /* ], */
+  if(ping->trainc > 0)
+    {
+      if((trains = ping_trains(ping)) == NULL)
+	goto cleanup;
+      len += (trains_len = strlen(trains));
+    }
   if((stats = ping_stats(ping)) != NULL)
     len += (stats_len = strlen(stats));
   len += 2; /* }\n */
@@ -403,6 +447,11 @@ int scamper_file_json_ping_write(const scamper_file_t *sf,
       wc += reply_lens[i];
     }
   memcpy(str+wc, "],", 2); wc += 2;
+  if(trains != NULL)
+    {
+      memcpy(str+wc, trains, trains_len);
+      wc += trains_len;
+    }
   if(stats != NULL)
     {
       memcpy(str+wc, stats, stats_len);
@@ -416,6 +465,7 @@ int scamper_file_json_ping_write(const scamper_file_t *sf,
  cleanup:
   if(str != NULL) free(str);
   if(header != NULL) free(header);
+  if(trains != NULL) free(trains);
   if(stats != NULL) free(stats);
   if(reply_lens != NULL) free(reply_lens);
   if(replies != NULL)
@@ -144,10 +144,14 @@ static char *ping_reply(const scamper_ping_t *ping,
 static char *ping_stats(const scamper_ping_t *ping)
 {
   scamper_ping_stats_t stats;
+  const scamper_ping_train_t *train;
+  uint32_t gap_min = 0, gap_max = 0, gapc = 0;
+  uint64_t gap_sum = 0, jitter_sum = 0;
   size_t off = 0;
   char str[64];
   char buf[512];
   int rp = 0;
+  uint16_t i;
 
   if(scamper_ping_stats(ping, &stats) != 0)
     return NULL;
@@ -176,6 +180,28 @@ static char *ping_stats(const scamper_ping_t *ping)
       		    timeval_tostr_us(&stats.stddev_rtt, str, sizeof(str)));
     }
 
+  /* weight each train's gap statistics by the number of gaps in it */
+  for(i=0; i<ping->trainc; i++)
+    {
+      train = &ping->trains[i];
+      if(train->probec < 2)
+	continue;
+      if(gapc == 0 || gap_min > train->gap_min)
+	gap_min = train->gap_min;
+      if(gapc == 0 || gap_max < train->gap_max)
+	gap_max = train->gap_max;
+      gap_sum += (uint64_t)train->gap_mean * (train->probec - 1);
+      jitter_sum += (uint64_t)train->jitter * (train->probec - 1);
+      gapc += train->probec - 1;
+    }
+  if(gapc > 0)
+    string_concat(buf, sizeof(buf), &off,
+		  "%u train%s of %u probes, gap min/avg/max/jitter ="
+		  " %u/%u/%u/%u us\n", ping->trainc,
+		  ping->trainc != 1 ? "s" : "", ping->train_size,
+		  gap_min, (uint32_t)(gap_sum / gapc), gap_max,
+		  (uint32_t)(jitter_sum / gapc));
+
   return strdup(buf);
 }
 
@@ -76,6 +76,9 @@
 #define WARTS_PING_PROBE_TCPSEQ   31
 #define WARTS_PING_ADDR_RTR       32
 #define WARTS_PING_PROBE_TIMEOUT_US 33
+#define WARTS_PING_TRAIN_SIZE     34
+#define WARTS_PING_TRAIN_GAP      35
+#define WARTS_PING_TRAINC         36
 
 static const warts_var_t ping_vars[] =
 {
@@ -112,6 +115,9 @@ static const warts_var_t ping_vars[] =
   {WARTS_PING_PROBE_TCPSEQ,   4, -1},
   {WARTS_PING_ADDR_RTR,      -1, -1},
   {WARTS_PING_PROBE_TIMEOUT_US, 4, -1},
+  {WARTS_PING_TRAIN_SIZE,     2, -1},
+  {WARTS_PING_TRAIN_GAP,      2, -1},
+  {WARTS_PING_TRAINC,         2, -1},
 };
 #define ping_vars_mfb WARTS_VAR_MFB(ping_vars)
 
@@ -538,7 +544,10 @@ static void warts_ping_params(const scamper_ping_t *ping,
 	 (var->id == WARTS_PING_PROBE_WAIT_US && ping->probe_wait_us == 0) ||
 	 (var->id == WARTS_PING_PROBE_TIMEOUT_US && ping->probe_timeout_us == 0) ||
 	 (var->id == WARTS_PING_PROBE_TCPACK  && ping->probe_tcpack == 0) ||
-	 (var->id == WARTS_PING_PROBE_TCPSEQ  && ping->probe_tcpseq == 0))
+	 (var->id == WARTS_PING_PROBE_TCPSEQ  && ping->probe_tcpseq == 0) ||
+	 (var->id == WARTS_PING_TRAIN_SIZE    && ping->train_size == 0) ||
+	 (var->id == WARTS_PING_TRAIN_GAP     && ping->train_size == 0) ||
+	 (var->id == WARTS_PING_TRAINC        && ping->trainc == 0))
 	{
 	  continue;
 	}
@@ -678,6 +687,9 @@ static int warts_ping_params_read(scamper_ping_t *ping, warts_state_t *state,
     {&ping->probe_tcpseq,  (wpr_t)extract_uint32,          NULL},
     {&ping->rtr,           (wpr_t)extract_addr_static,     NULL},
     {&ping->probe_timeout_us, (wpr_t)extract_uint32,       NULL},
+    {&ping->train_size,    (wpr_t)extract_uint16,          NULL},
+    {&ping->train_gap,     (wpr_t)extract_uint16,          NULL},
+    {&ping->trainc,        (wpr_t)extract_uint16,          NULL},
   };
   const int handler_cnt = sizeof(handlers)/sizeof(warts_param_reader_t);
   uint32_t o = *off;
@@ -741,6 +753,9 @@ static int warts_ping_params_write(const scamper_ping_t *ping,
     {&ping->probe_tcpseq,  (wpw_t)insert_uint32,          NULL},
     {ping->rtr,            (wpw_t)insert_addr_static,     NULL},
     {&ping->probe_timeout_us, (wpw_t)insert_uint32,       NULL},
+    {&ping->train_size,    (wpw_t)insert_uint16,          NULL},
+    {&ping->train_gap,     (wpw_t)insert_uint16,          NULL},
+    {&ping->trainc,        (wpw_t)insert_uint16,          NULL},
   };
 
   const int handler_cnt = sizeof(handlers)/sizeof(warts_param_writer_t);
@@ -753,6 +768,59 @@ static int warts_ping_params_write(const scamper_ping_t *ping,
   return 0;
 }
 
+/*
+ * the summary of each train follows the reply records.  older readers
+ * stop after the replies, and do not see them.
+ */
+#define WARTS_PING_TRAIN_LEN 21
+
+static int warts_ping_trains_read(scamper_ping_t *ping, const uint8_t *buf,
+				  uint32_t *off, uint32_t len)
+{
+  scamper_ping_train_t *train;
+  uint16_t i, trainc = ping->trainc;
+
+  ping->trainc = 0;
+  if(scamper_ping_trains_alloc(ping, trainc) != 0)
+    return -1;
+
+  for(i=0; i<trainc; i++)
+    {
+      train = &ping->trains[i];
+      if(extract_uint16(buf, off, len, &train->probe_id, NULL) != 0 ||
+	 extract_uint16(buf, off, len, &train->probec, NULL) != 0 ||
+	 extract_byte(buf, off, len, &train->flags, NULL) != 0 ||
+	 extract_uint32(buf, off, len, &train->gap_min, NULL) != 0 ||
+	 extract_uint32(buf, off, len, &train->gap_max, NULL) != 0 ||
+	 extract_uint32(buf, off, len, &train->gap_mean, NULL) != 0 ||
+	 extract_uint32(buf, off, len, &train->jitter, NULL) != 0)
+	return -1;
+    }
+
+  return 0;
+}
+
+static void warts_ping_trains_write(const scamper_ping_t *ping, uint8_t *buf,
+				    uint32_t *off, uint32_t len)
+{
+  const scamper_ping_train_t *train;
+  uint16_t i;
+
+  for(i=0; i<ping->trainc; i++)
+    {
+      train = &ping->trains[i];
+      insert_uint16(buf, off, len, &train->probe_id, NULL);
+      insert_uint16(buf, off, len, &train->probec, NULL);
+      insert_byte(buf, off, len, &train->flags, NULL);
+      insert_uint32(buf, off, len, &train->gap_min, NULL);
+      insert_uint32(buf, off, len, &train->gap_max, NULL);
+      insert_uint32(buf, off, len, &train->gap_mean, NULL);
+      insert_uint32(buf, off, len, &train->jitter, NULL);
+    }
+
+  return;
+}
+
 int scamper_file_warts_ping_read(scamper_file_t *sf, const warts_hdr_t *hdr,
 				 scamper_ping_t **ping_out)
 {
@@ -826,14 +894,16 @@ int scamper_file_warts_ping_read(scamper_file_t *sf, const warts_hdr_t *hdr,
     }
 
  done:
+  if(ping->trainc > 0 &&
+     warts_ping_trains_read(ping, buf, &off, hdr->len) != 0)
+    goto err;
+
   warts_addrtable_free(table);
   *ping_out = ping;
-  free(buf);
   return 0;
 
  err:
   if(table != NULL) warts_addrtable_free(table);
-  if(buf != NULL) free(buf);
   if(ping != NULL) scamper_ping_free(ping);
   return -1;
 }
@@ -860,6 +930,7 @@ int scamper_file_warts_ping_write(const scamper_file_t *sf,
 
   /* length of the ping's flags, parameters, and number of reply records */
   len = 8 + flags_len + 2 + params_len + 2;
+  len += ping->trainc * WARTS_PING_TRAIN_LEN;
 
   if((reply_count = scamper_ping_reply_count(ping)) > 0)
     {
@@ -909,6 +980,8 @@ int scamper_file_warts_ping_write(const scamper_file_t *sf,
       reply_state = NULL;
     }
 
+  warts_ping_trains_write(ping, buf, &off, len);
+
   assert(off == len);
 
   if(warts_write(sf, buf, len) == -1)
@@ -56,10 +56,14 @@
 #include "scamper_dl.h"
 #include "scamper_firewall.h"
 #include "scamper_probe.h"
+#include "scamper_shard.h"
+#include "scamper_stopset.h"
+#include "scamper_slab.h"
 #include "scamper_privsep.h"
 #include "scamper_control.h"
 #include "scamper_osinfo.h"
 #include "trace/scamper_trace_do.h"
+#include "trace/scamper_sweep_do.h"
 #include "ping/scamper_ping_do.h"
 #include "tracelb/scamper_tracelb_do.h"
 #include "dealias/scamper_dealias_do.h"
@@ -104,6 +108,11 @@
 #define FLAG_DEBUGFILEAPPEND 0x00000080
 #define FLAG_NOTLS_REMOTE    0x00000100
 #define FLAG_NOTLS           0x00000200
+#define FLAG_DLRING          0x00000800
+#define FLAG_TXBATCH         0x00001000
+#define FLAG_RXBATCH         0x00002000
+#define FLAG_IOURING         0x00004000
+#define FLAG_NOSLAB          0x00008000
 #if defined(IP_RECVERR) || defined(IPV6_RECVERR)
 #define FLAG_ICMP_RECVERR    0x00000400
 #endif
@@ -115,6 +124,9 @@
  * command:     default command to use with scamper
  * pps:         how many probe packets to send per second
  * window:      maximum number of concurrent tasks to actively probe
+ * memlimit:    megabytes of task memory above which no new tasks start
+ * dnscache:    number of PTR and A answers to cache
+ * dnscache_file: file to keep cached PTR and A answers in across runs
  * outfile:     where to send results by default
  * outtype:     format to use when writing results to outfile
  * intype:      format of input file
@@ -133,12 +145,19 @@
  * debugfile:   place to write debugging output
  * firewall:    scamper should use the system firewall when needed
  * pidfile:     place to write process id
+ * shards:      number of processes to spread the probing tasks across
+ * zlevel:      level to compress .gz, .zst, and .xz outfiles at
+ * stopset:     file holding a doubletree stop set shared with other monitors
+ * stopset_slots: number of slots to create the stop set file with
  */
 static uint32_t options    = 0;
 static uint32_t flags      = 0;
 static char  *command      = NULL;
 static int    pps          = SCAMPER_OPTION_PPS_DEF;
 static int    window       = SCAMPER_OPTION_WINDOW_DEF;
+static int    memlimit     = SCAMPER_OPTION_MEMLIMIT_DEF;
+static int    dnscache     = SCAMPER_OPTION_DNSCACHE_DEF;
+static char  *dnscache_file = NULL;
 static char  *outfile      = "-";
 static char  *outtype      = "text";
 static char  *intype       = NULL;
@@ -156,6 +175,10 @@ static char **arglist      = NULL;
 static int    arglist_len  = 0;
 static char  *firewall     = NULL;
 static char  *pidfile      = NULL;
+static int    shards       = 0;
+static int    zlevel       = 0;
+static char  *stopset      = NULL;
+static long   stopset_slots = SCAMPER_STOPSET_SLOTS_DEF;
 
 #ifndef WITHOUT_DEBUGFILE
 static char  *debugfile    = NULL;
@@ -297,9 +320,19 @@ static void usage(uint32_t opt_mask)
       usage_line("noinitndc: do not initialise neighbour discovery cache");
       usage_line("outcopy: output copy of all results collected to file");
       usage_line("rawtcp: use raw socket to send IPv4 TCP probes");
+      usage_line("noslab: allocate replies and hops with malloc, not slabs");
 #if defined(IP_RECVERR) || defined(IPV6_RECVERR)
       usage_line("icmp-rxerr: use recverr cmsg to receive ICMP responses");
 #endif
+#ifdef __linux__
+      usage_line("dl-ring: use a PACKET_MMAP ring to read datalink frames");
+#endif
+#ifdef HAVE_SENDMMSG
+      usage_line("txbatch: send probes due together with sendmmsg(2)");
+#endif
+#ifdef HAVE_RECVMMSG
+      usage_line("rxbatch: read ICMP responses together with recvmmsg(2)");
+#endif
 #ifdef HAVE_OPENSSL
       usage_line("notls: do not use TLS anywhere in scamper");
       usage_line("notls-remote: do not use TLS on remote control sockets");
@@ -309,6 +342,9 @@ static void usage(uint32_t opt_mask)
 #endif
 #ifndef _WIN32
       usage_line("select: use select(2) rather than poll(2)");
+      usage_line("shards=n: spread the tasks across n probing processes");
+      usage_line("stopset=file[:slots]: share a doubletree stop set in file");
+      usage_line("dnscache-file=file: keep cached DNS answers in file");
 #endif
 #ifdef HAVE_KQUEUE
       usage_line("kqueue: use kqueue(2) rather than poll(2)");
@@ -316,6 +352,12 @@ static void usage(uint32_t opt_mask)
 #ifdef HAVE_EPOLL
       usage_line("epoll: use epoll(7) rather than poll(2)");
 #endif
+#ifdef HAVE_IO_URING
+      usage_line("io_uring: use io_uring(7) rather than poll(2)");
+#endif
+      usage_line("memlimit=n: start no new tasks while tasks hold n MB");
+      usage_line("dnscache=n: cache up to n PTR and A answers");
+      usage_line("zlevel=n: compress .gz, .zst, and .xz outfiles at level n");
 #ifndef WITHOUT_DEBUGFILE
       usage_line("debugfileappend: append to debugfile, rather than truncate");
 #endif
@@ -486,6 +528,8 @@ static int check_options(int argc, char *argv[])
      scamper_do_sniff_arg_validate, scamper_do_sniff_usage},
     {"scamper-host", "host",
      scamper_do_host_arg_validate, scamper_do_host_usage},
+    {"scamper-sweep", "sweep",
+     scamper_do_sweep_arg_validate, scamper_do_sweep_usage},
   };
   int   i;
   long  lo_w = window, lo_p = pps;
@@ -494,7 +538,11 @@ static int check_options(int argc, char *argv[])
   char *opt_ctrl_inet = NULL, *opt_ctrl_unix = NULL, *opt_monitorname = NULL;
   char *opt_pps = NULL, *opt_command = NULL, *opt_window = NULL;
   char *opt_firewall = NULL, *opt_pidfile = NULL, *opt_ctrl_remote = NULL;
-  char *opt_nameserver = NULL;
+  char *opt_nameserver = NULL, *opt_shards = NULL, *opt_zlevel = NULL;
+  char *opt_memlimit = NULL, *opt_dnscache = NULL, *opt_stopset = NULL;
+  char *ptr;
+  struct stat sb;
+  long  lo;
 
 #ifndef WITHOUT_DEBUGFILE
   char *opt_debugfile = NULL;
@@ -619,18 +667,45 @@ static int check_options(int argc, char *argv[])
 	    flags |= FLAG_OUTCOPY;
 	  else if(strcasecmp(optarg, "rawtcp") == 0)
 	    flags |= FLAG_RAWTCP;
+	  else if(strcasecmp(optarg, "noslab") == 0)
+	    flags |= FLAG_NOSLAB;
 #if defined(IP_RECVERR) || defined(IPV6_RECVERR)
 	  else if(strcasecmp(optarg, "icmp-rxerr") == 0 ||
 		  strcasecmp(optarg, "rxerr-icmp") == 0)
 	    flags |= FLAG_ICMP_RECVERR;
+#endif
+#ifdef __linux__
+	  else if(strcasecmp(optarg, "dl-ring") == 0)
+	    flags |= FLAG_DLRING;
+#endif
+#ifdef HAVE_SENDMMSG
+	  else if(strcasecmp(optarg, "txbatch") == 0)
+	    flags |= FLAG_TXBATCH;
+#endif
+#ifdef HAVE_RECVMMSG
+	  else if(strcasecmp(optarg, "rxbatch") == 0)
+	    flags |= FLAG_RXBATCH;
 #endif
 	  else if(strcasecmp(optarg, "notls-remote") == 0)
 	    flags |= FLAG_NOTLS_REMOTE;
 	  else if(strcasecmp(optarg, "notls") == 0)
 	    flags |= FLAG_NOTLS;
+	  else if(strncasecmp(optarg, "zlevel=", 7) == 0)
+	    opt_zlevel = optarg+7;
+	  else if(strncasecmp(optarg, "memlimit=", 9) == 0)
+	    opt_memlimit = optarg+9;
+	  else if(strncasecmp(optarg, "dnscache=", 9) == 0)
+	    opt_dnscache = optarg+9;
 #ifndef _WIN32
 	  else if(strcasecmp(optarg, "select") == 0)
 	    flags |= FLAG_SELECT;
+	  else if(strncasecmp(optarg, "shards=", 7) == 0)
+	    opt_shards = optarg+7;
+	  else if(strncasecmp(optarg, "stopset=", 8) == 0 && optarg[8] != '\0')
+	    opt_stopset = optarg+8;
+	  else if(strncasecmp(optarg, "dnscache-file=", 14) == 0 &&
+		  optarg[14] != '\0')
+	    dnscache_file = optarg+14;
 #endif
 #ifdef HAVE_KQUEUE
 	  else if(strcasecmp(optarg, "kqueue") == 0)
@@ -640,6 +715,10 @@ static int check_options(int argc, char *argv[])
 	  else if(strcasecmp(optarg, "epoll") == 0)
 	    flags |= FLAG_EPOLL;
 #endif
+#ifdef HAVE_IO_URING
+	  else if(strcasecmp(optarg, "io_uring") == 0)
+	    flags |= FLAG_IOURING;
+#endif
 #ifndef WITHOUT_DEBUGFILE
 	  else if(strcasecmp(optarg, "debugfileappend") == 0)
 	    flags |= FLAG_DEBUGFILEAPPEND;
@@ -735,6 +814,73 @@ static int check_options(int argc, char *argv[])
 	}
     }
 
+  /* shards read their tasks from the input, not from control sockets */
+  if(opt_shards != NULL)
+    {
+      if(string_tolong(opt_shards, &lo) != 0 ||
+	 lo < SCAMPER_SHARD_MIN || lo > SCAMPER_SHARD_MAX ||
+	 (options & (OPT_CTRL_INET|OPT_CTRL_UNIX|OPT_CTRL_REMOTE)) != 0)
+	{
+	  usage(OPT_OPTION);
+	  return -1;
+	}
+      shards = lo;
+    }
+
+  /* the codec named by the outfile's suffix checks the level further */
+  if(opt_zlevel != NULL)
+    {
+      if(string_tolong(opt_zlevel, &lo) != 0 || lo < 1 || lo > 22)
+	{
+	  usage(OPT_OPTION);
+	  return -1;
+	}
+      zlevel = lo;
+    }
+
+  if(opt_memlimit != NULL)
+    {
+      if(string_tolong(opt_memlimit, &lo) != 0 ||
+	 lo < SCAMPER_OPTION_MEMLIMIT_MIN || lo > SCAMPER_OPTION_MEMLIMIT_MAX)
+	{
+	  usage(OPT_OPTION);
+	  return -1;
+	}
+      memlimit = lo;
+    }
+
+  if(opt_dnscache != NULL)
+    {
+      if(string_tolong(opt_dnscache, &lo) != 0 ||
+	 lo < SCAMPER_OPTION_DNSCACHE_MIN || lo > SCAMPER_OPTION_DNSCACHE_MAX)
+	{
+	  usage(OPT_OPTION);
+	  return -1;
+	}
+      dnscache = lo;
+    }
+
+  /* the stop set file can be followed by the number of slots it holds */
+  if(opt_stopset != NULL)
+    {
+      if((stopset = strdup(opt_stopset)) == NULL)
+	{
+	  printerror(__func__, "could not strdup stopset");
+	  return -1;
+	}
+      if((ptr = strrchr(stopset, ':')) != NULL && string_isdigit(ptr+1) != 0)
+	{
+	  if(string_tolong(ptr+1, &lo) != 0 ||
+	     lo < SCAMPER_STOPSET_SLOTS_MIN || lo > SCAMPER_STOPSET_SLOTS_MAX)
+	    {
+	      usage(OPT_OPTION);
+	      return -1;
+	    }
+	  *ptr = '\0';
+	  stopset_slots = lo;
+	}
+    }
+
   if(options & OPT_FIREWALL && (firewall = strdup(opt_firewall)) == NULL)
     {
       printerror(__func__, "could not strdup firewall");
@@ -889,6 +1035,18 @@ static int check_options(int argc, char *argv[])
 	  usage(0);
 	  return -1;
 	}
+
+      /*
+       * each shard reads the whole input file for itself, so the input
+       * cannot be stdin, a pipe, or anything else that is read only once
+       */
+      if(shards != 0 &&
+	 (strcmp(arglist[0], "-") == 0 || stat(arglist[0], &sb) != 0 ||
+	  S_ISREG(sb.st_mode) == 0))
+	{
+	  usage(OPT_INFILE | OPT_OPTION);
+	  return -1;
+	}
     }
 
 #ifdef HAVE_OPENSSL
@@ -974,6 +1132,42 @@ int scamper_option_window_set(const int w)
   return ppswindow_set(pps, w);
 }
 
+int scamper_option_memlimit_get()
+{
+  return memlimit;
+}
+
+int scamper_option_memlimit_set(const int m)
+{
+  if(m < SCAMPER_OPTION_MEMLIMIT_MIN || m > SCAMPER_OPTION_MEMLIMIT_MAX)
+    return -1;
+  memlimit = m;
+  return 0;
+}
+
+int scamper_option_dnscache_get(void)
+{
+  return dnscache;
+}
+
+const char *scamper_option_dnscache_file_get(void)
+{
+  return dnscache_file;
+}
+
+/*
+ * memlimit_reached
+ *
+ * return non-zero if the tasks scamper holds have used up the memory
+ * budget, in which case no new tasks are started until some finish.
+ */
+static int memlimit_reached(void)
+{
+  if(memlimit == 0)
+    return 0;
+  return scamper_task_mem_total() >= (size_t)memlimit * 1024 * 1024;
+}
+
 const char *scamper_option_monitorname_get()
 {
   return monitorname;
@@ -1037,6 +1231,17 @@ int scamper_option_epoll(void)
   return 0;
 }
 
+int scamper_option_iouring(void)
+{
+  if(flags & FLAG_IOURING) return 1;
+  return 0;
+}
+
+int scamper_option_zlevel(void)
+{
+  return zlevel;
+}
+
 int scamper_option_noinitndc(void)
 {
   if(flags & FLAG_NOINITNDC) return 1;
@@ -1061,6 +1266,24 @@ int scamper_option_icmp_rxerr(void)
 #endif
 }
 
+int scamper_option_dlring(void)
+{
+  if(flags & FLAG_DLRING) return 1;
+  return 0;
+}
+
+int scamper_option_txbatch(void)
+{
+  if(flags & FLAG_TXBATCH) return 1;
+  return 0;
+}
+
+int scamper_option_rxbatch(void)
+{
+  if(flags & FLAG_RXBATCH) return 1;
+  return 0;
+}
+
 int scamper_option_debugfileappend(void)
 {
   if(flags & FLAG_DEBUGFILEAPPEND) return 1;
@@ -1180,7 +1403,7 @@ static int scamper_timeout(struct timeval *timeout, struct timeval *nextprobe,
   
   if(scamper_queue_readycount() > 0 ||
      ((window == 0 || scamper_queue_windowcount() < window) &&
-      scamper_sources_isready() != 0))
+      memlimit_reached() == 0 && scamper_sources_isready() != 0))
     {
       /*
        * if there is something ready to be probed right now, then set the
@@ -1189,19 +1412,29 @@ static int scamper_timeout(struct timeval *timeout, struct timeval *nextprobe,
       timeval_add_us(nextprobe, lastprobe, wait_between);
       probe = 1;
     }
-  else if(scamper_queue_count() > 0)
+  else
     {
       /*
        * if there isn't anything ready to go right now, but we are
        * waiting on a response from an earlier probe, then set the timer
        * to go off when that probe expires.
        */
-      scamper_queue_waittime(nextprobe);
-      probe = 1;
-    }
-  else
-    {
-      if(exit_when_done != 0 && scamper_sources_isempty() == 1)
+      if(scamper_queue_count() > 0 && scamper_queue_waittime(nextprobe) != 0)
+	probe = 1;
+
+      /*
+       * if a source is over its pps cap, set the timer to go off when
+       * it may probe again, if that is sooner.
+       */
+      if(scamper_sources_ppswait(&tv) != 0 &&
+	 (probe == 0 || timeval_cmp(&tv, nextprobe) < 0))
+	{
+	  timeval_cpy(nextprobe, &tv);
+	  probe = 1;
+	}
+
+      if(probe == 0 && scamper_queue_count() == 0 &&
+	 exit_when_done != 0 && scamper_sources_isempty() == 1)
 	return 2;
     }
 
@@ -1246,6 +1479,7 @@ static int scamper(int argc, char *argv[])
   scamper_task_t          *task;
   scamper_outfile_t       *sof, *sof2;
   scamper_file_t          *file;
+  uint32_t                 owed = 0;
   int                      x;
 
   if(check_options(argc, argv) == -1)
@@ -1253,6 +1487,12 @@ static int scamper(int argc, char *argv[])
       return -1;
     }
 
+#ifndef DMALLOC
+  /* recycle the objects that measurements allocate for each response */
+  if((flags & FLAG_NOSLAB) == 0)
+    scamper_slab_enable();
+#endif
+
 #ifdef HAVE_DAEMON
   if((options & OPT_DAEMON) != 0)
     {
@@ -1276,6 +1516,42 @@ static int scamper(int argc, char *argv[])
     }
 #endif
 
+#ifndef _WIN32
+  /*
+   * fork the shards before anything else is initialised, so that each
+   * shard has its own sockets, queues, and privsep process.  the parent
+   * writes out the results that the shards send it.
+   */
+  if(shards != 0)
+    {
+      if(scamper_shard_fork(shards, wait_between, probe_window, window,
+			    &x) != 0)
+	return -1;
+      if(x < 0)
+	{
+	  if((options & OPT_PIDFILE) != 0 && scamper_pidfile() != 0)
+	    return -1;
+	  return scamper_shard_merge(outfile, outtype);
+	}
+      options &= ~OPT_PIDFILE;
+      outfile = "-";
+      outtype = "warts";
+
+      /* only the first shard loads and saves the dns cache file */
+      if(x != 0)
+	dnscache_file = NULL;
+    }
+#endif
+
+#ifndef _WIN32
+  /*
+   * map the shared stop set before privilege separation, as the file
+   * might not be reachable afterwards
+   */
+  if(stopset != NULL && scamper_stopset_open(stopset, stopset_slots) != 0)
+    return -1;
+#endif
+
   if(scamper_osinfo_init() != 0)
     return -1;
 
@@ -1437,7 +1713,8 @@ static int scamper(int argc, char *argv[])
      scamper_do_neighbourdisc_init() != 0 ||
      scamper_do_tbit_init() != 0 ||
      scamper_do_sniff_init() != 0 ||
-     scamper_do_host_init() != 0)
+     scamper_do_host_init() != 0 ||
+     scamper_do_sweep_init() != 0)
     {
       return -1;
     }
@@ -1517,6 +1794,13 @@ static int scamper(int argc, char *argv[])
 
   for(;;)
     {
+      /*
+       * send any probes batched up before working out how long to wait,
+       * as a task that could not send its probe may now be done
+       */
+      scamper_probe_flush();
+      scamper_probe_txcbs();
+
       if((x = scamper_timeout(&timeout, &nextprobe, &lastprobe)) == 0)
 	{
 	  /*
@@ -1540,6 +1824,7 @@ static int scamper(int argc, char *argv[])
 	  break;
 	}
 
+
       /* listen until it is time to send the next probe */
       if(scamper_fds_poll(timeout_ptr) == -1)
 	return -1;
@@ -1577,6 +1862,9 @@ static int scamper(int argc, char *argv[])
 	  scamper_task_free(task);
 	}
 
+      /* tell the other shards how much of the window this shard holds */
+      scamper_shard_window_sync(scamper_queue_windowcount());
+
       /*
        * if there is something waiting to be probed, then find out if it is
        * time to probe yet
@@ -1608,32 +1896,61 @@ static int scamper(int argc, char *argv[])
 	      if(timeval_cmp(&nextprobe, &tv) > 0)
 		break;
 
+	      /* the probe rate is shared with any other shards */
+	      if(scamper_shard_pps_take(&tv, &lastprobe) != 0)
+		break;
+
+	      /*
+	       * a task that sent more than one packet when it last probed
+	       * (e.g. a ping train) pays for the extra packets with the
+	       * slots that follow
+	       */
+	      if(owed > 0)
+		{
+		  owed--;
+		  timeval_cpy(&lastprobe, &nextprobe);
+		  continue;
+		}
+
 	      /*
 	       * look for an address that we can send a probe to.  if
 	       * scamper doesn't have a task on the probe queue waiting
 	       * to be probed, then get a fresh task. if there's absolutely
 	       * nothing that scamper can probe, then break.
 	       */
-	      if((task = scamper_queue_select()) == NULL)
+	      if((task = scamper_queue_select(&tv)) == NULL)
 		{
 		  /*
-		   * if we are already probing to the window limit, don't
+		   * if we are already probing to the window limit, or the
+		   * tasks we hold have used up the memory budget, don't
 		   * add any new tasks
 		   */
-		  if(window != 0 && scamper_queue_windowcount() >= window)
-		    break;
+		  if((window != 0 && scamper_queue_windowcount() >= window) ||
+		     memlimit_reached() != 0 ||
+		     scamper_shard_window_take(&tv, &lastprobe) != 0)
+		    {
+		      scamper_shard_pps_give();
+		      break;
+		    }
 
 		  /*
 		   * if there are no more tasks ready to be added yet, there's
 		   * nothing more to be done in the loop
 		   */
 		  if(scamper_sources_gettask(&task) != 0 || task == NULL)
-		    break;
+		    {
+		      scamper_shard_window_give();
+		      scamper_shard_pps_give();
+		      break;
+		    }
 		}
 
-	      scamper_task_probe(task);
+	      owed += scamper_task_probe(task) - 1;
 	      timeval_cpy(&lastprobe, &nextprobe);
 	    }
+
+	  /* send the probes batched up in this pass */
+	  scamper_probe_flush();
 	}
     }
 
@@ -1667,6 +1984,7 @@ static void cleanup(void)
   scamper_do_tbit_cleanup();
   scamper_do_sniff_cleanup();
   scamper_do_host_cleanup();
+  scamper_do_sweep_cleanup();
 
   scamper_dl_cleanup();
 
@@ -1718,6 +2036,12 @@ static void cleanup(void)
       firewall = NULL;
     }
 
+  if(stopset != NULL)
+    {
+      free(stopset);
+      stopset = NULL;
+    }
+
   if(command != NULL)
     {
       free(command);
@@ -1726,6 +2050,11 @@ static void cleanup(void)
   scamper_queue_cleanup();
   scamper_task_cleanup();
   scamper_probe_cleanup();
+  scamper_shard_cleanup();
+  scamper_stopset_close();
+
+  /* only after every task, and the data it held, has been freed */
+  scamper_slab_cleanup();
 
 #ifndef WITHOUT_DEBUGFILE
   if(options & OPT_DEBUGFILE)
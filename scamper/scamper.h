@@ -38,6 +38,18 @@ int scamper_option_pps_set(const int pps);
 int scamper_option_window_get(void);
 int scamper_option_window_set(const int window);
 
+#define SCAMPER_OPTION_MEMLIMIT_MIN  0
+#define SCAMPER_OPTION_MEMLIMIT_DEF  0
+#define SCAMPER_OPTION_MEMLIMIT_MAX  1048576
+int scamper_option_memlimit_get(void);
+int scamper_option_memlimit_set(const int memlimit);
+
+#define SCAMPER_OPTION_DNSCACHE_MIN  0
+#define SCAMPER_OPTION_DNSCACHE_DEF  10000
+#define SCAMPER_OPTION_DNSCACHE_MAX  1000000
+int scamper_option_dnscache_get(void);
+const char *scamper_option_dnscache_file_get(void);
+
 #define SCAMPER_OPTION_COMMAND_DEF   "trace"
 const char *scamper_option_command_get(void);
 int scamper_option_command_set(const char *command);
@@ -53,10 +65,15 @@ int scamper_option_notls(void);
 int scamper_option_select(void);
 int scamper_option_kqueue(void);
 int scamper_option_epoll(void);
+int scamper_option_iouring(void);
 int scamper_option_rawtcp(void);
 int scamper_option_icmp_rxerr(void);
+int scamper_option_dlring(void);
+int scamper_option_txbatch(void);
+int scamper_option_rxbatch(void);
 int scamper_option_debugfileappend(void);
 int scamper_option_daemon(void);
+int scamper_option_zlevel(void);
 
 void scamper_exitwhendone(int on);
 
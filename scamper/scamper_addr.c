@@ -29,7 +29,6 @@
 #endif
 #include "internal.h"
 
-#include "mjl_splaytree.h"
 #include "scamper_addr.h"
 #include "utils.h"
 
@@ -193,9 +192,29 @@ static const struct handler handlers[] = {
   }
 };
 
+/*
+ * addrcache_slot
+ *
+ * a slot in the address cache's open-addressing hash table.  the
+ * address bytes are copied into the slot, zero padded, so that a
+ * lookup compares two 64-bit words per slot without following the
+ * pointer to the scamper_addr_t.
+ */
+typedef struct addrcache_slot
+{
+  scamper_addr_t *sa;       /* NULL if the slot is empty */
+  uint64_t        key[2];   /* the address bytes */
+  uint32_t        hash;     /* hash of type and key */
+  int             type;     /* address type */
+} addrcache_slot_t;
+
+#define ADDRCACHE_SLOTS_MIN 1024
+
 struct scamper_addrcache
 {
-  splaytree_t *tree[sizeof(handlers)/sizeof(struct handler)];
+  addrcache_slot_t *slots;
+  size_t            mask;     /* number of slots, minus one */
+  size_t            count;    /* number of slots in use */
 };
 
 static int ipv4_cmp(const scamper_addr_t *sa, const scamper_addr_t *sb)
@@ -889,26 +908,26 @@ scamper_addr_t *scamper_addr_alloc_dm(const int type, const void *addr,
 #endif
 {
   scamper_addr_t *sa;
+  size_t size;
 
   assert(addr != NULL);
   assert(type-1 >= 0);
   assert((size_t)(type-1) < sizeof(handlers)/sizeof(struct handler));
 
+  /* the address is stored immediately after the structure */
+  size = sizeof(scamper_addr_t) + handlers[type-1].size;
+
 #ifndef DMALLOC
-  sa = malloc_zero(sizeof(scamper_addr_t));
+  sa = malloc_zero(size);
 #else
-  sa = malloc_zero_dm(sizeof(scamper_addr_t), file, line);
+  sa = malloc_zero_dm(size, file, line);
 #endif
 
   if(sa == NULL)
     return NULL;
 
-  if((sa->addr = memdup(addr, handlers[type-1].size)) == NULL)
-    {
-      free(sa);
-      return NULL;
-    }
-
+  sa->addr = sa + 1;
+  memcpy(sa->addr, addr, handlers[type-1].size);
   sa->type = type;
   sa->refcnt = 1;
   sa->internal = NULL;
@@ -1066,33 +1085,168 @@ int scamper_addr_isreserved(const scamper_addr_t *sa)
   return handlers[sa->type-1].isreserved(sa);
 }
 
+static uint32_t addrcache_hash(const int type, const uint64_t *key)
+{
+  uint64_t h;
+
+  h  = key[0] * UINT64_C(0x9e3779b97f4a7c15);
+  h ^= (key[1] + type) * UINT64_C(0xc2b2ae3d27d4eb4f);
+  h ^= h >> 31;
+  h *= UINT64_C(0x94d049bb133111eb);
+  h ^= h >> 29;
+
+  return (uint32_t)h;
+}
+
+static void addrcache_key(const int type, const void *addr, uint64_t *key)
+{
+  key[0] = key[1] = 0;
+  memcpy(key, addr, handlers[type-1].size);
+  return;
+}
+
+/*
+ * addrcache_find
+ *
+ * return the slot holding the address, or the empty slot where it
+ * would be inserted.  this does not change the table, so concurrent
+ * lookups do not need to exclude each other.
+ */
+static addrcache_slot_t *addrcache_find(const scamper_addrcache_t *ac,
+					const int type, const uint64_t *key,
+					const uint32_t hash)
+{
+  addrcache_slot_t *slot;
+  size_t i = hash & ac->mask;
+
+  for(;;)
+    {
+      slot = &ac->slots[i];
+      if(slot->sa == NULL ||
+	 (slot->hash == hash && slot->key[0] == key[0] &&
+	  slot->key[1] == key[1] && slot->type == type))
+	return slot;
+      i = (i + 1) & ac->mask;
+    }
+}
+
+/*
+ * addrcache_resize
+ *
+ * move the addresses in the cache into a table of the given number of
+ * slots, which must be a power of two.
+ */
+static int addrcache_resize(scamper_addrcache_t *ac, size_t slotc)
+{
+  addrcache_slot_t *old = ac->slots, *slot;
+  size_t i, oldc = ac->mask + 1;
+
+  if((ac->slots = malloc_zero(sizeof(addrcache_slot_t) * slotc)) == NULL)
+    {
+      ac->slots = old;
+      return -1;
+    }
+  ac->mask = slotc - 1;
+
+  if(old == NULL)
+    return 0;
+
+  for(i=0; i<oldc; i++)
+    {
+      if(old[i].sa == NULL)
+	continue;
+      slot = addrcache_find(ac, old[i].type, old[i].key, old[i].hash);
+      memcpy(slot, &old[i], sizeof(addrcache_slot_t));
+    }
+  free(old);
+
+  return 0;
+}
+
+/*
+ * addrcache_remove
+ *
+ * remove the address from the table, shifting any addresses after it
+ * in the same run of slots back so that no lookup is cut short by the
+ * slot becoming empty.
+ */
+static void addrcache_remove(scamper_addrcache_t *ac, scamper_addr_t *sa)
+{
+  addrcache_slot_t *slot;
+  uint64_t key[2];
+  size_t i, j, k;
+
+  addrcache_key(sa->type, sa->addr, key);
+  slot = addrcache_find(ac, sa->type, key, addrcache_hash(sa->type, key));
+  assert(slot->sa == sa);
+  i = j = slot - ac->slots;
+
+  for(;;)
+    {
+      j = (j + 1) & ac->mask;
+      if(ac->slots[j].sa == NULL)
+	break;
+      k = ac->slots[j].hash & ac->mask;
+
+      /* move the address in j back if its home slot is not in (i, j] */
+      if((i <= j) ? (i < k && k <= j) : (i < k || k <= j))
+	continue;
+      memcpy(&ac->slots[i], &ac->slots[j], sizeof(addrcache_slot_t));
+      i = j;
+    }
+
+  ac->slots[i].sa = NULL;
+  ac->count--;
+
+  /* give back memory when the table is mostly empty */
+  if(ac->mask + 1 > ADDRCACHE_SLOTS_MIN && ac->count < (ac->mask + 1) / 8)
+    addrcache_resize(ac, (ac->mask + 1) / 2);
+
+  return;
+}
+
 scamper_addr_t *scamper_addrcache_get(scamper_addrcache_t *ac,
 				      const int type, const void *addr)
 {
-  scamper_addr_t *sa, findme;
+  addrcache_slot_t *slot;
+  scamper_addr_t *sa;
+  uint64_t key[2];
+  uint32_t hash;
 
-  findme.type = type;
-  findme.addr = (void *)addr;
+  assert(type > 0);
+  assert((size_t)type <= sizeof(handlers)/sizeof(struct handler));
 
-  if((sa = splaytree_find(ac->tree[type-1], &findme)) != NULL)
+  addrcache_key(type, addr, key);
+  hash = addrcache_hash(type, key);
+  slot = addrcache_find(ac, type, key, hash);
+
+  if((sa = slot->sa) != NULL)
     {
       assert(sa->internal == ac);
       sa->refcnt++;
       return sa;
     }
 
-  if((sa = scamper_addr_alloc(type, addr)) != NULL)
+  /* keep the table at most half full */
+  if((ac->count + 1) * 2 > ac->mask + 1)
     {
-      if(splaytree_insert(ac->tree[type-1], sa) == NULL)
-	goto err;
-      sa->internal = ac;
+      if(addrcache_resize(ac, (ac->mask + 1) * 2) != 0)
+	return NULL;
+      slot = addrcache_find(ac, type, key, hash);
     }
 
-  return sa;
+  if((sa = scamper_addr_alloc(type, addr)) == NULL)
+    return NULL;
+  sa->internal = ac;
 
- err:
-  scamper_addr_free(sa);
-  return NULL;
+  slot->sa     = sa;
+  slot->key[0] = key[0];
+  slot->key[1] = key[1];
+  slot->hash   = hash;
+  slot->type   = type;
+  ac->count++;
+
+  return sa;
 }
 
 /*
@@ -1162,9 +1316,8 @@ void scamper_addr_free(scamper_addr_t *sa)
     return;
 
   if((ac = sa->internal) != NULL)
-    splaytree_remove_item(ac->tree[sa->type-1], sa);
+    addrcache_remove(ac, sa);
 
-  free(sa->addr);
   free(sa);
   return;
 }
@@ -1246,19 +1399,18 @@ int scamper_addr_raw_cmp(const scamper_addr_t *a, const void *raw)
   return memcmp(a->addr, raw, handlers[a->type-1].size);
 }
 
-static void free_cb(void *node)
-{
-  ((scamper_addr_t *)node)->internal = NULL;
-  return;
-}
-
 void scamper_addrcache_free(scamper_addrcache_t *ac)
 {
-  int i;
+  size_t i;
 
-  for(i=(sizeof(handlers)/sizeof(struct handler))-1; i>=0; i--)
-    if(ac->tree[i] != NULL)
-      splaytree_free(ac->tree[i], free_cb);
+  /* addresses still in use outlive the cache */
+  if(ac->slots != NULL)
+    {
+      for(i=0; i<=ac->mask; i++)
+	if(ac->slots[i].sa != NULL)
+	  ac->slots[i].sa->internal = NULL;
+      free(ac->slots);
+    }
   free(ac);
 
   return;
@@ -1267,21 +1419,15 @@ void scamper_addrcache_free(scamper_addrcache_t *ac)
 scamper_addrcache_t *scamper_addrcache_alloc()
 {
   scamper_addrcache_t *ac;
-  int i;
 
   if((ac = malloc_zero(sizeof(scamper_addrcache_t))) == NULL)
     return NULL;
 
-  for(i=(sizeof(handlers)/sizeof(struct handler))-1; i>=0; i--)
+  if(addrcache_resize(ac, ADDRCACHE_SLOTS_MIN) != 0)
     {
-      ac->tree[i] = splaytree_alloc((splaytree_cmp_t)handlers[i].cmp);
-      if(ac->tree[i] == NULL)
-	goto err;
+      free(ac);
+      return NULL;
     }
 
   return ac;
-
- err:
-  scamper_addrcache_free(ac);
-  return NULL;
 }
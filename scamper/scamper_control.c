@@ -219,6 +219,7 @@ typedef struct client
    *  sof_obj:    current object partially written over socket.
    *  sof_off:    offset into current object being written.
    *  sof_format: the format (warts/json) of results being sent to clients
+   *  sof_encoding: whether warts is sent uuencoded or as raw bytes
    */
   scamper_source_t   *source;
   scamper_outfile_t  *sof;
@@ -226,6 +227,7 @@ typedef struct client
   client_obj_t       *sof_obj;
   size_t              sof_off;
   uint8_t             sof_format;
+  uint8_t             sof_encoding;
 } client_t;
 
 #define CLIENT_MODE_INTERACTIVE 0
@@ -238,6 +240,9 @@ typedef struct client
 #define CLIENT_FORMAT_WARTS     0
 #define CLIENT_FORMAT_JSON      1
 
+#define CLIENT_ENCODING_UUENCODE 0
+#define CLIENT_ENCODING_BINARY   1
+
 #define REMOTE_MODE_CONNECT     0
 #define REMOTE_MODE_GO          1
 
@@ -739,12 +744,17 @@ static char *source_tostr(char *str, const size_t len,
     outfile[0] = '\0';
 
   snprintf(str, len,
-	   "name '%s'%s list_id %u cycle_id %u priority %u%s %s",
+	   "name '%s'%s list_id %u cycle_id %u priority %u pps %u share %u"
+	   " probes %llu deficit %lld%s %s",
 	   scamper_source_getname(source),
 	   descr,
 	   scamper_source_getlistid(source),
 	   scamper_source_getcycleid(source),
 	   scamper_source_getpriority(source),
+	   scamper_source_getpps(source),
+	   scamper_source_getshare(source),
+	   (unsigned long long)scamper_source_getprobes(source),
+	   (long long)scamper_source_getdeficit(source),
 	   outfile,
 	   type);
 
@@ -866,11 +876,13 @@ static int command_attach(client_t *client, char *buf)
   scamper_file_t *sf;
   char sab[128];
   long priority = 1;
-  char *priority_str = NULL, *format = NULL, *params[2], *next;
+  char *priority_str = NULL, *format = NULL, *encoding = NULL, *params[6];
+  char *next;
   int i, cnt = sizeof(params) / sizeof(char *);
   param_t handlers[] = {
     {"priority", &priority_str},
     {"format", &format},
+    {"encoding", &encoding},
   };
   int handler_cnt = sizeof(handlers) / sizeof(param_t);
 
@@ -914,6 +926,24 @@ static int command_attach(client_t *client, char *buf)
       return 0;
     }
 
+  /*
+   * warts records are uuencoded unless the client asks for the raw
+   * bytes.  json is always sent as is.
+   */
+  if(encoding == NULL || strcasecmp(encoding, "uuencode") == 0)
+    {
+      client->sof_encoding = CLIENT_ENCODING_UUENCODE;
+    }
+  else if(strcasecmp(encoding, "binary") == 0)
+    {
+      client->sof_encoding = CLIENT_ENCODING_BINARY;
+    }
+  else
+    {
+      client_send(client, "ERR encoding must be uuencode or binary");
+      return 0;
+    }
+
   if(client_sockaddr_tostr(client, sab, sizeof(sab)) == NULL)
     goto err;
 
@@ -997,6 +1027,29 @@ static int command_get_command(client_t *client, char *buf)
   return client_send(client, "OK command %s", command);
 }
 
+static void memory_foreach(void *param, const char *name,
+			   int taskc, size_t bytes)
+{
+  client_t *client = (client_t *)param;
+  client_send(client, "INFO %s tasks %d bytes %llu",
+	      name, taskc, (unsigned long long)bytes);
+  return;
+}
+
+/*
+ * command_get_memory
+ *
+ * report the memory accounted to each type of task, one INFO line per
+ * type, followed by the total and the limit in megabytes.
+ */
+static int command_get_memory(client_t *client, char *buf)
+{
+  scamper_task_mem_foreach(client, memory_foreach);
+  return client_send(client, "OK memory %llu limit %dMB",
+		     (unsigned long long)scamper_task_mem_total(),
+		     scamper_option_memlimit_get());
+}
+
 static int command_get_monitorname(client_t *client, char *buf)
 {
   const char *monitorname = scamper_option_monitorname_get();
@@ -1048,6 +1101,7 @@ static int command_get(client_t *client, char *buf)
 {
   static command_t handlers[] = {
     {"command",     command_get_command},
+    {"memory",      command_get_memory},
     {"monitorname", command_get_monitorname},
     {"nameserver",  command_get_nameserver},
     {"pid",         command_get_pid},
@@ -1061,7 +1115,7 @@ static int command_get(client_t *client, char *buf)
   if(buf == NULL)
     {
       client_send(client, "ERR usage: get "
-	  "[command | monitorname | pid | pps | version | window]");
+	  "[command | memory | monitorname | pid | pps | version | window]");
       return 0;
     }
 
@@ -1094,6 +1148,8 @@ static void observe_source_event_update(const scamper_source_event_t *sse,
   char autoreload[16];
   char cycles[16];
   char priority[24];
+  char pps[24];
+  char share[24];
 
   /* autoreload */
   if(sse->sse_update_flags & 0x01)
@@ -1113,9 +1169,19 @@ static void observe_source_event_update(const scamper_source_event_t *sse,
 	     " priority %d", sse->sse_update_priority);
   else priority[0] = '\0';
 
-  snprintf(buf, len, "update '%s'%s%s%s",
+  /* pps */
+  if(sse->sse_update_flags & 0x08)
+    snprintf(pps, sizeof(pps), " pps %d", sse->sse_update_pps);
+  else pps[0] = '\0';
+
+  /* share */
+  if(sse->sse_update_flags & 0x10)
+    snprintf(share, sizeof(share), " share %d", sse->sse_update_share);
+  else share[0] = '\0';
+
+  snprintf(buf, len, "update '%s'%s%s%s%s%s",
 	   scamper_source_getname(sse->source),
-	   autoreload, cycles, priority);
+	   autoreload, cycles, priority, pps, share);
   return;
 }
 
@@ -1691,6 +1757,12 @@ static int command_set_pps(client_t *client, char *buf)
 		  SCAMPER_OPTION_PPS_MIN, SCAMPER_OPTION_PPS_MAX);
 }
 
+static int command_set_memlimit(client_t *client, char *buf)
+{
+  return set_long(client, buf, "memlimit", scamper_option_memlimit_set,
+		  SCAMPER_OPTION_MEMLIMIT_MIN, SCAMPER_OPTION_MEMLIMIT_MAX);
+}
+
 static int command_set_window(client_t *client, char *buf)
 {
   return set_long(client, buf, "window", scamper_option_window_set,
@@ -1701,6 +1773,7 @@ static int command_set(client_t *client, char *buf)
 {
   static command_t handlers[] = {
     {"command",     command_set_command},
+    {"memlimit",    command_set_memlimit},
     {"monitorname", command_set_monitorname},
     {"nameserver",  command_set_nameserver},
     {"pps",         command_set_pps},
@@ -1713,7 +1786,7 @@ static int command_set(client_t *client, char *buf)
   if(buf == NULL)
     {
       client_send(client, "ERR usage: "
-		  "set [command | monitorname | pps | window]");
+		  "set [command | memlimit | monitorname | pps | window]");
       return 0;
     }
   next = string_nextword(buf);
@@ -1732,7 +1805,8 @@ static int command_set(client_t *client, char *buf)
  * to scamper.  no other type of source is supported with this function.
  *
  * source add [name <name>] [descr <descr>] [list_id <id>] [cycle_id <id>]
- *            [priority <priority>] [outfile <name>]
+ *            [priority <priority>] [pps <pps>] [share <percent>]
+ *            [outfile <name>]
  *            [command <command>] [file <name>] [cycles <count>]
  *            [autoreload <on|off>]
  */
@@ -1740,9 +1814,10 @@ static int command_source_add(client_t *client, char *buf)
 {
   scamper_source_params_t ssp;
   scamper_source_t *source;
-  char *params[24];
+  char *params[28];
   int   i, cnt = sizeof(params) / sizeof(char *);
-  char *file = NULL, *name = NULL, *priority = NULL;
+  char *file = NULL, *name = NULL, *priority = NULL, *pps = NULL;
+  char *share = NULL;
   char *descr = NULL, *list_id = NULL, *cycles = NULL, *autoreload = NULL;
   char *outfile = NULL, *command = NULL, *cycle_id = NULL;
   long  l;
@@ -1758,7 +1833,9 @@ static int command_source_add(client_t *client, char *buf)
     {"list_id",    &list_id},
     {"name",       &name},
     {"outfile",    &outfile},
+    {"pps",        &pps},
     {"priority",   &priority},
+    {"share",      &share},
   };
   int handler_cnt = sizeof(handlers) / sizeof(param_t);
 
@@ -1855,6 +1932,28 @@ static int command_source_add(client_t *client, char *buf)
       ssp.priority = l;
     }
 
+  /* sanity check the pps cap */
+  if(pps != NULL)
+    {
+      if(string_tolong(pps, &l) == -1 || l < 0 || l > 0x7fffffff)
+	{
+	  client_send(client, "ERR pps <number gte 0>");
+	  return -1;
+	}
+      ssp.pps = l;
+    }
+
+  /* sanity check the minimum share */
+  if(share != NULL)
+    {
+      if(string_tolong(share, &l) == -1 || l < 0 || l > 100)
+	{
+	  client_send(client, "ERR share <percent 0-100>");
+	  return -1;
+	}
+      ssp.share = l;
+    }
+
   /* sanity check the autoreload parameter */
   if(autoreload != NULL)
     {
@@ -2040,7 +2139,7 @@ static int command_source_list(client_t *client, char *buf)
 /*
  * command_source_update
  *
- * source update <name> [priority <priority>]
+ * source update <name> [priority <priority>] [pps <pps>] [share <percent>]
  *                      [autoreload <on|off>] [cycles <count>]
  *
  */
@@ -2048,14 +2147,17 @@ static int command_source_update(client_t *client, char *buf)
 {
   scamper_source_t *source;
   char             *autoreload = NULL, *cycles = NULL, *priority = NULL;
+  char             *pps = NULL, *share = NULL;
   int               i_autoreload, i_cycles;
-  long              l;
+  long              l, l_pps = 0, l_share = 0;
   int               i, cnt, handler_cnt;
-  char             *params[10], *next;
+  char             *params[14], *next;
   param_t           handlers[] = {
     {"autoreload", &autoreload},
     {"cycles",     &cycles},
+    {"pps",        &pps},
     {"priority",   &priority},
+    {"share",      &share},
   };
 
   if(buf == NULL)
@@ -2132,6 +2234,20 @@ static int command_source_update(client_t *client, char *buf)
 	}
     }
 
+  if(pps != NULL &&
+     (string_tolong(pps, &l_pps) == -1 || l_pps < 0 || l_pps > 0x7fffffff))
+    {
+      client_send(client, "ERR pps <number gte 0>");
+      return 0;
+    }
+
+  if(share != NULL &&
+     (string_tolong(share, &l_share) == -1 || l_share < 0 || l_share > 100))
+    {
+      client_send(client, "ERR share <percent 0-100>");
+      return 0;
+    }
+
   if(priority != NULL)
     {
       if(string_tolong(priority, &l) == -1 || l < 0)
@@ -2142,6 +2258,11 @@ static int command_source_update(client_t *client, char *buf)
       scamper_source_setpriority(source, (uint32_t)l);
     }
 
+  if(pps != NULL)
+    scamper_source_setpps(source, (uint32_t)l_pps);
+  if(share != NULL)
+    scamper_source_setshare(source, (uint32_t)l_share);
+
   if(autoreload != NULL || cycles != NULL)
     {
       scamper_source_file_update(source,
@@ -2493,7 +2614,8 @@ static int client_write_do(client_t *client,
 	 (o = slist_head_pop(client->sof_objs)) != NULL)
 	{
 	  client->sof_obj = o;
-	  if(client->sof_format == CLIENT_FORMAT_WARTS)
+	  if(client->sof_format == CLIENT_FORMAT_WARTS &&
+	     client->sof_encoding == CLIENT_ENCODING_UUENCODE)
 	    len = snprintf(str, sizeof(str), "DATA %d\n",
 			   (int)uuencode_len(o->len, NULL, NULL));
 	  else
@@ -2512,7 +2634,8 @@ static int client_write_do(client_t *client,
 
   if(o != NULL)
     {
-      if(client->sof_format == CLIENT_FORMAT_WARTS)
+      if(client->sof_format == CLIENT_FORMAT_WARTS &&
+	 client->sof_encoding == CLIENT_ENCODING_UUENCODE)
 	{
 	  len = uuencode_bytes(o->data, o->len, &client->sof_off,
 			       data, sizeof(data));
@@ -42,6 +42,14 @@
 #define HAVE_BPF_FILTER
 #endif
 
+/*
+ * the filter is rebuilt from the installed task signatures as they
+ * change, unless replacing a BPF filter would flush the buffer.
+ */
+#if defined(__linux__) || (defined(HAVE_BPF) && defined(BIOCSETFNR))
+#define HAVE_DL_FILTER_SIGS
+#endif
+
 #include "scamper.h"
 #include "scamper_debug.h"
 #include "scamper_addr.h"
@@ -51,6 +59,7 @@
 #include "scamper_task.h"
 #include "scamper_if.h"
 #include "scamper_osinfo.h"
+#include "mjl_list.h"
 #include "utils.h"
 
 #if defined(HAVE_BPF) && defined(DLT_APPLE_IP_OVER_IEEE1394)
@@ -59,6 +68,36 @@
 #define HAVE_FIREWIRE
 #endif
 
+#if defined(__linux__) && defined(TPACKET3_HDRLEN) && defined(HAVE_SYS_MMAN_H)
+#define HAVE_TPACKET_V3
+
+/*
+ * parameters of the PACKET_MMAP ring: the kernel fills blocks of frames
+ * and hands a block to scamper when it is full, or when the block has
+ * been open for DL_RING_BLOCK_TOV milliseconds.
+ */
+#define DL_RING_BLOCK_SIZE  (1 << 17)
+#define DL_RING_BLOCK_NR    32
+#define DL_RING_FRAME_SIZE  (1 << 11)
+#define DL_RING_BLOCK_TOV   2
+#endif
+
+#if defined(HAVE_BPF_FILTER)
+#if defined(HAVE_BPF)
+typedef struct bpf_insn dl_insn_t;
+#else
+typedef struct sock_filter dl_insn_t;
+#endif
+
+/*
+ * the largest number of IPv4 addresses the filter will match individually,
+ * and the largest filter scamper will build.  beyond the address limit,
+ * the filter only matches on the type of packet.
+ */
+#define DL_FILTER_ADDR_MAX  64
+#define DL_FILTER_INSN_MAX  512
+#endif
+
 struct scamper_dl
 {
   /* the file descriptor that scamper has on the datalink */
@@ -78,10 +117,27 @@ struct scamper_dl
   u_int          readbuf_len;
 #endif
 
+  /* the filter currently installed on the datalink */
+#if defined(HAVE_BPF_FILTER)
+  dl_insn_t     *filter;
+  int            filter_len;
+#endif
+
+  /* the node in the list of datalinks */
+  dlist_node_t  *node;
+
+  /* if we're using a TPACKET_V3 ring, the state of the mapped ring */
+#if defined(HAVE_TPACKET_V3)
+  uint8_t       *ring;
+  size_t         ring_len;
+  unsigned int   ring_block;
+#endif
+
 };
 
 static uint8_t          *readbuf = NULL;
 static size_t            readbuf_len = 0;
+static dlist_t          *dl_list = NULL;
 
 #if defined(HAVE_BPF)
 static const scamper_osinfo_t *osinfo = NULL;
@@ -993,7 +1049,11 @@ static int dl_bpf_filter(scamper_dl_t *node, struct bpf_insn *insns, int len)
   prog.bf_len   = len;
   prog.bf_insns = insns;
 
+#if defined(BIOCSETFNR)
+  if(ioctl(scamper_fd_fd_get(node->fdn), BIOCSETFNR, (caddr_t)&prog) == -1)
+#else
   if(ioctl(scamper_fd_fd_get(node->fdn), BIOCSETF, (caddr_t)&prog) == -1)
+#endif
     {
       printerror(__func__, "BIOCSETF failed");
       return -1;
@@ -1031,6 +1091,117 @@ static int dl_linux_open(const int ifindex)
   return fd;
 }
 
+#if defined(HAVE_TPACKET_V3)
+/*
+ * dl_linux_ring_init
+ *
+ * ask the kernel to deliver frames into a TPACKET_V3 ring that is mapped
+ * into scamper's address space.  if this fails, scamper falls back to
+ * reading each frame with recvfrom.
+ */
+static int dl_linux_ring_init(const int fd, scamper_dl_t *node)
+{
+  struct tpacket_req3 req;
+  int ver = TPACKET_V3;
+  void *ring;
+
+  if(setsockopt(fd, SOL_PACKET, PACKET_VERSION, &ver, sizeof(ver)) == -1)
+    {
+      printerror(__func__, "could not set TPACKET_V3 on fd %d", fd);
+      return -1;
+    }
+
+  memset(&req, 0, sizeof(req));
+  req.tp_block_size = DL_RING_BLOCK_SIZE;
+  req.tp_block_nr = DL_RING_BLOCK_NR;
+  req.tp_frame_size = DL_RING_FRAME_SIZE;
+  req.tp_frame_nr = (DL_RING_BLOCK_SIZE / DL_RING_FRAME_SIZE) *
+    DL_RING_BLOCK_NR;
+  req.tp_retire_blk_tov = DL_RING_BLOCK_TOV;
+  if(setsockopt(fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) == -1)
+    {
+      printerror(__func__, "could not set PACKET_RX_RING on fd %d", fd);
+      goto err;
+    }
+
+  node->ring_len = (size_t)req.tp_block_size * req.tp_block_nr;
+  ring = mmap(NULL, node->ring_len, PROT_READ | PROT_WRITE,
+	      MAP_SHARED | MAP_LOCKED, fd, 0);
+  if(ring == MAP_FAILED)
+    ring = mmap(NULL, node->ring_len, PROT_READ | PROT_WRITE,
+		MAP_SHARED, fd, 0);
+  if(ring == MAP_FAILED)
+    {
+      printerror(__func__, "could not mmap ring on fd %d", fd);
+      goto err;
+    }
+
+  node->ring = ring;
+  node->ring_block = 0;
+  return 0;
+
+ err:
+  /* tear down any partially configured ring and revert to TPACKET_V1 */
+  memset(&req, 0, sizeof(req));
+  setsockopt(fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req));
+  ver = TPACKET_V1;
+  setsockopt(fd, SOL_PACKET, PACKET_VERSION, &ver, sizeof(ver));
+  node->ring_len = 0;
+  return -1;
+}
+
+/*
+ * dl_linux_ring_read
+ *
+ * process every block the kernel has handed to userspace, using the
+ * timestamp the kernel recorded for each frame, and then return each
+ * block to the kernel.
+ */
+static int dl_linux_ring_read(scamper_dl_t *node)
+{
+  struct tpacket_block_desc *bd;
+  struct tpacket3_hdr *ppd;
+  scamper_dl_rec_t dl;
+  unsigned int i, blocks = 0;
+  int ifindex;
+
+  if(scamper_fd_ifindex(node->fdn, &ifindex) != 0)
+    return -1;
+
+  while(blocks < DL_RING_BLOCK_NR)
+    {
+      bd = (struct tpacket_block_desc *)
+	(node->ring + ((size_t)node->ring_block * DL_RING_BLOCK_SIZE));
+      if((bd->hdr.bh1.block_status & TP_STATUS_USER) == 0)
+	break;
+
+      ppd = (struct tpacket3_hdr *)((uint8_t *)bd +
+				    bd->hdr.bh1.offset_to_first_pkt);
+      for(i=0; i<bd->hdr.bh1.num_pkts; i++)
+	{
+	  memset(&dl, 0, sizeof(dl));
+	  dl.dl_ifindex = ifindex;
+	  if(node->dlt_cb(&dl, (uint8_t *)ppd + ppd->tp_mac, ppd->tp_snaplen))
+	    {
+	      dl.dl_tv.tv_sec = ppd->tp_sec;
+	      dl.dl_tv.tv_usec = ppd->tp_nsec / 1000;
+	      dl.dl_flags |= SCAMPER_DL_REC_FLAG_TIMESTAMP;
+	      scamper_task_handledl(&dl);
+	    }
+	  ppd = (struct tpacket3_hdr *)((uint8_t *)ppd + ppd->tp_next_offset);
+	}
+
+      /* hand the block back to the kernel */
+      __sync_synchronize();
+      bd->hdr.bh1.block_status = TP_STATUS_KERNEL;
+      node->ring_block = (node->ring_block + 1) % DL_RING_BLOCK_NR;
+      blocks++;
+    }
+
+  return 0;
+}
+#endif
+
 static int dl_linux_node_init(const scamper_fd_t *fdn, scamper_dl_t *node)
 {
   struct ifreq ifreq;
@@ -1102,6 +1273,11 @@ static int dl_linux_node_init(const scamper_fd_t *fdn, scamper_dl_t *node)
       goto err;
     }
 
+#if defined(HAVE_TPACKET_V3)
+  if(scamper_option_dlring() != 0 && dl_linux_ring_init(fd, node) != 0)
+    scamper_debug(__func__, "%s using recvfrom rather than ring", ifname);
+#endif
+
   return 0;
 
  err:
@@ -1115,6 +1291,11 @@ static int dl_linux_read(const int fd, scamper_dl_t *node)
   struct sockaddr_ll from;
   socklen_t          fromlen;
 
+#if defined(HAVE_TPACKET_V3)
+  if(node->ring != NULL)
+    return dl_linux_ring_read(node);
+#endif
+
   fromlen = sizeof(from);
   while((len = recvfrom(fd, readbuf, readbuf_len, MSG_TRUNC,
 			(struct sockaddr *)&from, &fromlen)) == -1)
@@ -1557,42 +1738,416 @@ static int dl_dlpi_tx(const scamper_dl_t *node,
 
 #if defined(HAVE_BPF_FILTER)
 
-#if defined(HAVE_BPF)
-static void bpf_stmt(struct bpf_insn *insn, uint16_t code, uint32_t k)
-#else
-static void bpf_stmt(struct sock_filter *insn, uint16_t code, uint32_t k)
-#endif
+/*
+ * labels used when building a filter.  jumps to a label are resolved
+ * once the whole program has been emitted.
+ */
+#define DL_FILTER_L_NEXT     (-1)
+#define DL_FILTER_L_ARP      0
+#define DL_FILTER_L_IP4      1
+#define DL_FILTER_L_IP6      2
+#define DL_FILTER_L_TU4      3
+#define DL_FILTER_L_ICMP4    4
+#define DL_FILTER_L_ER4      5
+#define DL_FILTER_L_EQ4      6
+#define DL_FILTER_L_ERR4     7
+#define DL_FILTER_L_MATCH    8
+#define DL_FILTER_L_ACCEPT   9
+#define DL_FILTER_L_MAX      10
+
+typedef struct dl_filter
 {
-  insn->code = code;
-  insn->jt   = 0;
-  insn->jf   = 0;
-  insn->k    = k;
+  dl_insn_t insns[DL_FILTER_INSN_MAX];
+  int       jt[DL_FILTER_INSN_MAX];
+  int       jf[DL_FILTER_INSN_MAX];
+  int       labels[DL_FILTER_L_MAX];
+  int       len;
+} dl_filter_t;
+
+static void dl_filter_jump(dl_filter_t *f, uint16_t code, uint32_t k,
+			   int jt, int jf)
+{
+  if(f->len < 0 || f->len >= DL_FILTER_INSN_MAX)
+    {
+      f->len = -1;
+      return;
+    }
+  f->insns[f->len].code = code;
+  f->insns[f->len].jt   = 0;
+  f->insns[f->len].jf   = 0;
+  f->insns[f->len].k    = k;
+  f->jt[f->len] = jt;
+  f->jf[f->len] = jf;
+  f->len++;
   return;
 }
 
+static void dl_filter_stmt(dl_filter_t *f, uint16_t code, uint32_t k)
+{
+  dl_filter_jump(f, code, k, DL_FILTER_L_NEXT, DL_FILTER_L_NEXT);
+  return;
+}
+
+#if defined(HAVE_DL_FILTER_SIGS)
+static void dl_filter_label(dl_filter_t *f, int label)
+{
+  f->labels[label] = f->len;
+  return;
+}
+
+/*
+ * dl_filter_resolve
+ *
+ * fill out the jump offsets in the program now that the location of all
+ * labels is known.  conditional jumps can only go 255 instructions forward.
+ */
+static int dl_filter_resolve(dl_filter_t *f)
+{
+  int i, off;
+
+  if(f->len < 0)
+    return -1;
+
+  for(i=0; i<f->len; i++)
+    {
+      if(f->insns[i].code == (BPF_JMP+BPF_JA))
+	{
+	  if(f->jt[i] == DL_FILTER_L_NEXT || f->labels[f->jt[i]] < i+1)
+	    return -1;
+	  f->insns[i].k = f->labels[f->jt[i]] - (i+1);
+	  continue;
+	}
+      if(f->jt[i] != DL_FILTER_L_NEXT)
+	{
+	  off = f->labels[f->jt[i]] - (i+1);
+	  if(f->labels[f->jt[i]] < 0 || off < 0 || off > 255)
+	    return -1;
+	  f->insns[i].jt = off;
+	}
+      if(f->jf[i] != DL_FILTER_L_NEXT)
+	{
+	  off = f->labels[f->jf[i]] - (i+1);
+	  if(f->labels[f->jf[i]] < 0 || off < 0 || off > 255)
+	    return -1;
+	  f->insns[i].jf = off;
+	}
+    }
+
+  return 0;
+}
+
+/*
+ * dl_filter_ip4
+ *
+ * emit the part of the filter that handles IPv4 packets, where the IPv4
+ * header begins l bytes into the frame.  if the destination of every
+ * tx_ip signature is known, store the address(es) that scamper_task
+ * would look up into scratch memory and match them against the set.
+ */
+static void dl_filter_ip4(dl_filter_t *f, const scamper_task_sig_dl_t *sd,
+			  uint32_t l)
+{
+  int i, j, match = (sd->tx_ip4 == sd->ip4c) ? 1 : 0;
+
+  dl_filter_label(f, DL_FILTER_L_IP4);
+
+  if(sd->tx_ip4 == 0 && sd->sniff == 0)
+    {
+      dl_filter_stmt(f, BPF_RET+BPF_K, 0);
+      return;
+    }
+
+  /* sniff tasks only want ICMP */
+  if(sd->tx_ip4 == 0)
+    {
+      dl_filter_stmt(f, BPF_LD+BPF_B+BPF_ABS, l+9);
+      dl_filter_jump(f, BPF_JMP+BPF_JEQ+BPF_K, IPPROTO_ICMP,
+		     DL_FILTER_L_ACCEPT, DL_FILTER_L_NEXT);
+      dl_filter_stmt(f, BPF_RET+BPF_K, 0);
+      return;
+    }
+
+  /* accept all fragments after the first */
+  dl_filter_stmt(f, BPF_LD+BPF_H+BPF_ABS, l+6);
+  dl_filter_jump(f, BPF_JMP+BPF_JSET+BPF_K, 0x1fff,
+		 DL_FILTER_L_ACCEPT, DL_FILTER_L_NEXT);
+
+  dl_filter_stmt(f, BPF_LD+BPF_B+BPF_ABS, l+9);
+  dl_filter_jump(f, BPF_JMP+BPF_JEQ+BPF_K, IPPROTO_ICMP,
+		 DL_FILTER_L_ICMP4, DL_FILTER_L_NEXT);
+
+  if(match != 0)
+    {
+      /* TCP and UDP are matched on either address, others on dst */
+      dl_filter_jump(f, BPF_JMP+BPF_JEQ+BPF_K, IPPROTO_TCP,
+		     DL_FILTER_L_TU4, DL_FILTER_L_NEXT);
+      dl_filter_jump(f, BPF_JMP+BPF_JEQ+BPF_K, IPPROTO_UDP,
+		     DL_FILTER_L_TU4, DL_FILTER_L_NEXT);
+      dl_filter_stmt(f, BPF_LD+BPF_W+BPF_ABS, l+16);
+      dl_filter_stmt(f, BPF_ST, 0);
+      dl_filter_stmt(f, BPF_ST, 1);
+      dl_filter_jump(f, BPF_JMP+BPF_JA, 0, DL_FILTER_L_MATCH, DL_FILTER_L_NEXT);
+
+      dl_filter_label(f, DL_FILTER_L_TU4);
+      dl_filter_stmt(f, BPF_LD+BPF_W+BPF_ABS, l+12);
+      dl_filter_stmt(f, BPF_ST, 0);
+      dl_filter_stmt(f, BPF_LD+BPF_W+BPF_ABS, l+16);
+      dl_filter_stmt(f, BPF_ST, 1);
+      dl_filter_jump(f, BPF_JMP+BPF_JA, 0, DL_FILTER_L_MATCH, DL_FILTER_L_NEXT);
+    }
+  else
+    {
+      dl_filter_jump(f, BPF_JMP+BPF_JA, 0, DL_FILTER_L_ACCEPT, DL_FILTER_L_NEXT);
+    }
+
+  /*
+   * ICMP echo requests and replies, and ICMP errors that quote a probe.
+   * the errors are matched on the destination of the quoted packet.
+   */
+  dl_filter_label(f, DL_FILTER_L_ICMP4);
+  if(sd->sniff > 0)
+    {
+      dl_filter_jump(f, BPF_JMP+BPF_JA, 0, DL_FILTER_L_ACCEPT, DL_FILTER_L_NEXT);
+      if(match == 0)
+	return;
+    }
+  else
+    {
+      dl_filter_stmt(f, BPF_LDX+BPF_B+BPF_MSH, l);
+      dl_filter_stmt(f, BPF_LD+BPF_B+BPF_IND, l);
+      if(match == 0)
+	{
+	  dl_filter_jump(f, BPF_JMP+BPF_JEQ+BPF_K, ICMP_ECHOREPLY,
+			 DL_FILTER_L_ACCEPT, DL_FILTER_L_NEXT);
+	  dl_filter_jump(f, BPF_JMP+BPF_JEQ+BPF_K, ICMP_ECHO,
+			 DL_FILTER_L_ACCEPT, DL_FILTER_L_NEXT);
+	  dl_filter_jump(f, BPF_JMP+BPF_JEQ+BPF_K, ICMP_UNREACH,
+			 DL_FILTER_L_ACCEPT, DL_FILTER_L_NEXT);
+	  dl_filter_jump(f, BPF_JMP+BPF_JEQ+BPF_K, ICMP_TIMXCEED,
+			 DL_FILTER_L_ACCEPT, DL_FILTER_L_NEXT);
+	  dl_filter_stmt(f, BPF_RET+BPF_K, 0);
+	  return;
+	}
+      dl_filter_jump(f, BPF_JMP+BPF_JEQ+BPF_K, ICMP_ECHOREPLY,
+		     DL_FILTER_L_ER4, DL_FILTER_L_NEXT);
+      dl_filter_jump(f, BPF_JMP+BPF_JEQ+BPF_K, ICMP_ECHO,
+		     DL_FILTER_L_EQ4, DL_FILTER_L_NEXT);
+      dl_filter_jump(f, BPF_JMP+BPF_JEQ+BPF_K, ICMP_UNREACH,
+		     DL_FILTER_L_ERR4, DL_FILTER_L_NEXT);
+      dl_filter_jump(f, BPF_JMP+BPF_JEQ+BPF_K, ICMP_TIMXCEED,
+		     DL_FILTER_L_ERR4, DL_FILTER_L_NEXT);
+      dl_filter_stmt(f, BPF_RET+BPF_K, 0);
+
+      dl_filter_label(f, DL_FILTER_L_ER4);
+      dl_filter_stmt(f, BPF_LD+BPF_W+BPF_ABS, l+12);
+      dl_filter_stmt(f, BPF_ST, 0);
+      dl_filter_stmt(f, BPF_ST, 1);
+      dl_filter_jump(f, BPF_JMP+BPF_JA, 0, DL_FILTER_L_MATCH, DL_FILTER_L_NEXT);
+
+      dl_filter_label(f, DL_FILTER_L_EQ4);
+      dl_filter_stmt(f, BPF_LD+BPF_W+BPF_ABS, l+16);
+      dl_filter_stmt(f, BPF_ST, 0);
+      dl_filter_stmt(f, BPF_ST, 1);
+      dl_filter_jump(f, BPF_JMP+BPF_JA, 0, DL_FILTER_L_MATCH, DL_FILTER_L_NEXT);
+
+      dl_filter_label(f, DL_FILTER_L_ERR4);
+      dl_filter_stmt(f, BPF_LD+BPF_W+BPF_IND, l+8+16);
+      dl_filter_stmt(f, BPF_ST, 0);
+      dl_filter_stmt(f, BPF_ST, 1);
+    }
+
+  dl_filter_label(f, DL_FILTER_L_MATCH);
+  for(i=0; i<2; i++)
+    {
+      dl_filter_stmt(f, BPF_LD+BPF_MEM, i);
+      for(j=0; j<sd->ip4c; j++)
+	dl_filter_jump(f, BPF_JMP+BPF_JEQ+BPF_K, ntohl(sd->ip4[j].s_addr),
+		       DL_FILTER_L_ACCEPT, DL_FILTER_L_NEXT);
+    }
+  dl_filter_stmt(f, BPF_RET+BPF_K, 0);
+
+  return;
+}
+
+/*
+ * dl_filter_compile
+ *
+ * build a filter that only accepts frames that could match one of the
+ * signatures that tasks have installed.  IPv4 packets are matched on
+ * address when there are few enough tx_ip signatures, otherwise all
+ * filtering is on the type of packet.
+ */
+static int dl_filter_compile(const scamper_dl_t *node,
+			     const scamper_task_sig_dl_t *sd, dl_filter_t *f)
+{
+  uint32_t l;
+  int e, i;
+
+  f->len = 0;
+  for(i=0; i<DL_FILTER_L_MAX; i++)
+    f->labels[i] = -1;
+
+  /* figure out where the network header is, and if there is an ethertype */
+  if(node->dlt_cb == dlt_en10mb_cb)
+    {
+      e = 12; l = 14;
+    }
+#ifdef HAVE_FIREWIRE
+  else if(node->dlt_cb == dlt_firewire_cb)
+    {
+      e = 16; l = 18;
+    }
+#endif
+#ifdef HAVE_BPF
+  else if(node->dlt_cb == dlt_null_cb)
+    {
+      e = -1; l = 4;
+    }
+#endif
+  else if(node->dlt_cb == dlt_raw_cb)
+    {
+      e = -1; l = 0;
+    }
+  else return -1;
+
+  if(e >= 0)
+    {
+      dl_filter_stmt(f, BPF_LD+BPF_H+BPF_ABS, e);
+      dl_filter_jump(f, BPF_JMP+BPF_JEQ+BPF_K, ETHERTYPE_IP,
+		     DL_FILTER_L_IP4, DL_FILTER_L_NEXT);
+      dl_filter_jump(f, BPF_JMP+BPF_JEQ+BPF_K, ETHERTYPE_IPV6,
+		     DL_FILTER_L_IP6, DL_FILTER_L_NEXT);
+      dl_filter_jump(f, BPF_JMP+BPF_JEQ+BPF_K, ETHERTYPE_ARP,
+		     DL_FILTER_L_ARP, DL_FILTER_L_NEXT);
+      dl_filter_stmt(f, BPF_RET+BPF_K, 0);
+      dl_filter_label(f, DL_FILTER_L_ARP);
+      dl_filter_stmt(f, BPF_RET+BPF_K, sd->tx_nd4 > 0 ? 65535 : 0);
+    }
+  else
+    {
+      dl_filter_stmt(f, BPF_LD+BPF_B+BPF_ABS, l);
+      dl_filter_stmt(f, BPF_ALU+BPF_AND+BPF_K, 0xf0);
+      dl_filter_jump(f, BPF_JMP+BPF_JEQ+BPF_K, 0x40,
+		     DL_FILTER_L_IP4, DL_FILTER_L_NEXT);
+      dl_filter_jump(f, BPF_JMP+BPF_JEQ+BPF_K, 0x60,
+		     DL_FILTER_L_IP6, DL_FILTER_L_NEXT);
+      dl_filter_stmt(f, BPF_RET+BPF_K, 0);
+    }
+
+  /*
+   * IPv6 is only filtered on the type of packet: if the only signatures
+   * are for neighbour discovery or sniffing, then only ICMPv6 is needed.
+   */
+  dl_filter_label(f, DL_FILTER_L_IP6);
+  if(sd->tx_ip6 > 0)
+    {
+      dl_filter_stmt(f, BPF_RET+BPF_K, 65535);
+    }
+  else if(sd->tx_nd6 > 0 || sd->sniff > 0)
+    {
+      dl_filter_stmt(f, BPF_LD+BPF_B+BPF_ABS, l+6);
+      dl_filter_jump(f, BPF_JMP+BPF_JEQ+BPF_K, IPPROTO_ICMPV6,
+		     DL_FILTER_L_ACCEPT, DL_FILTER_L_NEXT);
+      dl_filter_stmt(f, BPF_RET+BPF_K, 0);
+    }
+  else
+    {
+      dl_filter_stmt(f, BPF_RET+BPF_K, 0);
+    }
+
+  /* the IPv4 code is last so the address match is close to the accept */
+  dl_filter_ip4(f, sd, l);
+  dl_filter_label(f, DL_FILTER_L_ACCEPT);
+  dl_filter_stmt(f, BPF_RET+BPF_K, 65535);
+
+  return dl_filter_resolve(f);
+}
+#endif
+
 static int dl_filter(scamper_dl_t *node)
 {
-#if defined(HAVE_BPF)
-  struct bpf_insn insns[1];
-#else
-  struct sock_filter insns[1];
+#if defined(HAVE_DL_FILTER_SIGS)
+  scamper_task_sig_dl_t sd;
+  struct in_addr ip4[DL_FILTER_ADDR_MAX];
+#endif
+  dl_filter_t *f = NULL;
+  dl_insn_t *insns = NULL;
+  int len, rc = -1;
+
+  if((f = malloc(sizeof(dl_filter_t))) == NULL)
+    {
+      printerror(__func__, "could not malloc filter");
+      return -1;
+    }
+
+#if defined(HAVE_DL_FILTER_SIGS)
+  memset(&sd, 0, sizeof(sd));
+  sd.ip4 = ip4;
+  sd.ip4m = DL_FILTER_ADDR_MAX;
+  scamper_task_sig_dl(&sd);
+  if(dl_filter_compile(node, &sd, f) != 0)
 #endif
+    {
+      f->len = 0;
+      dl_filter_stmt(f, BPF_RET+BPF_K, 65535);
+    }
+  len = f->len;
+
+  /* nothing to do if the filter has not changed */
+  if(node->filter != NULL && node->filter_len == len &&
+     memcmp(node->filter, f->insns, sizeof(dl_insn_t) * len) == 0)
+    {
+      rc = 0;
+      goto done;
+    }
 
-  bpf_stmt(&insns[0], BPF_RET+BPF_K, 65535);
+  if((insns = memdup(f->insns, sizeof(dl_insn_t) * len)) == NULL)
+    {
+      printerror(__func__, "could not memdup filter");
+      goto done;
+    }
 
 #if defined(HAVE_BPF)
-  if(dl_bpf_filter(node, insns, 1) == -1)
+  if(dl_bpf_filter(node, f->insns, len) == -1)
 #elif defined(__linux__)
-  if(dl_linux_filter(node, insns, 1) == -1)
+  if(dl_linux_filter(node, f->insns, len) == -1)
 #endif
     {
-      return -1;
+      goto done;
     }
 
-   return 0;
+  if(node->filter != NULL)
+    free(node->filter);
+  node->filter = insns; insns = NULL;
+  node->filter_len = len;
+  rc = 0;
+
+ done:
+  if(insns != NULL) free(insns);
+  free(f);
+  return rc;
 }
 #endif
 
+/*
+ * scamper_dl_filter_update
+ *
+ * the set of signatures installed by tasks has changed, so bring the
+ * filter on each datalink up to date.
+ */
+void scamper_dl_filter_update(void)
+{
+#if defined(HAVE_DL_FILTER_SIGS)
+  dlist_node_t *dn;
+
+  if(dl_list == NULL)
+    return;
+  for(dn=dlist_head_node(dl_list); dn != NULL; dn=dlist_node_next(dn))
+    dl_filter(dlist_node_item(dn));
+#endif
+  return;
+}
+
 int scamper_dl_rec_src(scamper_dl_rec_t *dl, scamper_addr_t *addr)
 {
   if(dl->dl_af == AF_INET)
@@ -1959,6 +2514,16 @@ void scamper_dl_read_cb(const int fd, void *param)
 void scamper_dl_state_free(scamper_dl_t *dl)
 {
   assert(dl != NULL);
+  if(dl->node != NULL)
+    dlist_node_pop(dl_list, dl->node);
+#if defined(HAVE_BPF_FILTER)
+  if(dl->filter != NULL)
+    free(dl->filter);
+#endif
+#if defined(HAVE_TPACKET_V3)
+  if(dl->ring != NULL)
+    munmap(dl->ring, dl->ring_len);
+#endif
   free(dl);
   return;
 }
@@ -1996,6 +2561,12 @@ scamper_dl_t *scamper_dl_state_alloc(scamper_fd_t *fdn)
   dl_filter(dl);
 #endif
 
+  if((dl->node = dlist_tail_push(dl_list, dl)) == NULL)
+    {
+      printerror(__func__, "could not push dl");
+      goto err;
+    }
+
   return dl;
 
  err:
@@ -2075,8 +2646,26 @@ int scamper_dl_open(const int ifindex)
   return fd;
 }
 
+/*
+ * dl_list_onremove
+ *
+ * the datalink states outlive the list when scamper exits, as they are
+ * freed with their file descriptors; clear their pointers into the list.
+ */
+static void dl_list_onremove(scamper_dl_t *dl)
+{
+  dl->node = NULL;
+  return;
+}
+
 void scamper_dl_cleanup()
 {
+  if(dl_list != NULL)
+    {
+      dlist_free_cb(dl_list, (dlist_free_t)dl_list_onremove);
+      dl_list = NULL;
+    }
+
   if(readbuf != NULL)
     {
       free(readbuf);
@@ -2088,6 +2677,12 @@ void scamper_dl_cleanup()
 
 int scamper_dl_init()
 {
+  if((dl_list = dlist_alloc()) == NULL)
+    {
+      printerror(__func__, "could not alloc dl_list");
+      return -1;
+    }
+
 #if defined(HAVE_BPF)
   if(dl_bpf_init() == -1)
     {
@@ -534,6 +534,11 @@ scamper_dl_t *scamper_dl_state_alloc(scamper_fd_t *fdn);
 void scamper_dl_state_free(scamper_dl_t *dl);
 #endif
 
+/*
+ * scamper_dl_filter_update: rebuild datalink filters from task signatures
+ */
+void scamper_dl_filter_update(void);
+
 /*
  * scamper_dl_read_cb: callback for read events
  */
@@ -30,6 +30,7 @@
 #include "internal.h"
 
 #include "scamper.h"
+#include "scamper_addr.h"
 #include "scamper_fds.h"
 #include "scamper_debug.h"
 #include "scamper_icmp4.h"
@@ -40,6 +41,7 @@
 #include "scamper_tcp6.h"
 #include "scamper_ip4.h"
 #include "scamper_dl.h"
+#include "scamper_probe.h"
 #ifndef _WIN32
 #include "scamper_rtsock.h"
 #endif
@@ -60,6 +62,9 @@ typedef struct scamper_fd_poll
   dlist_t         *list;   /* which list the node is in */
   dlist_node_t    *node;   /* node in the poll list */
   uint8_t          flags;  /* flags associated with structure */
+#ifdef HAVE_IO_URING
+  uint32_t         seq;    /* identifies the poll request in the ring */
+#endif
 } scamper_fd_poll_t;
 
 /*
@@ -162,6 +167,7 @@ struct scamper_fd
   (fd)->type == SCAMPER_FD_TYPE_DL)
 
 #define SCAMPER_FD_POLL_FLAG_INACTIVE 0x01 /* the fd should not be polled */
+#define SCAMPER_FD_POLL_FLAG_ARMED    0x02 /* a ring poll request is active */
 
 #define fd_tcp_sport  fd_t_un.fd_t_tcp.sport
 #define fd_tcp_addr   fd_t_un.fd_t_tcp.addr
@@ -182,6 +188,10 @@ static dlist_t       *write_queue = NULL;
 static dlist_t       *refcnt_0    = NULL;
 static int          (*pollfunc)(struct timeval *timeout) = NULL;
 
+#ifdef HAVE_IO_URING
+static void fds_uring_cancel(scamper_fd_poll_t *poll);
+#endif
+
 #ifdef HAVE_SCAMPER_DEBUG
 
 static char *fd_addr_tostr(char *buf, size_t len, int af, void *addr)
@@ -282,6 +292,9 @@ static char *fd_tostr(scamper_fd_t *fdn)
 
 static void fd_close(scamper_fd_t *fdn)
 {
+  /* send any probes waiting to go out on the socket */
+  scamper_probe_flush();
+
   switch(fdn->type)
     {
     case SCAMPER_FD_TYPE_PRIVATE:
@@ -347,6 +360,12 @@ static void fd_free(scamper_fd_t *fdn)
   if(fdn->fd >= 0 && fdn->fd < fd_array_s && fd_array != NULL)
     fd_array[fdn->fd] = NULL;
 
+#ifdef HAVE_IO_URING
+  /* a poll request holds a reference to the file, so cancel it */
+  fds_uring_cancel(&fdn->read);
+  fds_uring_cancel(&fdn->write);
+#endif
+
   if(fdn->read.node != NULL)
     dlist_node_pop(fdn->read.list, fdn->read.node);
 
@@ -967,6 +986,283 @@ static int fds_epoll(struct timeval *tv)
 }
 #endif
 
+#ifdef HAVE_IO_URING
+/*
+ * the io_uring backend.  each fd that is being monitored for an event
+ * has a one-shot poll request in the ring.  poll requests, and requests
+ * to remove them when an fd is paused, are queued in the submission
+ * ring and handed to the kernel in the same io_uring_enter call that
+ * waits for completions, so enabling and disabling events does not cost
+ * a system call each as it does with epoll_ctl.  when a poll request
+ * completes, the callback is called, and the request re-armed if the
+ * fd is still being monitored.
+ */
+#define URING_ENTRIES   256
+#define URING_UD_IGNORE 0xffffffffffffffffULL
+
+static int                   ur = -1;
+static void                 *ur_sq_ptr = NULL;
+static size_t                ur_sq_len = 0;
+static void                 *ur_cq_ptr = NULL;
+static size_t                ur_cq_len = 0;
+static struct io_uring_sqe  *ur_sqes = NULL;
+static size_t                ur_sqes_len = 0;
+static unsigned             *ur_sq_head, *ur_sq_tail, *ur_sq_mask;
+static unsigned             *ur_sq_array, ur_sq_entries;
+static unsigned             *ur_cq_head, *ur_cq_tail, *ur_cq_mask;
+static struct io_uring_cqe  *ur_cqes = NULL;
+static struct io_uring_cqe  *ur_events = NULL;
+static unsigned              ur_cq_entries;
+static unsigned              ur_submit = 0;
+static uint32_t              ur_seq = 0;
+
+static int fds_uring_enter(unsigned to_submit, unsigned min_complete,
+			   unsigned flags, void *arg, size_t argsz)
+{
+  int rc;
+  rc = syscall(__NR_io_uring_enter, ur, to_submit, min_complete, flags,
+	       arg, argsz);
+  if(rc > 0)
+    ur_submit -= rc;
+  return rc;
+}
+
+static struct io_uring_sqe *fds_uring_sqe(void)
+{
+  struct io_uring_sqe *sqe;
+  unsigned tail, idx;
+
+  /* if the submission ring is full, hand what is there to the kernel */
+  tail = *ur_sq_tail;
+  if(tail - __atomic_load_n(ur_sq_head, __ATOMIC_ACQUIRE) >= ur_sq_entries)
+    {
+      if(fds_uring_enter(ur_submit, 0, 0, NULL, 0) < 0)
+	{
+	  printerror(__func__, "could not submit");
+	  return NULL;
+	}
+    }
+
+  idx = tail & *ur_sq_mask;
+  sqe = &ur_sqes[idx];
+  memset(sqe, 0, sizeof(struct io_uring_sqe));
+  ur_sq_array[idx] = idx;
+  __atomic_store_n(ur_sq_tail, tail + 1, __ATOMIC_RELEASE);
+  ur_submit++;
+  return sqe;
+}
+
+static uint64_t fds_uring_ud(int fd, uint32_t seq, int write)
+{
+  return ((uint64_t)fd << 32) | (seq << 1) | (write != 0 ? 1 : 0);
+}
+
+/*
+ * fds_uring_arm
+ *
+ * queue a one-shot poll request for the fd.
+ */
+static void fds_uring_arm(scamper_fd_t *fdn, scamper_fd_poll_t *poll)
+{
+  struct io_uring_sqe *sqe;
+  uint32_t events;
+  int write = (poll == &fdn->write) ? 1 : 0;
+
+  if((poll->flags & SCAMPER_FD_POLL_FLAG_ARMED) != 0 ||
+     (sqe = fds_uring_sqe()) == NULL)
+    return;
+
+  events = write != 0 ? POLLOUT : POLLIN;
+#if BYTE_ORDER == BIG_ENDIAN
+  events = (events << 16) | (events >> 16);
+#endif
+
+  poll->seq = (ur_seq++) & 0x7fffffff;
+  poll->flags |= SCAMPER_FD_POLL_FLAG_ARMED;
+  sqe->opcode = IORING_OP_POLL_ADD;
+  sqe->fd = fdn->fd;
+  sqe->poll32_events = events;
+  sqe->user_data = fds_uring_ud(fdn->fd, poll->seq, write);
+  return;
+}
+
+/*
+ * fds_uring_cancel
+ *
+ * queue a request to remove the poll request for the fd.
+ */
+static void fds_uring_cancel(scamper_fd_poll_t *poll)
+{
+  struct io_uring_sqe *sqe;
+  scamper_fd_t *fdn = poll->fdn;
+
+  if(ur == -1 || (poll->flags & SCAMPER_FD_POLL_FLAG_ARMED) == 0)
+    return;
+  poll->flags &= ~(SCAMPER_FD_POLL_FLAG_ARMED);
+
+  if((sqe = fds_uring_sqe()) == NULL)
+    return;
+  sqe->opcode = IORING_OP_POLL_REMOVE;
+  sqe->fd = -1;
+  sqe->addr = fds_uring_ud(fdn->fd, poll->seq, poll == &fdn->write);
+  sqe->user_data = URING_UD_IGNORE;
+  return;
+}
+
+static int fds_uring_init(void)
+{
+  struct io_uring_params p;
+
+  memset(&p, 0, sizeof(p));
+  if((ur = syscall(__NR_io_uring_setup, URING_ENTRIES, &p)) == -1)
+    {
+      printerror(__func__, "could not io_uring_setup");
+      return -1;
+    }
+  if((p.features & IORING_FEAT_EXT_ARG) == 0)
+    {
+      printerror_msg(__func__, "io_uring does not support timeouts");
+      return -1;
+    }
+
+  ur_sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  ur_cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+  if((p.features & IORING_FEAT_SINGLE_MMAP) != 0)
+    {
+      if(ur_cq_len > ur_sq_len)
+	ur_sq_len = ur_cq_len;
+      ur_cq_len = 0;
+    }
+
+  ur_sq_ptr = mmap(NULL, ur_sq_len, PROT_READ | PROT_WRITE,
+		   MAP_SHARED | MAP_POPULATE, ur, IORING_OFF_SQ_RING);
+  if(ur_sq_ptr == MAP_FAILED)
+    {
+      printerror(__func__, "could not mmap sq ring");
+      ur_sq_ptr = NULL;
+      return -1;
+    }
+
+  if(ur_cq_len == 0)
+    ur_cq_ptr = ur_sq_ptr;
+  else if((ur_cq_ptr = mmap(NULL, ur_cq_len, PROT_READ | PROT_WRITE,
+			    MAP_SHARED | MAP_POPULATE, ur,
+			    IORING_OFF_CQ_RING)) == MAP_FAILED)
+    {
+      printerror(__func__, "could not mmap cq ring");
+      ur_cq_ptr = NULL;
+      return -1;
+    }
+
+  ur_sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+  ur_sqes = mmap(NULL, ur_sqes_len, PROT_READ | PROT_WRITE,
+		 MAP_SHARED | MAP_POPULATE, ur, IORING_OFF_SQES);
+  if(ur_sqes == MAP_FAILED)
+    {
+      printerror(__func__, "could not mmap sqes");
+      ur_sqes = NULL;
+      return -1;
+    }
+
+  ur_sq_head    = (unsigned *)((uint8_t *)ur_sq_ptr + p.sq_off.head);
+  ur_sq_tail    = (unsigned *)((uint8_t *)ur_sq_ptr + p.sq_off.tail);
+  ur_sq_mask    = (unsigned *)((uint8_t *)ur_sq_ptr + p.sq_off.ring_mask);
+  ur_sq_array   = (unsigned *)((uint8_t *)ur_sq_ptr + p.sq_off.array);
+  ur_sq_entries = p.sq_entries;
+  ur_cq_head    = (unsigned *)((uint8_t *)ur_cq_ptr + p.cq_off.head);
+  ur_cq_tail    = (unsigned *)((uint8_t *)ur_cq_ptr + p.cq_off.tail);
+  ur_cq_mask    = (unsigned *)((uint8_t *)ur_cq_ptr + p.cq_off.ring_mask);
+  ur_cqes = (struct io_uring_cqe *)((uint8_t *)ur_cq_ptr + p.cq_off.cqes);
+  ur_cq_entries = p.cq_entries;
+
+  if((ur_events = malloc_zero(sizeof(struct io_uring_cqe) *
+			      ur_cq_entries)) == NULL)
+    {
+      printerror(__func__, "could not alloc events");
+      return -1;
+    }
+
+  scamper_debug(__func__, "fd %d entries %u", ur, ur_sq_entries);
+  return 0;
+}
+
+static int fds_uring(struct timeval *tv)
+{
+  struct io_uring_getevents_arg arg;
+  struct __kernel_timespec ts;
+  scamper_fd_poll_t *poll;
+  scamper_fd_t *fdp;
+  unsigned head, tail, c, i;
+  uint64_t ud;
+  uint32_t seq;
+  int fd, rc;
+
+  memset(&arg, 0, sizeof(arg));
+  arg.sigmask_sz = _NSIG / 8;
+  if(tv != NULL)
+    {
+      ts.tv_sec  = tv->tv_sec;
+      ts.tv_nsec = tv->tv_usec * 1000;
+      arg.ts = (uint64_t)(uintptr_t)&ts;
+    }
+
+  /* submit the queued requests, and wait for something to complete */
+  rc = fds_uring_enter(ur_submit, 1,
+		       IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG,
+		       &arg, sizeof(arg));
+  if(rc < 0 && errno != ETIME && errno != EINTR && errno != EBUSY)
+    {
+      printerror(__func__, "could not io_uring_enter");
+      return -1;
+    }
+
+  /* copy the completions out so that the callbacks can queue requests */
+  head = *ur_cq_head;
+  tail = __atomic_load_n(ur_cq_tail, __ATOMIC_ACQUIRE);
+  c = 0;
+  while(head != tail)
+    {
+      memcpy(&ur_events[c++], &ur_cqes[head & *ur_cq_mask],
+	     sizeof(struct io_uring_cqe));
+      head++;
+    }
+  __atomic_store_n(ur_cq_head, head, __ATOMIC_RELEASE);
+
+  for(i=0; i<c; i++)
+    {
+      if((ud = ur_events[i].user_data) == URING_UD_IGNORE)
+	continue;
+      fd  = ud >> 32;
+      seq = (ud & 0xffffffff) >> 1;
+      if(fd < 0 || fd >= fd_array_s || (fdp = fd_array[fd]) == NULL)
+	continue;
+
+      /* ignore completions of requests that have since been cancelled */
+      poll = (ud & 1) != 0 ? &fdp->write : &fdp->read;
+      if((poll->flags & SCAMPER_FD_POLL_FLAG_ARMED) == 0 || poll->seq != seq)
+	continue;
+      poll->flags &= ~(SCAMPER_FD_POLL_FLAG_ARMED);
+
+      if(ur_events[i].res < 0)
+	{
+	  printerror_msg(__func__, "fd %d poll: %s", fd,
+			 strerror(-ur_events[i].res));
+	  continue;
+	}
+      poll->cb(fd, poll->param);
+
+      /* the callback might have freed the fd */
+      if((fdp = fd_array[fd]) == NULL)
+	continue;
+      poll = (ud & 1) != 0 ? &fdp->write : &fdp->read;
+      if((poll->flags & SCAMPER_FD_POLL_FLAG_INACTIVE) == 0)
+	fds_uring_arm(fdp, poll);
+    }
+
+  return 0;
+}
+#endif
+
 static int fd_addr_cmp(int type, void *a, void *b)
 {
   assert(type == SCAMPER_FD_TYPE_TCP4   || type == SCAMPER_FD_TYPE_TCP6 ||
@@ -1454,6 +1750,10 @@ void scamper_fd_read_pause(scamper_fd_t *fdn)
     fds_epoll_ctl(fdn, EPOLLIN, EPOLL_CTL_DEL);
 #endif
 
+#ifdef HAVE_IO_URING
+  fds_uring_cancel(&fdn->read);
+#endif
+
   fdn->read.flags |= SCAMPER_FD_POLL_FLAG_INACTIVE;
   return;
 }
@@ -1482,6 +1782,11 @@ void scamper_fd_read_unpause(scamper_fd_t *fdn)
 	fds_epoll_ctl(fdn, EPOLLIN, EPOLL_CTL_ADD);
 #endif
 
+#ifdef HAVE_IO_URING
+      if(ur != -1)
+	fds_uring_arm(fdn, &fdn->read);
+#endif
+
       /*
        * the fd may still be on the read fds list, just with the inactive bit
        * set.  if it isn't, then we have to put it on the queue.
@@ -1513,6 +1818,10 @@ void scamper_fd_write_pause(scamper_fd_t *fdn)
     fds_epoll_ctl(fdn, EPOLLOUT, EPOLL_CTL_DEL);
 #endif
 
+#ifdef HAVE_IO_URING
+  fds_uring_cancel(&fdn->write);
+#endif
+
   fdn->write.flags |= SCAMPER_FD_POLL_FLAG_INACTIVE;
   return;
 }
@@ -1541,6 +1850,11 @@ void scamper_fd_write_unpause(scamper_fd_t *fdn)
 	fds_epoll_ctl(fdn, EPOLLOUT, EPOLL_CTL_ADD);
 #endif
 
+#ifdef HAVE_IO_URING
+      if(ur != -1)
+	fds_uring_arm(fdn, &fdn->write);
+#endif
+
       /*
        * the fd may still be on the write fds list, just with the inactive bit
        * set.  if it isn't, then we have to put it on the queue.
@@ -1942,6 +2256,15 @@ int scamper_fds_init()
     }
 #endif
 
+#ifdef HAVE_IO_URING
+  if(scamper_option_iouring())
+    {
+      pollfunc = fds_uring;
+      if(fds_uring_init() != 0)
+	return -1;
+    }
+#endif
+
   if(scamper_option_select() || pollfunc == NULL)
     pollfunc = fds_select;
 
@@ -2068,5 +2391,31 @@ void scamper_fds_cleanup()
     }
 #endif
 
+#ifdef HAVE_IO_URING
+  if(ur_sqes != NULL)
+    {
+      munmap(ur_sqes, ur_sqes_len);
+      ur_sqes = NULL;
+    }
+  if(ur_cq_ptr != NULL && ur_cq_ptr != ur_sq_ptr)
+    munmap(ur_cq_ptr, ur_cq_len);
+  ur_cq_ptr = NULL;
+  if(ur_sq_ptr != NULL)
+    {
+      munmap(ur_sq_ptr, ur_sq_len);
+      ur_sq_ptr = NULL;
+    }
+  if(ur != -1)
+    {
+      close(ur);
+      ur = -1;
+    }
+  if(ur_events != NULL)
+    {
+      free(ur_events);
+      ur_events = NULL;
+    }
+#endif
+
   return;
 }
@@ -35,6 +35,7 @@
 #include "scamper_file_text.h"
 #include "scamper_file_arts.h"
 #include "scamper_file_json.h"
+#include "scamper_file_z.h"
 
 #include "trace/scamper_trace.h"
 #include "trace/scamper_trace_text.h"
@@ -89,6 +90,7 @@ struct scamper_file
   void                     *writeparam;
   scamper_file_readfunc_t   readfunc;
   void                     *readparam;
+  scamper_file_z_t         *z;
 };
 
 struct scamper_file_filter
@@ -418,6 +420,44 @@ int scamper_file_read(scamper_file_t *sf, scamper_file_filter_t *filter,
   return -1;
 }
 
+/*
+ * scamper_file_idx_count
+ *
+ * the number of records in the index of a file opened with mode 'm'.
+ */
+uint32_t scamper_file_idx_count(const scamper_file_t *sf)
+{
+  warts_state_t *state;
+  if(sf->type != SCAMPER_FILE_WARTS || (state = sf->state) == NULL)
+    return 0;
+  return state->idxc;
+}
+
+const scamper_file_idx_t *scamper_file_idx_get(const scamper_file_t *sf,
+					       uint32_t i)
+{
+  warts_state_t *state;
+  if(sf->type != SCAMPER_FILE_WARTS || (state = sf->state) == NULL ||
+     i >= state->idxc)
+    return NULL;
+  return &state->idx[i];
+}
+
+/*
+ * scamper_file_idx_seek
+ *
+ * position the file so that the next call to scamper_file_read returns
+ * the i'th record in the index.  reading continues from there.
+ */
+int scamper_file_idx_seek(scamper_file_t *sf, uint32_t i)
+{
+  if(sf->type != SCAMPER_FILE_WARTS ||
+     scamper_file_warts_idx_seek(sf, i) != 0)
+    return -1;
+  sf->eof = 0;
+  return 0;
+}
+
 /*
  * scamper_file_filter_isset
  *
@@ -570,6 +610,20 @@ void scamper_file_seteof(scamper_file_t *sf)
   return;
 }
 
+/*
+ * scamper_file_setzlevel
+ *
+ * set the compression level of a file that is being written compressed,
+ * or zero for the codec's default.  this has to be done before anything
+ * is written to the file, and does nothing to an uncompressed file.
+ */
+int scamper_file_setzlevel(scamper_file_t *sf, int level)
+{
+  if(sf->z == NULL)
+    return 0;
+  return scamper_file_z_setlevel(sf->z, level);
+}
+
 /*
  * scamper_file_free
  *
@@ -578,6 +632,7 @@ void scamper_file_free(scamper_file_t *sf)
 {
   if(sf != NULL)
     {
+      if(sf->z) scamper_file_z_free(sf->z);
       if(sf->filename) free(sf->filename);
       free(sf);
     }
@@ -596,6 +651,13 @@ void scamper_file_close(scamper_file_t *sf)
       handlers[sf->type].free_state(sf);
     }
 
+  /* finish any compressed stream before the file is closed */
+  if(sf->z != NULL)
+    {
+      scamper_file_z_free(sf->z);
+      sf->z = NULL;
+    }
+
   /* close the file descriptor */
   if(sf->fd != -1)
     {
@@ -639,9 +701,45 @@ static int file_type_detect(scamper_file_t *sf)
   return SCAMPER_FILE_NONE;
 }
 
+/*
+ * file_open_readz
+ *
+ * if the file begins like a compressed file, then read it through a
+ * decompressor.  only warts files are recognised inside a compressed
+ * file.  returns 1 if the file is compressed, 0 if not, -1 on error.
+ */
+static int file_open_readz(scamper_file_t *sf)
+{
+  uint8_t buf[6];
+  size_t len;
+  int codec, rc;
+
+  if(lseek(sf->fd, 0, SEEK_SET) == -1)
+    return -1;
+  if((rc = read_wrap(sf->fd, buf, &len, sizeof(buf))) == -1)
+    return -1;
+  if((codec = scamper_file_z_magic(buf, len)) == SCAMPER_FILE_Z_NONE)
+    return lseek(sf->fd, 0, SEEK_SET) == -1 ? -1 : 0;
+
+  if(lseek(sf->fd, 0, SEEK_SET) == -1 ||
+     (sf->z = scamper_file_z_alloc(sf->fd, codec, 'r')) == NULL)
+    return -1;
+  scamper_file_setreadfunc(sf, sf->z, scamper_file_z_read);
+
+  /* the warts magic, 0x1205, in network byte order */
+  if(scamper_file_z_peek(sf->z, buf, 2) != 0 || buf[0] != 0x12 ||
+     buf[1] != 0x05 ||
+     (sf->type != SCAMPER_FILE_NONE && sf->type != SCAMPER_FILE_WARTS))
+    return -1;
+  sf->type = SCAMPER_FILE_WARTS;
+
+  return 1;
+}
+
 static int file_open_read(scamper_file_t *sf)
 {
   struct stat sb;
+  int rc;
 
   if(sf->fd != -1)
     {
@@ -649,7 +747,12 @@ static int file_open_read(scamper_file_t *sf)
 	return -1;
 
       if(sb.st_size != 0 && (sb.st_mode & S_IFIFO) == 0)
-	sf->type = file_type_detect(sf);
+	{
+	  if((rc = file_open_readz(sf)) == -1)
+	    return -1;
+	  if(rc == 0)
+	    sf->type = file_type_detect(sf);
+	}
     }
 
   if(sf->type == SCAMPER_FILE_NONE)
@@ -661,6 +764,21 @@ static int file_open_read(scamper_file_t *sf)
   return handlers[sf->type].init_read(sf);
 }
 
+static int file_open_mmap(scamper_file_t *sf)
+{
+  /* only warts files, and only regular files, can be mapped */
+  if(sf->fd == -1 || file_type_detect(sf) != SCAMPER_FILE_WARTS)
+    return -1;
+  sf->type = SCAMPER_FILE_WARTS;
+
+  if(scamper_file_warts_init_mmap(sf) != 0)
+    return -1;
+
+  /* the index may have been built by reading to the end of the file */
+  sf->eof = 0;
+  return 0;
+}
+
 static int file_open_write(scamper_file_t *sf)
 {
   if(sf->type != SCAMPER_FILE_NONE && handlers[sf->type].init_write != NULL)
@@ -701,8 +819,11 @@ static scamper_file_t *file_open(int fd, char *fn, char mode, int type)
 {
   scamper_file_t *sf;
   int (*open_func)(scamper_file_t *);
+  struct stat sb;
+  int codec;
 
   if(mode == 'r')      open_func = file_open_read;
+  else if(mode == 'm') open_func = file_open_mmap;
   else if(mode == 'w') open_func = file_open_write;
   else if(mode == 'a') open_func = file_open_append;
   else return NULL;
@@ -720,6 +841,26 @@ static scamper_file_t *file_open(int fd, char *fn, char mode, int type)
 
   sf->type = type;
   sf->fd   = fd;
+
+  /*
+   * a file whose name ends in .gz, .zst, or .xz is written compressed.
+   * the text writers write straight to the file descriptor, and
+   * appending to a warts file needs to read it, so only empty files
+   * can be appended to.
+   */
+  if((mode == 'w' || mode == 'a') && fd != -1 &&
+     (codec = scamper_file_z_suffix(fn)) != SCAMPER_FILE_Z_NONE)
+    {
+      if((mode == 'a' && (fstat(fd, &sb) != 0 || sb.st_size != 0)) ||
+	 type == SCAMPER_FILE_TEXT ||
+	 (sf->z = scamper_file_z_alloc(fd, codec, 'w')) == NULL)
+	{
+	  scamper_file_close(sf);
+	  return NULL;
+	}
+      scamper_file_setwritefunc(sf, sf->z, scamper_file_z_write);
+    }
+
   if(open_func(sf) == -1)
     {
       scamper_file_close(sf);
@@ -753,7 +894,8 @@ scamper_file_t *scamper_file_openfd(int fd, char *fn, char mode, char *type)
  *
  * open the file specified with the appropriate mode.
  * the modes that we know about are 'r' read-only, 'w' write-only on a
- * brand new file, and 'a' for appending.
+ * brand new file, 'a' for appending, and 'm' to read a warts file that
+ * is mapped into memory and indexed.
  *
  * in 'w' mode [and conditionally for 'a'] an optional parameter may be
  * supplied that says what type of file should be written.
@@ -786,6 +928,12 @@ scamper_file_t *scamper_file_open(char *filename, char mode, char *type)
       else
 	flags = O_RDONLY;
     }
+  else if(mode == 'm')
+    {
+      if(string_isdash(filename) != 0)
+	return NULL;
+      flags = O_RDONLY;
+    }
   else if(mode == 'w' || mode == 'a')
     {
       /* sanity check the type of file to be written */
@@ -815,7 +963,7 @@ scamper_file_t *scamper_file_open(char *filename, char mode, char *type)
 
   if(fd == -1)
     {
-      if(mode == 'r') fd = open(filename, flags);
+      if(mode == 'r' || mode == 'm') fd = open(filename, flags);
       else            fd = open(filename, flags, mo);
 
       if(fd == -1)
@@ -69,6 +69,26 @@ int scamper_file_read(scamper_file_t *sf, scamper_file_filter_t *filter,
 
 int scamper_file_write_obj(scamper_file_t *sf,uint16_t type,const void *data);
 
+/*
+ * an entry in the index of a warts file opened with mode 'm'.  dst is
+ * null for records that do not have a single destination.
+ */
+struct scamper_addr;
+typedef struct scamper_file_idx
+{
+  uint64_t             off;
+  uint16_t             type;
+  uint32_t             list_id;
+  uint32_t             cycle_id;
+  struct scamper_addr *dst;
+  struct timeval       start;
+} scamper_file_idx_t;
+
+uint32_t scamper_file_idx_count(const scamper_file_t *sf);
+const scamper_file_idx_t *scamper_file_idx_get(const scamper_file_t *sf,
+					       uint32_t i);
+int scamper_file_idx_seek(scamper_file_t *sf, uint32_t i);
+
 struct scamper_cycle;
 int scamper_file_write_cycle_start(scamper_file_t *sf,
 				   struct scamper_cycle *cycle);
@@ -127,6 +147,9 @@ void  scamper_file_setwritefunc(scamper_file_t *sf, void *param,
 scamper_file_writefunc_t scamper_file_getwritefunc(const scamper_file_t *sf);
 void *scamper_file_getwriteparam(const scamper_file_t *sf);
 
+/* set the level a file named *.gz, *.zst, or *.xz is compressed at */
+int   scamper_file_setzlevel(scamper_file_t *sf, int level);
+
 int   scamper_file_getfd(const scamper_file_t *sf);
 void *scamper_file_getstate(const scamper_file_t *sf);
 void  scamper_file_setstate(scamper_file_t *sf, void *state);
@@ -883,12 +883,44 @@ void warts_params_write(uint8_t *buf, uint32_t *off,
   return;
 }
 
+/*
+ * warts_readbuf_grow
+ *
+ * make sure the read buffer can hold a record of the given length.
+ */
+static int warts_readbuf_grow(warts_state_t *state, size_t len)
+{
+  size_t size;
+
+  if(state->readahead == WARTS_READAHEAD_ON)
+    size = WARTS_READBUF_LEN;
+  else
+    size = 4096;
+  while(size < len)
+    size *= 2;
+
+  if(size <= state->readbuf_len)
+    return 0;
+  if(realloc_wrap((void **)&state->readbuf, size) != 0)
+    return -1;
+  state->readbuf_len = size;
+  return 0;
+}
+
 /*
  * warts_read
  *
- * this function reads the requested number of bytes into a new piece of
- * memory returned in *buf.  as the underlying file descriptor may be
- * set O_NONBLOCK, most of this code is spent dealing with partial reads.
+ * this function returns a pointer to the requested number of bytes in
+ * *buf.  the bytes are held in a buffer kept in the file's state, or in
+ * the mapping of a file opened with mode 'm', and the pointer is only
+ * valid until the next call to warts_read.
+ *
+ * if the file descriptor blocks, as it does when reading a file, the
+ * buffer is filled so that most records are returned without a system
+ * call.  if the file descriptor is set O_NONBLOCK, it is probably being
+ * monitored by an event loop that calls scamper_file_read when there is
+ * data to read, so do not read past the end of the requested record.
+ * in that case, most of this code is spent dealing with partial reads.
  */
 int warts_read(scamper_file_t *sf, uint8_t **buf, size_t len)
 {
@@ -896,104 +928,109 @@ int warts_read(scamper_file_t *sf, uint8_t **buf, size_t len)
   warts_state_t *state = scamper_file_getstate(sf);
   int            fd    = scamper_file_getfd(sf);
   uint8_t       *tmp   = NULL;
+  size_t         want;
+  ssize_t        rc;
   int            ret;
-  size_t         rc;
 
   *buf = NULL;
   if(len == 0)
     return -1;
 
-  if(rf != NULL)
+  /* a memory-mapped file is read in place */
+  if(state->map != NULL)
     {
-      if((ret = rf(scamper_file_getreadparam(sf), buf, len)) == 0 || ret == -2)
+      if((size_t)state->off == state->map_len)
 	{
-	  if(ret == -2)
-	    scamper_file_seteof(sf);
+	  scamper_file_seteof(sf);
 	  return 0;
 	}
-      return -1;
+      if(state->map_len - state->off < len)
+	return -1;
+      *buf = state->map + state->off;
+      state->off += len;
+      return 0;
     }
 
-  /* if there is data left over from a prior read, then append to it. */
-  if(state->readbuf != NULL)
+  if(state->readahead == 0)
     {
-      assert(state->readbuf_len == len);
+      state->readahead = WARTS_READAHEAD_ON;
+#ifndef _WIN32
+      if(rf == NULL && (ret = fcntl(fd, F_GETFL)) != -1 &&
+	 (ret & O_NONBLOCK) != 0)
+	state->readahead = WARTS_READAHEAD_OFF;
+#endif
+    }
 
-      /* read */
-      if((ret = read_wrap(fd, state->readbuf + state->readlen, &rc,
-			  len - state->readlen)) != 0)
-	{
-	  /* rc will be zero if nothing was read, so safe to use */
-	  state->readlen += rc;
+  if(warts_readbuf_grow(state, len) != 0)
+    return -1;
 
-	  /*
-	   * we got an error (or EOF) without successfully reading whatever
-	   * was left over.
-	   */
-	  if((ret == -1 && errno != EAGAIN) || ret == -2)
+  if(rf != NULL)
+    {
+      ret = rf(scamper_file_getreadparam(sf), &tmp, len);
+      if(ret == 0 || ret == -2)
+	{
+	  if(ret == -2)
+	    scamper_file_seteof(sf);
+	  if(tmp != NULL)
 	    {
-	      if(ret == -2)
-		scamper_file_seteof(sf);
-	      return -1;
+	      memcpy(state->readbuf, tmp, len);
+	      free(tmp);
+	      *buf = state->readbuf;
 	    }
-
-	  /*
-	   * read has not completed yet, but we haven't got a failure
-	   * condition either.
-	   */
 	  return 0;
 	}
-
-      *buf = state->readbuf;
-      state->readlen = 0;
-      state->readbuf = NULL;
-      state->readbuf_len = 0;
-      state->off += len;
-      return 0;
+      return -1;
     }
 
-  /* no data left over, reading from scratch */
-  if((tmp = malloc_zero(len)) == NULL)
-    return -1;
-
-  /* try and read.  if we read the whole amount, everything is good */
-  if((ret = read_wrap(fd, tmp, &rc, len)) == 0)
+  /* if the record is not already in the buffer, then read it */
+  if(state->readlen - state->readbuf_off < len)
     {
-      *buf = tmp;
-      state->off += len;
-      return 0;
-    }
+      /* move whatever has not been returned to the front of the buffer */
+      if(state->readbuf_off > 0)
+	{
+	  state->readlen -= state->readbuf_off;
+	  memmove(state->readbuf, state->readbuf + state->readbuf_off,
+		  state->readlen);
+	  state->readbuf_off = 0;
+	}
 
-  /* if a partial read occured, then record the partial read in state */
-  if(rc != 0)
-    {
-      state->readlen = rc;
-      state->readbuf = tmp;
-      state->readbuf_len = len;
-    }
-  else
-    {
-      free(tmp);
-    }
+      if(state->readahead == WARTS_READAHEAD_ON)
+	want = state->readbuf_len;
+      else
+	want = len;
 
-  /* if we got eof and we had a partial read, then we've got a problem */
-  if(ret == -2)
-    {
-      /* got eof */
-      scamper_file_seteof(sf);
+      while(state->readlen < len)
+	{
+	  if((rc = read(fd, state->readbuf + state->readlen,
+			want - state->readlen)) > 0)
+	    {
+	      state->readlen += rc;
+	      continue;
+	    }
 
-      /* partial read, so error condition */
-      if(rc != 0)
-	return -1;
+	  /* if we got eof and we had a partial read, then there's a problem */
+	  if(rc == 0)
+	    {
+	      scamper_file_seteof(sf);
+	      if(state->readlen != 0)
+		return -1;
+	      return 0;
+	    }
 
-      return 0;
-    }
+	  if(errno == EINTR)
+	    continue;
 
-  /* if the read would block, then there's no problem */
-  if(ret == -1 && errno == EAGAIN)
-    return 0;
+	  /* if the read would block, then there's no problem */
+	  if(errno == EAGAIN)
+	    return 0;
+	  return -1;
+	}
+    }
 
-  return -1;
+  *buf = state->readbuf + state->readbuf_off;
+  state->readbuf_off += len;
+  state->off += len;
+  return 0;
 }
 
 /*
@@ -1065,7 +1102,6 @@ int warts_hdr_read(scamper_file_t *sf, warts_hdr_t *hdr)
   extract_uint16(buf, &off, len, &hdr->magic, NULL);
   extract_uint16(buf, &off, len, &hdr->type, NULL);
   extract_uint32(buf, &off, len, &hdr->len, NULL);
-  free(buf);
 
   assert(off == len);
   return 1;
@@ -1135,7 +1171,6 @@ int warts_addr_read(scamper_file_t *sf, const warts_hdr_t *hdr,
     goto err;
 
   state->addr_table[state->addr_count++] = addr;
-  free(buf);
 
   if(addr_out != NULL)
     *addr_out = addr;
@@ -1144,7 +1179,6 @@ int warts_addr_read(scamper_file_t *sf, const warts_hdr_t *hdr,
 
  err:
   if(addr != NULL) scamper_addr_free(addr);
-  if(buf != NULL) free(buf);
   return -1;
 }
 
@@ -1332,7 +1366,6 @@ int warts_list_read(scamper_file_t *sf, const warts_hdr_t *hdr,
 
   state->list_table[state->list_count++] = wl;
   scamper_list_free(list);
-  free(buf);
 
   if(list_out != NULL)
     {
@@ -1343,7 +1376,6 @@ int warts_list_read(scamper_file_t *sf, const warts_hdr_t *hdr,
  err:
   if(list != NULL) scamper_list_free(list);
   if(wl != NULL)   warts_list_free(wl);
-  if(buf != NULL)  free(buf);
   return -1;
 }
 
@@ -1638,7 +1670,6 @@ int warts_cycle_read(scamper_file_t *sf, const warts_hdr_t *hdr,
 
   state->cycle_table[state->cycle_count++] = wc;
   scamper_cycle_free(cycle);
-  free(buf);
 
   if(cycle_out != NULL)
     {
@@ -1653,7 +1684,6 @@ int warts_cycle_read(scamper_file_t *sf, const warts_hdr_t *hdr,
       if(cycle->list != NULL) scamper_list_free(cycle->list);
       free(cycle);
     }
-  if(buf != NULL) free(buf);
   return -1;
 }
 
@@ -1809,12 +1839,9 @@ int warts_cycle_stop_read(scamper_file_t *sf, const warts_hdr_t *hdr,
   warts_cycle_free(state->cycle_table[id]);
   state->cycle_table[id] = NULL;
 
-  free(buf);
-
   return 0;
 
  err:
-  if(buf != NULL) free(buf);
   return -1;
 }
 
@@ -2067,6 +2094,14 @@ int scamper_file_warts_read(scamper_file_t *sf, scamper_file_filter_t *filter,
 	 hdr.type == SCAMPER_FILE_OBJ_CYCLE_START ||
 	 hdr.type == SCAMPER_FILE_OBJ_CYCLE_STOP)
 	{
+	  /* these were loaded when the file was first positioned */
+	  if(state->idx_defs != 0)
+	    {
+	      if(warts_read(sf, &buf, hdr.len) != 0 || buf == NULL)
+		goto err;
+	      continue;
+	    }
+
 	  if(objread[hdr.type](sf, &hdr, &ptr) != 0)
 	    goto err;
 
@@ -2115,7 +2150,6 @@ int scamper_file_warts_read(scamper_file_t *sf, scamper_file_filter_t *filter,
 	      state->hdr = hdr;
 	      return 0;
 	    }
-	  free(buf);
 	  memset(&state->hdr, 0, sizeof(state->hdr));
 	}
       else
@@ -2211,6 +2245,137 @@ int scamper_file_warts_init_read(scamper_file_t *sf)
   return -1;
 }
 
+/*
+ * warts_state_reset
+ *
+ * forget the lists, cycles, and addresses read from the file so far, so
+ * that the file can be read again from another position.
+ */
+static void warts_state_reset(warts_state_t *state)
+{
+  uint32_t i;
+
+  for(i=1; i<state->list_count; i++)
+    if(state->list_table[i] != NULL)
+      warts_list_free(state->list_table[i]);
+  state->list_count = 1;
+
+  for(i=1; i<state->cycle_count; i++)
+    if(state->cycle_table[i] != NULL)
+      warts_cycle_free(state->cycle_table[i]);
+  state->cycle_count = 1;
+
+  for(i=1; i<state->addr_count; i++)
+    if(state->addr_table[i] != NULL)
+      scamper_addr_free(state->addr_table[i]);
+  state->addr_count = 1;
+
+  memset(&state->hdr, 0, sizeof(state->hdr));
+  state->idx_defs = 0;
+  state->off = 0;
+  return;
+}
+
+/*
+ * warts_idx_defs
+ *
+ * load every list, cycle, and address record in the file, in the order
+ * they appear, so that any other record can then be read on its own.
+ */
+static int warts_idx_defs(scamper_file_t *sf, warts_state_t *state)
+{
+  scamper_file_idx_t *idx;
+  warts_hdr_t hdr;
+  uint32_t i;
+  int rc;
+
+  warts_state_reset(state);
+
+  for(i=0; i<state->idxc; i++)
+    {
+      idx = &state->idx[i];
+      if(idx->type != SCAMPER_FILE_OBJ_ADDR &&
+	 idx->type != SCAMPER_FILE_OBJ_LIST &&
+	 idx->type != SCAMPER_FILE_OBJ_CYCLE_DEF &&
+	 idx->type != SCAMPER_FILE_OBJ_CYCLE_START)
+	continue;
+
+      state->off = idx->off;
+      if(warts_hdr_read(sf, &hdr) != 1 || hdr.type != idx->type)
+	return -1;
+
+      if(hdr.type == SCAMPER_FILE_OBJ_ADDR)
+	rc = warts_addr_read(sf, &hdr, NULL);
+      else if(hdr.type == SCAMPER_FILE_OBJ_LIST)
+	rc = warts_list_read(sf, &hdr, NULL);
+      else
+	rc = warts_cycle_read(sf, &hdr, NULL);
+      if(rc != 0)
+	return -1;
+    }
+
+  state->idx_defs = 1;
+  return 0;
+}
+
+/*
+ * scamper_file_warts_idx_seek
+ *
+ * position the file so that the next record read is the i'th record
+ * in the index.
+ */
+int scamper_file_warts_idx_seek(scamper_file_t *sf, uint32_t i)
+{
+  warts_state_t *state = scamper_file_getstate(sf);
+
+  if(state == NULL || state->map == NULL || i >= state->idxc)
+    return -1;
+  if(state->idx_defs == 0 && warts_idx_defs(sf, state) != 0)
+    return -1;
+
+  state->off = state->idx[i].off;
+  memset(&state->hdr, 0, sizeof(state->hdr));
+  return 0;
+}
+
+/*
+ * scamper_file_warts_init_mmap
+ *
+ * map a warts file into memory for reading, and load or build the
+ * index of the records it contains.
+ */
+int scamper_file_warts_init_mmap(scamper_file_t *sf)
+{
+#ifdef HAVE_SYS_MMAN_H
+  warts_state_t *state;
+  int fd = scamper_file_getfd(sf);
+  struct stat sb;
+  void *map;
+
+  if(fstat(fd, &sb) != 0 || S_ISREG(sb.st_mode) == 0 || sb.st_size == 0)
+    return -1;
+
+  if(scamper_file_warts_init_read(sf) != 0)
+    return -1;
+  state = scamper_file_getstate(sf);
+
+  map = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if(map == MAP_FAILED)
+    return -1;
+  state->map = map;
+  state->map_len = sb.st_size;
+
+  if(scamper_file_warts_idx_init(sf) != 0)
+    return -1;
+
+  /* the file is read from the start, as if it had just been opened */
+  warts_state_reset(state);
+  return 0;
+#else
+  return -1;
+#endif
+}
+
 /*
  * scamper_file_warts_init_write
  *
@@ -2264,7 +2429,8 @@ int scamper_file_warts_init_append(scamper_file_t *sf)
 {
   warts_state_t   *s;
   warts_hdr_t      hdr;
-  int              i, fd;
+  uint8_t         *buf;
+  int              i;
   uint32_t         j;
   scamper_addr_t  *addr;
   scamper_list_t  *list;
@@ -2276,8 +2442,6 @@ int scamper_file_warts_init_append(scamper_file_t *sf)
       return -1;
     }
 
-  fd = scamper_file_getfd(sf);
-
   for(;;)
     {
       /* read the header for the next record from the file */
@@ -2322,7 +2486,12 @@ int scamper_file_warts_init_append(scamper_file_t *sf)
 	  break;
 
 	default:
-	  if(lseek(fd, hdr.len, SEEK_CUR) == -1)
+	  /*
+	   * skip the record through warts_read: with read-ahead, the
+	   * file offset is past the end of this record
+	   */
+	  if(hdr.len > 0 &&
+	     (warts_read(sf, &buf, hdr.len) != 0 || buf == NULL))
 	    {
 	      return -1;
 	    }
@@ -2426,6 +2595,12 @@ void scamper_file_warts_free_state(scamper_file_t *sf)
       free(state->readbuf);
     }
 
+#ifdef HAVE_SYS_MMAN_H
+  if(state->map != NULL)
+    munmap(state->map, state->map_len);
+#endif
+  scamper_file_warts_idx_free(state);
+
   warts_free_state(state->list_tree,
 		   (void **)state->list_table, state->list_count,
 		   (splaytree_free_t)warts_list_free);
@@ -51,6 +51,11 @@ typedef struct warts_var
   ssize_t size;
   int     tlv_id;
 } warts_var_t;
+
+#define WARTS_READBUF_LEN   262144
+#define WARTS_READAHEAD_ON  1
+#define WARTS_READAHEAD_OFF 2
+
 #define WARTS_VAR_COUNT(array) (sizeof(array)/sizeof(warts_var_t))
 #define WARTS_VAR_MFB(array) ((WARTS_VAR_COUNT(array) / 7) + \
 			      (WARTS_VAR_COUNT(array) % 7 == 0 ? 0 : 1))
@@ -118,10 +123,29 @@ typedef struct warts_state
   int               isreg;
   off_t             off;
 
-  /* temporary buffer for leftover partial reads */
+  /*
+   * buffer of bytes read from the file.  readbuf_off is the offset of
+   * the first byte not yet returned by warts_read, and readlen is the
+   * number of bytes in the buffer.  readahead is zero until the first
+   * read, when it is set to WARTS_READAHEAD_ON or WARTS_READAHEAD_OFF.
+   */
   uint8_t          *readbuf;
-  size_t            readlen;
   size_t            readbuf_len;
+  size_t            readbuf_off;
+  size_t            readlen;
+  uint8_t           readahead;
+
+  /*
+   * a file opened with mode 'm' is mapped into memory, and has an index
+   * of the records it contains.  idx_defs is set once the list, cycle,
+   * and address records have been loaded so that records can be read
+   * in any order.
+   */
+  uint8_t          *map;
+  size_t            map_len;
+  scamper_file_idx_t *idx;
+  uint32_t          idxc;
+  uint8_t           idx_defs;
 
   /*
    * if a partial read was done on the last loop through but whatever
@@ -313,6 +337,11 @@ int scamper_file_warts_is(const scamper_file_t *file);
 int scamper_file_warts_init_append(scamper_file_t *file);
 int scamper_file_warts_init_read(scamper_file_t *file);
 int scamper_file_warts_init_write(scamper_file_t *file);
+int scamper_file_warts_init_mmap(scamper_file_t *file);
+
+int scamper_file_warts_idx_seek(scamper_file_t *file, uint32_t i);
+int scamper_file_warts_idx_init(scamper_file_t *file);
+void scamper_file_warts_idx_free(warts_state_t *state);
 
 void scamper_file_warts_free_state(scamper_file_t *file);
 
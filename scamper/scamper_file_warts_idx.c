@@ -0,0 +1,496 @@
+/*
+ * scamper_file_warts_idx.c
+ *
+ * $Id$
+ *
+ * an index of the records in a warts file, so that the records for a
+ * few destinations can be found without decoding the whole file.  the
+ * index is kept alongside the file, in a file with .idx appended to
+ * the name, and is rebuilt if the warts file changes.
+ *
+ * Copyright (C) 2026 Matthew Luckie
+ * Author: Matthew Luckie
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include "internal.h"
+
+#include "scamper_addr.h"
+#include "scamper_list.h"
+#include "scamper_file.h"
+#include "scamper_file_warts.h"
+#include "trace/scamper_trace.h"
+#include "ping/scamper_ping.h"
+#include "tracelb/scamper_tracelb.h"
+#include "dealias/scamper_dealias.h"
+#include "neighbourdisc/scamper_neighbourdisc.h"
+#include "tbit/scamper_tbit.h"
+#include "sting/scamper_sting.h"
+#include "sniff/scamper_sniff.h"
+#include "host/scamper_host.h"
+
+#include "utils.h"
+
+/*
+ * the index file begins with a header:
+ *  - 4 byte magic, 4 byte version
+ *  - 8 byte size and 8 byte mtime of the warts file when indexed
+ *  - 4 byte count of records, 4 bytes unused
+ *
+ * and is followed by one entry for each record:
+ *  - 8 byte offset of the record's warts header
+ *  - 2 byte record type, 1 byte dst address type, 1 byte unused
+ *  - 4 byte list id, 4 byte cycle id
+ *  - 4 byte start time seconds, 4 byte microseconds
+ *  - 16 bytes of dst address
+ *
+ * all values are in network byte order.
+ */
+#define WARTS_IDX_MAGIC   0x57494458
+#define WARTS_IDX_VERSION 1
+#define WARTS_IDX_HDRLEN  32
+#define WARTS_IDX_RECLEN  44
+
+static void idx_htonq(uint8_t *buf, uint64_t u64)
+{
+  bytes_htonl(buf, (uint32_t)(u64 >> 32));
+  bytes_htonl(buf+4, (uint32_t)(u64 & 0xffffffff));
+  return;
+}
+
+static uint64_t idx_ntohq(const uint8_t *buf)
+{
+  return (((uint64_t)bytes_ntohl(buf)) << 32) | bytes_ntohl(buf+4);
+}
+
+static char *idx_filename(const scamper_file_t *sf)
+{
+  char *fn, *ifn;
+  size_t len;
+
+  if((fn = scamper_file_getfilename((scamper_file_t *)sf)) == NULL)
+    return NULL;
+  len = strlen(fn) + 5;
+  if((ifn = malloc(len)) == NULL)
+    return NULL;
+  snprintf(ifn, len, "%s.idx", fn);
+  return ifn;
+}
+
+static int idx_grow(warts_state_t *state, uint32_t *size)
+{
+  size_t len;
+
+  if(state->idxc < *size)
+    return 0;
+  *size = (*size == 0) ? 1024 : *size * 2;
+  len = sizeof(scamper_file_idx_t) * *size;
+  return realloc_wrap((void **)&state->idx, len);
+}
+
+/*
+ * idx_obj
+ *
+ * record the list, cycle, destination, and start time of an object in
+ * its index entry, and then free the object.
+ */
+static void idx_obj(scamper_file_idx_t *idx, void *data)
+{
+  scamper_list_t *list = NULL;
+  scamper_cycle_t *cycle = NULL;
+  scamper_addr_t *dst = NULL;
+  struct timeval *start = NULL;
+
+  switch(idx->type)
+    {
+    case SCAMPER_FILE_OBJ_LIST:
+      idx->list_id = ((scamper_list_t *)data)->id;
+      scamper_list_free(data);
+      return;
+
+    case SCAMPER_FILE_OBJ_CYCLE_START:
+    case SCAMPER_FILE_OBJ_CYCLE_DEF:
+    case SCAMPER_FILE_OBJ_CYCLE_STOP:
+      cycle = data;
+      idx->list_id = cycle->list != NULL ? cycle->list->id : 0;
+      idx->cycle_id = cycle->id;
+      if(idx->type == SCAMPER_FILE_OBJ_CYCLE_STOP)
+	idx->start.tv_sec = cycle->stop_time;
+      else
+	idx->start.tv_sec = cycle->start_time;
+      scamper_cycle_free(cycle);
+      return;
+
+    case SCAMPER_FILE_OBJ_ADDR:
+      scamper_addr_free(data);
+      return;
+
+    case SCAMPER_FILE_OBJ_TRACE:
+      list = ((scamper_trace_t *)data)->list;
+      cycle = ((scamper_trace_t *)data)->cycle;
+      dst = ((scamper_trace_t *)data)->dst;
+      start = &((scamper_trace_t *)data)->start;
+      break;
+
+    case SCAMPER_FILE_OBJ_PING:
+      list = ((scamper_ping_t *)data)->list;
+      cycle = ((scamper_ping_t *)data)->cycle;
+      dst = ((scamper_ping_t *)data)->dst;
+      start = &((scamper_ping_t *)data)->start;
+      break;
+
+    case SCAMPER_FILE_OBJ_TRACELB:
+      list = ((scamper_tracelb_t *)data)->list;
+      cycle = ((scamper_tracelb_t *)data)->cycle;
+      dst = ((scamper_tracelb_t *)data)->dst;
+      start = &((scamper_tracelb_t *)data)->start;
+      break;
+
+    case SCAMPER_FILE_OBJ_DEALIAS:
+      list = ((scamper_dealias_t *)data)->list;
+      cycle = ((scamper_dealias_t *)data)->cycle;
+      start = &((scamper_dealias_t *)data)->start;
+      break;
+
+    case SCAMPER_FILE_OBJ_NEIGHBOURDISC:
+      list = ((scamper_neighbourdisc_t *)data)->list;
+      cycle = ((scamper_neighbourdisc_t *)data)->cycle;
+      dst = ((scamper_neighbourdisc_t *)data)->dst_ip;
+      start = &((scamper_neighbourdisc_t *)data)->start;
+      break;
+
+    case SCAMPER_FILE_OBJ_TBIT:
+      list = ((scamper_tbit_t *)data)->list;
+      cycle = ((scamper_tbit_t *)data)->cycle;
+      dst = ((scamper_tbit_t *)data)->dst;
+      start = &((scamper_tbit_t *)data)->start;
+      break;
+
+    case SCAMPER_FILE_OBJ_STING:
+      list = ((scamper_sting_t *)data)->list;
+      cycle = ((scamper_sting_t *)data)->cycle;
+      dst = ((scamper_sting_t *)data)->dst;
+      start = &((scamper_sting_t *)data)->start;
+      break;
+
+    case SCAMPER_FILE_OBJ_SNIFF:
+      list = ((scamper_sniff_t *)data)->list;
+      cycle = ((scamper_sniff_t *)data)->cycle;
+      start = &((scamper_sniff_t *)data)->start;
+      break;
+
+    case SCAMPER_FILE_OBJ_HOST:
+      list = ((scamper_host_t *)data)->list;
+      cycle = ((scamper_host_t *)data)->cycle;
+      dst = ((scamper_host_t *)data)->dst;
+      start = &((scamper_host_t *)data)->start;
+      break;
+    }
+
+  if(list != NULL)
+    idx->list_id = list->id;
+  if(cycle != NULL)
+    idx->cycle_id = cycle->id;
+  if(start != NULL)
+    timeval_cpy(&idx->start, start);
+  if(dst != NULL && (SCAMPER_ADDR_TYPE_IS_IPV4(dst) ||
+		     SCAMPER_ADDR_TYPE_IS_IPV6(dst)))
+    idx->dst = scamper_addr_use(dst);
+
+  switch(idx->type)
+    {
+    case SCAMPER_FILE_OBJ_TRACE:
+      scamper_trace_free(data);
+      break;
+    case SCAMPER_FILE_OBJ_PING:
+      scamper_ping_free(data);
+      break;
+    case SCAMPER_FILE_OBJ_TRACELB:
+      scamper_tracelb_free(data);
+      break;
+    case SCAMPER_FILE_OBJ_DEALIAS:
+      scamper_dealias_free(data);
+      break;
+    case SCAMPER_FILE_OBJ_NEIGHBOURDISC:
+      scamper_neighbourdisc_free(data);
+      break;
+    case SCAMPER_FILE_OBJ_TBIT:
+      scamper_tbit_free(data);
+      break;
+    case SCAMPER_FILE_OBJ_STING:
+      scamper_sting_free(data);
+      break;
+    case SCAMPER_FILE_OBJ_SNIFF:
+      scamper_sniff_free(data);
+      break;
+    case SCAMPER_FILE_OBJ_HOST:
+      scamper_host_free(data);
+      break;
+    }
+
+  return;
+}
+
+/*
+ * idx_build
+ *
+ * read every record in the file, noting where each one starts.
+ */
+static int idx_build(scamper_file_t *sf, warts_state_t *state)
+{
+  uint16_t types[] = {
+    SCAMPER_FILE_OBJ_LIST,
+    SCAMPER_FILE_OBJ_CYCLE_START,
+    SCAMPER_FILE_OBJ_CYCLE_DEF,
+    SCAMPER_FILE_OBJ_CYCLE_STOP,
+    SCAMPER_FILE_OBJ_ADDR,
+    SCAMPER_FILE_OBJ_TRACE,
+    SCAMPER_FILE_OBJ_PING,
+    SCAMPER_FILE_OBJ_TRACELB,
+    SCAMPER_FILE_OBJ_DEALIAS,
+    SCAMPER_FILE_OBJ_NEIGHBOURDISC,
+    SCAMPER_FILE_OBJ_TBIT,
+    SCAMPER_FILE_OBJ_STING,
+    SCAMPER_FILE_OBJ_SNIFF,
+    SCAMPER_FILE_OBJ_HOST,
+  };
+  uint16_t typec = sizeof(types) / sizeof(uint16_t);
+  scamper_file_filter_t *filter;
+  scamper_file_idx_t *idx;
+  uint32_t size = 0;
+  uint16_t type;
+  void *data;
+  off_t off;
+  int rc = -1;
+
+  if((filter = scamper_file_filter_alloc(types, typec)) == NULL)
+    return -1;
+
+  for(;;)
+    {
+      if(idx_grow(state, &size) != 0)
+	goto done;
+
+      off = state->off;
+      if(scamper_file_warts_read(sf, filter, &type, &data) != 0)
+	goto done;
+      if(data == NULL)
+	break;
+
+      idx = &state->idx[state->idxc++];
+      memset(idx, 0, sizeof(scamper_file_idx_t));
+      idx->off = off;
+      idx->type = type;
+      idx_obj(idx, data);
+    }
+  rc = 0;
+
+ done:
+  scamper_file_filter_free(filter);
+  return rc;
+}
+
+/*
+ * idx_load
+ *
+ * read the index from disk, provided it was built for the warts file
+ * as it is now.
+ */
+static int idx_load(const char *ifn, const struct stat *sb,
+		    warts_state_t *state)
+{
+  scamper_file_idx_t *idx;
+  uint8_t hdr[WARTS_IDX_HDRLEN], *buf = NULL, *ptr;
+  struct stat isb;
+  uint32_t i, count;
+  size_t len;
+  int fd, rc = -1;
+
+  if((fd = open(ifn, O_RDONLY)) == -1)
+    return -1;
+
+  if(fstat(fd, &isb) != 0 || isb.st_size < WARTS_IDX_HDRLEN ||
+     read_wrap(fd, hdr, NULL, WARTS_IDX_HDRLEN) != 0)
+    goto done;
+
+  if(bytes_ntohl(hdr) != WARTS_IDX_MAGIC ||
+     bytes_ntohl(hdr+4) != WARTS_IDX_VERSION ||
+     idx_ntohq(hdr+8) != (uint64_t)sb->st_size ||
+     idx_ntohq(hdr+16) != (uint64_t)sb->st_mtime)
+    goto done;
+
+  count = bytes_ntohl(hdr+24);
+  len = (size_t)count * WARTS_IDX_RECLEN;
+  if((uint64_t)isb.st_size != WARTS_IDX_HDRLEN + (uint64_t)len)
+    goto done;
+
+  if(count == 0)
+    {
+      rc = 0;
+      goto done;
+    }
+
+  if((buf = malloc(len)) == NULL ||
+     (state->idx = malloc_zero(sizeof(scamper_file_idx_t) * count)) == NULL ||
+     read_wrap(fd, buf, NULL, len) != 0)
+    goto done;
+
+  for(i=0; i<count; i++)
+    {
+      ptr = buf + (i * WARTS_IDX_RECLEN);
+      idx = &state->idx[state->idxc];
+      idx->off          = idx_ntohq(ptr);
+      idx->type         = bytes_ntohs(ptr+8);
+      idx->list_id      = bytes_ntohl(ptr+12);
+      idx->cycle_id     = bytes_ntohl(ptr+16);
+      idx->start.tv_sec = bytes_ntohl(ptr+20);
+      idx->start.tv_usec = bytes_ntohl(ptr+24);
+      if(idx->off >= (uint64_t)sb->st_size)
+	goto done;
+      if(ptr[10] == SCAMPER_ADDR_TYPE_IPV4 ||
+	 ptr[10] == SCAMPER_ADDR_TYPE_IPV6)
+	{
+	  if((idx->dst = scamper_addr_alloc(ptr[10], ptr+28)) == NULL)
+	    goto done;
+	}
+      else if(ptr[10] != 0)
+	goto done;
+      state->idxc++;
+    }
+  rc = 0;
+
+ done:
+  if(rc != 0)
+    scamper_file_warts_idx_free(state);
+  if(buf != NULL) free(buf);
+  close(fd);
+  return rc;
+}
+
+/*
+ * idx_write
+ *
+ * write the index to disk.  the index is only an optimisation, so if
+ * it cannot be written then the file is still usable.
+ */
+static void idx_write(const char *ifn, const struct stat *sb,
+		      const warts_state_t *state)
+{
+  const scamper_file_idx_t *idx;
+  uint8_t *buf = NULL, *ptr;
+  uint32_t i;
+  size_t len;
+  mode_t mo;
+  int fd = -1;
+
+#ifndef _WIN32
+  mo = S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH;
+#else
+  mo = _S_IREAD | _S_IWRITE;
+#endif
+
+  len = WARTS_IDX_HDRLEN + ((size_t)state->idxc * WARTS_IDX_RECLEN);
+  if((buf = malloc_zero(len)) == NULL)
+    goto done;
+
+  bytes_htonl(buf, WARTS_IDX_MAGIC);
+  bytes_htonl(buf+4, WARTS_IDX_VERSION);
+  idx_htonq(buf+8, sb->st_size);
+  idx_htonq(buf+16, sb->st_mtime);
+  bytes_htonl(buf+24, state->idxc);
+
+  for(i=0; i<state->idxc; i++)
+    {
+      idx = &state->idx[i];
+      ptr = buf + WARTS_IDX_HDRLEN + (i * WARTS_IDX_RECLEN);
+      idx_htonq(ptr, idx->off);
+      bytes_htons(ptr+8, idx->type);
+      bytes_htonl(ptr+12, idx->list_id);
+      bytes_htonl(ptr+16, idx->cycle_id);
+      bytes_htonl(ptr+20, idx->start.tv_sec);
+      bytes_htonl(ptr+24, idx->start.tv_usec);
+      if(idx->dst != NULL)
+	{
+	  ptr[10] = idx->dst->type;
+	  memcpy(ptr+28, idx->dst->addr, scamper_addr_size(idx->dst));
+	}
+    }
+
+  if((fd = open(ifn, O_WRONLY | O_TRUNC | O_CREAT, mo)) == -1)
+    goto done;
+  if(write_wrap(fd, buf, NULL, len) != 0)
+    {
+      close(fd); fd = -1;
+      unlink(ifn);
+    }
+
+ done:
+  if(fd != -1) close(fd);
+  if(buf != NULL) free(buf);
+  return;
+}
+
+/*
+ * scamper_file_warts_idx_init
+ *
+ * load the index for the file, or build it if there is no index or the
+ * index is out of date.
+ */
+int scamper_file_warts_idx_init(scamper_file_t *sf)
+{
+  warts_state_t *state = scamper_file_getstate(sf);
+  struct stat sb;
+  char *ifn;
+  int rc = -1;
+
+  if(fstat(scamper_file_getfd(sf), &sb) != 0)
+    return -1;
+
+  ifn = idx_filename(sf);
+  if(ifn != NULL && idx_load(ifn, &sb, state) == 0)
+    {
+      rc = 0;
+      goto done;
+    }
+
+  if(idx_build(sf, state) != 0)
+    goto done;
+  if(ifn != NULL)
+    idx_write(ifn, &sb, state);
+  rc = 0;
+
+ done:
+  if(ifn != NULL) free(ifn);
+  return rc;
+}
+
+void scamper_file_warts_idx_free(warts_state_t *state)
+{
+  uint32_t i;
+
+  if(state->idx == NULL)
+    return;
+  for(i=0; i<state->idxc; i++)
+    if(state->idx[i].dst != NULL)
+      scamper_addr_free(state->idx[i].dst);
+  free(state->idx);
+  state->idx = NULL;
+  state->idxc = 0;
+  return;
+}
@@ -0,0 +1,614 @@
+/*
+ * scamper_file_z.c
+ *
+ * $Id$
+ *
+ * read and write gzip, zstd, and xz compressed files, by sitting behind
+ * the readfunc and writefunc hooks of a scamper_file_t.
+ *
+ * Copyright (C) 2026 Matthew Luckie
+ * Author: Matthew Luckie
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include "internal.h"
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef HAVE_LZMA
+#include <lzma.h>
+#endif
+
+#include "scamper_file_z.h"
+#include "utils.h"
+
+#if defined(HAVE_ZLIB) || defined(HAVE_ZSTD) || defined(HAVE_LZMA)
+#define HAVE_Z
+#endif
+
+int scamper_file_z_suffix(const char *filename)
+{
+  static const struct {
+    const char *suffix;
+    int         codec;
+  } suffixes[] = {
+    {".gz",  SCAMPER_FILE_Z_GZIP},
+    {".zst", SCAMPER_FILE_Z_ZSTD},
+    {".xz",  SCAMPER_FILE_Z_XZ},
+  };
+  size_t i, len, sl;
+
+  if(filename == NULL)
+    return SCAMPER_FILE_Z_NONE;
+
+  len = strlen(filename);
+  for(i=0; i<sizeof(suffixes)/sizeof(suffixes[0]); i++)
+    {
+      sl = strlen(suffixes[i].suffix);
+      if(len > sl && strcasecmp(filename+len-sl, suffixes[i].suffix) == 0)
+	return suffixes[i].codec;
+    }
+
+  return SCAMPER_FILE_Z_NONE;
+}
+
+int scamper_file_z_magic(const uint8_t *buf, size_t len)
+{
+  static const uint8_t gz[] = {0x1f, 0x8b};
+  static const uint8_t zst[] = {0x28, 0xb5, 0x2f, 0xfd};
+  static const uint8_t xz[] = {0xfd, 0x37, 0x7a, 0x58, 0x5a, 0x00};
+
+  if(len >= sizeof(gz) && memcmp(buf, gz, sizeof(gz)) == 0)
+    return SCAMPER_FILE_Z_GZIP;
+  if(len >= sizeof(zst) && memcmp(buf, zst, sizeof(zst)) == 0)
+    return SCAMPER_FILE_Z_ZSTD;
+  if(len >= sizeof(xz) && memcmp(buf, xz, sizeof(xz)) == 0)
+    return SCAMPER_FILE_Z_XZ;
+  return SCAMPER_FILE_Z_NONE;
+}
+
+#ifdef HAVE_Z
+
+/* size of the buffers on either side of the codec */
+#define Z_BUFLEN   65536
+
+/*
+ * when writing, flush the compressor at the end of the first record
+ * after this many bytes have gone in, so that a reader of a file that
+ * is still being written (or was cut short) can get at all but the most
+ * recent records without costing much in compression.
+ */
+#define Z_FLUSHLEN 65536
+
+#define Z_RUN   0
+#define Z_FLUSH 1
+#define Z_END   2
+
+struct scamper_file_z
+{
+  int               fd;
+  int               codec;
+  char              mode;
+  int               level;
+  uint8_t           init;
+  uint8_t           eof;
+
+  /* compressed bytes read from the file, but not yet decompressed */
+  uint8_t          *in;
+  size_t            in_off;
+  size_t            in_len;
+
+  /*
+   * when reading, decompressed bytes not yet returned.  when writing,
+   * compressed bytes not yet written.
+   */
+  uint8_t          *out;
+  size_t            out_off;
+  size_t            out_len;
+  size_t            out_size;
+
+  /* bytes passed to the compressor since the last flush */
+  size_t            unflushed;
+
+#ifdef HAVE_ZLIB
+  z_stream          gz;
+#endif
+#ifdef HAVE_ZSTD
+  ZSTD_CCtx        *zc;
+  ZSTD_DCtx        *zd;
+#endif
+#ifdef HAVE_LZMA
+  lzma_stream       xz;
+#endif
+};
+
+/*
+ * z_decode
+ *
+ * decompress as much of the input buffer as fits in the output buffer.
+ * returns the number of bytes produced, or -1 on error.
+ */
+static ssize_t z_decode(scamper_file_z_t *z)
+{
+  uint8_t *in = z->in + z->in_off, *out = z->out + z->out_len;
+  size_t in_len = z->in_len - z->in_off, out_len = z->out_size - z->out_len;
+  size_t in_used = 0, out_used = 0;
+
+#ifdef HAVE_ZLIB
+  if(z->codec == SCAMPER_FILE_Z_GZIP)
+    {
+      int rc;
+      z->gz.next_in = in; z->gz.avail_in = in_len;
+      z->gz.next_out = out; z->gz.avail_out = out_len;
+      rc = inflate(&z->gz, Z_NO_FLUSH);
+      in_used = in_len - z->gz.avail_in;
+      out_used = out_len - z->gz.avail_out;
+
+      /* a gzip file may be made of several members, one after another */
+      if(rc == Z_STREAM_END)
+	{
+	  if(inflateReset(&z->gz) != Z_OK)
+	    return -1;
+	}
+      else if(rc != Z_OK && rc != Z_BUF_ERROR)
+	return -1;
+    }
+#endif
+
+#ifdef HAVE_ZSTD
+  if(z->codec == SCAMPER_FILE_Z_ZSTD)
+    {
+      ZSTD_inBuffer ib = {in, in_len, 0};
+      ZSTD_outBuffer ob = {out, out_len, 0};
+      if(ZSTD_isError(ZSTD_decompressStream(z->zd, &ob, &ib)))
+	return -1;
+      in_used = ib.pos;
+      out_used = ob.pos;
+    }
+#endif
+
+#ifdef HAVE_LZMA
+  if(z->codec == SCAMPER_FILE_Z_XZ)
+    {
+      lzma_ret rc;
+      z->xz.next_in = in; z->xz.avail_in = in_len;
+      z->xz.next_out = out; z->xz.avail_out = out_len;
+      rc = lzma_code(&z->xz, z->eof != 0 ? LZMA_FINISH : LZMA_RUN);
+      in_used = in_len - z->xz.avail_in;
+      out_used = out_len - z->xz.avail_out;
+      if(rc != LZMA_OK && rc != LZMA_STREAM_END && rc != LZMA_BUF_ERROR)
+	return -1;
+    }
+#endif
+
+  z->in_off += in_used;
+  z->out_len += out_used;
+  return (ssize_t)out_used;
+}
+
+/*
+ * z_fill
+ *
+ * try to have at least len decompressed bytes in the output buffer.
+ * fewer bytes are available if the file ends first, or if the file
+ * descriptor is non-blocking and there is nothing more to read yet.
+ */
+static int z_fill(scamper_file_z_t *z, size_t len)
+{
+  ssize_t rc;
+  size_t size;
+
+  if(z->out_len - z->out_off >= len)
+    return 0;
+
+  /* shuffle what is left to the front, and make sure it will fit */
+  if(z->out_off > 0)
+    {
+      memmove(z->out, z->out + z->out_off, z->out_len - z->out_off);
+      z->out_len -= z->out_off;
+      z->out_off = 0;
+    }
+  if(z->out_size < len)
+    {
+      size = len > Z_BUFLEN ? len : Z_BUFLEN;
+      if(realloc_wrap((void **)&z->out, size) != 0)
+	return -1;
+      z->out_size = size;
+    }
+
+  while(z->out_len < len)
+    {
+      if(z->in_off == z->in_len && z->eof == 0)
+	{
+	  if((rc = read(z->fd, z->in, Z_BUFLEN)) < 0)
+	    {
+	      if(errno == EINTR)
+		continue;
+	      if(errno == EAGAIN)
+		break;
+	      return -1;
+	    }
+	  if(rc == 0)
+	    z->eof = 1;
+	  z->in_off = 0;
+	  z->in_len = (size_t)rc;
+	}
+
+      if((rc = z_decode(z)) < 0)
+	return -1;
+
+      /* the codec has nothing more to give */
+      if(rc == 0 && z->in_off == z->in_len && z->eof != 0)
+	break;
+    }
+
+  return 0;
+}
+
+int scamper_file_z_peek(scamper_file_z_t *z, uint8_t *buf, size_t len)
+{
+  if(z_fill(z, len) != 0 || z->out_len - z->out_off < len)
+    return -1;
+  memcpy(buf, z->out + z->out_off, len);
+  return 0;
+}
+
+/*
+ * scamper_file_z_read
+ *
+ * return the next len decompressed bytes in a malloc'd buffer, in the
+ * way that warts_read expects of a readfunc.
+ */
+int scamper_file_z_read(void *param, uint8_t **data, size_t len)
+{
+  scamper_file_z_t *z = param;
+  size_t avail;
+
+  *data = NULL;
+  if(z_fill(z, len) != 0)
+    return -1;
+
+  if((avail = z->out_len - z->out_off) < len)
+    {
+      /* nothing more to come: either a clean end, or a truncated file */
+      if(z->eof != 0 && z->in_off == z->in_len)
+	return avail == 0 ? -2 : -1;
+      return 0;
+    }
+
+  if((*data = memdup(z->out + z->out_off, len)) == NULL)
+    return -1;
+  z->out_off += len;
+  return 0;
+}
+
+static int z_writeout(scamper_file_z_t *z)
+{
+  if(z->out_len > 0 && write_wrap(z->fd, z->out, NULL, z->out_len) != 0)
+    return -1;
+  z->out_len = 0;
+  return 0;
+}
+
+/*
+ * z_encode
+ *
+ * compress len bytes of data.  if op is Z_FLUSH or Z_END, then also
+ * write everything the compressor has buffered to the file, ending the
+ * stream in the latter case.
+ */
+static int z_encode(scamper_file_z_t *z, const void *data, size_t len, int op)
+{
+  size_t out_len;
+  int done = 0;
+
+  while(done == 0)
+    {
+      if(z->out_len == z->out_size && z_writeout(z) != 0)
+	return -1;
+      out_len = z->out_size - z->out_len;
+
+#ifdef HAVE_ZLIB
+      if(z->codec == SCAMPER_FILE_Z_GZIP)
+	{
+	  int flush, rc;
+	  if(op == Z_RUN) flush = Z_NO_FLUSH;
+	  else if(op == Z_FLUSH) flush = Z_SYNC_FLUSH;
+	  else flush = Z_FINISH;
+	  z->gz.next_in = (uint8_t *)data; z->gz.avail_in = len;
+	  z->gz.next_out = z->out + z->out_len; z->gz.avail_out = out_len;
+	  rc = deflate(&z->gz, flush);
+	  if(rc == Z_STREAM_ERROR)
+	    return -1;
+	  data = z->gz.next_in; len = z->gz.avail_in;
+	  z->out_len += out_len - z->gz.avail_out;
+	  if(op == Z_END)
+	    done = (rc == Z_STREAM_END);
+	  else
+	    done = (len == 0 && (op == Z_RUN || z->gz.avail_out != 0));
+	}
+#endif
+
+#ifdef HAVE_ZSTD
+      if(z->codec == SCAMPER_FILE_Z_ZSTD)
+	{
+	  ZSTD_inBuffer ib = {data, len, 0};
+	  ZSTD_outBuffer ob = {z->out + z->out_len, out_len, 0};
+	  ZSTD_EndDirective e;
+	  size_t rc;
+	  if(op == Z_RUN) e = ZSTD_e_continue;
+	  else if(op == Z_FLUSH) e = ZSTD_e_flush;
+	  else e = ZSTD_e_end;
+	  rc = ZSTD_compressStream2(z->zc, &ob, &ib, e);
+	  if(ZSTD_isError(rc))
+	    return -1;
+	  data = (const uint8_t *)data + ib.pos; len -= ib.pos;
+	  z->out_len += ob.pos;
+	  done = (len == 0 && (op == Z_RUN || rc == 0));
+	}
+#endif
+
+#ifdef HAVE_LZMA
+      if(z->codec == SCAMPER_FILE_Z_XZ)
+	{
+	  lzma_action action;
+	  lzma_ret rc;
+	  if(op == Z_RUN) action = LZMA_RUN;
+	  else if(op == Z_FLUSH) action = LZMA_SYNC_FLUSH;
+	  else action = LZMA_FINISH;
+	  z->xz.next_in = data; z->xz.avail_in = len;
+	  z->xz.next_out = z->out + z->out_len; z->xz.avail_out = out_len;
+	  rc = lzma_code(&z->xz, action);
+	  if(rc != LZMA_OK && rc != LZMA_STREAM_END)
+	    return -1;
+	  data = z->xz.next_in; len = z->xz.avail_in;
+	  z->out_len += out_len - z->xz.avail_out;
+	  if(op == Z_RUN)
+	    done = (len == 0);
+	  else
+	    done = (rc == LZMA_STREAM_END);
+	}
+#endif
+    }
+
+  if(op != Z_RUN && z_writeout(z) != 0)
+    return -1;
+  return 0;
+}
+
+static int z_encode_init(scamper_file_z_t *z)
+{
+#ifdef HAVE_ZLIB
+  if(z->codec == SCAMPER_FILE_Z_GZIP)
+    {
+      /* 15 + 16: the largest window, and a gzip rather than zlib header */
+      if(deflateInit2(&z->gz, z->level != 0 ? z->level : Z_DEFAULT_COMPRESSION,
+		      Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+	return -1;
+    }
+#endif
+
+#ifdef HAVE_ZSTD
+  if(z->codec == SCAMPER_FILE_Z_ZSTD)
+    {
+      if((z->zc = ZSTD_createCCtx()) == NULL)
+	return -1;
+      if(z->level != 0 &&
+	 ZSTD_isError(ZSTD_CCtx_setParameter(z->zc, ZSTD_c_compressionLevel,
+					     z->level)))
+	return -1;
+    }
+#endif
+
+#ifdef HAVE_LZMA
+  if(z->codec == SCAMPER_FILE_Z_XZ)
+    {
+      z->xz = (lzma_stream)LZMA_STREAM_INIT;
+      if(lzma_easy_encoder(&z->xz,
+			   z->level != 0 ? z->level : LZMA_PRESET_DEFAULT,
+			   LZMA_CHECK_CRC64) != LZMA_OK)
+	return -1;
+    }
+#endif
+
+  z->init = 1;
+  return 0;
+}
+
+/*
+ * scamper_file_z_write
+ *
+ * each call is passed a complete record, so flushing here leaves the
+ * compressed stream decodable up to a record boundary.
+ */
+int scamper_file_z_write(void *param, const void *data, size_t len)
+{
+  scamper_file_z_t *z = param;
+
+  if(z->init == 0 && z_encode_init(z) != 0)
+    return -1;
+  if(z_encode(z, data, len, Z_RUN) != 0)
+    return -1;
+
+  z->unflushed += len;
+  if(z->unflushed >= Z_FLUSHLEN)
+    {
+      if(z_encode(z, NULL, 0, Z_FLUSH) != 0)
+	return -1;
+      z->unflushed = 0;
+    }
+
+  return 0;
+}
+
+int scamper_file_z_setlevel(scamper_file_z_t *z, int level)
+{
+  int min = 1, max = 9;
+
+#ifdef HAVE_ZSTD
+  if(z->codec == SCAMPER_FILE_Z_ZSTD)
+    max = ZSTD_maxCLevel();
+#endif
+
+  if(z->mode != 'w' || z->init != 0 ||
+     (level != 0 && (level < min || level > max)))
+    return -1;
+  z->level = level;
+  return 0;
+}
+
+int scamper_file_z_free(scamper_file_z_t *z)
+{
+  int rc = 0;
+
+  /* an empty file is still a valid compressed stream */
+  if(z->mode == 'w')
+    {
+      if((z->init == 0 && z_encode_init(z) != 0) ||
+	 z_encode(z, NULL, 0, Z_END) != 0)
+	rc = -1;
+    }
+
+#ifdef HAVE_ZLIB
+  if(z->codec == SCAMPER_FILE_Z_GZIP)
+    {
+      if(z->mode == 'r')
+	inflateEnd(&z->gz);
+      else if(z->init != 0)
+	deflateEnd(&z->gz);
+    }
+#endif
+#ifdef HAVE_ZSTD
+  if(z->zc != NULL) ZSTD_freeCCtx(z->zc);
+  if(z->zd != NULL) ZSTD_freeDCtx(z->zd);
+#endif
+#ifdef HAVE_LZMA
+  if(z->codec == SCAMPER_FILE_Z_XZ)
+    lzma_end(&z->xz);
+#endif
+
+  if(z->in != NULL) free(z->in);
+  if(z->out != NULL) free(z->out);
+  free(z);
+  return rc;
+}
+
+scamper_file_z_t *scamper_file_z_alloc(int fd, int codec, char mode)
+{
+  scamper_file_z_t *z = NULL;
+  int ok = 0;
+
+  if(mode != 'r' && mode != 'w')
+    return NULL;
+
+#ifdef HAVE_ZLIB
+  if(codec == SCAMPER_FILE_Z_GZIP) ok = 1;
+#endif
+#ifdef HAVE_ZSTD
+  if(codec == SCAMPER_FILE_Z_ZSTD) ok = 1;
+#endif
+#ifdef HAVE_LZMA
+  if(codec == SCAMPER_FILE_Z_XZ) ok = 1;
+#endif
+  if(ok == 0)
+    return NULL;
+
+  if((z = malloc_zero(sizeof(scamper_file_z_t))) == NULL)
+    return NULL;
+  z->fd = fd;
+  z->codec = codec;
+  z->mode = mode;
+
+  if((mode == 'r' && (z->in = malloc(Z_BUFLEN)) == NULL) ||
+     (z->out = malloc(Z_BUFLEN)) == NULL)
+    goto err;
+  z->out_size = Z_BUFLEN;
+
+  /* the encoder is set up on the first write, once the level is known */
+  if(mode == 'w')
+    return z;
+
+#ifdef HAVE_ZLIB
+  if(codec == SCAMPER_FILE_Z_GZIP)
+    {
+      /* 15 + 32: the largest window, and detect the gzip header */
+      if(inflateInit2(&z->gz, 15 + 32) != Z_OK)
+	goto err;
+    }
+#endif
+#ifdef HAVE_ZSTD
+  if(codec == SCAMPER_FILE_Z_ZSTD && (z->zd = ZSTD_createDCtx()) == NULL)
+    goto err;
+#endif
+#ifdef HAVE_LZMA
+  if(codec == SCAMPER_FILE_Z_XZ)
+    {
+      z->xz = (lzma_stream)LZMA_STREAM_INIT;
+      if(lzma_stream_decoder(&z->xz, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK)
+	goto err;
+    }
+#endif
+
+  z->init = 1;
+  return z;
+
+ err:
+  if(z->in != NULL) free(z->in);
+  if(z->out != NULL) free(z->out);
+  free(z);
+  return NULL;
+}
+
+#else
+
+int scamper_file_z_peek(scamper_file_z_t *z, uint8_t *buf, size_t len)
+{
+  return -1;
+}
+
+int scamper_file_z_read(void *param, uint8_t **data, size_t len)
+{
+  return -1;
+}
+
+int scamper_file_z_write(void *param, const void *data, size_t len)
+{
+  return -1;
+}
+
+int scamper_file_z_setlevel(scamper_file_z_t *z, int level)
+{
+  return -1;
+}
+
+int scamper_file_z_free(scamper_file_z_t *z)
+{
+  return -1;
+}
+
+scamper_file_z_t *scamper_file_z_alloc(int fd, int codec, char mode)
+{
+  return NULL;
+}
+
+#endif /* HAVE_Z */
@@ -0,0 +1,59 @@
+/*
+ * scamper_file_z.h
+ *
+ * $Id$
+ *
+ * Copyright (C) 2026 Matthew Luckie
+ * Author: Matthew Luckie
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __SCAMPER_FILE_Z_H
+#define __SCAMPER_FILE_Z_H
+
+#define SCAMPER_FILE_Z_NONE 0
+#define SCAMPER_FILE_Z_GZIP 1
+#define SCAMPER_FILE_Z_ZSTD 2
+#define SCAMPER_FILE_Z_XZ   3
+
+typedef struct scamper_file_z scamper_file_z_t;
+
+/* the compression implied by a filename suffix, or by the leading bytes */
+int scamper_file_z_suffix(const char *filename);
+int scamper_file_z_magic(const uint8_t *buf, size_t len);
+
+/*
+ * scamper_file_z_alloc
+ *
+ * compress or decompress the file referred to by fd, according to mode
+ * 'r' or 'w'.  returns NULL if scamper was built without the codec.
+ */
+scamper_file_z_t *scamper_file_z_alloc(int fd, int codec, char mode);
+
+/* finishes the compressed stream, if writing, and frees the state */
+int scamper_file_z_free(scamper_file_z_t *z);
+
+/* set the compression level, before the first write */
+int scamper_file_z_setlevel(scamper_file_z_t *z, int level);
+
+/* look at the first len decompressed bytes without consuming them */
+int scamper_file_z_peek(scamper_file_z_t *z, uint8_t *buf, size_t len);
+
+/* scamper_file_readfunc_t and scamper_file_writefunc_t callbacks */
+int scamper_file_z_read(void *param, uint8_t **data, size_t len);
+int scamper_file_z_write(void *param, const void *data, size_t len);
+
+#endif /* __SCAMPER_FILE_Z_H */
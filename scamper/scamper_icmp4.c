@@ -44,6 +44,20 @@ static uint8_t *txbuf = NULL;
 static size_t   txbuf_len = 0;
 static uint8_t  rxbuf[65536];
 
+#ifdef HAVE_RECVMMSG
+typedef struct icmp4_rxbatch
+{
+  struct mmsghdr       msgs[SCAMPER_ICMP_BATCH_MAX];
+  struct iovec         iovs[SCAMPER_ICMP_BATCH_MAX];
+  struct sockaddr_in   froms[SCAMPER_ICMP_BATCH_MAX];
+  uint8_t              ctrls[SCAMPER_ICMP_BATCH_MAX][256];
+  uint8_t              bufs[SCAMPER_ICMP_BATCH_MAX][SCAMPER_ICMP_BATCH_LEN];
+  scamper_icmp_resp_t  irs[SCAMPER_ICMP_BATCH_MAX];
+} icmp4_rxbatch_t;
+
+static icmp4_rxbatch_t *rxbatch = NULL;
+#endif
+
 static void icmp4_header(scamper_probe_t *probe, uint8_t *buf)
 {
   buf[0] = probe->pr_icmp_type; /* type */
@@ -222,8 +236,8 @@ int scamper_icmp4_probe(scamper_probe_t *probe)
   /* get the transmit time immediately before we send the packet */
   gettimeofday_wrap(&probe->pr_tx);
 
-  i = sendto(probe->pr_fd, txbuf, len, 0, (struct sockaddr *)&sin4,
-	     sizeof(struct sockaddr_in));
+  i = scamper_probe_sendto(probe, txbuf, len, (struct sockaddr *)&sin4,
+			   sizeof(struct sockaddr_in));
 
   if(i < 0)
     {
@@ -544,13 +558,24 @@ static void icmp4_recv_ip(int fd, scamper_icmp_resp_t *ir, const uint8_t *buf,
 	      ir->ir_flags |= SCAMPER_ICMP_RESP_FLAG_KERNRX;
 	      break;
 	    }
+#if defined(SO_TIMESTAMPNS)
+	  if(cmsg->cmsg_level == SOL_SOCKET &&
+	     cmsg->cmsg_type == SCM_TIMESTAMPNS)
+	    {
+	      timeval_cpy_ts(&ir->ir_rx, (struct timespec *)CMSG_DATA(cmsg));
+	      ir->ir_flags |= SCAMPER_ICMP_RESP_FLAG_KERNRX;
+	      break;
+	    }
+#endif
 	  cmsg = (struct cmsghdr *)CMSG_NXTHDR(msg, cmsg);
 	}
     }
 #endif
 
 #if defined(SIOCGSTAMP)
-  if((ir->ir_flags & SCAMPER_ICMP_RESP_FLAG_KERNRX) == 0)
+  /* SIOCGSTAMP reports the last packet read, not this one, when batched */
+  if((ir->ir_flags & SCAMPER_ICMP_RESP_FLAG_KERNRX) == 0 &&
+     scamper_option_rxbatch() == 0)
     {
       if(ioctl(fd, SIOCGSTAMP, &ir->ir_rx) != -1)
 	ir->ir_flags |= SCAMPER_ICMP_RESP_FLAG_KERNRX;
@@ -724,12 +749,23 @@ static int scamper_icmp4_recv_err(int fd, scamper_icmp_resp_t *resp)
 }
 #endif
 
-int scamper_icmp4_recv(int fd, scamper_icmp_resp_t *resp)
+/*
+ * icmp4_recv_pkt
+ *
+ * decode an ICMP packet received on fd into the response structure.
+ * returns zero if the packet is a response scamper might be interested in.
+ */
+#ifndef _WIN32
+static int icmp4_recv_pkt(int fd, scamper_icmp_resp_t *resp, uint8_t *buf,
+			  ssize_t pbuflen, struct msghdr *msg)
+#else
+static int icmp4_recv_pkt(int fd, scamper_icmp_resp_t *resp, uint8_t *buf,
+			  ssize_t pbuflen)
+#endif
 {
   ssize_t              poffset;
-  ssize_t              pbuflen;
   struct icmp         *icmp;
-  struct ip           *ip_outer = (struct ip *)rxbuf;
+  struct ip           *ip_outer = (struct ip *)buf;
   struct ip           *ip_inner;
   struct udphdr       *udp;
   struct tcphdr       *tcp;
@@ -740,39 +776,6 @@ int scamper_icmp4_recv(int fd, scamper_icmp_resp_t *resp)
   uint8_t             *ext;
   ssize_t              extlen;
 
-#ifndef _WIN32
-  struct sockaddr_in   from;
-  uint8_t              ctrlbuf[256];
-  struct msghdr        msg;
-  struct iovec         iov;
-
-  memset(&iov, 0, sizeof(iov));
-  iov.iov_base = (caddr_t)rxbuf;
-  iov.iov_len  = sizeof(rxbuf);
-
-  msg.msg_name       = (caddr_t)&from;
-  msg.msg_namelen    = sizeof(from);
-  msg.msg_iov        = &iov;
-  msg.msg_iovlen     = 1;
-  msg.msg_control    = (caddr_t)ctrlbuf;
-  msg.msg_controllen = sizeof(ctrlbuf);
-
-  if((pbuflen = recvmsg(fd, &msg, 0)) == -1)
-    {
-      printerror(__func__, "could not recvmsg");
-      return -1;
-    }
-
-#else
-
-  if((pbuflen = recv(fd, rxbuf, sizeof(rxbuf), 0)) == SOCKET_ERROR)
-    {
-      printerror(__func__, "could not recv");
-      return -1;
-    }
-
-#endif
-
   if((iphl = ip_hl(ip_outer)) < 20)
     {
       scamper_debug(__func__, "iphl %d < 20", iphl);
@@ -789,7 +792,7 @@ int scamper_icmp4_recv(int fd, scamper_icmp_resp_t *resp)
       return -1;
     }
 
-  icmp = (struct icmp *)(rxbuf + iphl);
+  icmp = (struct icmp *)(buf + iphl);
   type = icmp->icmp_type;
   code = icmp->icmp_code;
 
@@ -820,15 +823,15 @@ int scamper_icmp4_recv(int fd, scamper_icmp_resp_t *resp)
 
       if(type == ICMP_TSTAMPREPLY)
 	{
-	  resp->ir_icmp_tso = bytes_ntohl(rxbuf + iphl + 8);
-	  resp->ir_icmp_tsr = bytes_ntohl(rxbuf + iphl + 12);
-	  resp->ir_icmp_tst = bytes_ntohl(rxbuf + iphl + 16);
+	  resp->ir_icmp_tso = bytes_ntohl(buf + iphl + 8);
+	  resp->ir_icmp_tsr = bytes_ntohl(buf + iphl + 12);
+	  resp->ir_icmp_tst = bytes_ntohl(buf + iphl + 16);
 	}
 
 #ifndef _WIN32
-      icmp4_recv_ip(fd, resp, rxbuf, iphl, &msg);
+      icmp4_recv_ip(fd, resp, buf, iphl, msg);
 #else
-      icmp4_recv_ip(fd, resp, rxbuf, iphl);
+      icmp4_recv_ip(fd, resp, buf, iphl);
 #endif
 
       return 0;
@@ -853,9 +856,9 @@ int scamper_icmp4_recv(int fd, scamper_icmp_resp_t *resp)
 
       /* record details of the IP header and the ICMP headers */
 #ifndef _WIN32
-      icmp4_recv_ip(fd, resp, rxbuf, iphl, &msg);
+      icmp4_recv_ip(fd, resp, buf, iphl, msg);
 #else
-      icmp4_recv_ip(fd, resp, rxbuf, iphl);
+      icmp4_recv_ip(fd, resp, buf, iphl);
 #endif
 
       /* record details of the IP header found in the ICMP error message */
@@ -877,18 +880,18 @@ int scamper_icmp4_recv(int fd, scamper_icmp_resp_t *resp)
 
       if(resp->ir_inner_ip_off == 0)
 	{
-	  ipopt_parse(resp, rxbuf+iphl+8, iphlq, ip_quote_rr, ip_quote_ts);
+	  ipopt_parse(resp, buf+iphl+8, iphlq, ip_quote_rr, ip_quote_ts);
 
 	  if(nh == IPPROTO_UDP)
 	    {
-	      udp = (struct udphdr *)(rxbuf+poffset);
+	      udp = (struct udphdr *)(buf+poffset);
 	      resp->ir_inner_udp_sport = ntohs(udp->uh_sport);
 	      resp->ir_inner_udp_dport = ntohs(udp->uh_dport);
 	      resp->ir_inner_udp_sum   = udp->uh_sum;
 	    }
 	  else if(nh == IPPROTO_ICMP)
 	    {
-	      icmp = (struct icmp *)(rxbuf+poffset);
+	      icmp = (struct icmp *)(buf+poffset);
 	      resp->ir_inner_icmp_type = icmp->icmp_type;
 	      resp->ir_inner_icmp_code = icmp->icmp_code;
 	      resp->ir_inner_icmp_sum  = icmp->icmp_cksum;
@@ -897,7 +900,7 @@ int scamper_icmp4_recv(int fd, scamper_icmp_resp_t *resp)
 	    }
 	  else if(nh == IPPROTO_TCP)
 	    {
-	      tcp = (struct tcphdr *)(rxbuf+poffset);
+	      tcp = (struct tcphdr *)(buf+poffset);
 	      resp->ir_inner_tcp_sport = ntohs(tcp->th_sport);
 	      resp->ir_inner_tcp_dport = ntohs(tcp->th_dport);
 	      resp->ir_inner_tcp_seq   = ntohl(tcp->th_seq);
@@ -905,7 +908,7 @@ int scamper_icmp4_recv(int fd, scamper_icmp_resp_t *resp)
 	}
       else
 	{
-	  resp->ir_inner_data = rxbuf + poffset;
+	  resp->ir_inner_data = buf + poffset;
 	  resp->ir_inner_datalen = pbuflen - poffset;
 	}
 
@@ -921,7 +924,7 @@ int scamper_icmp4_recv(int fd, scamper_icmp_resp_t *resp)
        */
       if(pbuflen - (iphl+8) > 128 + 4)
 	{
-	  ext    = rxbuf   + (iphl + 8 + 128);
+	  ext    = buf   + (iphl + 8 + 128);
 	  extlen = pbuflen - (iphl + 8 + 128);
 
 	  if(((ext[0] & 0xf0) == 0x20 || ext[0] == 0x02) &&
@@ -940,9 +943,133 @@ int scamper_icmp4_recv(int fd, scamper_icmp_resp_t *resp)
   return -1;
 }
 
+int scamper_icmp4_recv(int fd, scamper_icmp_resp_t *resp)
+{
+  ssize_t              pbuflen;
+
+#ifndef _WIN32
+  struct sockaddr_in   from;
+  uint8_t              ctrlbuf[256];
+  struct msghdr        msg;
+  struct iovec         iov;
+
+  memset(&iov, 0, sizeof(iov));
+  iov.iov_base = (caddr_t)rxbuf;
+  iov.iov_len  = sizeof(rxbuf);
+
+  msg.msg_name       = (caddr_t)&from;
+  msg.msg_namelen    = sizeof(from);
+  msg.msg_iov        = &iov;
+  msg.msg_iovlen     = 1;
+  msg.msg_control    = (caddr_t)ctrlbuf;
+  msg.msg_controllen = sizeof(ctrlbuf);
+
+  if((pbuflen = recvmsg(fd, &msg, 0)) == -1)
+    {
+      printerror(__func__, "could not recvmsg");
+      return -1;
+    }
+
+#else
+
+  if((pbuflen = recv(fd, rxbuf, sizeof(rxbuf), 0)) == SOCKET_ERROR)
+    {
+      printerror(__func__, "could not recv");
+      return -1;
+    }
+
+#endif
+
+#ifndef _WIN32
+  return icmp4_recv_pkt(fd, resp, rxbuf, pbuflen, &msg);
+#else
+  return icmp4_recv_pkt(fd, resp, rxbuf, pbuflen);
+#endif
+}
+
+#ifdef HAVE_RECVMMSG
+/*
+ * icmp4_read_batch
+ *
+ * read the ICMP messages waiting on the socket, up to
+ * SCAMPER_ICMP_BATCH_MAX, with a single recvmmsg call.  decode all of them
+ * before handing the responses to the tasks that are waiting for them.
+ */
+static void icmp4_read_batch(const int fd)
+{
+  struct msghdr *msg;
+  int i, rc, irc = 0;
+
+  if(rxbatch == NULL &&
+     (rxbatch = malloc_zero(sizeof(icmp4_rxbatch_t))) == NULL)
+    {
+      printerror(__func__, "could not malloc rxbatch");
+      return;
+    }
+
+  for(i=0; i<SCAMPER_ICMP_BATCH_MAX; i++)
+    {
+      rxbatch->iovs[i].iov_base = (caddr_t)rxbatch->bufs[i];
+      rxbatch->iovs[i].iov_len  = sizeof(rxbatch->bufs[i]);
+
+      msg = &rxbatch->msgs[i].msg_hdr;
+      msg->msg_name       = (caddr_t)&rxbatch->froms[i];
+      msg->msg_namelen    = sizeof(rxbatch->froms[i]);
+      msg->msg_iov        = &rxbatch->iovs[i];
+      msg->msg_iovlen     = 1;
+      msg->msg_control    = (caddr_t)rxbatch->ctrls[i];
+      msg->msg_controllen = sizeof(rxbatch->ctrls[i]);
+      msg->msg_flags      = 0;
+    }
+
+  if((rc = recvmmsg(fd, rxbatch->msgs, SCAMPER_ICMP_BATCH_MAX,
+		    MSG_DONTWAIT, NULL)) == -1)
+    {
+      if(errno != EAGAIN && errno != EINTR)
+	printerror(__func__, "could not recvmmsg");
+      return;
+    }
+
+  for(i=0; i<rc; i++)
+    {
+      msg = &rxbatch->msgs[i].msg_hdr;
+      if(msg->msg_flags & MSG_TRUNC)
+	{
+	  scamper_debug(__func__, "message larger than %d bytes",
+			SCAMPER_ICMP_BATCH_LEN);
+	  continue;
+	}
+
+      memset(&rxbatch->irs[irc], 0, sizeof(scamper_icmp_resp_t));
+      if(icmp4_recv_pkt(fd, &rxbatch->irs[irc], rxbatch->bufs[i],
+			rxbatch->msgs[i].msg_len, msg) == 0)
+	irc++;
+      else
+	scamper_icmp_resp_clean(&rxbatch->irs[irc]);
+    }
+
+  for(i=0; i<irc; i++)
+    {
+      scamper_icmp_resp_handle(&rxbatch->irs[i]);
+      scamper_icmp_resp_clean(&rxbatch->irs[i]);
+    }
+
+  return;
+}
+#endif
+
 void scamper_icmp4_read_cb(const int fd, void *param)
 {
   scamper_icmp_resp_t ir;
+
+#ifdef HAVE_RECVMMSG
+  if(scamper_option_rxbatch())
+    {
+      icmp4_read_batch(fd);
+      return;
+    }
+#endif
+
   memset(&ir, 0, sizeof(ir));
   if(scamper_icmp4_recv(fd, &ir) == 0)
     scamper_icmp_resp_handle(&ir);
@@ -970,6 +1097,14 @@ void scamper_icmp4_cleanup()
       txbuf = NULL;
     }
 
+#ifdef HAVE_RECVMMSG
+  if(rxbatch != NULL)
+    {
+      free(rxbatch);
+      rxbatch = NULL;
+    }
+#endif
+
   return;
 }
 
@@ -1133,6 +1268,17 @@ int scamper_icmp4_open(const void *addr)
     }
 #endif
 
+#if defined(SO_TIMESTAMPNS) && defined(HAVE_RECVMMSG)
+  /* SIOCGSTAMP cannot be used when reading batches of responses */
+  opt = 1;
+  if(scamper_option_rxbatch() &&
+     setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, &opt, sizeof(opt)) == -1)
+    {
+      printerror(__func__, "could not set SO_TIMESTAMPNS");
+      goto err;
+    }
+#endif
+
   /*
    * on linux systems with ICMP_FILTER defined, filter all messages except
    * destination unreachable and time exceeded messages
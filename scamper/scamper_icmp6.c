@@ -43,6 +43,20 @@ static uint8_t *txbuf = NULL;
 static size_t   txbuf_len = 0;
 static uint8_t  rxbuf[65536];
 
+#ifdef HAVE_RECVMMSG
+typedef struct icmp6_rxbatch
+{
+  struct mmsghdr       msgs[SCAMPER_ICMP_BATCH_MAX];
+  struct iovec         iovs[SCAMPER_ICMP_BATCH_MAX];
+  struct sockaddr_in6  froms[SCAMPER_ICMP_BATCH_MAX];
+  uint8_t              ctrls[SCAMPER_ICMP_BATCH_MAX][256];
+  uint8_t              bufs[SCAMPER_ICMP_BATCH_MAX][SCAMPER_ICMP_BATCH_LEN];
+  scamper_icmp_resp_t  irs[SCAMPER_ICMP_BATCH_MAX];
+} icmp6_rxbatch_t;
+
+static icmp6_rxbatch_t *rxbatch = NULL;
+#endif
+
 static void icmp6_header(scamper_probe_t *probe, uint8_t *buf)
 {
   buf[0] = probe->pr_icmp_type;
@@ -188,8 +202,10 @@ int scamper_icmp6_probe(scamper_probe_t *probe)
   icmphdrlen = (1 + 1 + 2 + 2 + 2);
   len = probe->pr_len + icmphdrlen;
 
+  /* batched probes carry their hop limit with them */
   i = probe->pr_ip_ttl;
-  if(setsockopt(probe->pr_fd,
+  if(scamper_probe_batched(probe) == 0 &&
+     setsockopt(probe->pr_fd,
 		IPPROTO_IPV6, IPV6_UNICAST_HOPS, (char *)&i, sizeof(i)) == -1)
     {
       printerror(__func__, "could not set hlim to %d", i);
@@ -225,8 +241,8 @@ int scamper_icmp6_probe(scamper_probe_t *probe)
   /* get the transmit time immediately before we send the packet */
   gettimeofday_wrap(&probe->pr_tx);
 
-  i = sendto(probe->pr_fd, txbuf, len, 0, (struct sockaddr *)&sin6,
-	     sizeof(struct sockaddr_in6));
+  i = scamper_probe_sendto(probe, txbuf, len, (struct sockaddr *)&sin6,
+			   sizeof(struct sockaddr_in6));
 
   if(i < 0)
     {
@@ -289,13 +305,23 @@ static void icmp6_recv_ip_outer(int fd, scamper_icmp_resp_t *resp,
 	      resp->ir_flags |= SCAMPER_ICMP_RESP_FLAG_KERNRX;
 	    }
 #endif
+
+#if defined(SO_TIMESTAMPNS)
+	  if(cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SCM_TIMESTAMPNS)
+	    {
+	      timeval_cpy_ts(&resp->ir_rx, (struct timespec *)CMSG_DATA(cm));
+	      resp->ir_flags |= SCAMPER_ICMP_RESP_FLAG_KERNRX;
+	    }
+#endif
 	  cm = (struct cmsghdr *)CMSG_NXTHDR(msg, cm);
 	}
     }
 #endif
 
 #if defined(SIOCGSTAMP)
-  if((resp->ir_flags & SCAMPER_ICMP_RESP_FLAG_KERNRX) == 0)
+  /* SIOCGSTAMP reports the last packet read, not this one, when batched */
+  if((resp->ir_flags & SCAMPER_ICMP_RESP_FLAG_KERNRX) == 0 &&
+     scamper_option_rxbatch() == 0)
     {
       if(ioctl(fd, SIOCGSTAMP, &resp->ir_rx) != -1)
 	resp->ir_flags |= SCAMPER_ICMP_RESP_FLAG_KERNRX;
@@ -317,22 +343,18 @@ static void icmp6_recv_ip_outer(int fd, scamper_icmp_resp_t *resp,
 }
 
 /*
- * scamper_icmp6_recv
+ * icmp6_recv_pkt
  *
- * handle receiving an ICMPv6 packet.
- *
- * if the packet is an ICMP response that we should concern ourselves with
- * (i.e. it is in response to one of our probes) then we fill out
- * the attached icmp_response structure and return zero.
- *
- * if we should ignore this packet, or an error condition occurs, then
- * we return -1.
+ * decode an ICMP6 packet received from the address in from.
  */
-int scamper_icmp6_recv(int fd, scamper_icmp_resp_t *resp)
+static int icmp6_recv_pkt(int fd, scamper_icmp_resp_t *resp,
+#ifndef _WIN32
+			  struct msghdr *msg,
+#endif
+			  uint8_t *buf, ssize_t pbuflen,
+			  struct sockaddr_in6 *from)
 {
-  struct sockaddr_in6  from;
   ssize_t              poffset;
-  ssize_t              pbuflen;
   struct icmp6_hdr    *icmp, *icmpq;
   struct ip6_hdr      *ip;
   struct ip6_frag     *frag;
@@ -343,40 +365,7 @@ int scamper_icmp6_recv(int fd, scamper_icmp_resp_t *resp)
   uint8_t             *ext;
   ssize_t              extlen;
 
-#ifndef _WIN32
-  uint8_t              ctrlbuf[256];
-  struct msghdr        msg;
-  struct iovec         iov;
-
-  memset(&iov, 0, sizeof(iov));
-  iov.iov_base = (caddr_t)rxbuf;
-  iov.iov_len  = sizeof(rxbuf);
-
-  msg.msg_name       = (caddr_t)&from;
-  msg.msg_namelen    = sizeof(from);
-  msg.msg_iov        = &iov;
-  msg.msg_iovlen     = 1;
-  msg.msg_control    = (caddr_t)ctrlbuf;
-  msg.msg_controllen = sizeof(ctrlbuf);
-
-  if((pbuflen = recvmsg(fd, &msg, 0)) == -1)
-    {
-      printerror(__func__, "could not recvmsg");
-      return -1;
-    }
-#endif
-
-#ifdef _WIN32
-  socklen_t fromlen = sizeof(from);
-  if((pbuflen = recvfrom(fd, rxbuf, sizeof(rxbuf), 0,
-			 (struct sockaddr *)&from, &fromlen)) < 0)
-    {
-      printerror(__func__, "could not recvfrom");
-      return -1;
-    }
-#endif
-
-  icmp = (struct icmp6_hdr *)rxbuf;
+  icmp = (struct icmp6_hdr *)buf;
   if(pbuflen < (ssize_t)sizeof(struct icmp6_hdr))
     {
       return -1;
@@ -395,7 +384,7 @@ int scamper_icmp6_recv(int fd, scamper_icmp_resp_t *resp)
     }
 
   poffset  = sizeof(struct icmp6_hdr);
-  ip       = (struct ip6_hdr *)(rxbuf + poffset);
+  ip       = (struct ip6_hdr *)(buf + poffset);
 
   memset(resp, 0, sizeof(scamper_icmp_resp_t));
 
@@ -405,14 +394,14 @@ int scamper_icmp6_recv(int fd, scamper_icmp_resp_t *resp)
     {
       resp->ir_icmp_id  = ntohs(icmp->icmp6_id);
       resp->ir_icmp_seq = ntohs(icmp->icmp6_seq);
-      memcpy(&resp->ir_inner_ip_dst.v6, &from.sin6_addr,
+      memcpy(&resp->ir_inner_ip_dst.v6, &from->sin6_addr,
 	     sizeof(struct in6_addr));
 
 #ifndef _WIN32
-      icmp6_recv_ip_outer(fd,resp,&msg,icmp,&from,
+      icmp6_recv_ip_outer(fd,resp,msg,icmp,from,
 			  pbuflen + sizeof(struct ip6_hdr));
 #else
-      icmp6_recv_ip_outer(fd,resp,icmp,&from,pbuflen+sizeof(struct ip6_hdr));
+      icmp6_recv_ip_outer(fd,resp,icmp,from,pbuflen+sizeof(struct ip6_hdr));
 #endif
 
       return 0;
@@ -435,14 +424,14 @@ int scamper_icmp6_recv(int fd, scamper_icmp_resp_t *resp)
 
       if(nh == IPPROTO_UDP)
 	{
-          udp = (struct udphdr *)(rxbuf+poffset);
+          udp = (struct udphdr *)(buf+poffset);
 	  resp->ir_inner_udp_sport = ntohs(udp->uh_sport);
 	  resp->ir_inner_udp_dport = ntohs(udp->uh_dport);
 	  resp->ir_inner_udp_sum   = udp->uh_sum;
 	}
       else if(nh == IPPROTO_ICMPV6)
 	{
-	  icmpq = (struct icmp6_hdr *)(rxbuf+poffset);
+	  icmpq = (struct icmp6_hdr *)(buf+poffset);
 	  resp->ir_inner_icmp_type = icmpq->icmp6_type;
 	  resp->ir_inner_icmp_code = icmpq->icmp6_code;
 	  resp->ir_inner_icmp_sum  = icmpq->icmp6_cksum;
@@ -451,14 +440,14 @@ int scamper_icmp6_recv(int fd, scamper_icmp_resp_t *resp)
 	}
       else if(nh == IPPROTO_TCP)
 	{
-	  tcp = (struct tcphdr *)(rxbuf+poffset);
+	  tcp = (struct tcphdr *)(buf+poffset);
 	  resp->ir_inner_tcp_sport = ntohs(tcp->th_sport);
 	  resp->ir_inner_tcp_dport = ntohs(tcp->th_dport);
 	  resp->ir_inner_tcp_seq   = ntohl(tcp->th_seq);
 	}
       else if(nh == IPPROTO_FRAGMENT)
 	{
-	  frag = (struct ip6_frag *)(rxbuf+poffset);
+	  frag = (struct ip6_frag *)(buf+poffset);
 	  resp->ir_inner_ip_proto = nh = frag->ip6f_nxt;
 	  resp->ir_inner_ip_off = ntohs(frag->ip6f_offlg) >> 3;
 	  resp->ir_inner_ip_id  = ntohl(frag->ip6f_ident);
@@ -467,16 +456,16 @@ int scamper_icmp6_recv(int fd, scamper_icmp_resp_t *resp)
 	  if(resp->ir_inner_ip_off == 0)
 	    continue;
 
-	  resp->ir_inner_data = rxbuf + poffset;
+	  resp->ir_inner_data = buf + poffset;
 	  resp->ir_inner_datalen = pbuflen - poffset;
 	}
 
       /* record details of the IP header and the ICMP headers */
 #ifndef _WIN32
-      icmp6_recv_ip_outer(fd,resp,&msg,icmp,&from,
+      icmp6_recv_ip_outer(fd,resp,msg,icmp,from,
 			  pbuflen + sizeof(struct ip6_hdr));
 #else
-      icmp6_recv_ip_outer(fd,resp,icmp,&from,pbuflen+sizeof(struct ip6_hdr));
+      icmp6_recv_ip_outer(fd,resp,icmp,from,pbuflen+sizeof(struct ip6_hdr));
 #endif
 
       memcpy(&resp->ir_inner_ip_dst.v6, &ip->ip6_dst, sizeof(struct in6_addr));
@@ -497,7 +486,7 @@ int scamper_icmp6_recv(int fd, scamper_icmp_resp_t *resp)
        */
       if(pbuflen - 8 > 128 + 4)
 	{
-	  ext    = rxbuf   + (8 + 128);
+	  ext    = buf   + (8 + 128);
 	  extlen = pbuflen - (8 + 128);
 
 	  if((ext[0] & 0xf0) == 0x20 &&
@@ -514,10 +503,146 @@ int scamper_icmp6_recv(int fd, scamper_icmp_resp_t *resp)
   return -1;
 }
 
+/*
+ * scamper_icmp6_recv
+ *
+ * handle receiving an ICMPv6 packet.
+ *
+ * if the packet is an ICMP response that we should concern ourselves with
+ * (i.e. it is in response to one of our probes) then we fill out
+ * the attached icmp_response structure and return zero.
+ *
+ * if we should ignore this packet, or an error condition occurs, then
+ * we return -1.
+ */
+int scamper_icmp6_recv(int fd, scamper_icmp_resp_t *resp)
+{
+  struct sockaddr_in6  from;
+  ssize_t              pbuflen;
+
+#ifndef _WIN32
+  uint8_t              ctrlbuf[256];
+  struct msghdr        msg;
+  struct iovec         iov;
+
+  memset(&iov, 0, sizeof(iov));
+  iov.iov_base = (caddr_t)rxbuf;
+  iov.iov_len  = sizeof(rxbuf);
+
+  msg.msg_name       = (caddr_t)&from;
+  msg.msg_namelen    = sizeof(from);
+  msg.msg_iov        = &iov;
+  msg.msg_iovlen     = 1;
+  msg.msg_control    = (caddr_t)ctrlbuf;
+  msg.msg_controllen = sizeof(ctrlbuf);
+
+  if((pbuflen = recvmsg(fd, &msg, 0)) == -1)
+    {
+      printerror(__func__, "could not recvmsg");
+      return -1;
+    }
+#endif
+
+#ifdef _WIN32
+  socklen_t fromlen = sizeof(from);
+  if((pbuflen = recvfrom(fd, rxbuf, sizeof(rxbuf), 0,
+			 (struct sockaddr *)&from, &fromlen)) < 0)
+    {
+      printerror(__func__, "could not recvfrom");
+      return -1;
+    }
+#endif
+
+#ifndef _WIN32
+  return icmp6_recv_pkt(fd, resp, &msg, rxbuf, pbuflen, &from);
+#else
+  return icmp6_recv_pkt(fd, resp, rxbuf, pbuflen, &from);
+#endif
+}
+
+#ifdef HAVE_RECVMMSG
+/*
+ * icmp6_read_batch
+ *
+ * read the ICMP6 messages waiting on the socket, up to
+ * SCAMPER_ICMP_BATCH_MAX, with a single recvmmsg call.  decode all of them
+ * before handing the responses to the tasks that are waiting for them.
+ */
+static void icmp6_read_batch(const int fd)
+{
+  struct msghdr *msg;
+  int i, rc, irc = 0;
+
+  if(rxbatch == NULL &&
+     (rxbatch = malloc_zero(sizeof(icmp6_rxbatch_t))) == NULL)
+    {
+      printerror(__func__, "could not malloc rxbatch");
+      return;
+    }
+
+  for(i=0; i<SCAMPER_ICMP_BATCH_MAX; i++)
+    {
+      rxbatch->iovs[i].iov_base = (caddr_t)rxbatch->bufs[i];
+      rxbatch->iovs[i].iov_len  = sizeof(rxbatch->bufs[i]);
+
+      msg = &rxbatch->msgs[i].msg_hdr;
+      msg->msg_name       = (caddr_t)&rxbatch->froms[i];
+      msg->msg_namelen    = sizeof(rxbatch->froms[i]);
+      msg->msg_iov        = &rxbatch->iovs[i];
+      msg->msg_iovlen     = 1;
+      msg->msg_control    = (caddr_t)rxbatch->ctrls[i];
+      msg->msg_controllen = sizeof(rxbatch->ctrls[i]);
+      msg->msg_flags      = 0;
+    }
+
+  if((rc = recvmmsg(fd, rxbatch->msgs, SCAMPER_ICMP_BATCH_MAX,
+		    MSG_DONTWAIT, NULL)) == -1)
+    {
+      if(errno != EAGAIN && errno != EINTR)
+	printerror(__func__, "could not recvmmsg");
+      return;
+    }
+
+  for(i=0; i<rc; i++)
+    {
+      msg = &rxbatch->msgs[i].msg_hdr;
+      if(msg->msg_flags & MSG_TRUNC)
+	{
+	  scamper_debug(__func__, "message larger than %d bytes",
+			SCAMPER_ICMP_BATCH_LEN);
+	  continue;
+	}
+
+      memset(&rxbatch->irs[irc], 0, sizeof(scamper_icmp_resp_t));
+      if(icmp6_recv_pkt(fd, &rxbatch->irs[irc], msg, rxbatch->bufs[i],
+			rxbatch->msgs[i].msg_len, &rxbatch->froms[i]) == 0)
+	irc++;
+      else
+	scamper_icmp_resp_clean(&rxbatch->irs[irc]);
+    }
+
+  for(i=0; i<irc; i++)
+    {
+      scamper_icmp_resp_handle(&rxbatch->irs[i]);
+      scamper_icmp_resp_clean(&rxbatch->irs[i]);
+    }
+
+  return;
+}
+#endif
+
 void scamper_icmp6_read_cb(const int fd, void *param)
 {
   scamper_icmp_resp_t ir;
 
+#ifdef HAVE_RECVMMSG
+  if(scamper_option_rxbatch())
+    {
+      icmp6_read_batch(fd);
+      return;
+    }
+#endif
+
   memset(&ir, 0, sizeof(ir));
 
   if(scamper_icmp6_recv(fd, &ir) == 0)
@@ -536,6 +661,14 @@ void scamper_icmp6_cleanup()
       txbuf = NULL;
     }
 
+#ifdef HAVE_RECVMMSG
+  if(rxbatch != NULL)
+    {
+      free(rxbatch);
+      rxbatch = NULL;
+    }
+#endif
+
   return;
 }
 
@@ -594,6 +727,17 @@ int scamper_icmp6_open(const void *addr)
     }
 #endif
 
+#if defined(SO_TIMESTAMPNS) && defined(HAVE_RECVMMSG)
+  /* SIOCGSTAMP cannot be used when reading batches of responses */
+  opt = 1;
+  if(scamper_option_rxbatch() &&
+     setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, &opt, sizeof(opt)) == -1)
+    {
+      printerror(__func__, "could not set SO_TIMESTAMPNS");
+      goto err;
+    }
+#endif
+
 #if defined(ICMP6_FILTER)
   /*
    * if the operating system has filtering capabilities for the ICMP6
@@ -392,7 +392,15 @@ void scamper_icmp_resp_handle(scamper_icmp_resp_t *resp)
   memset(&sig, 0, sizeof(sig));
   sig.sig_type = SCAMPER_TASK_SIG_TYPE_TX_IP;
   sig.sig_tx_ip_dst = &addr;
-  if((task = scamper_task_find(&sig)) != NULL)
+  if((task = scamper_task_find(&sig)) == NULL)
+    {
+      /* the probe might belong to a sweep across a prefix */
+      sig.sig_type = SCAMPER_TASK_SIG_TYPE_SWEEP;
+      sig.sig_sweep_pfx = &addr;
+      sig.sig_sweep_plen = addr.type == SCAMPER_ADDR_TYPE_IPV4 ? 32 : 128;
+      task = scamper_task_find(&sig);
+    }
+  if(task != NULL)
     scamper_task_handleicmp(task, resp);
   return;
 }
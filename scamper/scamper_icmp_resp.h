@@ -33,6 +33,13 @@
 #define SCAMPER_ICMP_RESP_FLAG_INNER_IPOPT_TS  0x08
 #define SCAMPER_ICMP_RESP_FLAG_RXERR           0x10
 
+/*
+ * the number of messages an ICMP socket will read with one call to
+ * recvmmsg, and the largest message that will be read that way.
+ */
+#define SCAMPER_ICMP_BATCH_MAX 32
+#define SCAMPER_ICMP_BATCH_LEN 9216
+
 #define SCAMPER_ICMP_RESP_IS_ECHO_REPLY(ir) ( \
  (ir->ir_af == AF_INET  && ir->ir_icmp_type == 0) || \
  (ir->ir_af == AF_INET6 && ir->ir_icmp_type == 129))
@@ -28,6 +28,7 @@
 #endif
 #include "internal.h"
 
+#include "scamper.h"
 #include "scamper_debug.h"
 #include "scamper_file.h"
 #include "scamper_privsep.h"
@@ -249,6 +250,13 @@ scamper_outfile_t *scamper_outfile_open(char *name, char *file, char *mo)
       return NULL;
     }
 
+  if(scamper_file_setzlevel(sf, scamper_option_zlevel()) != 0)
+    {
+      printerror_msg(__func__, "invalid compression level for %s", file);
+      scamper_file_close(sf);
+      return NULL;
+    }
+
   if((sof = outfile_alloc(name, sf)) == NULL)
     {
       scamper_file_close(sf);
@@ -306,6 +314,13 @@ static int outfile_opendef(char *filename, char *type)
       return -1;
     }
 
+  if(scamper_file_setzlevel(sf, scamper_option_zlevel()) != 0)
+    {
+      printerror_msg(__func__, "invalid compression level for %s", filename);
+      scamper_file_close(sf);
+      return -1;
+    }
+
   if((outfile_def = outfile_alloc(filename, sf)) == NULL)
     {
       scamper_file_close(sf);
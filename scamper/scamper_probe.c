@@ -89,8 +89,57 @@ typedef struct probe_state
  */
 #define PAD(s) ((s > 0) ? (1 + ((s - 1) | (sizeof(long) - 1)) - s) : 0)
 
+#ifdef HAVE_SENDMMSG
+/*
+ * probe_batch_t:
+ *
+ * probes that have been built and are waiting to be sent on the same
+ * socket with a single sendmmsg call.  the batch is sent when it is
+ * full, when a probe for a different socket is queued, when the first
+ * probe has been waiting PROBE_BATCH_USEC, at the end of each pass over
+ * the probe queue, or when scamper is about to wait for something to
+ * happen.  only probes with a pr_txcb are queued, so that the time each
+ * probe was actually sent, or the error, can be passed back.  the
+ * callbacks are held in the sent array until scamper_probe_txcbs is
+ * called from the main loop, so that a task is never called back while
+ * it is in the middle of sending a probe.
+ */
+#define PROBE_BATCH_MAX  64
+#define PROBE_BATCH_USEC 100
+
+typedef struct probe_sent
+{
+  void                   (*txcb)(void *, uint32_t, const struct timeval *,
+				 int);
+  void                    *param;
+  uint32_t                 id;
+  struct timeval           tx;
+  int                      error;
+} probe_sent_t;
+
+typedef struct probe_batch
+{
+  struct mmsghdr           msgs[PROBE_BATCH_MAX];
+  struct iovec             iovs[PROBE_BATCH_MAX];
+  struct sockaddr_storage  sas[PROBE_BATCH_MAX];
+  uint8_t                  cmsgs[PROBE_BATCH_MAX][CMSG_SPACE(sizeof(int))];
+  uint8_t                 *bufs[PROBE_BATCH_MAX];
+  size_t                   bufs_len[PROBE_BATCH_MAX];
+  probe_sent_t             sent[PROBE_BATCH_MAX];
+  struct timeval           tv;
+  int                      fd;
+  int                      c;
+  probe_sent_t            *done;
+  size_t                   donec;
+  size_t                   donem;
+} probe_batch_t;
+
+static probe_batch_t *batch = NULL;
+#endif
+
 static uint8_t *pktbuf = NULL;
 static size_t   pktbuf_len = 0;
+static uint32_t probe_count = 0;
 static int      ipid_dl = 0;
 static int      rawtcp = 0;
 
@@ -513,6 +562,7 @@ static int probe_dl_tx(probe_state_t *pt)
       pt->error = errno;
       return -1;
     }
+  probe_count++;
 
   pt->mode = PROBE_MODE_TX;
   return 0;
@@ -893,6 +943,223 @@ int scamper_probe_task(scamper_probe_t *pr, scamper_task_t *task)
   return -1;
 }
 
+int scamper_probe_batched(const scamper_probe_t *probe)
+{
+#ifdef HAVE_SENDMMSG
+  if(batch != NULL && probe->pr_txcb != NULL &&
+     (probe->pr_flags & SCAMPER_PROBE_FLAG_RXERR) == 0 &&
+     (probe->pr_flags & SCAMPER_PROBE_FLAG_NOBATCH) == 0)
+    return 1;
+#endif
+  return 0;
+}
+
+void scamper_probe_flush(void)
+{
+#ifdef HAVE_SENDMMSG
+  struct timeval tv;
+  int i, off = 0, rc;
+  size_t len;
+
+  if(batch == NULL || batch->c == 0)
+    return;
+
+  /* make room to record the outcome of each probe */
+  if(batch->donec + batch->c > batch->donem)
+    {
+      len = sizeof(probe_sent_t) * (batch->donec + batch->c);
+      if(realloc_wrap((void **)&batch->done, len) != 0)
+	printerror(__func__, "could not realloc done");
+      else
+	batch->donem = batch->donec + batch->c;
+    }
+
+  /*
+   * sendmmsg returns the number of messages sent before the first
+   * one that could not be sent.  report and skip that message.
+   */
+  while(off < batch->c)
+    {
+      gettimeofday_wrap(&tv);
+      if((rc = sendmmsg(batch->fd, &batch->msgs[off], batch->c-off, 0)) > 0)
+	{
+	  for(i=off; i<off+rc; i++)
+	    {
+	      timeval_cpy(&batch->sent[i].tx, &tv);
+	      batch->sent[i].error = 0;
+	    }
+	  off += rc;
+	  continue;
+	}
+      if(rc == -1 && errno == EINTR)
+	continue;
+      batch->sent[off].error = errno;
+      printerror(__func__, "could not send %d byte probe on fd %d",
+		 (int)batch->iovs[off].iov_len, batch->fd);
+      off++;
+    }
+
+  for(i=0; i<batch->c; i++)
+    {
+      if(batch->sent[i].txcb == NULL || batch->donec == batch->donem)
+	continue;
+      memcpy(&batch->done[batch->donec++], &batch->sent[i],
+	     sizeof(probe_sent_t));
+    }
+
+  batch->c = 0;
+#endif
+  return;
+}
+
+void scamper_probe_txcbs(void)
+{
+#ifdef HAVE_SENDMMSG
+  probe_sent_t *ps;
+  size_t i;
+
+  if(batch == NULL)
+    return;
+
+  /*
+   * a callback may send more probes, but only scamper_probe_flush adds
+   * to the done array, and it is not called from a callback
+   */
+  for(i=0; i<batch->donec; i++)
+    {
+      ps = &batch->done[i];
+      if(ps->txcb == NULL)
+	continue;
+      if(ps->error == 0)
+	ps->txcb(ps->param, ps->id, &ps->tx, 0);
+      else
+	ps->txcb(ps->param, ps->id, NULL, ps->error);
+    }
+  batch->donec = 0;
+#endif
+  return;
+}
+
+void scamper_probe_txcb_cancel(const void *param)
+{
+#ifdef HAVE_SENDMMSG
+  size_t i;
+
+  if(batch == NULL)
+    return;
+  for(i=0; i<(size_t)batch->c; i++)
+    if(batch->sent[i].param == param)
+      batch->sent[i].txcb = NULL;
+  for(i=0; i<batch->donec; i++)
+    if(batch->done[i].param == param)
+      batch->done[i].txcb = NULL;
+#endif
+  return;
+}
+
+#ifdef HAVE_SENDMMSG
+static ssize_t probe_batch_add(const scamper_probe_t *pr,
+			       const void *buf, size_t len,
+			       const struct sockaddr *sa, socklen_t sl)
+{
+  struct msghdr *msg;
+  struct cmsghdr *cmsg;
+  int i, hlim;
+
+  if(batch->c > 0 && (batch->fd != pr->pr_fd ||
+		      batch->c == PROBE_BATCH_MAX ||
+		      timeval_inrange_us(&pr->pr_tx, &batch->tv,
+					 PROBE_BATCH_USEC) == 0))
+    scamper_probe_flush();
+
+  i = batch->c;
+  if(batch->bufs_len[i] < len)
+    {
+      if(realloc_wrap((void **)&batch->bufs[i], len) != 0)
+	{
+	  printerror(__func__, "could not realloc");
+	  return -1;
+	}
+      batch->bufs_len[i] = len;
+    }
+  memcpy(batch->bufs[i], buf, len);
+  memcpy(&batch->sas[i], sa, sl);
+
+  batch->iovs[i].iov_base = batch->bufs[i];
+  batch->iovs[i].iov_len  = len;
+
+  msg = &batch->msgs[i].msg_hdr;
+  memset(msg, 0, sizeof(struct msghdr));
+  msg->msg_name    = &batch->sas[i];
+  msg->msg_namelen = sl;
+  msg->msg_iov     = &batch->iovs[i];
+  msg->msg_iovlen  = 1;
+
+  /*
+   * IPv6 probes cannot share a sticky hop limit set with setsockopt
+   * while they wait, so each carries its own.
+   */
+  if(sa->sa_family == AF_INET6)
+    {
+      msg->msg_control    = batch->cmsgs[i];
+      msg->msg_controllen = sizeof(batch->cmsgs[i]);
+      cmsg = CMSG_FIRSTHDR(msg);
+      cmsg->cmsg_level = IPPROTO_IPV6;
+      cmsg->cmsg_type  = IPV6_HOPLIMIT;
+      cmsg->cmsg_len   = CMSG_LEN(sizeof(int));
+      hlim = pr->pr_ip_ttl;
+      memcpy(CMSG_DATA(cmsg), &hlim, sizeof(hlim));
+    }
+
+  batch->sent[i].txcb  = pr->pr_txcb;
+  batch->sent[i].param = pr->pr_txcb_param;
+  batch->sent[i].id    = pr->pr_txcb_id;
+
+  if(i == 0)
+    {
+      batch->fd = pr->pr_fd;
+      timeval_cpy(&batch->tv, &pr->pr_tx);
+    }
+  batch->c++;
+
+  return len;
+}
+#endif
+
+/*
+ * scamper_probe_sendto
+ *
+ * called by the transport-specific routines in place of sendto, after
+ * the probe's transmit timestamp has been recorded.
+ */
+ssize_t scamper_probe_sendto(const scamper_probe_t *probe,
+			     const void *buf, size_t len,
+			     const struct sockaddr *sa, socklen_t sl)
+{
+  ssize_t rc;
+
+#ifdef HAVE_SENDMMSG
+  if(scamper_probe_batched(probe) != 0)
+    {
+      if((rc = probe_batch_add(probe, buf, len, sa, sl)) >= 0)
+	probe_count++;
+      return rc;
+    }
+
+  /* keep probes on the same socket in order */
+  if(batch != NULL && batch->c > 0 && batch->fd == probe->pr_fd)
+    scamper_probe_flush();
+#endif
+  if((rc = sendto(probe->pr_fd, buf, len, 0, sa, sl)) >= 0)
+    probe_count++;
+  return rc;
+}
+
+uint32_t scamper_probe_getcount(void)
+{
+  return probe_count;
+}
+
 /*
  * scamper_probe_send
  *
@@ -1025,6 +1292,7 @@ int scamper_probe(scamper_probe_t *probe)
       probe->pr_errno = errno;
       return -1;
     }
+  probe_count++;
 
   probe->pr_tx_raw = pktbuf + pad + probe->pr_dl_len;
   probe->pr_tx_rawlen = len - probe->pr_dl_len;
@@ -1038,11 +1306,34 @@ int scamper_probe_init(void)
     ipid_dl = 1;
   if(scamper_option_planetlab() || scamper_option_rawtcp())
     rawtcp = 1;
+#ifdef HAVE_SENDMMSG
+  if(scamper_option_txbatch() &&
+     (batch = malloc_zero(sizeof(probe_batch_t))) == NULL)
+    {
+      printerror(__func__, "could not malloc batch");
+      return -1;
+    }
+#endif
   return 0;
 }
 
 void scamper_probe_cleanup(void)
 {
+#ifdef HAVE_SENDMMSG
+  int i;
+
+  if(batch != NULL)
+    {
+      for(i=0; i<PROBE_BATCH_MAX; i++)
+	if(batch->bufs[i] != NULL)
+	  free(batch->bufs[i]);
+      if(batch->done != NULL)
+	free(batch->done);
+      free(batch);
+      batch = NULL;
+    }
+#endif
+
   if(pktbuf != NULL)
     {
       free(pktbuf);
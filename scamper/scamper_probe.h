@@ -91,6 +91,7 @@ typedef struct scamper_probe_ipopt
 #define SCAMPER_PROBE_FLAG_SPOOF      0x0004
 #define SCAMPER_PROBE_FLAG_DL         0x0008
 #define SCAMPER_PROBE_FLAG_RXERR      0x0010 /* socket is an rxerr variant */
+#define SCAMPER_PROBE_FLAG_NOBATCH    0x0020 /* send now, do not batch */
 
 #define SCAMPER_PROBE_TCPOPT_SACK     0x01
 #define SCAMPER_PROBE_TCPOPT_TS       0x02
@@ -177,6 +178,17 @@ typedef struct scamper_probe
   /* the time immediately before the call to sendto was made */
   struct timeval         pr_tx;
 
+  /*
+   * if pr_txcb is set, the probe may be queued to be sent in a batch
+   * with other probes, and pr_tx is the time it was queued.  pr_txcb is
+   * called with pr_txcb_param and pr_txcb_id once the probe is sent,
+   * with the time it was sent, or with the errno if it could not be.
+   */
+  void                 (*pr_txcb)(void *param, uint32_t id,
+				  const struct timeval *tx, int error);
+  void                  *pr_txcb_param;
+  uint32_t               pr_txcb_id;
+
   /* the actual transmitted packet, IP header and down, when datalink tx'd */
   uint8_t               *pr_tx_raw;
   uint16_t               pr_tx_rawlen;
@@ -187,6 +199,27 @@ typedef struct scamper_probe
 
 int scamper_probe(scamper_probe_t *probe);
 
+/*
+ * scamper_probe_sendto:  send a built probe on its socket, or queue it
+ *                        to be sent in a batch with other probes
+ * scamper_probe_batched: return non-zero if the probe would be batched
+ * scamper_probe_flush:   send any probes that are queued
+ * scamper_probe_txcbs:   tell the owners of probes sent in a batch when
+ *                        each was sent, or why it could not be
+ * scamper_probe_txcb_cancel: do not call back about probes queued with
+ *                        the given pr_txcb_param
+ * scamper_probe_getcount: the number of packets passed to the kernel to
+ *                        send, which wraps
+ */
+ssize_t scamper_probe_sendto(const scamper_probe_t *probe,
+			     const void *buf, size_t len,
+			     const struct sockaddr *sa, socklen_t sl);
+int scamper_probe_batched(const scamper_probe_t *probe);
+void scamper_probe_flush(void);
+void scamper_probe_txcbs(void);
+void scamper_probe_txcb_cancel(const void *param);
+uint32_t scamper_probe_getcount(void);
+
 #ifdef __SCAMPER_TASK_H
 int scamper_probe_task(scamper_probe_t *probe, scamper_task_t *task);
 #endif
@@ -34,7 +34,7 @@
 #include "scamper_debug.h"
 #include "utils.h"
 #include "mjl_list.h"
-#include "mjl_heap.h"
+#include "mjl_timewheel.h"
 
 struct scamper_queue
 {
@@ -54,16 +54,11 @@ struct scamper_queue
   scamper_queue_event_cb_t  cb;
 };
 
-static dlist_t *probe_queue = NULL;
-static heap_t  *wait_queue = NULL;
-static heap_t  *done_queue = NULL;
-static heap_t  *event_queue = NULL;
-static int      count = 0;
-
-static int queue_cmp(const scamper_queue_t *a, const scamper_queue_t *b)
-{
-  return timeval_cmp(&b->timeout, &a->timeout);
-}
+static dlist_t     *probe_queue = NULL;
+static timewheel_t *wait_queue = NULL;
+static timewheel_t *done_queue = NULL;
+static timewheel_t *event_queue = NULL;
+static int          count = 0;
 
 static void queue_onremove(void *item)
 {
@@ -87,7 +82,7 @@ static void queue_unlink(scamper_queue_t *sq)
     dlist_node_pop(sq->queue, sq->node);
   else if(sq->queue == wait_queue || sq->queue == done_queue ||
 	  sq->queue == event_queue)
-    heap_delete(sq->queue, sq->node);
+    timewheel_delete(sq->queue, sq->node);
 
   count--;
   return;
@@ -114,7 +109,7 @@ static int queue_link(scamper_queue_t *sq, void *queue)
   else
     {
       assert(queue == wait_queue || queue == done_queue);
-      node = heap_insert(queue, sq);
+      node = timewheel_insert(queue, &sq->timeout, sq);
     }
 
   /* ensure we've got a node */
@@ -136,15 +131,7 @@ static int queue_link(scamper_queue_t *sq, void *queue)
  */
 int scamper_queue_event_waittime(struct timeval *tv)
 {
-  scamper_queue_t *sq;
-
-  if((sq = (scamper_queue_t *)heap_head_item(event_queue)) != NULL)
-    {
-      timeval_cpy(tv, &sq->timeout);
-      return 1;
-    }
-
-  return 0;
+  return timewheel_head_time(event_queue, tv);
 }
 
 /*
@@ -154,14 +141,12 @@ int scamper_queue_event_waittime(struct timeval *tv)
  */
 int scamper_queue_event_proc(const struct timeval *tv)
 {
-  scamper_queue_t *sq = heap_head_item(event_queue);
+  scamper_queue_t *sq;
 
-  while(sq != NULL && timeval_cmp(tv, &sq->timeout) >= 0)
+  while((sq = timewheel_remove(event_queue, tv)) != NULL)
     {
-      heap_remove(event_queue);
       if(sq->cb(sq->un.ptr) != 0)
 	return -1;
-      sq = heap_head_item(event_queue);
     }
 
   return 0;
@@ -176,21 +161,17 @@ int scamper_queue_event_update_time(scamper_queue_t *sq,
 				    const struct timeval *tv)
 {
   assert(sq->queue == NULL || sq->queue == event_queue);
-  timeval_cpy(&sq->timeout, tv);
 
-  if(sq->queue == NULL)
-    {
-      if((sq->node = heap_insert(event_queue, sq)) == NULL)
-	{
-	  printerror(__func__, "could not add to heap");
-	  return -1;
-	}
-      sq->queue = event_queue;
-    }
-  else
+  if(sq->queue != NULL)
+    timewheel_delete(event_queue, sq->node);
+
+  timeval_cpy(&sq->timeout, tv);
+  if((sq->node = timewheel_insert(event_queue, &sq->timeout, sq)) == NULL)
     {
-      heap_remake(event_queue);
+      printerror(__func__, "could not add to event queue");
+      return -1;
     }
+  sq->queue = event_queue;
   return 0;
 }
 
@@ -221,9 +202,9 @@ scamper_queue_t *scamper_queue_event(const struct timeval *tv,
   sq->queue = event_queue;
   sq->un.ptr = ptr;
   sq->cb = cb;
-  if((sq->node = heap_insert(event_queue, sq)) == NULL)
+  if((sq->node = timewheel_insert(event_queue, &sq->timeout, sq)) == NULL)
     {
-      printerror(__func__, "could add to heap");
+      printerror(__func__, "could add to event queue");
       goto err;
     }
 
@@ -316,14 +297,21 @@ void scamper_queue_detach(scamper_queue_t *sq)
 /*
  * scamper_queue_select
  *
- * return the next task in the probe queue to deal with
+ * return the next task in the probe queue to deal with.  tasks from a
+ * source that is over its pps cap are passed over, and stay where they
+ * are in the queue.
  */
-struct scamper_task *scamper_queue_select()
+struct scamper_task *scamper_queue_select(const struct timeval *now)
 {
   scamper_queue_t *sq;
+  dlist_node_t *dn;
 
-  if((sq = dlist_head_pop(probe_queue)) != NULL)
+  for(dn = dlist_head_node(probe_queue); dn != NULL; dn = dlist_node_next(dn))
     {
+      sq = dlist_node_item(dn);
+      if(scamper_task_canprobe(sq->un.task, now) == 0)
+	continue;
+      dlist_node_pop(probe_queue, dn);
       count--;
       return sq->un.task;
     }
@@ -339,16 +327,11 @@ struct scamper_task *scamper_queue_getdone(const struct timeval *tv)
 {
   scamper_queue_t *sq;
 
-  if((sq = (scamper_queue_t *)heap_head_item(done_queue)) == NULL)
+  if((sq = timewheel_remove(done_queue, tv)) == NULL)
     return NULL;
 
-  if(timeval_cmp(tv, &sq->timeout) >= 0)
-    {
-      queue_unlink(sq);
-      return sq->un.task;
-    }
-
-  return NULL;
+  count--;
+  return sq->un.task;
 }
 
 /*
@@ -364,20 +347,20 @@ struct scamper_task *scamper_queue_getdone(const struct timeval *tv)
  */
 int scamper_queue_waittime(struct timeval *tv)
 {
-  scamper_queue_t *sq;
-  heap_t *queues[2];
+  struct timeval x;
+  timewheel_t *queues[2];
   int i, set = 0;
 
   queues[0] = wait_queue;
   queues[1] = done_queue;
 
-  for(i=(sizeof(queues)/sizeof(heap_t *))-1; i >= 0; i--)
+  for(i=(sizeof(queues)/sizeof(timewheel_t *))-1; i >= 0; i--)
     {
-      if((sq = (scamper_queue_t *)heap_head_item(queues[i])) != NULL)
+      if(timewheel_head_time(queues[i], &x) != 0)
 	{
-	  if(set == 0 || timeval_cmp(tv, &sq->timeout) > 0)
+	  if(set == 0 || timeval_cmp(tv, &x) > 0)
 	    {
-	      timeval_cpy(tv, &sq->timeout);
+	      timeval_cpy(tv, &x);
 	      set++;
 	    }
 	}
@@ -394,24 +377,23 @@ int scamper_queue_waittime(struct timeval *tv)
  * action.
  *
  * we then return the count of ready tasks, which is the count of items on
- * the probe queue.
+ * the probe queue, less those whose source is over its pps cap.
  */
 int scamper_queue_readycount()
 {
   scamper_queue_t *sq;
+  dlist_node_t *dn;
   struct timeval tv;
+  int c = 0;
 
-  if(heap_count(wait_queue) > 0)
-    {
-      gettimeofday_wrap(&tv);
+  gettimeofday_wrap(&tv);
 
+  if(timewheel_count(wait_queue) > 0)
+    {
       /* timeout any tasks on the wait queue that are due to be probed again */
-      while((sq = heap_head_item(wait_queue)) != NULL)
+      while((sq = timewheel_remove(wait_queue, &tv)) != NULL)
 	{
-	  if(timeval_cmp(&tv, &sq->timeout) < 0)
-	    break;
-
-	  queue_unlink(sq);
+	  count--;
 
 	  scamper_task_handletimeout(sq->un.task);
 
@@ -420,12 +402,19 @@ int scamper_queue_readycount()
 	}
     }
 
-  return dlist_count(probe_queue);
+  for(dn = dlist_head_node(probe_queue); dn != NULL; dn = dlist_node_next(dn))
+    {
+      sq = dlist_node_item(dn);
+      if(scamper_task_canprobe(sq->un.task, &tv) != 0)
+	c++;
+    }
+
+  return c;
 }
 
 int scamper_queue_windowcount()
 {
-  return dlist_count(probe_queue) + heap_count(wait_queue);
+  return dlist_count(probe_queue) + timewheel_count(wait_queue);
 }
 
 /*
@@ -438,7 +427,7 @@ void scamper_queue_empty()
 {
   scamper_queue_t *sq;
 
-  while((sq = (scamper_queue_t *)heap_remove(wait_queue)) != NULL)
+  while((sq = timewheel_remove(wait_queue, NULL)) != NULL)
     count--;
 
   while((sq = (scamper_queue_t *)dlist_head_pop(probe_queue)) != NULL)
@@ -472,6 +461,10 @@ void scamper_queue_free(scamper_queue_t *sq)
 
 int scamper_queue_init()
 {
+  struct timeval now;
+
+  gettimeofday_wrap(&now);
+
   if((probe_queue = dlist_alloc()) == NULL)
     {
       printerror(__func__, "could not alloc probe_queue");
@@ -479,26 +472,26 @@ int scamper_queue_init()
     }
   dlist_onremove(probe_queue, queue_onremove);
 
-  if((wait_queue = heap_alloc((heap_cmp_t)queue_cmp)) == NULL)
+  if((wait_queue = timewheel_alloc(&now)) == NULL)
     {
       printerror(__func__, "could not alloc wait_queue");
       return -1;
     }
-  heap_onremove(wait_queue, queue_onremove);
+  timewheel_onremove(wait_queue, queue_onremove);
 
-  if((done_queue = heap_alloc((heap_cmp_t)queue_cmp)) == NULL)
+  if((done_queue = timewheel_alloc(&now)) == NULL)
     {
       printerror(__func__, "could not alloc done_queue");
       return -1;
     }
-  heap_onremove(done_queue, queue_onremove);
+  timewheel_onremove(done_queue, queue_onremove);
 
-  if((event_queue = heap_alloc((heap_cmp_t)queue_cmp)) == NULL)
+  if((event_queue = timewheel_alloc(&now)) == NULL)
     {
       printerror(__func__, "could not alloc event_queue");
       return -1;
     }
-  heap_onremove(event_queue, queue_onremove);
+  timewheel_onremove(event_queue, queue_onremove);
 
   return 0;
 }
@@ -507,19 +500,19 @@ void scamper_queue_cleanup()
 {
   if(event_queue != NULL)
     {
-      heap_free(event_queue, NULL);
+      timewheel_free(event_queue, NULL);
       event_queue = NULL;
     }
 
   if(done_queue != NULL)
     {
-      heap_free(done_queue, NULL);
+      timewheel_free(done_queue, NULL);
       done_queue = NULL;
     }
 
   if(wait_queue != NULL)
     {
-      heap_free(wait_queue, NULL);
+      timewheel_free(wait_queue, NULL);
       wait_queue = NULL;
     }
 
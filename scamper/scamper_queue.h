@@ -57,7 +57,7 @@ void scamper_queue_free(scamper_queue_t *queue);
 void scamper_queue_detach(scamper_queue_t *queue);
 
 /* get the next task to do something with */
-struct scamper_task *scamper_queue_select(void);
+struct scamper_task *scamper_queue_select(const struct timeval *now);
 
 /* get the next task that is completed and ready to be written out */
 struct scamper_task *scamper_queue_getdone(const struct timeval *tv);
@@ -0,0 +1,195 @@
+/*
+ * scamper_queue_bench.c
+ *
+ * $Id$
+ *
+ * compare the cost of the operations scamper_queue makes on its wait
+ * queue when the queue is a binary heap and when it is a timing wheel.
+ * build with "make scamper_queue_bench".
+ *
+ * Copyright (C) 2026 Matthew Luckie
+ * Author: Matthew Luckie
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include "internal.h"
+
+#include "mjl_heap.h"
+#include "mjl_timewheel.h"
+#include "utils.h"
+
+typedef struct bench_item
+{
+  struct timeval  timeout;
+  void           *node;
+} bench_item_t;
+
+static bench_item_t *items = NULL;
+static int           itemc = 200000;
+static int           moves = 4;
+static int           maxwait = 5000;
+
+static int item_cmp(const bench_item_t *a, const bench_item_t *b)
+{
+  return timeval_cmp(&b->timeout, &a->timeout);
+}
+
+static void item_onremove(void *ptr)
+{
+  ((bench_item_t *)ptr)->node = NULL;
+  return;
+}
+
+static void item_timeout(bench_item_t *item, const struct timeval *now)
+{
+  timeval_add_us(&item->timeout, now, random() % (maxwait * 1000));
+  return;
+}
+
+static int bench_heap(const struct timeval *start, int *elapsed, int *done)
+{
+  struct timeval now, t0, t1;
+  bench_item_t *item;
+  heap_t *heap;
+  int i, j;
+
+  if((heap = heap_alloc((heap_cmp_t)item_cmp)) == NULL)
+    return -1;
+  heap_onremove(heap, item_onremove);
+
+  gettimeofday_wrap(&t0);
+  timeval_cpy(&now, start);
+  for(i=0; i<itemc; i++)
+    {
+      item_timeout(&items[i], &now);
+      if((items[i].node = heap_insert(heap, &items[i])) == NULL)
+	return -1;
+    }
+
+  /* reschedule each item a few times, as tasks waiting for replies do */
+  for(j=0; j<moves; j++)
+    {
+      for(i=0; i<itemc; i++)
+	{
+	  heap_delete(heap, items[i].node);
+	  item_timeout(&items[i], &now);
+	  if((items[i].node = heap_insert(heap, &items[i])) == NULL)
+	    return -1;
+	}
+    }
+
+  /* advance the clock one millisecond at a time until the heap drains */
+  while(heap_count(heap) > 0)
+    {
+      while((item = heap_head_item(heap)) != NULL &&
+	    timeval_cmp(&now, &item->timeout) >= 0)
+	{
+	  heap_remove(heap);
+	  (*done)++;
+	}
+      timeval_add_ms(&now, &now, 1);
+    }
+  gettimeofday_wrap(&t1);
+
+  *elapsed = timeval_diff_ms(&t1, &t0);
+  heap_free(heap, NULL);
+  return 0;
+}
+
+static int bench_timewheel(const struct timeval *start, int *elapsed,
+			   int *done)
+{
+  struct timeval now, t0, t1;
+  timewheel_t *tw;
+  int i, j;
+
+  if((tw = timewheel_alloc(start)) == NULL)
+    return -1;
+  timewheel_onremove(tw, item_onremove);
+
+  gettimeofday_wrap(&t0);
+  timeval_cpy(&now, start);
+  for(i=0; i<itemc; i++)
+    {
+      item_timeout(&items[i], &now);
+      if((items[i].node = timewheel_insert(tw, &items[i].timeout,
+					   &items[i])) == NULL)
+	return -1;
+    }
+
+  for(j=0; j<moves; j++)
+    {
+      for(i=0; i<itemc; i++)
+	{
+	  timewheel_delete(tw, items[i].node);
+	  item_timeout(&items[i], &now);
+	  if((items[i].node = timewheel_insert(tw, &items[i].timeout,
+					       &items[i])) == NULL)
+	    return -1;
+	}
+    }
+
+  while(timewheel_count(tw) > 0)
+    {
+      while(timewheel_remove(tw, &now) != NULL)
+	(*done)++;
+      timeval_add_ms(&now, &now, 1);
+    }
+  gettimeofday_wrap(&t1);
+
+  *elapsed = timeval_diff_ms(&t1, &t0);
+  timewheel_free(tw, NULL);
+  return 0;
+}
+
+int main(int argc, char *argv[])
+{
+  struct timeval start;
+  int heap_ms, heap_done = 0, tw_ms, tw_done = 0;
+
+  if(argc > 1 && (itemc = atoi(argv[1])) < 1)
+    {
+      fprintf(stderr, "usage: scamper_queue_bench [items [moves [maxwait]]]\n");
+      return -1;
+    }
+  if(argc > 2)
+    moves = atoi(argv[2]);
+  if(argc > 3 && (maxwait = atoi(argv[3])) < 1)
+    maxwait = 1;
+
+  if((items = malloc_zero(sizeof(bench_item_t) * itemc)) == NULL)
+    return -1;
+
+  gettimeofday_wrap(&start);
+
+  srandom(1);
+  if(bench_heap(&start, &heap_ms, &heap_done) != 0)
+    return -1;
+
+  srandom(1);
+  if(bench_timewheel(&start, &tw_ms, &tw_done) != 0)
+    return -1;
+
+  printf("items %d, moves %d, maxwait %dms\n", itemc, moves, maxwait);
+  printf("heap:      %d ms, %d removed\n", heap_ms, heap_done);
+  printf("timewheel: %d ms, %d removed\n", tw_ms, tw_done);
+
+  free(items);
+  return 0;
+}
@@ -0,0 +1,653 @@
+/*
+ * scamper_shard.c
+ *
+ * $Id$
+ *
+ * Copyright (C) 2026 Matthew Luckie
+ * Author: Matthew Luckie
+ *
+ * scamper keeps the state of the tasks it is probing in structures that
+ * are private to a single event loop.  to use more than one CPU, scamper
+ * forks a number of shards, each of which runs its own event loop with
+ * its own sockets, queues, and task signatures.  every shard reads the
+ * same input, and keeps the tasks whose signature hashes to it, so that
+ * tasks that could see each other's responses are in the same shard.
+ * the shards share the packets per second and window budgets through a
+ * small piece of shared memory, and write their results in warts format
+ * to a pipe read by the parent, which writes them out as requested.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include "internal.h"
+
+#include "scamper.h"
+#include "scamper_debug.h"
+#include "scamper_addr.h"
+#include "scamper_list.h"
+#include "scamper_file.h"
+#include "scamper_task.h"
+#include "scamper_shard.h"
+#include "trace/scamper_trace.h"
+#include "ping/scamper_ping.h"
+#include "tracelb/scamper_tracelb.h"
+#include "dealias/scamper_dealias.h"
+#include "neighbourdisc/scamper_neighbourdisc.h"
+#include "tbit/scamper_tbit.h"
+#include "sting/scamper_sting.h"
+#include "sniff/scamper_sniff.h"
+#include "host/scamper_host.h"
+
+#include "mjl_list.h"
+#include "utils.h"
+
+/* microseconds to wait before looking for a free slot in the window */
+#define SHARD_WINDOW_RETRY 10000
+
+#if defined(MAP_ANON) && !defined(MAP_ANONYMOUS)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+/*
+ * shard_budget
+ *
+ * the budgets shared between the shards.  next is the earliest time, in
+ * microseconds, that any shard may send its next probe.  active is the
+ * number of tasks in the window across all shards, and held records how
+ * many of those each shard holds, so the parent can return the slots of
+ * a shard that exits without doing so itself.
+ */
+typedef struct shard_budget
+{
+  uint64_t         next;
+  int              active;
+  int              held[SCAMPER_SHARD_MAX];
+} shard_budget_t;
+
+typedef struct shard_child
+{
+  pid_t            pid;
+  int              fd;
+  scamper_file_t  *file;
+} shard_child_t;
+
+/*
+ * shard_cycle
+ *
+ * each shard writes a start and stop record for each cycle.  the parent
+ * writes the first start record it sees, and the last stop record once
+ * all shards have finished the cycle.
+ */
+typedef struct shard_cycle
+{
+  uint32_t         list_id;
+  uint32_t         cycle_id;
+  scamper_cycle_t *stop;
+  int              stops;
+  dlist_node_t    *node;
+} shard_cycle_t;
+
+static shard_budget_t *budget       = NULL;
+static shard_child_t  *children     = NULL;
+static int             shardc       = 0;
+static int             shard_id     = -1;
+static int             wait_us      = 0;
+static int             window_us    = 0;
+static int             window_max   = 0;
+static uint64_t        pps_claim    = 0;
+
+static uint64_t tv_to_us(const struct timeval *tv)
+{
+  return ((uint64_t)tv->tv_sec * 1000000) + tv->tv_usec;
+}
+
+static void us_to_tv(struct timeval *tv, uint64_t us)
+{
+  tv->tv_sec  = us / 1000000;
+  tv->tv_usec = us % 1000000;
+  return;
+}
+
+/*
+ * scamper_shard_task
+ *
+ * return non-zero if the task is to be probed by this shard.  a task
+ * with more than one signature (e.g. dealias) is always probed by the
+ * first shard, so that it is held back by any other such task whose
+ * signatures it overlaps.
+ */
+int scamper_shard_task(const scamper_task_t *task)
+{
+  if(shard_id < 0)
+    return 1;
+  if(scamper_task_sig_count(task) > 1)
+    return shard_id == 0 ? 1 : 0;
+  if((int)(scamper_task_sig_hash(task) % shardc) == shard_id)
+    return 1;
+  return 0;
+}
+
+/*
+ * scamper_shard_pps_take
+ *
+ * claim the next slot in the shared packets per second budget.  if the
+ * slot is not due yet, set lastprobe so that this shard will try again
+ * when it is.
+ */
+int scamper_shard_pps_take(const struct timeval *now,
+			   struct timeval *lastprobe)
+{
+  uint64_t n, cur, base;
+
+  if(shard_id < 0 || wait_us == 0)
+    return 0;
+
+  n = tv_to_us(now);
+  for(;;)
+    {
+      cur = base = budget->next;
+
+      /* do not let the shards burst more than the probe window */
+      if(base + window_us < n)
+	base = n - window_us;
+
+      if(base > n)
+	{
+	  us_to_tv(lastprobe, base - wait_us);
+	  return -1;
+	}
+
+      if(__sync_bool_compare_and_swap(&budget->next, cur, base + wait_us))
+	break;
+    }
+
+  pps_claim = base;
+  return 0;
+}
+
+/*
+ * scamper_shard_pps_give
+ *
+ * give back the slot just claimed because there was nothing to probe.
+ * if another shard has since claimed a later slot, leave it alone.
+ */
+void scamper_shard_pps_give(void)
+{
+  if(shard_id < 0 || wait_us == 0)
+    return;
+  __sync_bool_compare_and_swap(&budget->next, pps_claim+wait_us, pps_claim);
+  return;
+}
+
+/*
+ * scamper_shard_window_take
+ *
+ * claim a slot in the shared window.  if the other shards hold all of
+ * the slots, this shard will not hear when one is freed, so set
+ * lastprobe so that it tries again a little later.
+ */
+int scamper_shard_window_take(const struct timeval *now,
+			      struct timeval *lastprobe)
+{
+  int cur;
+
+  if(shard_id < 0 || window_max == 0)
+    return 0;
+
+  for(;;)
+    {
+      if((cur = budget->active) >= window_max)
+	{
+	  us_to_tv(lastprobe, tv_to_us(now) + SHARD_WINDOW_RETRY - wait_us);
+	  return -1;
+	}
+      if(__sync_bool_compare_and_swap(&budget->active, cur, cur + 1))
+	break;
+    }
+
+  budget->held[shard_id]++;
+  return 0;
+}
+
+void scamper_shard_window_give(void)
+{
+  if(shard_id < 0 || window_max == 0)
+    return;
+  __sync_fetch_and_sub(&budget->active, 1);
+  budget->held[shard_id]--;
+  return;
+}
+
+/*
+ * scamper_shard_window_sync
+ *
+ * update the number of slots this shard holds in the shared window with
+ * the number of tasks it has in its queues.
+ */
+void scamper_shard_window_sync(int count)
+{
+  int held;
+
+  if(shard_id < 0 || window_max == 0)
+    return;
+  if((held = budget->held[shard_id]) == count)
+    return;
+  __sync_fetch_and_add(&budget->active, count - held);
+  budget->held[shard_id] = count;
+  return;
+}
+
+static void shard_obj_free(uint16_t type, void *data)
+{
+  switch(type)
+    {
+    case SCAMPER_FILE_OBJ_CYCLE_START:
+    case SCAMPER_FILE_OBJ_CYCLE_STOP:
+      scamper_cycle_free(data);
+      break;
+
+    case SCAMPER_FILE_OBJ_TRACE:
+      scamper_trace_free(data);
+      break;
+
+    case SCAMPER_FILE_OBJ_PING:
+      scamper_ping_free(data);
+      break;
+
+    case SCAMPER_FILE_OBJ_TRACELB:
+      scamper_tracelb_free(data);
+      break;
+
+    case SCAMPER_FILE_OBJ_DEALIAS:
+      scamper_dealias_free(data);
+      break;
+
+    case SCAMPER_FILE_OBJ_NEIGHBOURDISC:
+      scamper_neighbourdisc_free(data);
+      break;
+
+    case SCAMPER_FILE_OBJ_TBIT:
+      scamper_tbit_free(data);
+      break;
+
+    case SCAMPER_FILE_OBJ_STING:
+      scamper_sting_free(data);
+      break;
+
+    case SCAMPER_FILE_OBJ_SNIFF:
+      scamper_sniff_free(data);
+      break;
+
+    case SCAMPER_FILE_OBJ_HOST:
+      scamper_host_free(data);
+      break;
+    }
+
+  return;
+}
+
+static shard_cycle_t *shard_cycle_get(dlist_t *list, scamper_cycle_t *cycle)
+{
+  shard_cycle_t *sc;
+  dlist_node_t *dn;
+
+  for(dn=dlist_head_node(list); dn != NULL; dn=dlist_node_next(dn))
+    {
+      sc = dlist_node_item(dn);
+      if(sc->list_id == cycle->list->id && sc->cycle_id == cycle->id)
+	return sc;
+    }
+
+  if((sc = malloc_zero(sizeof(shard_cycle_t))) == NULL)
+    return NULL;
+  sc->list_id = cycle->list->id;
+  sc->cycle_id = cycle->id;
+  if((sc->node = dlist_tail_push(list, sc)) == NULL)
+    {
+      free(sc);
+      return NULL;
+    }
+  sc->stops = -1;
+  return sc;
+}
+
+static void shard_cycle_free(shard_cycle_t *sc)
+{
+  if(sc->stop != NULL)
+    scamper_cycle_free(sc->stop);
+  free(sc);
+  return;
+}
+
+/*
+ * shard_obj_write
+ *
+ * write an object read from a shard to the output file.  returns one if
+ * the object was kept by the cycle state, so should not be freed.
+ */
+static int shard_obj_write(scamper_file_t *out, dlist_t *cycles,
+			   uint16_t type, void *data)
+{
+  shard_cycle_t *sc;
+
+  if(type != SCAMPER_FILE_OBJ_CYCLE_START &&
+     type != SCAMPER_FILE_OBJ_CYCLE_STOP)
+    {
+      scamper_file_write_obj(out, type, data);
+      return 0;
+    }
+
+  if((sc = shard_cycle_get(cycles, data)) == NULL)
+    return 0;
+
+  /* a new cycle is started with the first start record */
+  if(sc->stops == -1)
+    {
+      sc->stops = 0;
+      if(type == SCAMPER_FILE_OBJ_CYCLE_START)
+	scamper_file_write_obj(out, type, data);
+    }
+  if(type == SCAMPER_FILE_OBJ_CYCLE_START)
+    return 0;
+
+  /* keep the latest stop record until all shards have stopped */
+  if(sc->stop != NULL)
+    scamper_cycle_free(sc->stop);
+  sc->stop = data;
+  if(++sc->stops == shardc)
+    {
+      scamper_file_write_obj(out, type, sc->stop);
+      dlist_node_pop(cycles, sc->node);
+      shard_cycle_free(sc);
+    }
+  return 1;
+}
+
+int scamper_shard_merge(char *outfile, char *outtype)
+{
+  uint16_t types[] = {
+    SCAMPER_FILE_OBJ_CYCLE_START,
+    SCAMPER_FILE_OBJ_CYCLE_STOP,
+    SCAMPER_FILE_OBJ_TRACE,
+    SCAMPER_FILE_OBJ_PING,
+    SCAMPER_FILE_OBJ_TRACELB,
+    SCAMPER_FILE_OBJ_DEALIAS,
+    SCAMPER_FILE_OBJ_NEIGHBOURDISC,
+    SCAMPER_FILE_OBJ_TBIT,
+    SCAMPER_FILE_OBJ_STING,
+    SCAMPER_FILE_OBJ_SNIFF,
+    SCAMPER_FILE_OBJ_HOST,
+  };
+  uint16_t typec = sizeof(types) / sizeof(uint16_t);
+  scamper_file_filter_t *filter = NULL;
+  scamper_file_t *out = NULL;
+  struct pollfd *pfds = NULL;
+  dlist_t *cycles = NULL;
+  shard_cycle_t *sc;
+  shard_child_t *child;
+  uint16_t type;
+  void *data;
+  int i, j, x, live, status, rc = -1;
+
+  if((filter = scamper_file_filter_alloc(types, typec)) == NULL ||
+     (cycles = dlist_alloc()) == NULL ||
+     (pfds = malloc_zero(sizeof(struct pollfd) * shardc)) == NULL)
+    {
+      printerror(__func__, "could not alloc merge state");
+      goto done;
+    }
+
+  if(string_isdash(outfile) != 0)
+    out = scamper_file_openfd(STDOUT_FILENO, "-", 'w', outtype);
+  else
+    out = scamper_file_open(outfile, 'w', outtype);
+  if(out == NULL)
+    {
+      printerror(__func__, "could not open %s", outfile);
+      goto done;
+    }
+  if(scamper_file_setzlevel(out, scamper_option_zlevel()) != 0)
+    {
+      printerror_msg(__func__, "invalid compression level for %s", outfile);
+      goto done;
+    }
+
+  for(i=0; i<shardc; i++)
+    {
+      child = &children[i];
+      child->file = scamper_file_openfd(child->fd, NULL, 'r', "warts");
+      if(child->file == NULL || fcntl_set(child->fd, O_NONBLOCK) != 0)
+	{
+	  printerror(__func__, "could not open shard %d", i);
+	  goto done;
+	}
+    }
+
+  live = shardc;
+  while(live > 0)
+    {
+      j = 0;
+      for(i=0; i<shardc; i++)
+	{
+	  if(children[i].file == NULL)
+	    continue;
+	  pfds[j].fd = children[i].fd;
+	  pfds[j].events = POLLIN;
+	  pfds[j].revents = 0;
+	  j++;
+	}
+
+      if(poll(pfds, j, -1) < 0)
+	{
+	  if(errno == EINTR)
+	    continue;
+	  printerror(__func__, "could not poll");
+	  goto done;
+	}
+
+      j = 0;
+      for(i=0; i<shardc; i++)
+	{
+	  child = &children[i];
+	  if(child->file == NULL)
+	    continue;
+	  if(pfds[j++].revents == 0)
+	    continue;
+
+	  if((x = scamper_file_read(child->file, filter, &type, &data)) == 0 &&
+	     data != NULL)
+	    {
+	      if(shard_obj_write(out, cycles, type, data) == 0)
+		shard_obj_free(type, data);
+	      continue;
+	    }
+
+	  /* the pipe has only part of a record so far */
+	  if(x == 0 && scamper_file_geteof(child->file) == 0)
+	    continue;
+
+	  /* the shard has finished, or its output could not be read */
+	  scamper_file_close(child->file);
+	  child->file = NULL;
+	  child->fd = -1;
+	  live--;
+
+	  /* return any window slots the shard did not */
+	  if(budget->held[i] != 0)
+	    {
+	      __sync_fetch_and_sub(&budget->active, budget->held[i]);
+	      budget->held[i] = 0;
+	    }
+	}
+    }
+
+  /* write stop records for cycles that did not stop in every shard */
+  while((sc = dlist_head_pop(cycles)) != NULL)
+    {
+      if(sc->stop != NULL)
+	scamper_file_write_obj(out, SCAMPER_FILE_OBJ_CYCLE_STOP, sc->stop);
+      shard_cycle_free(sc);
+    }
+
+  rc = 0;
+  for(i=0; i<shardc; i++)
+    {
+      if(waitpid(children[i].pid, &status, 0) == -1)
+	{
+	  printerror(__func__, "could not waitpid shard %d", i);
+	  rc = -1;
+	}
+      else if(WIFEXITED(status) == 0 || WEXITSTATUS(status) != 0)
+	{
+	  printerror_msg(__func__, "shard %d did not exit cleanly", i);
+	  rc = -1;
+	}
+      children[i].pid = -1;
+    }
+
+ done:
+  if(cycles != NULL) dlist_free_cb(cycles, (dlist_free_t)shard_cycle_free);
+  if(filter != NULL) scamper_file_filter_free(filter);
+  if(out != NULL) scamper_file_close(out);
+  if(pfds != NULL) free(pfds);
+  return rc;
+}
+
+int scamper_shard_fork(int c, int wait_between, int probe_window,
+		       int window, int *shard)
+{
+  struct sigaction si_sa, si_chld;
+  struct timeval now;
+  int fds[2];
+  pid_t pid;
+  int i, j;
+
+  *shard = -1;
+  budget = mmap(NULL, sizeof(shard_budget_t), PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if(budget == MAP_FAILED)
+    {
+      printerror(__func__, "could not mmap budget");
+      budget = NULL;
+      return -1;
+    }
+  memset(budget, 0, sizeof(shard_budget_t));
+  gettimeofday_wrap(&now);
+  budget->next = tv_to_us(&now);
+
+  if((children = malloc_zero(sizeof(shard_child_t) * c)) == NULL)
+    {
+      printerror(__func__, "could not alloc children");
+      return -1;
+    }
+  shardc     = c;
+  wait_us    = wait_between;
+  window_us  = probe_window;
+  window_max = window;
+
+  for(i=0; i<shardc; i++)
+    {
+      children[i].pid = -1;
+      children[i].fd = -1;
+    }
+
+  /*
+   * the parent waits for the shards itself, so stop the SIGCHLD handler
+   * from reaping them.  the shards put the handler back.
+   */
+  sigemptyset(&si_sa.sa_mask);
+  si_sa.sa_flags   = 0;
+  si_sa.sa_handler = SIG_DFL;
+  if(sigaction(SIGCHLD, &si_sa, &si_chld) == -1)
+    {
+      printerror(__func__, "could not set sigaction for SIGCHLD");
+      return -1;
+    }
+
+  /* make sure output buffered before the fork is not written twice */
+  fflush(stdout);
+  fflush(stderr);
+
+  for(i=0; i<shardc; i++)
+    {
+      if(pipe(fds) != 0)
+	{
+	  printerror(__func__, "could not pipe");
+	  return -1;
+	}
+
+      if((pid = fork()) == -1)
+	{
+	  printerror(__func__, "could not fork");
+	  close(fds[0]); close(fds[1]);
+	  return -1;
+	}
+
+      if(pid == 0)
+	{
+	  /* the shard writes its results to the pipe in place of stdout */
+	  close(fds[0]);
+	  for(j=0; j<i; j++)
+	    close(children[j].fd);
+	  if(dup2(fds[1], STDOUT_FILENO) == -1)
+	    {
+	      printerror(__func__, "could not dup2");
+	      _exit(-1);
+	    }
+	  close(fds[1]);
+	  sigaction(SIGCHLD, &si_chld, NULL);
+	  free(children);
+	  children = NULL;
+	  shard_id = i;
+	  *shard = i;
+	  return 0;
+	}
+
+      close(fds[1]);
+      children[i].pid = pid;
+      children[i].fd = fds[0];
+    }
+
+  return 0;
+}
+
+void scamper_shard_cleanup(void)
+{
+  int i;
+
+  if(children != NULL)
+    {
+      for(i=0; i<shardc; i++)
+	{
+	  if(children[i].file != NULL)
+	    scamper_file_close(children[i].file);
+	  else if(children[i].fd != -1)
+	    close(children[i].fd);
+	}
+      free(children);
+      children = NULL;
+    }
+
+  if(budget != NULL)
+    {
+      munmap(budget, sizeof(shard_budget_t));
+      budget = NULL;
+    }
+
+  return;
+}
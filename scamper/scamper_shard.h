@@ -0,0 +1,65 @@
+/*
+ * scamper_shard.h
+ *
+ * $Id$
+ *
+ * Copyright (C) 2026 Matthew Luckie
+ * Author: Matthew Luckie
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __SCAMPER_SHARD_H
+#define __SCAMPER_SHARD_H
+
+#define SCAMPER_SHARD_MIN 2
+#define SCAMPER_SHARD_MAX 64
+
+/*
+ * scamper_shard_fork
+ *
+ * fork shardc copies of scamper, each of which will probe the tasks
+ * whose signatures hash to it.  each shard shares the packets per
+ * second and window budgets with the others.  *shard is set to the
+ * index of the shard in the child, and -1 in the parent.
+ */
+int scamper_shard_fork(int shardc, int wait_between, int probe_window,
+		       int window, int *shard);
+
+/*
+ * scamper_shard_merge
+ *
+ * called by the parent to read the warts records written by each shard,
+ * and write them to the output file in the requested format.
+ */
+int scamper_shard_merge(char *outfile, char *outtype);
+
+/* returns non-zero if the task should be probed by this shard */
+int scamper_shard_task(const scamper_task_t *task);
+
+/* claim, and give back, a slot in the shared packets per second budget */
+int scamper_shard_pps_take(const struct timeval *now,
+			   struct timeval *lastprobe);
+void scamper_shard_pps_give(void);
+
+/* claim, give back, and update the slots this shard holds in the window */
+int scamper_shard_window_take(const struct timeval *now,
+			      struct timeval *lastprobe);
+void scamper_shard_window_give(void);
+void scamper_shard_window_sync(int count);
+
+void scamper_shard_cleanup(void);
+
+#endif /* __SCAMPER_SHARD_H */
@@ -0,0 +1,206 @@
+/*
+ * scamper_slab.c
+ *
+ * $Id$
+ *
+ * Copyright (C) 2026 Matthew Luckie
+ * Author: Matthew Luckie
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include "internal.h"
+
+#include "scamper_slab.h"
+#include "utils.h"
+
+/* size of each chunk that objects are carved from */
+#define SLAB_CHUNK_SIZE 16384
+
+/* objects are aligned to this boundary within a chunk */
+#define SLAB_ALIGN      16
+
+struct scamper_slab
+{
+  scamper_slab_t **ref;      /* the static pointer held by the type */
+  size_t           size;     /* size of each object */
+  size_t           per;      /* number of objects in each chunk */
+  void            *free;     /* list of objects returned to the slab */
+  uint8_t         *next;     /* next object to carve from the chunk */
+  size_t           left;     /* number of objects left in the chunk */
+  void           **chunks;   /* chunks allocated */
+  int              chunkc;
+};
+
+static scamper_slab_t **slabs   = NULL;
+static int              slabc   = 0;
+static int              enabled = 0;
+static uint64_t         gets    = 0;
+static uint64_t         mallocs = 0;
+
+static scamper_slab_t *slab_alloc(scamper_slab_t **ref, size_t size)
+{
+  scamper_slab_t *slab;
+  size_t len;
+
+  if((slab = malloc_zero(sizeof(scamper_slab_t))) == NULL)
+    return NULL;
+
+  if(size < sizeof(void *))
+    size = sizeof(void *);
+  slab->size = ((size + SLAB_ALIGN - 1) / SLAB_ALIGN) * SLAB_ALIGN;
+  if((slab->per = SLAB_CHUNK_SIZE / slab->size) < 16)
+    slab->per = 16;
+  slab->ref = ref;
+
+  len = sizeof(scamper_slab_t *) * (slabc + 1);
+  if(realloc_wrap((void **)&slabs, len) != 0)
+    {
+      free(slab);
+      return NULL;
+    }
+  slabs[slabc++] = slab;
+  *ref = slab;
+
+  return slab;
+}
+
+static void slab_free(scamper_slab_t *slab)
+{
+  int i;
+  for(i=0; i<slab->chunkc; i++)
+    free(slab->chunks[i]);
+  if(slab->chunks != NULL)
+    free(slab->chunks);
+  *slab->ref = NULL;
+  free(slab);
+  return;
+}
+
+static int slab_refill(scamper_slab_t *slab)
+{
+  size_t len = sizeof(void *) * (slab->chunkc + 1);
+  uint8_t *chunk;
+
+  if(realloc_wrap((void **)&slab->chunks, len) != 0 ||
+     (chunk = malloc(slab->size * slab->per)) == NULL)
+    return -1;
+  mallocs++;
+
+  slab->chunks[slab->chunkc++] = chunk;
+  slab->next = chunk;
+  slab->left = slab->per;
+  return 0;
+}
+
+/*
+ * scamper_slab_get
+ *
+ * return a zeroed object of the given size from the slab, allocating
+ * the slab if this is the first object the caller has asked for.
+ */
+void *scamper_slab_get(scamper_slab_t **ref, size_t size)
+{
+  scamper_slab_t *slab;
+  void *ptr;
+
+  gets++;
+
+  if(enabled == 0)
+    {
+      mallocs++;
+      return malloc_zero(size);
+    }
+
+  if((slab = *ref) == NULL && (slab = slab_alloc(ref, size)) == NULL)
+    return NULL;
+
+  assert(size <= slab->size);
+
+  if(slab->free != NULL)
+    {
+      ptr = slab->free;
+      slab->free = *((void **)ptr);
+    }
+  else
+    {
+      if(slab->left == 0 && slab_refill(slab) != 0)
+	return NULL;
+      ptr = slab->next;
+      slab->next += slab->size;
+      slab->left--;
+    }
+
+  memset(ptr, 0, size);
+  return ptr;
+}
+
+/*
+ * scamper_slab_put
+ *
+ * return an object to its slab.  objects allocated before slabs were
+ * enabled are freed if the slab does not exist yet, and are otherwise
+ * kept on the free list like any other.
+ */
+void scamper_slab_put(scamper_slab_t **ref, void *ptr)
+{
+  scamper_slab_t *slab;
+
+  if(ptr == NULL)
+    return;
+
+  if(enabled == 0 || (slab = *ref) == NULL)
+    {
+      free(ptr);
+      return;
+    }
+
+  *((void **)ptr) = slab->free;
+  slab->free = ptr;
+  return;
+}
+
+void scamper_slab_counts(uint64_t *g, uint64_t *m)
+{
+  if(g != NULL) *g = gets;
+  if(m != NULL) *m = mallocs;
+  return;
+}
+
+void scamper_slab_enable(void)
+{
+  enabled = 1;
+  return;
+}
+
+void scamper_slab_cleanup(void)
+{
+  int i;
+
+  for(i=0; i<slabc; i++)
+    slab_free(slabs[i]);
+  if(slabs != NULL)
+    {
+      free(slabs);
+      slabs = NULL;
+    }
+  slabc = 0;
+  enabled = 0;
+
+  return;
+}
@@ -0,0 +1,49 @@
+/*
+ * scamper_slab.h
+ *
+ * $Id$
+ *
+ * Copyright (C) 2026 Matthew Luckie
+ * Author: Matthew Luckie
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __SCAMPER_SLAB_H
+#define __SCAMPER_SLAB_H
+
+/*
+ * a slab hands out fixed-size objects carved from large chunks, and
+ * keeps objects that are returned on a free list for the next caller.
+ * each type that uses a slab keeps a static pointer to it, which is
+ * allocated the first time an object is needed.
+ *
+ * slabs are not used until scamper_slab_enable is called, as they are
+ * not safe to share between threads; until then, objects are
+ * allocated with malloc and returned with free.  memory held by slabs
+ * is only returned to the system by scamper_slab_cleanup.
+ */
+typedef struct scamper_slab scamper_slab_t;
+
+void *scamper_slab_get(scamper_slab_t **slab, size_t size);
+void scamper_slab_put(scamper_slab_t **slab, void *ptr);
+
+void scamper_slab_enable(void);
+void scamper_slab_cleanup(void);
+
+/* number of objects handed out, and number of calls to malloc made */
+void scamper_slab_counts(uint64_t *gets, uint64_t *mallocs);
+
+#endif /* __SCAMPER_SLAB_H */
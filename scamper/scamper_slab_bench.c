@@ -0,0 +1,226 @@
+/*
+ * scamper_slab_bench.c
+ *
+ * $Id$
+ *
+ * compare the number of calls to malloc, and the time taken, when the
+ * hops and replies that measurements record for each response are
+ * allocated with malloc and when they are recycled through slabs.
+ * a window of measurements is kept in flight, each adding one response
+ * per round and freeing everything it holds when it completes, as
+ * scamper's tasks do.  build with "make scamper_slab_bench".
+ *
+ * Copyright (C) 2026 Matthew Luckie
+ * Author: Matthew Luckie
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include "internal.h"
+
+#include "scamper_addr.h"
+#include "scamper_list.h"
+#include "scamper_icmpext.h"
+#include "scamper_slab.h"
+#include "trace/scamper_trace.h"
+#include "ping/scamper_ping.h"
+#include "tracelb/scamper_tracelb.h"
+#include "dealias/scamper_dealias.h"
+#include "utils.h"
+
+/*
+ * bench_meas
+ *
+ * one measurement in flight: the type of object it records for each
+ * response, and the objects recorded so far.
+ */
+typedef struct bench_meas
+{
+  int    type;
+  void **objs;
+  int    objc;
+} bench_meas_t;
+
+static bench_meas_t *meas = NULL;
+static int           window = 1000;
+static int           responses = 30;
+static int           total = 2000000;
+
+static void *obj_alloc(int type, uint32_t i)
+{
+  scamper_trace_hop_t *hop;
+  scamper_ping_reply_t *reply;
+  scamper_dealias_reply_t *dr;
+  scamper_tracelb_reply_t *tr;
+  scamper_addr_t *sa;
+  struct in_addr in;
+
+  in.s_addr = htonl(i);
+  if((sa = scamper_addr_alloc(SCAMPER_ADDR_TYPE_IPV4, &in)) == NULL)
+    return NULL;
+
+  switch(type)
+    {
+    case 0:
+      if((hop = scamper_trace_hop_alloc()) == NULL)
+	break;
+      hop->hop_addr = sa;
+      return hop;
+
+    case 1:
+      if((reply = scamper_ping_reply_alloc()) == NULL)
+	break;
+      reply->addr = sa;
+      return reply;
+
+    case 2:
+      tr = scamper_tracelb_reply_alloc(sa);
+      scamper_addr_free(sa);
+      return tr;
+
+    case 3:
+      if((dr = scamper_dealias_reply_alloc()) == NULL)
+	break;
+      dr->src = sa;
+      return dr;
+    }
+
+  scamper_addr_free(sa);
+  return NULL;
+}
+
+static void obj_free(int type, void *obj)
+{
+  switch(type)
+    {
+    case 0: scamper_trace_hop_free(obj); break;
+    case 1: scamper_ping_reply_free(obj); break;
+    case 2: scamper_tracelb_reply_free(obj); break;
+    case 3: scamper_dealias_reply_free(obj); break;
+    }
+  return;
+}
+
+static void meas_empty(bench_meas_t *m)
+{
+  int i;
+  for(i=0; i<m->objc; i++)
+    obj_free(m->type, m->objs[i]);
+  m->objc = 0;
+  return;
+}
+
+static int bench(int *elapsed, uint64_t *gets, uint64_t *mallocs)
+{
+  struct timeval t0, t1;
+  uint64_t g0, m0, g1, m1;
+  bench_meas_t *m;
+  int i, done = 0;
+  void *obj;
+
+  scamper_slab_counts(&g0, &m0);
+  gettimeofday_wrap(&t0);
+
+  while(done < total)
+    {
+      for(i=0; i<window && done < total; i++)
+	{
+	  m = &meas[i];
+	  if((obj = obj_alloc(m->type, random())) == NULL)
+	    return -1;
+	  m->objs[m->objc++] = obj;
+	  done++;
+
+	  /* the measurement is complete: free what it collected */
+	  if(m->objc == m->type + responses - (i % responses) / 2)
+	    {
+	      meas_empty(m);
+	      m->type = (m->type + 1) % 4;
+	    }
+	}
+    }
+
+  for(i=0; i<window; i++)
+    meas_empty(&meas[i]);
+
+  gettimeofday_wrap(&t1);
+  scamper_slab_counts(&g1, &m1);
+
+  *elapsed = timeval_diff_ms(&t1, &t0);
+  *gets = g1 - g0;
+  *mallocs = m1 - m0;
+  return 0;
+}
+
+static void report(const char *name, int ms, uint64_t gets, uint64_t mallocs)
+{
+  printf("%-7s %d ms, %llu objects, %llu mallocs, "
+	 "%.6f mallocs per response\n",
+	 name, ms, (unsigned long long)gets, (unsigned long long)mallocs,
+	 gets > 0 ? (double)mallocs / gets : 0.0);
+  return;
+}
+
+int main(int argc, char *argv[])
+{
+  uint64_t malloc_gets, malloc_mallocs, slab_gets, slab_mallocs;
+  int malloc_ms, slab_ms, i;
+
+  if(argc > 1 && (total = atoi(argv[1])) < 1)
+    {
+      fprintf(stderr,
+	      "usage: scamper_slab_bench [responses [window [per-meas]]]\n");
+      return -1;
+    }
+  if(argc > 2 && (window = atoi(argv[2])) < 1)
+    window = 1;
+  if(argc > 3 && (responses = atoi(argv[3])) < 2)
+    responses = 2;
+
+  if((meas = malloc_zero(sizeof(bench_meas_t) * window)) == NULL)
+    return -1;
+  for(i=0; i<window; i++)
+    {
+      meas[i].type = i % 4;
+      if((meas[i].objs = malloc_zero(sizeof(void *) * (responses+4))) == NULL)
+	return -1;
+    }
+
+  srandom(1);
+  if(bench(&malloc_ms, &malloc_gets, &malloc_mallocs) != 0)
+    return -1;
+
+  scamper_slab_enable();
+
+  srandom(1);
+  if(bench(&slab_ms, &slab_gets, &slab_mallocs) != 0)
+    return -1;
+
+  printf("responses %d, window %d, up to %d responses per measurement\n",
+	 total, window, responses + 3);
+  printf("each response also allocates one scamper_addr_t, with its address\n"
+	 "bytes held in the same allocation\n");
+  report("malloc:", malloc_ms, malloc_gets, malloc_mallocs);
+  report("slab:", slab_ms, slab_gets, slab_mallocs);
+
+  scamper_slab_cleanup();
+  for(i=0; i<window; i++)
+    free(meas[i].objs);
+  free(meas);
+  return 0;
+}
@@ -49,7 +49,6 @@ typedef struct scamper_source_file
   /* parameters for the file */
   char               *filename;
   char               *command;
-  size_t              command_len;
   int                 cycles;
   int                 autoreload;
 
@@ -159,23 +158,21 @@ static int ssf_open(const char *filename)
  * ssf_read_line
  *
  * this callback receives a single line per call, which should contain an
- * address in string form.  it combines that address with the source's
- * default command and then passes the string to source_command for further
- * processing.  the line eventually ends up in the commands queue.
+ * address in string form.  it passes that address with the source's
+ * default command to source_command_addr for further processing.  the
+ * line eventually ends up in the commands queue.
  */
 static int ssf_read_line(void *param, uint8_t *buf, size_t len)
 {
   scamper_source_file_t *ssf = (scamper_source_file_t *)param;
   scamper_source_t *source = ssf->source;
   char *str = (char *)buf;
-  char cmd_buf[256], *cmd = NULL;
-  size_t reqd_len;
 
   /* make sure the string contains only printable characters */
   if(string_isprint(str, len) == 0)
     {
       printerror(__func__, "%s contains unprintable characters", ssf->filename);
-      goto err;
+      return -1;
     }
 
   if(ssf->command != NULL)
@@ -185,46 +182,22 @@ static int ssf_read_line(void *param, uint8_t *buf, size_t len)
       if(str[0] == '\0' || str[0] == '#')
 	return 0;
 
-      /* figure out if the cmd_buf above is large enough */
-      len = strlen(str);
-      if(sizeof(cmd_buf) >= (reqd_len = ssf->command_len + 1 + len + 1))
-	{
-	  cmd = cmd_buf;
-	}
-      else
-	{
-	  if((cmd = malloc_zero(reqd_len)) == NULL)
-	    {
-	      printerror(__func__, "could not malloc %u bytes", reqd_len);
-	      goto err;
-	    }
-	}
-
-      /* build the command string */
-      memcpy(cmd, ssf->command, ssf->command_len);
-      cmd[ssf->command_len] = ' ';
-      memcpy(cmd + ssf->command_len + 1, str, len+1);
+      /* add the command to the source */
+      if(scamper_source_command_addr(source, ssf->command, str) != 0)
+	return -1;
     }
   else
     {
       string_nullterm(str, "\r\t#", NULL);
       if(str[0] == '\0' || str[0] == '#')
 	return 0;
-      cmd = str;
-    }
 
-  /* add the command to the source */
-  if(scamper_source_command(source, cmd) != 0)
-    {
-      goto err;
+      /* add the command to the source */
+      if(scamper_source_command(source, str) != 0)
+	return -1;
     }
 
-  if(cmd != cmd_buf && cmd != str) free(cmd);
   return 0;
-
- err:
-  if(cmd != cmd_buf && cmd != str) free(cmd);
-  return -1;
 }
 
 static void ssf_read(const int fd, void *param)
@@ -529,7 +502,6 @@ scamper_source_t *scamper_source_file_alloc(scamper_source_params_t *ssp,
     {
       if((ssf->command = strdup(command)) == NULL)
 	goto err;
-      ssf->command_len = strlen(ssf->command);
     }
 
   if((fd = ssf_open(filename)) == -1)
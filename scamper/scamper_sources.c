@@ -38,8 +38,10 @@
 #include "scamper_outfiles.h"
 #include "scamper_sources.h"
 #include "scamper_cyclemon.h"
+#include "scamper_shard.h"
 
 #include "trace/scamper_trace_do.h"
+#include "trace/scamper_sweep_do.h"
 #include "ping/scamper_ping_do.h"
 #include "tracelb/scamper_tracelb_do.h"
 #include "dealias/scamper_dealias_do.h"
@@ -71,6 +73,8 @@ struct scamper_source
 
   /* properties of the source */
   uint32_t                      priority;
+  uint32_t                      pps;
+  uint32_t                      share;
   int                           type;
   int                           refcnt;
   scamper_outfile_t            *sof;
@@ -100,6 +104,35 @@ struct scamper_source
   void                         *list_node;
   splaytree_node_t             *tree_node;
 
+  /*
+   * tmpl_cmd:   the command most recently run against a bare address
+   * tmpl_funcs: the functions that build tasks from the template
+   * tmpl:       the command's parameters, parsed once for all addresses,
+   *             or NULL if the command has to be parsed for each address
+   */
+  char                         *tmpl_cmd;
+  const struct command_func    *tmpl_funcs;
+  void                         *tmpl;
+
+  /*
+   * the scheduler charges the source for each probe its tasks send.
+   *
+   * probes:     the number of probes the source's tasks have sent
+   * recent:     probes sent recently, halved each second, for the share
+   * deficit:    probes the source may send before it has to wait for
+   *             other sources to have their turn
+   * pps_credit: probing the source has left under its pps cap, in
+   *             microseconds multiplied by the cap so that a probe costs
+   *             one second's worth whatever the cap.  topped up as time
+   *             passes
+   * pps_tv:     when pps_credit was last topped up
+   */
+  uint64_t                      probes;
+  uint64_t                      recent;
+  int64_t                       deficit;
+  int64_t                       pps_credit;
+  struct timeval                pps_tv;
+
   /* data and callback functions specific to the type of source this is */
   void                         *data;
   int                         (*take)(void *data);
@@ -138,7 +171,9 @@ struct scamper_source_observer
  * command_funcs
  *
  * a utility struct to save passing loads of functions around individually
- * that are necessary to start a probe command.
+ * that are necessary to start a probe command.  the tmpl functions are
+ * optional: they parse a command without an address into a template
+ * that the data for each address is then built from.
  */
 typedef struct command_func
 {
@@ -147,6 +182,9 @@ typedef struct command_func
   void           *(*allocdata)(char *);
   scamper_task_t *(*alloctask)(void *, scamper_list_t *, scamper_cycle_t *);
   void            (*freedata)(void *data);
+  void           *(*alloctmpl)(char *);
+  void           *(*tmpldata)(const void *tmpl, const char *addr);
+  void            (*freetmpl)(void *tmpl);
 } command_func_t;
 
 static const command_func_t command_funcs[] = {
@@ -155,54 +193,74 @@ static const command_func_t command_funcs[] = {
     scamper_do_trace_alloc,
     scamper_do_trace_alloctask,
     scamper_do_trace_free,
+    scamper_do_trace_tmpl_alloc,
+    scamper_do_trace_tmpl_data,
+    scamper_do_trace_tmpl_free,
   },
   {
     "ping", 4,
     scamper_do_ping_alloc,
     scamper_do_ping_alloctask,
     scamper_do_ping_free,
+    scamper_do_ping_tmpl_alloc,
+    scamper_do_ping_tmpl_data,
+    scamper_do_ping_tmpl_free,
   },
   {
     "tracelb", 7,
     scamper_do_tracelb_alloc,
     scamper_do_tracelb_alloctask,
     scamper_do_tracelb_free,
+    NULL, NULL, NULL,
   },
   {
     "dealias", 7,
     scamper_do_dealias_alloc,
     scamper_do_dealias_alloctask,
     scamper_do_dealias_free,
+    NULL, NULL, NULL,
   },
   {
     "sting", 5,
     scamper_do_sting_alloc,
     scamper_do_sting_alloctask,
     scamper_do_sting_free,
+    NULL, NULL, NULL,
   },
   {
     "neighbourdisc", 13,
     scamper_do_neighbourdisc_alloc,
     scamper_do_neighbourdisc_alloctask,
     scamper_do_neighbourdisc_free,
+    NULL, NULL, NULL,
   },
   {
     "tbit", 4,
     scamper_do_tbit_alloc,
     scamper_do_tbit_alloctask,
     scamper_do_tbit_free,
+    NULL, NULL, NULL,
   },
   {
     "sniff", 5,
     scamper_do_sniff_alloc,
     scamper_do_sniff_alloctask,
     scamper_do_sniff_free,
+    NULL, NULL, NULL,
   },
   {
     "host", 4,
     scamper_do_host_alloc,
     scamper_do_host_alloctask,
     scamper_do_host_free,
+    NULL, NULL, NULL,
+  },
+  {
+    "sweep", 5,
+    scamper_do_sweep_alloc,
+    scamper_do_sweep_alloctask,
+    scamper_do_sweep_free,
+    NULL, NULL, NULL,
   },
 };
 
@@ -260,6 +318,22 @@ typedef struct command_onhold
   void                 *cookie;
 } command_onhold_t;
 
+/*
+ * source_ppswait
+ *
+ * state for finding the first time a source over its pps cap can probe.
+ *
+ *  now:     the current time
+ *  tv:      the earliest time found so far
+ *  set:     non-zero if tv is set
+ */
+typedef struct source_ppswait
+{
+  struct timeval        now;
+  struct timeval        tv;
+  int                   set;
+} source_ppswait_t;
+
 /*
  * global variables for managing sources:
  *
@@ -267,23 +341,32 @@ typedef struct command_onhold
  * either stored in the active list, a round-robin circular list, or in
  * the blocked list.
  *
- * the source, if any, currently being used (that is, has not used up its
- * priority quantum) is pointed to by source_cur.  the number of tasks that
- * have been read from the current source in this rotation is held in
- * source_cnt.
+ * the sources in the active list are mixed with deficit round robin.
+ * each time a source's turn comes around, its deficit is credited with
+ * its priority, and the source then supplies new tasks while its deficit
+ * is positive.  each probe a task sends is charged against the deficit
+ * of the task's source, so a source whose tasks send many probes waits
+ * more turns before it supplies another task.  the source whose turn it
+ * is is pointed to by source_cur.
+ *
+ * recent_probes is the sum of each source's recent probe count, which
+ * is halved every second at recent_tv, to compare against each source's
+ * minimum share.
  *
  * the sources are stored in a tree that is searchable by name.
  */
-static clist_t          *active      = NULL;
-static dlist_t          *blocked     = NULL;
-static dlist_t          *finished    = NULL;
-static scamper_source_t *source_cur  = NULL;
-static uint32_t          source_cnt  = 0;
-static splaytree_t      *source_tree = NULL;
-static dlist_t          *observers   = NULL;
+static clist_t          *active        = NULL;
+static dlist_t          *blocked       = NULL;
+static dlist_t          *finished      = NULL;
+static scamper_source_t *source_cur    = NULL;
+static splaytree_t      *source_tree   = NULL;
+static dlist_t          *observers     = NULL;
+static uint64_t          recent_probes = 0;
+static struct timeval    recent_tv;
 
 /* forward declare */
 static void source_free(scamper_source_t *source);
+static void source_tmpl_free(scamper_source_t *source);
 
 #if !defined(NDEBUG) && defined(SOURCES_DEBUG)
 static int command_assert(void *item, void *param)
@@ -496,12 +579,25 @@ static int command_cycle(scamper_source_t *source, scamper_cycle_t *cycle)
   return -1;
 }
 
+/*
+ * source_credit
+ *
+ * it is the source's turn, so credit its deficit with its priority.  a
+ * source does not bank more than one turn's credit.
+ */
+static void source_credit(scamper_source_t *source, int64_t turns)
+{
+  source->deficit += turns * (int64_t)source->priority;
+  if(source->deficit > (int64_t)source->priority)
+    source->deficit = source->priority;
+  return;
+}
+
 /*
  * source_next
  *
- * advance to the next source to read addresses from, and reset the
- * current count of how many addresses have been returned off the list
- * for this source-cycle
+ * advance to the next source to read addresses from, and credit it for
+ * its turn.
  */
 static scamper_source_t *source_next(void)
 {
@@ -509,12 +605,177 @@ static scamper_source_t *source_next(void)
 
   if((node = clist_node_next(source_cur->list_node)) != source_cur->list_node)
     source_cur = clist_node_item(node);
-
-  source_cnt = 0;
+  source_credit(source_cur, 1);
 
   return source_cur;
 }
 
+/*
+ * scamper_source_pps_ok
+ *
+ * determine if the source is under its pps cap.  the source's credit is
+ * topped up with the time that has passed since it was last checked,
+ * up to one second of probing.
+ */
+int scamper_source_pps_ok(scamper_source_t *source, const struct timeval *now)
+{
+  int64_t us, max;
+
+  if(source->pps == 0)
+    return 1;
+
+  max = (int64_t)1000000 * source->pps;
+  if(timeval_inrange_us(now, &source->pps_tv, 1000000) == 0)
+    {
+      source->pps_credit = max;
+      timeval_cpy(&source->pps_tv, now);
+    }
+  else if(timeval_cmp(now, &source->pps_tv) > 0)
+    {
+      us = timeval_diff_us(now, &source->pps_tv);
+      if((source->pps_credit += us * source->pps) > max)
+	source->pps_credit = max;
+      timeval_cpy(&source->pps_tv, now);
+    }
+
+  return source->pps_credit > 0 ? 1 : 0;
+}
+
+/*
+ * source_pps_wait
+ *
+ * if the source is over its pps cap, work out when it will have earned
+ * enough credit to probe again, and keep the earliest such time.
+ */
+static int source_pps_wait(void *param, void *item)
+{
+  source_ppswait_t *pw = param;
+  scamper_source_t *source = item;
+  struct timeval tv;
+
+  if(source->pps == 0 || scamper_source_pps_ok(source, &pw->now) != 0)
+    return 0;
+
+  timeval_add_us(&tv, &source->pps_tv,
+		 (int)((-source->pps_credit / source->pps) + 1));
+  if(pw->set == 0 || timeval_cmp(&tv, &pw->tv) < 0)
+    {
+      timeval_cpy(&pw->tv, &tv);
+      pw->set = 1;
+    }
+
+  return 0;
+}
+
+/*
+ * source_recent_decay
+ *
+ * halve the recent probe count of the source.
+ */
+static int source_recent_decay(void *param, void *item)
+{
+  scamper_source_t *source = item;
+  source->recent /= 2;
+  return 0;
+}
+
+/*
+ * source_pick
+ *
+ * pick the source to supply the next task.  a source that has been
+ * charged for less than its minimum share of recent probes goes first.
+ * otherwise, the source whose turn it is supplies the task if it still
+ * has deficit to spend, or the turn passes on.  if every source that is
+ * under its pps cap is in deficit, they are all credited with as many
+ * turns as it takes for one of them to be able to go.
+ */
+static scamper_source_t *source_pick(const struct timeval *now)
+{
+  scamper_source_t *source;
+  int64_t turns, min_turns;
+  int i, c;
+
+  if(source_cur == NULL)
+    return NULL;
+
+  /* halve the recent probe counts each second */
+  if(timeval_inrange_us(now, &recent_tv, 1000000) == 0)
+    {
+      splaytree_inorder(source_tree, source_recent_decay, NULL);
+      recent_probes /= 2;
+      timeval_cpy(&recent_tv, now);
+    }
+
+  c = clist_count(active);
+  if(recent_probes > 0)
+    {
+      source = source_cur;
+      for(i=0; i<c; i++)
+	{
+	  if(source->share > 0 && source->recent * 100 <
+	     (uint64_t)source->share * recent_probes &&
+	     scamper_source_pps_ok(source, now) != 0)
+	    return source;
+	  source = clist_node_item(clist_node_next(source->list_node));
+	}
+    }
+
+  for(;;)
+    {
+      min_turns = 0;
+      for(i=0; i<c; i++)
+	{
+	  source = source_cur;
+	  if(scamper_source_pps_ok(source, now) != 0)
+	    {
+	      if(source->deficit > 0)
+		return source;
+	      turns = ((1 - source->deficit) + source->priority - 1) /
+		source->priority;
+	      if(min_turns == 0 || turns < min_turns)
+		min_turns = turns;
+	    }
+	  source_next();
+	}
+
+      /* every source is at its pps cap */
+      if(min_turns == 0)
+	return NULL;
+
+      /*
+       * each source was credited with one turn as the turn passed it.
+       * skip ahead the rest of the turns that would pass with no source
+       * able to go.
+       */
+      if(--min_turns == 0)
+	continue;
+      source = source_cur;
+      for(i=0; i<c; i++)
+	{
+	  source_credit(source, min_turns);
+	  source = clist_node_item(clist_node_next(source->list_node));
+	}
+    }
+
+  return NULL;
+}
+
+/*
+ * scamper_source_charge
+ *
+ * charge the source for the probes sent by one of its tasks.
+ */
+void scamper_source_charge(scamper_source_t *source, uint32_t probes)
+{
+  source->probes += probes;
+  source->recent += probes;
+  source->deficit -= probes;
+  recent_probes += probes;
+  if(source->pps != 0)
+    source->pps_credit -= (int64_t)1000000 * probes;
+  return;
+}
+
 /*
  * source_active_detach
  *
@@ -528,7 +789,6 @@ static void source_active_detach(scamper_source_t *source)
   assert(source->list_ == active);
 
   source_cur = NULL;
-  source_cnt = 0;
 
   if(source->list_node != NULL)
     {
@@ -609,7 +869,7 @@ static int source_active_attach(scamper_source_t *source)
   if(source_cur == NULL)
     {
       source_cur = source;
-      source_cnt = 0;
+      source_credit(source, 1);
     }
 
   return 0;
@@ -766,6 +1026,13 @@ static int command_task_handle(scamper_source_t *source, command_t *command,
   return source_task_install(source, st, task_out);
 }
 
+/*
+ * command_probe_handle
+ *
+ * allocate a task for the command.  returns zero with the task in
+ * task_out, or NULL if the task has to wait for another task to finish.
+ * returns one if another shard probes the task, and -1 on error.
+ */
 static int command_probe_handle(scamper_source_t *source, command_t *command,
 				scamper_task_t **task_out)
 {
@@ -787,6 +1054,15 @@ static int command_probe_handle(scamper_source_t *source, command_t *command,
   command_free(command);
   command = NULL;
 
+  /* the task might be probed by another shard */
+  if(scamper_shard_task(task) == 0)
+    {
+      scamper_task_free(task);
+      *task_out = NULL;
+      sources_assert();
+      return 1;
+    }
+
   /*
    * keep a record in the source that this task is now active
    * pass the cyclemon structure to the task
@@ -1150,6 +1426,8 @@ static void source_free(scamper_source_t *source)
       splaytree_free(source->idtree, NULL);
     }
 
+  source_tmpl_free(source);
+
   /* release this structure's hold on the scamper_outfile */
   if(source->sof != NULL) scamper_outfile_free(source->sof);
 
@@ -1247,6 +1525,54 @@ void scamper_source_setpriority(scamper_source_t *source, uint32_t priority)
   return;
 }
 
+uint32_t scamper_source_getpps(const scamper_source_t *source)
+{
+  return source->pps;
+}
+
+void scamper_source_setpps(scamper_source_t *source, uint32_t pps)
+{
+  scamper_source_event_t sse;
+
+  /* the credit is scaled by the cap, so start again with a full second */
+  source->pps = pps;
+  memset(&source->pps_tv, 0, sizeof(source->pps_tv));
+
+  memset(&sse, 0, sizeof(sse));
+  sse.sse_update_flags |= 0x08;
+  sse.sse_update_pps = pps;
+  scamper_source_event_post(source, SCAMPER_SOURCE_EVENT_UPDATE, &sse);
+  return;
+}
+
+uint32_t scamper_source_getshare(const scamper_source_t *source)
+{
+  return source->share;
+}
+
+void scamper_source_setshare(scamper_source_t *source, uint32_t share)
+{
+  scamper_source_event_t sse;
+
+  source->share = share;
+
+  memset(&sse, 0, sizeof(sse));
+  sse.sse_update_flags |= 0x10;
+  sse.sse_update_share = share;
+  scamper_source_event_post(source, SCAMPER_SOURCE_EVENT_UPDATE, &sse);
+  return;
+}
+
+uint64_t scamper_source_getprobes(const scamper_source_t *source)
+{
+  return source->probes;
+}
+
+int64_t scamper_source_getdeficit(const scamper_source_t *source)
+{
+  return source->deficit;
+}
+
 const char *scamper_source_type_tostr(const scamper_source_t *source)
 {
   switch(source->type)
@@ -1318,7 +1644,7 @@ static const command_func_t *command_func_get(const char *command)
     {
       func = &command_funcs[i];
       if(strncasecmp(command, func->command, func->len) == 0 &&
-	 isspace((int)command[func->len]) && command[func->len] != '\0')
+	 (isspace((int)command[func->len]) || command[func->len] == '\0'))
 	{
 	  return func;
 	}
@@ -1455,22 +1781,15 @@ int scamper_source_command2(scamper_source_t *s, const char *command,
 }
 
 /*
- * scamper_source_command
+ * source_command_probe
  *
+ * queue a probe command with the data allocated for it.  the data is
+ * freed if the command cannot be queued.
  */
-int scamper_source_command(scamper_source_t *source, const char *command)
+static int source_command_probe(scamper_source_t *source,
+				const command_func_t *func, void *data)
 {
-  const command_func_t *func = NULL;
   command_t *cmd = NULL;
-  char *opts = NULL;
-  void *data = NULL;
-
-  sources_assert();
-
-  if((func = command_func_get(command)) == NULL)
-    goto err;
-  if((data = command_func_allocdata(func, command)) == NULL)
-    goto err;
 
   if((cmd = command_alloc(COMMAND_PROBE)) == NULL)
     goto err;
@@ -1482,17 +1801,131 @@ int scamper_source_command(scamper_source_t *source, const char *command)
     goto err;
 
   source_active_attach(source);
-  sources_assert();
   return 0;
 
  err:
-  if(opts != NULL) free(opts);
-  if(data != NULL) func->freedata(data);
-  if(cmd != NULL) free(cmd);
-  sources_assert();
+  if(cmd != NULL)
+    {
+      if(cmd->un.pr.cyclemon != NULL)
+	scamper_cyclemon_unuse(cmd->un.pr.cyclemon);
+      free(cmd);
+    }
+  func->freedata(data);
   return -1;
 }
 
+/*
+ * scamper_source_command
+ *
+ */
+int scamper_source_command(scamper_source_t *source, const char *command)
+{
+  const command_func_t *func = NULL;
+  void *data = NULL;
+  int rc = -1;
+
+  sources_assert();
+
+  if((func = command_func_get(command)) != NULL &&
+     (data = command_func_allocdata(func, command)) != NULL)
+    rc = source_command_probe(source, func, data);
+
+  sources_assert();
+  return rc;
+}
+
+static void source_tmpl_free(scamper_source_t *source)
+{
+  if(source->tmpl != NULL)
+    source->tmpl_funcs->freetmpl(source->tmpl);
+  if(source->tmpl_cmd != NULL)
+    free(source->tmpl_cmd);
+  source->tmpl = NULL;
+  source->tmpl_funcs = NULL;
+  source->tmpl_cmd = NULL;
+  return;
+}
+
+/*
+ * source_tmpl_set
+ *
+ * parse the command into a template, unless it is the command the
+ * source's template was built from already.  a command that cannot be
+ * made into a template is remembered so that it is not tried again.
+ */
+static int source_tmpl_set(scamper_source_t *source, const char *command)
+{
+  const command_func_t *func;
+  char *opts;
+
+  if(source->tmpl_cmd != NULL && strcmp(source->tmpl_cmd, command) == 0)
+    return 0;
+
+  source_tmpl_free(source);
+  if((source->tmpl_cmd = strdup(command)) == NULL)
+    {
+      printerror(__func__, "could not strdup command");
+      return -1;
+    }
+
+  if((func = command_func_get(command)) == NULL || func->alloctmpl == NULL)
+    return 0;
+
+  if((opts = strdup(command + func->len)) == NULL)
+    {
+      printerror(__func__, "could not strdup cmd opts");
+      return -1;
+    }
+  if((source->tmpl = func->alloctmpl(opts)) != NULL)
+    source->tmpl_funcs = func;
+  free(opts);
+
+  return 0;
+}
+
+/*
+ * scamper_source_command_addr
+ *
+ * queue the command to be run against the address.  the command is
+ * parsed once, and the template that results is used for each address
+ * the command is run against, rather than parsing the command again.
+ */
+int scamper_source_command_addr(scamper_source_t *source,
+				const char *command, const char *addr)
+{
+  size_t len, off = 0;
+  char *buf = NULL;
+  void *data;
+  int rc = -1;
+
+  sources_assert();
+
+  if(source_tmpl_set(source, command) != 0)
+    goto done;
+
+  if(source->tmpl != NULL)
+    {
+      if((data = source->tmpl_funcs->tmpldata(source->tmpl, addr)) != NULL)
+	rc = source_command_probe(source, source->tmpl_funcs, data);
+      goto done;
+    }
+
+  /* the command does not have a template: put the command back together */
+  len = strlen(command) + 1 + strlen(addr) + 1;
+  if((buf = malloc(len)) == NULL)
+    {
+      printerror(__func__, "could not malloc %d bytes", (int)len);
+      goto done;
+    }
+  string_concat(buf, len, &off, "%s %s", command, addr);
+  rc = scamper_source_command(source, buf);
+
+ done:
+  if(buf != NULL) free(buf);
+  sources_assert();
+  return rc;
+}
+
 /*
  * scamper_source_cycle
  *
@@ -1657,6 +2090,8 @@ scamper_source_t *scamper_source_alloc(const scamper_source_params_t *ssp)
 
   source->type     = ssp->type;
   source->priority = ssp->priority;
+  source->pps      = ssp->pps;
+  source->share    = ssp->share;
   source->id       = 1;
 
   return source;
@@ -1792,20 +2227,55 @@ int scamper_sources_isempty()
 /*
  * scamper_sources_isready
  *
- * return to the caller if a source is ready to return a new task.
+ * return to the caller if a source is ready to return a new task.  a
+ * source that is over its pps cap is not ready.
  */
 int scamper_sources_isready(void)
 {
+  scamper_source_t *source;
+  struct timeval now;
+  int i, c;
+
   sources_assert();
 
-  if(source_cur != NULL || dlist_count(finished) > 0)
+  if(dlist_count(finished) > 0)
+    return 1;
+
+  if(source_cur == NULL)
+    return 0;
+
+  gettimeofday_wrap(&now);
+  source = source_cur;
+  c = clist_count(active);
+  for(i=0; i<c; i++)
     {
-      return 1;
+      if(scamper_source_pps_ok(source, &now) != 0)
+	return 1;
+      source = clist_node_item(clist_node_next(source->list_node));
     }
 
   return 0;
 }
 
+/*
+ * scamper_sources_ppswait
+ *
+ * return non-zero if a source is over its pps cap, with tv set to the
+ * time the first such source can probe again.
+ */
+int scamper_sources_ppswait(struct timeval *tv)
+{
+  source_ppswait_t pw;
+
+  gettimeofday_wrap(&pw.now);
+  pw.set = 0;
+  splaytree_inorder(source_tree, source_pps_wait, &pw);
+  if(pw.set != 0)
+    timeval_cpy(tv, &pw.tv);
+
+  return pw.set;
+}
+
 /*
  * scamper_sources_empty
  *
@@ -1863,21 +2333,16 @@ int scamper_sources_gettask(scamper_task_t **task)
 {
   scamper_source_t *source;
   command_t *command;
+  struct timeval now;
+  int rc;
 
   sources_assert();
 
   while((source = dlist_head_item(finished)) != NULL)
     source_detach(source);
 
-  /*
-   * if the priority of the source was changed in between calls to this
-   * function, then make sure the source's priority hasn't been lowered to
-   * below how many tasks it has had allocated in this cycle
-   */
-  if(source_cur != NULL && source_cnt >= source_cur->priority)
-    source_next();
-
-  while((source = source_cur) != NULL)
+  gettimeofday_wrap(&now);
+  while((source = source_pick(&now)) != NULL)
     {
       assert(source->priority > 0);
 
@@ -1889,11 +2354,14 @@ int scamper_sources_gettask(scamper_task_t **task)
 	  switch(command->type)
 	    {
 	    case COMMAND_PROBE:
-	      if(command_probe_handle(source, command, task) != 0)
+	      /*
+	       * skip over tasks that another shard probes, and tasks put on
+	       * hold, until this shard has a task or the sources are empty
+	       */
+	      if((rc = command_probe_handle(source, command, task)) < 0)
 		goto err;
-	      if(*task == NULL)
+	      if(rc == 1 || *task == NULL)
 		continue;
-	      source_cnt++;
 	      goto done;
 
 	    case COMMAND_TASK:
@@ -1901,7 +2369,6 @@ int scamper_sources_gettask(scamper_task_t **task)
 		goto err;
 	      if(*task == NULL)
 		continue;
-	      source_cnt++;
 	      goto done;
 
 	    case COMMAND_CYCLE:
@@ -47,6 +47,8 @@ typedef struct scamper_source_params
    *  cycle_id: the initial cycle id to use.
    *  type:     type of the source (file, cmdline, control socket, ...)
    *  priority: the mix priority of this source compared to other sources.
+   *  pps:      the most probes per second the source may send, or zero.
+   *  share:    the minimum percentage of probes the source should get.
    *  sof:      the output file to direct results to.
    */
   char              *name;
@@ -55,6 +57,8 @@ typedef struct scamper_source_params
   uint32_t           cycle_id;
   int                type;
   uint32_t           priority;
+  uint32_t           pps;
+  uint32_t           share;
   scamper_outfile_t *sof;
 
   /*
@@ -86,6 +90,16 @@ uint32_t scamper_source_getcycleid(const scamper_source_t *source);
 int scamper_source_gettype(const scamper_source_t *source);
 uint32_t scamper_source_getpriority(const scamper_source_t *source);
 void scamper_source_setpriority(scamper_source_t *source, uint32_t priority);
+uint32_t scamper_source_getpps(const scamper_source_t *source);
+void scamper_source_setpps(scamper_source_t *source, uint32_t pps);
+uint32_t scamper_source_getshare(const scamper_source_t *source);
+void scamper_source_setshare(scamper_source_t *source, uint32_t share);
+
+/* functions for the probe accounting the sources are scheduled with */
+void scamper_source_charge(scamper_source_t *source, uint32_t probes);
+int scamper_source_pps_ok(scamper_source_t *source, const struct timeval *now);
+uint64_t scamper_source_getprobes(const scamper_source_t *source);
+int64_t scamper_source_getdeficit(const scamper_source_t *source);
 
 /* functions for getting string representations */
 const char *scamper_source_type_tostr(const scamper_source_t *source);
@@ -105,6 +119,8 @@ int scamper_source_isfinished(scamper_source_t *source);
 
 /* functions for adding stuff to the source's command queue */
 int scamper_source_command(scamper_source_t *source, const char *command);
+int scamper_source_command_addr(scamper_source_t *source,
+				const char *command, const char *addr);
 int scamper_source_command2(scamper_source_t *source, const char *command,
 			    uint32_t *id);
 int scamper_source_cycle(scamper_source_t *source);
@@ -121,6 +137,7 @@ int scamper_sources_gettask(struct scamper_task **task);
 int scamper_sources_del(scamper_source_t *source);
 scamper_source_t *scamper_sources_get(char *name);
 int scamper_sources_isready(void);
+int scamper_sources_ppswait(struct timeval *tv);
 int scamper_sources_isempty(void);
 void scamper_sources_foreach(void *p, int (*func)(void *, scamper_source_t *));
 void scamper_sources_empty(void);
@@ -149,16 +166,21 @@ typedef struct scamper_source_event
 
     struct sse_update
     {
-      uint8_t flags;  /* 0x01 == autoreload, 0x02 == cycles, 0x03 = priority */
+      uint8_t flags;  /* 0x01 == autoreload, 0x02 == cycles, 0x04 = priority,
+			 0x08 == pps, 0x10 == share */
       int     autoreload;
       int     cycles;
       int     priority;
+      int     pps;
+      int     share;
     } sseu_update;
 
 #define sse_update_flags       sse_un.sseu_update.flags
 #define sse_update_autoreload  sse_un.sseu_update.autoreload
 #define sse_update_cycles      sse_un.sseu_update.cycles
 #define sse_update_priority    sse_un.sseu_update.priority
+#define sse_update_pps         sse_un.sseu_update.pps
+#define sse_update_share       sse_un.sseu_update.share
 
     struct sse_cycle
     {
@@ -0,0 +1,398 @@
+/*
+ * scamper_stopset.c
+ *
+ * $Id$
+ *
+ * Copyright (C) 2026 Matthew Luckie
+ * Author: Matthew Luckie
+ *
+ * doubletree's global stop set records (interface, destination) pairs
+ * that have already been observed, so that a trace towards a destination
+ * can stop probing forward when it reaches an interface that another
+ * trace towards the same destination has already probed past.  this
+ * file keeps a global stop set in a file that many scamper processes can
+ * map at once, so that monitors probing the same destinations avoid each
+ * other's work.  the file is an open-addressed hash table of
+ * (interface, destination-prefix) pairs.  slots are claimed with an
+ * atomic compare-and-swap and are never removed, so readers need no
+ * locks.  the version of the stop set is the number of pairs that have
+ * been added to it, which a trace records so that the stop set it was
+ * collected with can be identified.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include "internal.h"
+
+#include "scamper_debug.h"
+#include "scamper_addr.h"
+#include "scamper_stopset.h"
+#include "utils.h"
+
+#define STOPSET_MAGIC 0x53535431 /* SST1 */
+
+/* slot hash values that do not identify a pair */
+#define STOPSET_HASH_EMPTY 0
+#define STOPSET_HASH_BUSY  1
+
+/*
+ * stopset_hdr
+ *
+ * the header at the start of the file.  slotc is a power of two, and
+ * plen4 and plen6 are the prefix lengths that destinations are recorded
+ * with, which are fixed when the file is created.  count and version
+ * are updated atomically by the processes adding pairs.
+ */
+typedef struct stopset_hdr
+{
+  uint32_t         magic;
+  uint32_t         slotc;
+  uint8_t          plen4;
+  uint8_t          plen6;
+  uint16_t         unused;
+  uint32_t         count;
+  uint32_t         version;
+} stopset_hdr_t;
+
+/*
+ * stopset_slot
+ *
+ * a slot holds one (interface, destination-prefix) pair.  the hash is
+ * written last, so that a reader that finds the hash it is looking for
+ * also finds the pair that goes with it.
+ */
+typedef struct stopset_slot
+{
+  uint32_t         hash;
+  uint8_t          type;
+  uint8_t          unused[3];
+  uint8_t          iface[16];
+  uint8_t          pfx[16];
+} stopset_slot_t;
+
+typedef struct stopset_key
+{
+  uint32_t         hash;
+  uint8_t          type;
+  uint8_t          iface[16];
+  uint8_t          pfx[16];
+} stopset_key_t;
+
+static stopset_hdr_t  *hdr   = NULL;
+static stopset_slot_t *slots = NULL;
+static size_t          map_len = 0;
+static int             full_warned = 0;
+
+static size_t stopset_len(uint32_t slotc)
+{
+  return sizeof(stopset_hdr_t) + ((size_t)slotc * sizeof(stopset_slot_t));
+}
+
+static int stopset_key(stopset_key_t *key, const scamper_addr_t *iface,
+		       const scamper_addr_t *dst)
+{
+  size_t i, len;
+  int plen;
+
+  if(iface->type != dst->type)
+    return -1;
+  if(SCAMPER_ADDR_TYPE_IS_IPV4(dst))
+    {
+      len = 4;
+      plen = hdr->plen4;
+    }
+  else if(SCAMPER_ADDR_TYPE_IS_IPV6(dst))
+    {
+      len = 16;
+      plen = hdr->plen6;
+    }
+  else return -1;
+
+  memset(key, 0, sizeof(stopset_key_t));
+  key->type = iface->type;
+  memcpy(key->iface, iface->addr, len);
+  memcpy(key->pfx, dst->addr, len);
+  for(i=plen/8; i<len; i++)
+    {
+      if(i == (size_t)plen/8 && plen % 8 != 0)
+	key->pfx[i] &= (0xff << (8 - (plen % 8)));
+      else
+	key->pfx[i] = 0;
+    }
+
+  /* FNV-1a */
+  key->hash = 2166136261U;
+  key->hash = (key->hash ^ key->type) * 16777619;
+  for(i=0; i<len; i++)
+    key->hash = (key->hash ^ key->iface[i]) * 16777619;
+  for(i=0; i<len; i++)
+    key->hash = (key->hash ^ key->pfx[i]) * 16777619;
+  if(key->hash <= STOPSET_HASH_BUSY)
+    key->hash += 2;
+
+  return 0;
+}
+
+static int stopset_slot_match(const stopset_slot_t *slot,
+			      const stopset_key_t *key)
+{
+  if(slot->type == key->type &&
+     memcmp(slot->iface, key->iface, sizeof(key->iface)) == 0 &&
+     memcmp(slot->pfx, key->pfx, sizeof(key->pfx)) == 0)
+    return 1;
+  return 0;
+}
+
+/*
+ * scamper_stopset_find
+ *
+ * return one if the interface has been observed on the way to the
+ * prefix enclosing the destination, zero if not.
+ */
+int scamper_stopset_find(const scamper_addr_t *iface,
+			 const scamper_addr_t *dst)
+{
+  stopset_key_t key;
+  uint32_t i, j, mask, hash;
+
+  if(hdr == NULL || stopset_key(&key, iface, dst) != 0)
+    return 0;
+
+  mask = hdr->slotc - 1;
+  for(i=0; i<hdr->slotc; i++)
+    {
+      j = (key.hash + i) & mask;
+      if((hash = slots[j].hash) == STOPSET_HASH_EMPTY)
+	break;
+      if(hash != key.hash)
+	continue;
+      __sync_synchronize();
+      if(stopset_slot_match(&slots[j], &key) != 0)
+	return 1;
+    }
+
+  return 0;
+}
+
+/*
+ * scamper_stopset_add
+ *
+ * add the (interface, destination-prefix) pair to the stop set, if it
+ * is not already there.  two processes adding the same pair at once
+ * could each add it, which costs a slot but does not change what is
+ * found.  the stop set is not allowed to become more than 7/8ths full.
+ */
+int scamper_stopset_add(const scamper_addr_t *iface,
+			const scamper_addr_t *dst)
+{
+  stopset_slot_t *slot;
+  stopset_key_t key;
+  uint32_t i, mask, hash;
+
+  if(hdr == NULL || stopset_key(&key, iface, dst) != 0)
+    return -1;
+
+  mask = hdr->slotc - 1;
+  i = 0;
+  while(i < hdr->slotc)
+    {
+      slot = &slots[(key.hash + i) & mask];
+      if((hash = slot->hash) == STOPSET_HASH_EMPTY)
+	{
+	  if(hdr->count >= hdr->slotc / 8 * 7)
+	    {
+	      if(full_warned == 0)
+		{
+		  printerror_msg(__func__, "stop set is full with %u pairs",
+				 hdr->count);
+		  full_warned = 1;
+		}
+	      return -1;
+	    }
+
+	  /* another process claimed the slot first: look at it again */
+	  if(__sync_bool_compare_and_swap(&slot->hash, STOPSET_HASH_EMPTY,
+					  STOPSET_HASH_BUSY) == 0)
+	    continue;
+
+	  slot->type = key.type;
+	  memcpy(slot->iface, key.iface, sizeof(key.iface));
+	  memcpy(slot->pfx, key.pfx, sizeof(key.pfx));
+	  __sync_synchronize();
+	  slot->hash = key.hash;
+	  __sync_fetch_and_add(&hdr->count, 1);
+	  __sync_fetch_and_add(&hdr->version, 1);
+	  return 0;
+	}
+
+      if(hash == key.hash)
+	{
+	  __sync_synchronize();
+	  if(stopset_slot_match(slot, &key) != 0)
+	    return 0;
+	}
+      i++;
+    }
+
+  return -1;
+}
+
+uint32_t scamper_stopset_version(void)
+{
+  if(hdr == NULL)
+    return 0;
+  return hdr->version;
+}
+
+int scamper_stopset_isopen(void)
+{
+  return hdr != NULL ? 1 : 0;
+}
+
+/*
+ * stopset_create
+ *
+ * create an empty stop set in a temporary file alongside the named
+ * file, and then link it into place, so that another process never
+ * maps a file whose header has not been written.  if another process
+ * created the file first, use that file.
+ */
+static int stopset_create(const char *filename, uint32_t slotc)
+{
+  stopset_hdr_t h;
+  char *tmp = NULL;
+  size_t len, off = 0;
+  int fd = -1, rc = -1;
+
+  len = strlen(filename) + 16;
+  if((tmp = malloc(len)) == NULL)
+    {
+      printerror(__func__, "could not malloc tmp");
+      goto done;
+    }
+  string_concat(tmp, len, &off, "%s.%ld", filename, (long)getpid());
+
+  if((fd = open(tmp, O_RDWR | O_CREAT | O_EXCL, 0644)) == -1)
+    {
+      printerror(__func__, "could not open %s", tmp);
+      goto done;
+    }
+
+  memset(&h, 0, sizeof(h));
+  h.magic = STOPSET_MAGIC;
+  h.slotc = SCAMPER_STOPSET_SLOTS_MIN;
+  while(h.slotc < slotc && h.slotc < SCAMPER_STOPSET_SLOTS_MAX)
+    h.slotc *= 2;
+  h.plen4 = SCAMPER_STOPSET_PLEN4;
+  h.plen6 = SCAMPER_STOPSET_PLEN6;
+  if(ftruncate(fd, stopset_len(h.slotc)) != 0 ||
+     write_wrap(fd, &h, NULL, sizeof(h)) != 0)
+    {
+      printerror(__func__, "could not initialise %s", tmp);
+      goto done;
+    }
+  close(fd); fd = -1;
+
+  if(link(tmp, filename) != 0 && errno != EEXIST)
+    {
+      printerror(__func__, "could not link %s", filename);
+      goto done;
+    }
+  rc = 0;
+
+ done:
+  if(fd != -1) close(fd);
+  if(tmp != NULL)
+    {
+      unlink(tmp);
+      free(tmp);
+    }
+  return rc;
+}
+
+int scamper_stopset_open(const char *filename, uint32_t slotc)
+{
+  struct stat sb;
+  void *map;
+  int fd = -1;
+
+  if((fd = open(filename, O_RDWR)) == -1)
+    {
+      if(errno != ENOENT || stopset_create(filename, slotc) != 0 ||
+	 (fd = open(filename, O_RDWR)) == -1)
+	{
+	  printerror(__func__, "could not open %s", filename);
+	  goto err;
+	}
+    }
+
+  if(fstat(fd, &sb) != 0)
+    {
+      printerror(__func__, "could not stat %s", filename);
+      goto err;
+    }
+  if(sb.st_size < (off_t)sizeof(stopset_hdr_t))
+    {
+      printerror_msg(__func__, "%s is not a stop set", filename);
+      goto err;
+    }
+
+  map = mmap(NULL, sb.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if(map == MAP_FAILED)
+    {
+      printerror(__func__, "could not mmap %s", filename);
+      goto err;
+    }
+  close(fd); fd = -1;
+  hdr = map;
+  map_len = sb.st_size;
+
+  if(hdr->magic != STOPSET_MAGIC || hdr->slotc == 0 ||
+     (hdr->slotc & (hdr->slotc - 1)) != 0 ||
+     stopset_len(hdr->slotc) != map_len ||
+     hdr->plen4 > 32 || hdr->plen6 > 128)
+    {
+      printerror_msg(__func__, "%s is not a stop set", filename);
+      scamper_stopset_close();
+      goto err;
+    }
+  slots = (stopset_slot_t *)(hdr + 1);
+
+  if(slotc != 0 && slotc != hdr->slotc)
+    scamper_debug(__func__, "%s has %u slots, not %u", filename,
+		  hdr->slotc, slotc);
+  scamper_debug(__func__, "%s: %u slots, version %u", filename,
+		hdr->slotc, hdr->version);
+  return 0;
+
+ err:
+  if(fd != -1) close(fd);
+  return -1;
+}
+
+void scamper_stopset_close(void)
+{
+  if(hdr != NULL)
+    {
+      munmap(hdr, map_len);
+      hdr = NULL;
+      slots = NULL;
+      map_len = 0;
+    }
+  return;
+}
@@ -0,0 +1,54 @@
+/*
+ * scamper_stopset.h
+ *
+ * $Id$
+ *
+ * Copyright (C) 2026 Matthew Luckie
+ * Author: Matthew Luckie
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __SCAMPER_STOPSET_H
+#define __SCAMPER_STOPSET_H
+
+/* the number of slots in a stop set file scamper creates */
+#define SCAMPER_STOPSET_SLOTS_MIN 1024
+#define SCAMPER_STOPSET_SLOTS_DEF 1048576
+#define SCAMPER_STOPSET_SLOTS_MAX 268435456
+
+/* destinations are recorded by the prefix that encloses them */
+#define SCAMPER_STOPSET_PLEN4 24
+#define SCAMPER_STOPSET_PLEN6 48
+
+/*
+ * open, creating if necessary, a stop set shared with other processes.
+ * slotc is the number of slots to create the file with, which is
+ * rounded up to a power of two; an existing file keeps its own size.
+ */
+int scamper_stopset_open(const char *filename, uint32_t slotc);
+int scamper_stopset_isopen(void);
+void scamper_stopset_close(void);
+
+/* the number of (interface, destination-prefix) pairs ever added */
+uint32_t scamper_stopset_version(void);
+
+/* functions for looking up and adding (interface, destination) pairs */
+int scamper_stopset_find(const scamper_addr_t *iface,
+			 const scamper_addr_t *dst);
+int scamper_stopset_add(const scamper_addr_t *iface,
+			const scamper_addr_t *dst);
+
+#endif /* __SCAMPER_STOPSET_H */
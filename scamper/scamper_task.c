@@ -43,9 +43,9 @@
 #include "scamper_file.h"
 #include "scamper_rtsock.h"
 #include "scamper_dl.h"
+#include "scamper_probe.h"
 #include "mjl_list.h"
 #include "mjl_splaytree.h"
-#include "mjl_patricia.h"
 #include "utils.h"
 
 struct scamper_task
@@ -80,6 +80,10 @@ struct scamper_task
   /* file descriptors held by the task */
   scamper_fd_t            **fds;
   int                       fdc;
+
+  /* memory accounted to this task, and the type it is accounted to */
+  struct task_mem          *mem;
+  size_t                    bytes;
 };
 
 struct scamper_task_anc
@@ -94,6 +98,11 @@ typedef struct s2t
   scamper_task_sig_t *sig;
   scamper_task_t     *task;
   void               *node;
+
+  /* chain in a sigtab_t bucket, for signatures kept in one */
+  struct s2t         *hnext;
+  struct s2t        **hprev;
+  uint32_t            hash;
 } s2t_t;
 
 typedef struct task_onhold
@@ -102,51 +111,206 @@ typedef struct task_onhold
   void           *param;
 } task_onhold_t;
 
-static patricia_t  *tx_ip4 = NULL;
-static patricia_t  *tx_ip6 = NULL;
-static patricia_t  *tx_nd4 = NULL;
-static patricia_t  *tx_nd6 = NULL;
-static dlist_t     *sniff = NULL;
+/*
+ * sigtab
+ *
+ * a chained hash table of installed signatures, keyed by the address
+ * in the signature (and the ICMP id, for sniff signatures), so that
+ * the task a packet belongs to is found without a tree walk.  an s2t
+ * held in a sigtab points to the table with its node field.
+ */
+typedef struct sigtab
+{
+  s2t_t  **buckets;
+  size_t   mask;    /* number of buckets, minus one */
+  int      count;   /* number of signatures in the table */
+} sigtab_t;
+
+#define SIGTAB_BUCKETS_MIN 256
+
+/*
+ * task_mem
+ *
+ * the memory accounted to all tasks of one type.  there are only a
+ * handful of task types, so these are kept in a small array.
+ */
+typedef struct task_mem
+{
+  const scamper_task_funcs_t *funcs;
+  size_t                      bytes;
+  int                         taskc;
+} task_mem_t;
+
+static sigtab_t     tx_ip4;
+static sigtab_t     tx_ip6;
+static sigtab_t     tx_nd4;
+static sigtab_t     tx_nd6;
+static sigtab_t     sniff;
 static splaytree_t *host = NULL;
+static dlist_t     *sweep = NULL;
+
+static task_mem_t   mems[16];
+static int          memc = 0;
+static size_t       mem_total = 0;
 
-static int tx_ip_cmp(const s2t_t *a, const s2t_t *b)
+static uint32_t sigtab_hash(const scamper_addr_t *addr, uint16_t id)
 {
-  assert(a->sig->sig_type == SCAMPER_TASK_SIG_TYPE_TX_IP);
-  assert(b->sig->sig_type == SCAMPER_TASK_SIG_TYPE_TX_IP);
-  return scamper_addr_cmp(a->sig->sig_tx_ip_dst, b->sig->sig_tx_ip_dst);
+  uint64_t key[2], h;
+
+  key[0] = key[1] = 0;
+  memcpy(key, addr->addr, scamper_addr_size(addr));
+
+  h  = key[0] * UINT64_C(0x9e3779b97f4a7c15);
+  h ^= (key[1] + id) * UINT64_C(0xc2b2ae3d27d4eb4f);
+  h ^= h >> 31;
+  h *= UINT64_C(0x94d049bb133111eb);
+  h ^= h >> 29;
+
+  return (uint32_t)h;
 }
 
-static int tx_ip_bit(const s2t_t *s2t, int bit)
+/*
+ * sig_key
+ *
+ * return the address, and set the id, that the signature is hashed
+ * by.  returns NULL for signatures that are not kept in a sigtab.
+ */
+static const scamper_addr_t *sig_key(const scamper_task_sig_t *sig,
+				     uint16_t *id)
 {
-  assert(s2t->sig->sig_type == SCAMPER_TASK_SIG_TYPE_TX_IP);
-  return scamper_addr_bit(s2t->sig->sig_tx_ip_dst, bit);
+  *id = 0;
+  switch(sig->sig_type)
+    {
+    case SCAMPER_TASK_SIG_TYPE_TX_IP:
+      return sig->sig_tx_ip_dst;
+    case SCAMPER_TASK_SIG_TYPE_TX_ND:
+      return sig->sig_tx_nd_ip;
+    case SCAMPER_TASK_SIG_TYPE_SNIFF:
+      *id = sig->sig_sniff_icmp_id;
+      return sig->sig_sniff_src;
+    }
+  return NULL;
 }
 
-static int tx_ip_fbd(const s2t_t *a, const s2t_t *b)
+static int sigtab_match(const s2t_t *s2t, const scamper_addr_t *addr,
+			uint16_t id, uint32_t hash)
 {
-  assert(a->sig->sig_type == SCAMPER_TASK_SIG_TYPE_TX_IP);
-  assert(b->sig->sig_type == SCAMPER_TASK_SIG_TYPE_TX_IP);
-  return scamper_addr_fbd(a->sig->sig_tx_ip_dst, b->sig->sig_tx_ip_dst);
+  const scamper_addr_t *key;
+  uint16_t key_id;
+
+  if(s2t->hash != hash)
+    return 0;
+  key = sig_key(s2t->sig, &key_id);
+  if(key_id != id || scamper_addr_cmp(key, addr) != 0)
+    return 0;
+  return 1;
 }
 
-static int tx_nd_cmp(const s2t_t *a, const s2t_t *b)
+static s2t_t *sigtab_find(const sigtab_t *tab, const scamper_addr_t *addr,
+			  uint16_t id, uint32_t hash)
 {
-  assert(a->sig->sig_type == SCAMPER_TASK_SIG_TYPE_TX_ND);
-  assert(b->sig->sig_type == SCAMPER_TASK_SIG_TYPE_TX_ND);
-  return scamper_addr_cmp(a->sig->sig_tx_nd_ip, b->sig->sig_tx_nd_ip);
+  s2t_t *s2t;
+
+  for(s2t = tab->buckets[hash & tab->mask]; s2t != NULL; s2t = s2t->hnext)
+    if(sigtab_match(s2t, addr, id, hash) != 0)
+      return s2t;
+
+  return NULL;
 }
 
-static int tx_nd_bit(const s2t_t *s2t, int bit)
+static void sigtab_link(sigtab_t *tab, s2t_t *s2t)
 {
-  assert(s2t->sig->sig_type == SCAMPER_TASK_SIG_TYPE_TX_ND);
-  return scamper_addr_bit(s2t->sig->sig_tx_nd_ip, bit);
+  s2t_t **bucket = &tab->buckets[s2t->hash & tab->mask];
+
+  if((s2t->hnext = *bucket) != NULL)
+    s2t->hnext->hprev = &s2t->hnext;
+  s2t->hprev = bucket;
+  *bucket = s2t;
+
+  return;
 }
 
-static int tx_nd_fbd(const s2t_t *a, const s2t_t *b)
+static int sigtab_resize(sigtab_t *tab, size_t bucketc)
 {
-  assert(a->sig->sig_type == SCAMPER_TASK_SIG_TYPE_TX_ND);
-  assert(b->sig->sig_type == SCAMPER_TASK_SIG_TYPE_TX_ND);
-  return scamper_addr_fbd(a->sig->sig_tx_nd_ip, b->sig->sig_tx_nd_ip);
+  s2t_t **old = tab->buckets, *s2t, *next;
+  size_t i, oldc = tab->mask + 1;
+
+  if((tab->buckets = malloc_zero(sizeof(s2t_t *) * bucketc)) == NULL)
+    {
+      tab->buckets = old;
+      return -1;
+    }
+  tab->mask = bucketc - 1;
+
+  if(old == NULL)
+    return 0;
+
+  for(i=0; i<oldc; i++)
+    {
+      for(s2t = old[i]; s2t != NULL; s2t = next)
+	{
+	  next = s2t->hnext;
+	  sigtab_link(tab, s2t);
+	}
+    }
+  free(old);
+
+  return 0;
+}
+
+static int sigtab_insert(sigtab_t *tab, s2t_t *s2t)
+{
+  const scamper_addr_t *key;
+  uint16_t id;
+
+  /* keep chains short by growing the table as it fills */
+  if((size_t)tab->count > tab->mask &&
+     sigtab_resize(tab, (tab->mask + 1) * 2) != 0)
+    return -1;
+
+  key = sig_key(s2t->sig, &id);
+  s2t->hash = sigtab_hash(key, id);
+  sigtab_link(tab, s2t);
+  s2t->node = tab;
+  tab->count++;
+
+  return 0;
+}
+
+static void sigtab_remove(sigtab_t *tab, s2t_t *s2t)
+{
+  if((*s2t->hprev = s2t->hnext) != NULL)
+    s2t->hnext->hprev = s2t->hprev;
+  s2t->hnext = NULL;
+  s2t->hprev = NULL;
+  tab->count--;
+  return;
+}
+
+static void sigtab_free(sigtab_t *tab)
+{
+  if(tab->buckets != NULL)
+    {
+      free(tab->buckets);
+      tab->buckets = NULL;
+    }
+  tab->mask = 0;
+  tab->count = 0;
+  return;
+}
+
+static sigtab_t *sigtab_get(const scamper_task_sig_t *sig)
+{
+  const scamper_addr_t *key;
+  uint16_t id;
+
+  if((key = sig_key(sig, &id)) == NULL)
+    return NULL;
+  if(sig->sig_type == SCAMPER_TASK_SIG_TYPE_SNIFF)
+    return &sniff;
+  if(sig->sig_type == SCAMPER_TASK_SIG_TYPE_TX_IP)
+    return key->type == SCAMPER_ADDR_TYPE_IPV4 ? &tx_ip4 : &tx_ip6;
+  return key->type == SCAMPER_ADDR_TYPE_IPV4 ? &tx_nd4 : &tx_nd6;
 }
 
 static int host_cmp(const s2t_t *a, const s2t_t *b)
@@ -163,25 +327,44 @@ static int host_cmp(const s2t_t *a, const s2t_t *b)
   return 0;
 }
 
+/*
+ * sweep_overlap
+ *
+ * two sweep signatures conflict if their prefixes overlap.  a reply is
+ * looked up with a /32 signature for the address the probe was sent to.
+ */
+static int sweep_overlap(const scamper_task_sig_t *a,
+			 const scamper_task_sig_t *b)
+{
+  int plen = a->sig_sweep_plen < b->sig_sweep_plen ?
+    a->sig_sweep_plen : b->sig_sweep_plen;
+  if(a->sig_sweep_pfx->type != b->sig_sweep_pfx->type)
+    return 0;
+  return scamper_addr_inprefix(a->sig_sweep_pfx,
+			       b->sig_sweep_pfx->addr, plen);
+}
+
 static void tx_ip_check(scamper_dl_rec_t *dl)
 {
-  scamper_task_sig_t sig;
   scamper_addr_t addr, addr2buf, *addr2 = NULL;
-  patricia_t *pt;
-  s2t_t fm, *s2t;
+  sigtab_t *tab;
+  s2t_t *s2t;
 
   if(SCAMPER_DL_IS_IPV4(dl))
     {
       addr.type = SCAMPER_ADDR_TYPE_IPV4;
-      pt = tx_ip4;
+      tab = &tx_ip4;
     }
   else if(SCAMPER_DL_IS_IPV6(dl))
     {
       addr.type = SCAMPER_ADDR_TYPE_IPV6;
-      pt = tx_ip6;
+      tab = &tx_ip6;
     }
   else return;
 
+  if(tab->count == 0)
+    return;
+
   if(dl->dl_ip_off != 0)
     {
       addr.addr = dl->dl_ip_src;
@@ -219,19 +402,14 @@ static void tx_ip_check(scamper_dl_rec_t *dl)
       addr.addr = dl->dl_ip_dst;
     }
 
-  fm.sig = &sig;
-  sig.sig_type = SCAMPER_TASK_SIG_TYPE_TX_IP;
-  sig.sig_tx_ip_dst = &addr;
-
-  if((s2t = patricia_find(pt, &fm)) != NULL &&
+  if((s2t = sigtab_find(tab, &addr, 0, sigtab_hash(&addr, 0))) != NULL &&
      s2t->task->funcs->handle_dl != NULL)
     {
       s2t->task->funcs->handle_dl(s2t->task, dl);
     }
   else if(addr2 != NULL)
     {
-      sig.sig_tx_ip_dst = addr2;
-      if((s2t = patricia_find(pt, &fm)) != NULL &&
+      if((s2t = sigtab_find(tab, addr2, 0, sigtab_hash(addr2, 0))) != NULL &&
 	 s2t->task->funcs->handle_dl != NULL)
 	{
 	  s2t->task->funcs->handle_dl(s2t->task, dl);
@@ -243,37 +421,33 @@ static void tx_ip_check(scamper_dl_rec_t *dl)
 
 static void tx_nd_check(scamper_dl_rec_t *dl)
 {
-  scamper_task_sig_t sig;
   scamper_addr_t ip;
   struct in_addr ip4;
   struct in6_addr ip6;
-  patricia_t *pt;
-  s2t_t fm, *s2t;
+  sigtab_t *tab;
+  s2t_t *s2t;
 
   if(SCAMPER_DL_IS_ARP_OP_REPLY(dl) && SCAMPER_DL_IS_ARP_PRO_IPV4(dl))
     {
-      if(patricia_count(tx_nd4) <= 0)
+      if(tx_nd4.count <= 0)
 	return;
       ip.type = SCAMPER_ADDR_TYPE_IPV4;
       memcpy(&ip4, dl->dl_arp_spa, sizeof(ip4));
       ip.addr = &ip4;
-      pt = tx_nd4;
+      tab = &tx_nd4;
     }
   else if(SCAMPER_DL_IS_ICMP6_ND_NADV(dl))
     {
-      if(patricia_count(tx_nd6) <= 0)
+      if(tx_nd6.count <= 0)
 	return;
       ip.type = SCAMPER_ADDR_TYPE_IPV6;
       memcpy(&ip6, dl->dl_icmp6_nd_target, sizeof(ip6));
       ip.addr = &ip6;
-      pt = tx_nd6;
+      tab = &tx_nd6;
     }
   else return;
 
-  sig.sig_type = SCAMPER_TASK_SIG_TYPE_TX_ND;
-  sig.sig_tx_nd_ip = &ip;
-  fm.sig = &sig;
-  if((s2t = patricia_find(pt, &fm)) == NULL)
+  if((s2t = sigtab_find(tab, &ip, 0, sigtab_hash(&ip, 0))) == NULL)
     return;
 
   if(s2t->task->funcs->handle_dl != NULL)
@@ -284,13 +458,12 @@ static void tx_nd_check(scamper_dl_rec_t *dl)
 
 static void sniff_check(scamper_dl_rec_t *dl)
 {
-  scamper_task_sig_t *sig;
-  s2t_t *s2t;
-  dlist_node_t *n;
+  s2t_t *s2t, *next;
   scamper_addr_t src;
+  uint32_t hash;
   uint16_t id;
 
-  if(dlist_count(sniff) <= 0)
+  if(sniff.count <= 0)
     return;
 
   if(SCAMPER_DL_IS_ICMP_ECHO_REPLY(dl))
@@ -308,12 +481,12 @@ static void sniff_check(scamper_dl_rec_t *dl)
     return;
   src.addr = dl->dl_ip_dst;
 
-  for(n = dlist_head_node(sniff); n != NULL; n = dlist_node_next(n))
+  /* more than one sniff task may be watching the same source and id */
+  hash = sigtab_hash(&src, id);
+  for(s2t = sniff.buckets[hash & sniff.mask]; s2t != NULL; s2t = next)
     {
-      s2t = dlist_node_item(n); sig = s2t->sig;
-      if(sig->sig_sniff_icmp_id != id)
-	continue;
-      if(scamper_addr_cmp(sig->sig_sniff_src, &src) != 0)
+      next = s2t->hnext;
+      if(sigtab_match(s2t, &src, id, hash) == 0)
 	continue;
 
       if(s2t->task->funcs->handle_dl != NULL)
@@ -332,30 +505,43 @@ static void s2t_free(s2t_t *s2t)
 
   if(s2t->node != NULL)
     {
-      if(sig->sig_type == SCAMPER_TASK_SIG_TYPE_TX_IP)
-	{
-	  if(sig->sig_tx_ip_dst->type == SCAMPER_ADDR_TYPE_IPV4)
-	    patricia_remove_node(tx_ip4, s2t->node);
-	  else
-	    patricia_remove_node(tx_ip6, s2t->node);
-	}
-      else if(sig->sig_type == SCAMPER_TASK_SIG_TYPE_TX_ND)
-	{
-	  if(sig->sig_tx_nd_ip->type == SCAMPER_ADDR_TYPE_IPV4)
-	    patricia_remove_node(tx_nd4, s2t->node);
-	  else
-	    patricia_remove_node(tx_nd6, s2t->node);
-	}
-      else if(sig->sig_type == SCAMPER_TASK_SIG_TYPE_SNIFF)
-	dlist_node_pop(sniff, s2t->node);
+      if(sig->sig_type == SCAMPER_TASK_SIG_TYPE_TX_IP ||
+	 sig->sig_type == SCAMPER_TASK_SIG_TYPE_TX_ND ||
+	 sig->sig_type == SCAMPER_TASK_SIG_TYPE_SNIFF)
+	sigtab_remove(s2t->node, s2t);
       else if(sig->sig_type == SCAMPER_TASK_SIG_TYPE_HOST)
 	splaytree_remove_node(host, s2t->node);
+      else if(sig->sig_type == SCAMPER_TASK_SIG_TYPE_SWEEP)
+	dlist_node_pop(sweep, s2t->node);
     }
 
   free(s2t);
   return;
 }
 
+void scamper_task_sig_dl(scamper_task_sig_dl_t *sd)
+{
+  s2t_t *s2t;
+  size_t i;
+
+  sd->tx_ip4 = tx_ip4.count;
+  sd->tx_ip6 = tx_ip6.count;
+  sd->tx_nd4 = tx_nd4.count;
+  sd->tx_nd6 = tx_nd6.count;
+  sd->sniff  = sniff.count;
+  sd->ip4c   = 0;
+
+  /* collect the IPv4 destinations if they all fit in the caller's array */
+  if(sd->tx_ip4 <= 0 || sd->tx_ip4 > sd->ip4m)
+    return;
+  for(i=0; i<=tx_ip4.mask; i++)
+    for(s2t = tx_ip4.buckets[i]; s2t != NULL; s2t = s2t->hnext)
+      memcpy(&sd->ip4[sd->ip4c++], s2t->sig->sig_tx_ip_dst->addr,
+	     sizeof(struct in_addr));
+
+  return;
+}
+
 char *scamper_task_sig_tostr(scamper_task_sig_t *sig, char *buf, size_t len)
 {
   char tmp[64];
@@ -374,12 +560,75 @@ char *scamper_task_sig_tostr(scamper_task_sig_t *sig, char *buf, size_t len)
   else if(sig->sig_type == SCAMPER_TASK_SIG_TYPE_HOST)
     string_concat(buf, len, &off, "host %s %u",
 		  sig->sig_host_name, sig->sig_host_type);
+  else if(sig->sig_type == SCAMPER_TASK_SIG_TYPE_SWEEP)
+    string_concat(buf, len, &off, "sweep %s/%u",
+		  scamper_addr_tostr(sig->sig_sweep_pfx, tmp, sizeof(tmp)),
+		  sig->sig_sweep_plen);
   else
     return NULL;
 
   return buf;
 }
 
+/*
+ * scamper_task_sig_hash
+ *
+ * hash the first signature of the task, so that tasks whose probes
+ * could be confused with each other hash to the same value.
+ */
+uint32_t scamper_task_sig_hash(const scamper_task_t *task)
+{
+  scamper_task_sig_t *sig;
+  const uint8_t *buf = NULL;
+  uint32_t h = 2166136261U;
+  size_t i, len = 0;
+  s2t_t *s2t;
+
+  if((s2t = slist_head_item(task->siglist)) == NULL)
+    return 0;
+  sig = s2t->sig;
+
+  if(sig->sig_type == SCAMPER_TASK_SIG_TYPE_TX_IP)
+    {
+      buf = sig->sig_tx_ip_dst->addr;
+      len = scamper_addr_size(sig->sig_tx_ip_dst);
+    }
+  else if(sig->sig_type == SCAMPER_TASK_SIG_TYPE_TX_ND)
+    {
+      buf = sig->sig_tx_nd_ip->addr;
+      len = scamper_addr_size(sig->sig_tx_nd_ip);
+    }
+  else if(sig->sig_type == SCAMPER_TASK_SIG_TYPE_SNIFF)
+    {
+      buf = sig->sig_sniff_src->addr;
+      len = scamper_addr_size(sig->sig_sniff_src);
+    }
+  else if(sig->sig_type == SCAMPER_TASK_SIG_TYPE_HOST)
+    {
+      buf = (const uint8_t *)sig->sig_host_name;
+      len = strlen(sig->sig_host_name);
+    }
+  else if(sig->sig_type == SCAMPER_TASK_SIG_TYPE_SWEEP)
+    {
+      buf = sig->sig_sweep_pfx->addr;
+      len = scamper_addr_size(sig->sig_sweep_pfx);
+    }
+
+  /* FNV-1a */
+  for(i=0; i<len; i++)
+    {
+      h ^= buf[i];
+      h *= 16777619;
+    }
+
+  return h;
+}
+
+int scamper_task_sig_count(const scamper_task_t *task)
+{
+  return slist_count(task->siglist);
+}
+
 scamper_task_sig_t *scamper_task_sig_alloc(uint8_t type)
 {
   scamper_task_sig_t *sig;
@@ -411,6 +660,10 @@ void scamper_task_sig_free(scamper_task_sig_t *sig)
     case SCAMPER_TASK_SIG_TYPE_HOST:
       if(sig->sig_host_name != NULL) free(sig->sig_host_name);
       break;
+
+    case SCAMPER_TASK_SIG_TYPE_SWEEP:
+      if(sig->sig_sweep_pfx != NULL) scamper_addr_free(sig->sig_sweep_pfx);
+      break;
     }
 
   free(sig);
@@ -461,22 +714,26 @@ int scamper_task_sig_add(scamper_task_t *task, scamper_task_sig_t *sig)
 
 scamper_task_t *scamper_task_find(scamper_task_sig_t *sig)
 {
-  s2t_t fm, *s2t;
+  const scamper_addr_t *key;
+  dlist_node_t *n;
+  s2t_t *s2t;
+  uint16_t id;
 
-  fm.sig = sig;
-  if(sig->sig_type == SCAMPER_TASK_SIG_TYPE_TX_IP)
+  if(sig->sig_type == SCAMPER_TASK_SIG_TYPE_TX_IP ||
+     sig->sig_type == SCAMPER_TASK_SIG_TYPE_TX_ND)
     {
-      if(sig->sig_tx_ip_dst->type == SCAMPER_ADDR_TYPE_IPV4)
-	s2t = patricia_find(tx_ip4, &fm);
-      else
-	s2t = patricia_find(tx_ip6, &fm);
+      key = sig_key(sig, &id);
+      s2t = sigtab_find(sigtab_get(sig), key, id, sigtab_hash(key, id));
     }
-  else if(sig->sig_type == SCAMPER_TASK_SIG_TYPE_TX_ND)
+  else if(sig->sig_type == SCAMPER_TASK_SIG_TYPE_SWEEP)
     {
-      if(sig->sig_tx_nd_ip->type == SCAMPER_ADDR_TYPE_IPV4)
-	s2t = patricia_find(tx_nd4, &fm);
-      else
-	s2t = patricia_find(tx_nd6, &fm);
+      for(n = dlist_head_node(sweep); n != NULL; n = dlist_node_next(n))
+	{
+	  s2t = dlist_node_item(n);
+	  if(sweep_overlap(s2t->sig, sig) != 0)
+	    return s2t->task;
+	}
+      return NULL;
     }
   else
     return NULL;
@@ -491,14 +748,21 @@ void scamper_task_sig_deinstall(scamper_task_t *task)
   s2t_t *s2t;
   scamper_task_sig_t *sig;
   slist_node_t *n;
+  int dl = 0;
 
   for(n=slist_head_node(task->siglist); n != NULL; n = slist_node_next(n))
     {
       s2t = slist_node_item(n); sig = s2t->sig;
+      if(s2t->node != NULL && sig->sig_type != SCAMPER_TASK_SIG_TYPE_HOST &&
+	 sig->sig_type != SCAMPER_TASK_SIG_TYPE_SWEEP)
+	dl = 1;
       s2t_free(s2t);
       scamper_task_sig_free(sig);
     }
 
+  if(dl != 0)
+    scamper_dl_filter_update();
+
   return;
 }
 
@@ -508,6 +772,7 @@ int scamper_task_sig_install(scamper_task_t *task)
   scamper_task_t *tf;
   s2t_t *s2t;
   slist_node_t *n;
+  int dl = 0;
 
   if(slist_count(task->siglist) < 1)
     {
@@ -527,32 +792,29 @@ int scamper_task_sig_install(scamper_task_t *task)
 	  continue;
 	}
 
-      if(sig->sig_type == SCAMPER_TASK_SIG_TYPE_TX_IP)
-	{
-	  if(sig->sig_tx_ip_dst->type == SCAMPER_ADDR_TYPE_IPV4)
-	    s2t->node = patricia_insert(tx_ip4, s2t);
-	  else
-	    s2t->node = patricia_insert(tx_ip6, s2t);
-	}
-      else if(sig->sig_type == SCAMPER_TASK_SIG_TYPE_TX_ND)
-	{
-	  if(sig->sig_tx_nd_ip->type == SCAMPER_ADDR_TYPE_IPV4)
-	    s2t->node = patricia_insert(tx_nd4, s2t);
-	  else
-	    s2t->node = patricia_insert(tx_nd6, s2t);
-	}
-      else if(sig->sig_type == SCAMPER_TASK_SIG_TYPE_SNIFF)
-	s2t->node = dlist_tail_push(sniff, s2t);
+      if(sig->sig_type == SCAMPER_TASK_SIG_TYPE_TX_IP ||
+	 sig->sig_type == SCAMPER_TASK_SIG_TYPE_TX_ND ||
+	 sig->sig_type == SCAMPER_TASK_SIG_TYPE_SNIFF)
+	sigtab_insert(sigtab_get(sig), s2t);
       else if(sig->sig_type == SCAMPER_TASK_SIG_TYPE_HOST)
 	s2t->node = splaytree_insert(host, s2t);
+      else if(sig->sig_type == SCAMPER_TASK_SIG_TYPE_SWEEP)
+	s2t->node = dlist_tail_push(sweep, s2t);
 
       if(s2t->node == NULL)
 	{
 	  scamper_debug(__func__, "could not install sig");
 	  goto err;
 	}
+
+      if(sig->sig_type != SCAMPER_TASK_SIG_TYPE_HOST &&
+	 sig->sig_type != SCAMPER_TASK_SIG_TYPE_SWEEP)
+	dl = 1;
     }
 
+  if(dl != 0)
+    scamper_dl_filter_update();
+
   return 0;
 
  err:
@@ -617,6 +879,66 @@ int scamper_task_dehold(scamper_task_t *task, void *cookie)
   return 0;
 }
 
+static task_mem_t *task_mem_get(const scamper_task_funcs_t *funcs)
+{
+  int i;
+
+  for(i=0; i<memc; i++)
+    if(mems[i].funcs == funcs)
+      return &mems[i];
+
+  if(memc == sizeof(mems) / sizeof(task_mem_t))
+    return NULL;
+
+  mems[memc].funcs = funcs;
+  mems[memc].bytes = 0;
+  mems[memc].taskc = 0;
+  return &mems[memc++];
+}
+
+/*
+ * scamper_task_mem_add
+ *
+ * record that the task now holds an additional len bytes.  the
+ * accounting is approximate: callers record the structures they
+ * allocate, not the overhead of the allocator.
+ */
+void scamper_task_mem_add(scamper_task_t *task, size_t len)
+{
+  task->bytes += len;
+  if(task->mem != NULL)
+    task->mem->bytes += len;
+  mem_total += len;
+  return;
+}
+
+static void task_mem_sub(scamper_task_t *task, size_t len)
+{
+  if(len > task->bytes)
+    len = task->bytes;
+  task->bytes -= len;
+  if(task->mem != NULL)
+    task->mem->bytes -= len;
+  mem_total -= len;
+  return;
+}
+
+size_t scamper_task_mem_total(void)
+{
+  return mem_total;
+}
+
+void scamper_task_mem_foreach(void *param,
+			      void (*func)(void *param, const char *name,
+					   int taskc, size_t bytes))
+{
+  int i;
+  for(i=0; i<memc; i++)
+    func(param, mems[i].funcs->name != NULL ? mems[i].funcs->name : "task",
+	 mems[i].taskc, mems[i].bytes);
+  return;
+}
+
 /*
  * scamper_task_alloc
  *
@@ -644,6 +966,10 @@ scamper_task_t *scamper_task_alloc(void *data, scamper_task_funcs_t *funcs)
   task->funcs = funcs;
   task->data = data;
 
+  if((task->mem = task_mem_get(funcs)) != NULL)
+    task->mem->taskc++;
+  scamper_task_mem_add(task, sizeof(scamper_task_t));
+
   return task;
 
  err:
@@ -665,6 +991,9 @@ void scamper_task_free(scamper_task_t *task)
   task_onhold_t *toh;
   int i;
 
+  /* do not tell the task about probes it queued that are not yet sent */
+  scamper_probe_txcb_cancel(task);
+
   if(task->funcs != NULL)
     task->funcs->task_free(task);
 
@@ -720,6 +1049,10 @@ void scamper_task_free(scamper_task_t *task)
       free(task->fds);
     }
 
+  if(task->mem != NULL)
+    task->mem->taskc--;
+  task_mem_sub(task, task->bytes);
+
   free(task);
   return;
 }
@@ -752,6 +1085,25 @@ scamper_source_t *scamper_task_getsource(scamper_task_t *task)
   return scamper_sourcetask_getsource(task->sourcetask);
 }
 
+/*
+ * scamper_task_getfile
+ *
+ * return the file that the task's results will be written to, for tasks
+ * that write some of their results out before they are done.
+ */
+scamper_file_t *scamper_task_getfile(scamper_task_t *task)
+{
+  scamper_source_t *source;
+  scamper_outfile_t *sof;
+  const char *sofname;
+
+  if((source = scamper_task_getsource(task)) == NULL ||
+     (sofname = scamper_source_getoutfile(source)) == NULL ||
+     (sof = scamper_outfiles_get(sofname)) == NULL)
+    return NULL;
+  return scamper_outfile_getfile(sof);
+}
+
 void scamper_task_setsourcetask(scamper_task_t *task, scamper_sourcetask_t *st)
 {
   assert(task->sourcetask == NULL);
@@ -771,10 +1123,40 @@ void scamper_task_write(scamper_task_t *task, scamper_file_t *file)
   return;
 }
 
-void scamper_task_probe(scamper_task_t *task)
+/*
+ * scamper_task_probe
+ *
+ * have the task send its next probe, and return the number of packets
+ * it sent.  a task that sends its probes other than through
+ * scamper_probe, or sends nothing, is counted as sending one packet.
+ */
+uint32_t scamper_task_probe(scamper_task_t *task)
 {
+  uint32_t c = scamper_probe_getcount();
+
   task->funcs->probe(task);
-  return;
+  if((c = scamper_probe_getcount() - c) == 0)
+    c = 1;
+
+  /* the source the task came from is charged for each packet */
+  if(task->sourcetask != NULL)
+    scamper_source_charge(scamper_sourcetask_getsource(task->sourcetask),
+			  c);
+
+  return c;
+}
+
+/*
+ * scamper_task_canprobe
+ *
+ * return non-zero if the source the task came from is under its pps cap.
+ */
+int scamper_task_canprobe(scamper_task_t *task, const struct timeval *now)
+{
+  if(task->sourcetask == NULL)
+    return 1;
+  return scamper_source_pps_ok(scamper_sourcetask_getsource(task->sourcetask),
+			       now);
 }
 
 void scamper_task_halt(scamper_task_t *task)
@@ -932,36 +1314,27 @@ scamper_fd_t *scamper_task_fd_rtsock(scamper_task_t *task)
 
 int scamper_task_init(void)
 {
-  if((tx_ip4 = patricia_alloc((patricia_bit_t)tx_ip_bit,
-			      (patricia_cmp_t)tx_ip_cmp,
-			      (patricia_fbd_t)tx_ip_fbd)) == NULL)
-    return -1;
-  if((tx_ip6 = patricia_alloc((patricia_bit_t)tx_ip_bit,
-			      (patricia_cmp_t)tx_ip_cmp,
-			      (patricia_fbd_t)tx_ip_fbd)) == NULL)
-    return -1;
-  if((tx_nd4 = patricia_alloc((patricia_bit_t)tx_nd_bit,
-			      (patricia_cmp_t)tx_nd_cmp,
-			      (patricia_fbd_t)tx_nd_fbd)) == NULL)
-    return -1;
-  if((tx_nd6 = patricia_alloc((patricia_bit_t)tx_nd_bit,
-			      (patricia_cmp_t)tx_nd_cmp,
-			      (patricia_fbd_t)tx_nd_fbd)) == NULL)
+  if(sigtab_resize(&tx_ip4, SIGTAB_BUCKETS_MIN) != 0 ||
+     sigtab_resize(&tx_ip6, SIGTAB_BUCKETS_MIN) != 0 ||
+     sigtab_resize(&tx_nd4, SIGTAB_BUCKETS_MIN) != 0 ||
+     sigtab_resize(&tx_nd6, SIGTAB_BUCKETS_MIN) != 0 ||
+     sigtab_resize(&sniff, SIGTAB_BUCKETS_MIN) != 0)
     return -1;
   if((host = splaytree_alloc((splaytree_cmp_t)host_cmp)) == NULL)
     return -1;
-  if((sniff = dlist_alloc()) == NULL)
+  if((sweep = dlist_alloc()) == NULL)
     return -1;
   return 0;
 }
 
 void scamper_task_cleanup(void)
 {
-  if(tx_ip4 != NULL) { patricia_free(tx_ip4); tx_ip4 = NULL; }
-  if(tx_ip6 != NULL) { patricia_free(tx_ip6); tx_ip6 = NULL; }
-  if(tx_nd4 != NULL) { patricia_free(tx_nd4); tx_nd4 = NULL; }
-  if(tx_nd6 != NULL) { patricia_free(tx_nd6); tx_nd6 = NULL; }
+  sigtab_free(&tx_ip4);
+  sigtab_free(&tx_ip6);
+  sigtab_free(&tx_nd4);
+  sigtab_free(&tx_nd6);
+  sigtab_free(&sniff);
   if(host != NULL)   { splaytree_free(host, NULL);   host   = NULL; }
-  if(sniff != NULL)  { dlist_free(sniff); sniff = NULL; }
+  if(sweep != NULL)  { dlist_free(sweep); sweep = NULL; }
   return;
 }
@@ -40,6 +40,7 @@ struct scamper_sourcetask;
 #define SCAMPER_TASK_SIG_TYPE_TX_ND 2
 #define SCAMPER_TASK_SIG_TYPE_SNIFF 3
 #define SCAMPER_TASK_SIG_TYPE_HOST  4
+#define SCAMPER_TASK_SIG_TYPE_SWEEP 5
 
 typedef struct scamper_task scamper_task_t;
 typedef struct scamper_task_anc scamper_task_anc_t;
@@ -68,9 +69,35 @@ typedef struct scamper_task_sig
       char                *name;
       uint16_t             type;
     } host;
+    struct sweep_sig
+    {
+      struct scamper_addr *pfx;
+      uint8_t              plen;
+    } sweep;
   } un;
 } scamper_task_sig_t;
 
+/*
+ * scamper_task_sig_dl_t
+ *
+ * a summary of the signatures installed that need frames from the
+ * datalink, used to build a filter for the datalink.  the caller
+ * supplies space in ip4 for up to ip4m of the IPv4 destinations of
+ * tx_ip signatures; ip4c is how many were filled, and is only
+ * meaningful if tx_ip4 <= ip4m.
+ */
+typedef struct scamper_task_sig_dl
+{
+  int             tx_ip4;
+  int             tx_ip6;
+  int             tx_nd4;
+  int             tx_nd6;
+  int             sniff;
+  struct in_addr *ip4;
+  int             ip4m;
+  int             ip4c;
+} scamper_task_sig_dl_t;
+
 #define sig_tx_ip_dst         un.ip.dst
 #define sig_tx_ip_src         un.ip.src
 #define sig_tx_nd_ip          un.nd.ip
@@ -78,6 +105,8 @@ typedef struct scamper_task_sig
 #define sig_sniff_icmp_id     un.sniff.icmpid
 #define sig_host_name         un.host.name
 #define sig_host_type         un.host.type
+#define sig_sweep_pfx         un.sweep.pfx
+#define sig_sweep_plen        un.sweep.plen
 
 typedef struct scamper_task_funcs
 {
@@ -102,6 +131,9 @@ typedef struct scamper_task_funcs
   /* free the task's data and state */
   void (*task_free)(struct scamper_task *task);
 
+  /* the name of the task type, used when reporting memory use */
+  const char *name;
+
 } scamper_task_funcs_t;
 
 scamper_task_t *scamper_task_alloc(void *data, scamper_task_funcs_t *funcs);
@@ -111,6 +143,7 @@ void scamper_task_free(scamper_task_t *task);
 void *scamper_task_getdata(const scamper_task_t *task);
 void *scamper_task_getstate(const scamper_task_t *task);
 struct scamper_source *scamper_task_getsource(scamper_task_t *task);
+struct scamper_file *scamper_task_getfile(scamper_task_t *task);
 
 /* set various items on the task */
 void scamper_task_setdatanull(scamper_task_t *task);
@@ -121,10 +154,18 @@ void scamper_task_setcyclemon(scamper_task_t *t, struct scamper_cyclemon *cm);
 
 /* access the various functions registered with the task */
 void scamper_task_write(scamper_task_t *task, struct scamper_file *file);
-void scamper_task_probe(scamper_task_t *task);
+uint32_t scamper_task_probe(scamper_task_t *task);
+int scamper_task_canprobe(scamper_task_t *task, const struct timeval *now);
 void scamper_task_handletimeout(scamper_task_t *task);
 void scamper_task_halt(scamper_task_t *task);
 
+/* account for memory held by the task's data and state */
+void scamper_task_mem_add(scamper_task_t *task, size_t len);
+size_t scamper_task_mem_total(void);
+void scamper_task_mem_foreach(void *param,
+			      void (*func)(void *param, const char *name,
+					   int taskc, size_t bytes));
+
 /* pass the datalink record to all appropriate tasks */
 void scamper_task_handledl(struct scamper_dl_rec *dl);
 
@@ -165,6 +206,9 @@ int scamper_task_sig_install(scamper_task_t *task);
 void scamper_task_sig_deinstall(scamper_task_t *task);
 scamper_task_t *scamper_task_find(scamper_task_sig_t *sig);
 char *scamper_task_sig_tostr(scamper_task_sig_t *sig, char *buf, size_t len);
+uint32_t scamper_task_sig_hash(const scamper_task_t *task);
+int scamper_task_sig_count(const scamper_task_t *task);
+void scamper_task_sig_dl(scamper_task_sig_dl_t *sd);
 
 /* manage ancillary data attached to the task */
 scamper_task_anc_t *scamper_task_anc_add(scamper_task_t *task, void *data,
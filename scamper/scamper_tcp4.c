@@ -318,8 +318,8 @@ int scamper_tcp4_probe(scamper_probe_t *pr)
   /* get the transmit time immediately before we send the packet */
   gettimeofday_wrap(&pr->pr_tx);
 
-  i = sendto(pr->pr_fd, pktbuf, len, 0, (struct sockaddr *)&sin4,
-	     sizeof(struct sockaddr_in));
+  i = scamper_probe_sendto(pr, pktbuf, len, (struct sockaddr *)&sin4,
+			   sizeof(struct sockaddr_in));
 
   if(i < 0)
     {
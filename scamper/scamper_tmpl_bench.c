@@ -0,0 +1,190 @@
+/*
+ * scamper_tmpl_bench.c
+ *
+ * $Id$
+ *
+ * compare the rate that trace and ping measurements are built for a list
+ * of addresses when the command is parsed for each address, and when the
+ * command is parsed once into a template that each measurement is then
+ * built from.  build with "make scamper_tmpl_bench".
+ *
+ * Copyright (C) 2026 Matthew Luckie
+ * Author: Matthew Luckie
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include "internal.h"
+
+#include "scamper_addr.h"
+#include "scamper_list.h"
+#include "scamper_task.h"
+#include "trace/scamper_trace.h"
+#include "trace/scamper_trace_do.h"
+#include "ping/scamper_ping.h"
+#include "ping/scamper_ping_do.h"
+#include "utils.h"
+
+/*
+ * the rest of scamper is linked in with its main renamed to scamper_main
+ * so that the functions that build measurements can be called directly
+ */
+#undef main
+
+extern scamper_addrcache_t *addrcache;
+
+typedef struct bench_cmd
+{
+  char   *name;
+  char   *opts;
+  void *(*allocdata)(char *);
+  void *(*alloctmpl)(char *);
+  void *(*tmpldata)(const void *, const char *);
+  void  (*freetmpl)(void *);
+  void  (*freedata)(void *);
+} bench_cmd_t;
+
+static void bench_trace_free(void *data)
+{
+  scamper_trace_free(data);
+  return;
+}
+
+static void bench_ping_free(void *data)
+{
+  scamper_ping_free(data);
+  return;
+}
+
+static const bench_cmd_t cmds[] = {
+  {"trace", "-P icmp-paris -q 1",
+   scamper_do_trace_alloc, scamper_do_trace_tmpl_alloc,
+   scamper_do_trace_tmpl_data, scamper_do_trace_tmpl_free,
+   bench_trace_free},
+  {"ping", "-c 4 -P udp -d 33435",
+   scamper_do_ping_alloc, scamper_do_ping_tmpl_alloc,
+   scamper_do_ping_tmpl_data, scamper_do_ping_tmpl_free,
+   bench_ping_free},
+};
+static int cmds_cnt = sizeof(cmds) / sizeof(bench_cmd_t);
+
+static char **addrs = NULL;
+static int    addrc = 200000;
+
+static int bench_parse(const bench_cmd_t *cmd, int *elapsed)
+{
+  struct timeval t0, t1;
+  char buf[128];
+  size_t off;
+  void *data;
+  int i;
+
+  gettimeofday_wrap(&t0);
+  for(i=0; i<addrc; i++)
+    {
+      off = 0;
+      string_concat(buf, sizeof(buf), &off, "%s %s", cmd->opts, addrs[i]);
+      if((data = cmd->allocdata(buf)) == NULL)
+	return -1;
+      cmd->freedata(data);
+    }
+  gettimeofday_wrap(&t1);
+
+  *elapsed = timeval_diff_ms(&t1, &t0);
+  return 0;
+}
+
+static int bench_tmpl(const bench_cmd_t *cmd, int *elapsed)
+{
+  struct timeval t0, t1;
+  void *tmpl, *data;
+  char *opts;
+  int i;
+
+  gettimeofday_wrap(&t0);
+  if((opts = strdup(cmd->opts)) == NULL ||
+     (tmpl = cmd->alloctmpl(opts)) == NULL)
+    return -1;
+  for(i=0; i<addrc; i++)
+    {
+      if((data = cmd->tmpldata(tmpl, addrs[i])) == NULL)
+	return -1;
+      cmd->freedata(data);
+    }
+  cmd->freetmpl(tmpl);
+  free(opts);
+  gettimeofday_wrap(&t1);
+
+  *elapsed = timeval_diff_ms(&t1, &t0);
+  return 0;
+}
+
+static int bench_rate(int ms)
+{
+  if(ms < 1)
+    ms = 1;
+  return (int)(((long long)addrc * 1000) / ms);
+}
+
+int main(int argc, char *argv[])
+{
+  char buf[32];
+  size_t off;
+  int i, parse_ms, tmpl_ms;
+
+  if(argc > 1 && (addrc = atoi(argv[1])) < 1)
+    {
+      fprintf(stderr, "usage: scamper_tmpl_bench [addrs]\n");
+      return -1;
+    }
+
+  if((addrcache = scamper_addrcache_alloc()) == NULL ||
+     (addrs = malloc_zero(sizeof(char *) * addrc)) == NULL)
+    return -1;
+
+  /* a list of addresses in 10.0.0.0/8, as a list source would supply */
+  for(i=0; i<addrc; i++)
+    {
+      off = 0;
+      string_concat(buf, sizeof(buf), &off, "10.%d.%d.%d",
+		    (i >> 16) & 0xff, (i >> 8) & 0xff, i & 0xff);
+      if((addrs[i] = strdup(buf)) == NULL)
+	return -1;
+    }
+
+  printf("addrs %d\n", addrc);
+  for(i=0; i<cmds_cnt; i++)
+    {
+      if(bench_parse(&cmds[i], &parse_ms) != 0 ||
+	 bench_tmpl(&cmds[i], &tmpl_ms) != 0)
+	{
+	  fprintf(stderr, "could not build %s %s\n", cmds[i].name,
+		  cmds[i].opts);
+	  return -1;
+	}
+      printf("%s %s\n", cmds[i].name, cmds[i].opts);
+      printf("  parse:    %d ms, %d/s\n", parse_ms, bench_rate(parse_ms));
+      printf("  template: %d ms, %d/s\n", tmpl_ms, bench_rate(tmpl_ms));
+    }
+
+  for(i=0; i<addrc; i++)
+    free(addrs[i]);
+  free(addrs);
+  scamper_addrcache_free(addrcache);
+  return 0;
+}
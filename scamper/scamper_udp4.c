@@ -172,8 +172,8 @@ int scamper_udp4_probe(scamper_probe_t *probe)
   /* get the transmit time immediately before we send the packet */
   gettimeofday_wrap(&probe->pr_tx);
 
-  i = sendto(probe->pr_fd, pktbuf, len, 0, (struct sockaddr *)&sin4,
-	     sizeof(struct sockaddr_in));
+  i = scamper_probe_sendto(probe, pktbuf, len, (struct sockaddr *)&sin4,
+			   sizeof(struct sockaddr_in));
 
   if(i < 0)
     {
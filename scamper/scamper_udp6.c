@@ -144,8 +144,10 @@ int scamper_udp6_probe(scamper_probe_t *probe)
   assert(probe->pr_ip_src != NULL);
   assert(probe->pr_len != 0 || probe->pr_data == NULL);
 
+  /* batched probes carry their hop limit with them */
   i = probe->pr_ip_ttl;
-  if(setsockopt(probe->pr_fd,
+  if(scamper_probe_batched(probe) == 0 &&
+     setsockopt(probe->pr_fd,
 		IPPROTO_IPV6, IPV6_UNICAST_HOPS, (char *)&i, sizeof(i)) == -1)
     {
       printerror(__func__, "could not set hlim to %d", i);
@@ -169,8 +171,9 @@ int scamper_udp6_probe(scamper_probe_t *probe)
 
   for(j=0; j<k; j++)
     {
-      i = sendto(probe->pr_fd, probe->pr_data, probe->pr_len, 0,
-		 (struct sockaddr *)&sin6, sizeof(struct sockaddr_in6));
+      i = scamper_probe_sendto(probe, probe->pr_data, probe->pr_len,
+			       (struct sockaddr *)&sin6,
+			       sizeof(struct sockaddr_in6));
 
       /*
        * if we sent the probe successfully, there is nothing more to
@@ -0,0 +1,138 @@
+/*
+ * scamper_warts_append_test.c
+ *
+ * $Id$
+ *
+ * check that a warts file that already holds data records can be
+ * opened in append mode, and that the records written before and after
+ * are all read back.  run with "make check".
+ *
+ * Copyright (C) 2026 Matthew Luckie
+ * Author: Matthew Luckie
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include "internal.h"
+
+#include "scamper_addr.h"
+#include "scamper_list.h"
+#include "scamper_file.h"
+#include "ping/scamper_ping.h"
+#include "utils.h"
+
+/* enough records that the first pass fills more than one read-ahead */
+#define TEST_RECORDS 5000
+
+static int write_pings(char *filename, char mode, scamper_cycle_t *cycle,
+		       int count)
+{
+  scamper_file_t *sf = NULL;
+  scamper_ping_t *ping = NULL;
+  int i, rc = -1;
+
+  if((sf = scamper_file_open(filename, mode, "warts")) == NULL)
+    {
+      fprintf(stderr, "could not open %s mode %c\n", filename, mode);
+      goto done;
+    }
+
+  for(i=0; i<count; i++)
+    {
+      if((ping = scamper_ping_alloc()) == NULL ||
+	 (ping->src = scamper_addr_resolve(AF_INET, "192.0.2.1")) == NULL ||
+	 (ping->dst = scamper_addr_resolve(AF_INET, "192.0.2.2")) == NULL)
+	goto done;
+      ping->list = scamper_list_use(cycle->list);
+      ping->cycle = scamper_cycle_use(cycle);
+      ping->userid = i;
+      if(scamper_file_write_ping(sf, ping) != 0)
+	{
+	  fprintf(stderr, "could not write ping %d mode %c\n", i, mode);
+	  goto done;
+	}
+      scamper_ping_free(ping); ping = NULL;
+    }
+  rc = 0;
+
+ done:
+  if(ping != NULL) scamper_ping_free(ping);
+  if(sf != NULL) scamper_file_close(sf);
+  return rc;
+}
+
+static int count_pings(char *filename)
+{
+  scamper_file_filter_t *filter = NULL;
+  scamper_file_t *sf = NULL;
+  uint16_t type = SCAMPER_FILE_OBJ_PING;
+  uint16_t obj_type;
+  void *obj;
+  int count = -1;
+
+  if((sf = scamper_file_open(filename, 'r', NULL)) == NULL ||
+     (filter = scamper_file_filter_alloc(&type, 1)) == NULL)
+    goto done;
+
+  count = 0;
+  while(scamper_file_read(sf, filter, &obj_type, &obj) == 0)
+    {
+      if(obj == NULL)
+	break;
+      scamper_ping_free(obj);
+      count++;
+    }
+
+ done:
+  if(filter != NULL) scamper_file_filter_free(filter);
+  if(sf != NULL) scamper_file_close(sf);
+  return count;
+}
+
+int main(int argc, char *argv[])
+{
+  scamper_list_t *list = NULL;
+  scamper_cycle_t *cycle = NULL;
+  char filename[64];
+  int count, rc = -1;
+
+  snprintf(filename, sizeof(filename), "warts_append_test.%d.warts",
+	   (int)getpid());
+  unlink(filename);
+
+  if((list = scamper_list_alloc(1, "test", NULL, NULL)) == NULL ||
+     (cycle = scamper_cycle_alloc(list)) == NULL)
+    goto done;
+
+  if(write_pings(filename, 'w', cycle, TEST_RECORDS) != 0 ||
+     write_pings(filename, 'a', cycle, 1) != 0)
+    goto done;
+
+  if((count = count_pings(filename)) != TEST_RECORDS + 1)
+    {
+      fprintf(stderr, "read %d pings, expected %d\n", count, TEST_RECORDS+1);
+      goto done;
+    }
+  rc = 0;
+
+ done:
+  unlink(filename);
+  if(cycle != NULL) scamper_cycle_free(cycle);
+  if(list != NULL) scamper_list_free(list);
+  return rc;
+}
@@ -448,6 +448,7 @@ int scamper_do_sniff_init()
   sniff_funcs.handle_dl      = do_sniff_handle_dl;
   sniff_funcs.write          = do_sniff_write;
   sniff_funcs.task_free      = do_sniff_free;
+  sniff_funcs.name           = "sniff";
   sniff_funcs.halt           = do_sniff_halt;
 
   return 0;
@@ -334,12 +334,10 @@ int scamper_file_warts_sniff_read(scamper_file_t *sf, const warts_hdr_t *hdr,
 
   warts_addrtable_free(table);
   *sniff_out = sniff;
-  free(buf);
   return 0;
 
  err:
   if(table != NULL) warts_addrtable_free(table);
-  if(buf != NULL) free(buf);
   if(sniff != NULL) scamper_sniff_free(sniff);
   return -1;
 }
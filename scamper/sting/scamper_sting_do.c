@@ -1116,6 +1116,7 @@ int scamper_do_sting_init(void)
   sting_funcs.handle_timeout = do_sting_handle_timeout;
   sting_funcs.write          = do_sting_write;
   sting_funcs.task_free      = do_sting_free;
+  sting_funcs.name           = "sting";
   sting_funcs.halt           = do_sting_halt;
 
   return 0;
@@ -400,12 +400,10 @@ int scamper_file_warts_sting_read(scamper_file_t *sf, const warts_hdr_t *hdr,
 
   warts_addrtable_free(table);
   *sting_out = sting;
-  free(buf);
   return 0;
 
  err:
   if(table != NULL) warts_addrtable_free(table);
-  if(buf != NULL) free(buf);
   if(sting != NULL) scamper_sting_free(sting);
   return -1;
 }
@@ -4540,6 +4540,7 @@ int scamper_do_tbit_init(void)
   tbit_funcs.handle_timeout = do_tbit_handle_timeout;
   tbit_funcs.write          = do_tbit_write;
   tbit_funcs.task_free      = do_tbit_free;
+  tbit_funcs.name           = "tbit";
   tbit_funcs.halt           = do_tbit_halt;
 
   return 0;
@@ -1070,12 +1070,10 @@ int scamper_file_warts_tbit_read(scamper_file_t *sf, const warts_hdr_t *hdr,
 
   warts_addrtable_free(table);
   *tbit_out = tbit;
-  free(buf);
   return 0;
 
  err:
   if(table != NULL) warts_addrtable_free(table);
-  if(buf != NULL) free(buf);
   if(tbit != NULL) scamper_tbit_free(tbit);
   return -1;
 }
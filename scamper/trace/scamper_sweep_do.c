@@ -0,0 +1,1078 @@
+/*
+ * scamper_sweep_do.c
+ *
+ * $Id$
+ *
+ * Copyright (C) 2026 Matthew Luckie
+ * Author: Matthew Luckie
+ *
+ * a sweep traces towards one address in every /24 of an IPv4 prefix
+ * without keeping state for each probe it sends, so that a large prefix
+ * can be traced at the rate scamper is allowed to probe.  the (target,
+ * TTL) pairs are probed in a random order so that no network sees a
+ * burst of probes, and each probe carries what is needed to make sense
+ * of a response to it:
+ *
+ *  - icmp-paris: the ICMP ID holds the time the probe was sent, in
+ *    milliseconds since the sweep began, and the ICMP sequence number
+ *    holds the TTL and a check value derived from the target.  the
+ *    payload is set so that the ICMP checksum is the same for all probes.
+ *
+ *  - udp-paris: the IP ID holds the time the probe was sent, and the UDP
+ *    checksum holds the TTL and the check value.
+ *
+ * the targets are probed in blocks.  the hops of a block's targets are
+ * kept only until the block's responses have had time to arrive, and
+ * then a trace record is written for each target that had a response.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include "internal.h"
+
+#include "scamper.h"
+#include "scamper_addr.h"
+#include "scamper_list.h"
+#include "scamper_icmpext.h"
+#include "scamper_trace.h"
+#include "scamper_fds.h"
+#include "scamper_task.h"
+#include "scamper_icmp_resp.h"
+#include "scamper_dl.h"
+#include "scamper_probe.h"
+#include "scamper_getsrc.h"
+#include "scamper_file.h"
+#include "scamper_options.h"
+#include "scamper_debug.h"
+#include "scamper_icmp4.h"
+#include "scamper_udp4.h"
+#include "scamper_sweep_do.h"
+#include "utils.h"
+
+/* the number of rounds in the feistel network permuting probe order */
+#define SWEEP_PERM_ROUNDS 4
+
+typedef struct sweep
+{
+  scamper_list_t   *list;
+  scamper_cycle_t  *cycle;
+  scamper_addr_t   *src;
+  scamper_addr_t   *pfx;
+  uint32_t          userid;
+  uint32_t          block;
+  uint16_t          sport;
+  uint16_t          dport;
+  uint8_t           plen;
+  uint8_t           type;
+  uint8_t           firsthop;
+  uint8_t           hoplimit;
+  uint8_t           offset;
+  uint8_t           wait;
+} sweep_t;
+
+/*
+ * sweep_perm
+ *
+ * a keyed permutation of [0, n).  a feistel network permutes a domain
+ * of 2^(2*bits) values, and values outside [0, n) are walked through
+ * the network again until they fall inside it.
+ */
+typedef struct sweep_perm
+{
+  uint32_t          n;
+  uint32_t          mask;
+  uint32_t          key[SWEEP_PERM_ROUNDS];
+  int               bits;
+} sweep_perm_t;
+
+typedef struct sweep_dst
+{
+  scamper_trace_hop_t **hops;
+} sweep_dst_t;
+
+/*
+ * sweep_block
+ *
+ * a block of targets, and the hops collected for them.  the (target,
+ * TTL) pairs of the block are probed in the order given by perm, and
+ * the block's responses are waited for until finish.
+ */
+typedef struct sweep_block
+{
+  uint32_t          id;
+  uint32_t          tc;
+  uint32_t          pos;
+  sweep_perm_t      perm;
+  struct timeval    start;
+  struct timeval    finish;
+  sweep_dst_t     **dsts;
+} sweep_block_t;
+
+typedef struct sweep_state
+{
+  scamper_fd_t     *probe;
+  sweep_perm_t      perm;
+  uint32_t          net;
+  uint32_t          check;
+  uint32_t          blockc;
+  uint8_t           ttlc;
+  struct timeval    start;
+  sweep_block_t    *cur;
+  sweep_block_t    *drain;
+} sweep_state_t;
+
+/* the callback functions registered with the sweep task */
+static scamper_task_funcs_t sweep_funcs;
+
+/* address cache used to avoid reallocating the same address multiple times */
+extern scamper_addrcache_t *addrcache;
+
+#define SWEEP_OPT_BLOCK    1
+#define SWEEP_OPT_DPORT    2
+#define SWEEP_OPT_FIRSTHOP 3
+#define SWEEP_OPT_HOPLIMIT 4
+#define SWEEP_OPT_OFFSET   5
+#define SWEEP_OPT_METHOD   6
+#define SWEEP_OPT_SPORT    7
+#define SWEEP_OPT_SRCADDR  8
+#define SWEEP_OPT_USERID   9
+#define SWEEP_OPT_WAIT     10
+
+static const scamper_option_in_t opts[] = {
+  {'b', NULL, SWEEP_OPT_BLOCK,    SCAMPER_OPTION_TYPE_NUM},
+  {'d', NULL, SWEEP_OPT_DPORT,    SCAMPER_OPTION_TYPE_NUM},
+  {'f', NULL, SWEEP_OPT_FIRSTHOP, SCAMPER_OPTION_TYPE_NUM},
+  {'m', NULL, SWEEP_OPT_HOPLIMIT, SCAMPER_OPTION_TYPE_NUM},
+  {'o', NULL, SWEEP_OPT_OFFSET,   SCAMPER_OPTION_TYPE_NUM},
+  {'P', NULL, SWEEP_OPT_METHOD,   SCAMPER_OPTION_TYPE_STR},
+  {'s', NULL, SWEEP_OPT_SPORT,    SCAMPER_OPTION_TYPE_NUM},
+  {'S', NULL, SWEEP_OPT_SRCADDR,  SCAMPER_OPTION_TYPE_STR},
+  {'U', NULL, SWEEP_OPT_USERID,   SCAMPER_OPTION_TYPE_NUM},
+  {'w', NULL, SWEEP_OPT_WAIT,     SCAMPER_OPTION_TYPE_NUM},
+};
+
+static const int opts_cnt = SCAMPER_OPTION_COUNT(opts);
+
+const char *scamper_do_sweep_usage(void)
+{
+  return
+    "sweep [-b block] [-d dport] [-f firsthop] [-m maxttl] [-o offset]\n"
+    "      [-P method] [-s sport] [-S srcaddr] [-U userid] [-w wait]\n"
+    "      <prefix>\n";
+}
+
+static sweep_t *sweep_getdata(const scamper_task_t *task)
+{
+  return scamper_task_getdata(task);
+}
+
+static sweep_state_t *sweep_getstate(const scamper_task_t *task)
+{
+  return scamper_task_getstate(task);
+}
+
+static uint32_t sweep_mix(uint32_t x)
+{
+  x ^= x >> 16; x *= 0x85ebca6b;
+  x ^= x >> 13; x *= 0xc2b2ae35;
+  x ^= x >> 16;
+  return x;
+}
+
+static uint32_t sweep_feistel(const sweep_perm_t *p, uint32_t x)
+{
+  uint32_t l = x >> p->bits, r = x & p->mask, t;
+  int i;
+
+  for(i=0; i<SWEEP_PERM_ROUNDS; i++)
+    {
+      t = l ^ (sweep_mix(r ^ p->key[i]) & p->mask);
+      l = r; r = t;
+    }
+
+  return (l << p->bits) | r;
+}
+
+static uint32_t sweep_feistel_inv(const sweep_perm_t *p, uint32_t x)
+{
+  uint32_t l = x >> p->bits, r = x & p->mask, t;
+  int i;
+
+  for(i=SWEEP_PERM_ROUNDS-1; i>=0; i--)
+    {
+      t = r ^ (sweep_mix(l ^ p->key[i]) & p->mask);
+      r = l; l = t;
+    }
+
+  return (l << p->bits) | r;
+}
+
+static uint32_t sweep_perm(const sweep_perm_t *p, uint32_t x)
+{
+  do x = sweep_feistel(p, x); while(x >= p->n);
+  return x;
+}
+
+static uint32_t sweep_perm_inv(const sweep_perm_t *p, uint32_t x)
+{
+  do x = sweep_feistel_inv(p, x); while(x >= p->n);
+  return x;
+}
+
+static int sweep_perm_init(sweep_perm_t *p, uint32_t n)
+{
+  int i;
+
+  p->n = n;
+  p->bits = 1;
+  while(p->bits < 16 && ((uint64_t)1 << (p->bits * 2)) < n)
+    p->bits++;
+  p->mask = (1 << p->bits) - 1;
+
+  for(i=0; i<SWEEP_PERM_ROUNDS; i++)
+    if(random_u32(&p->key[i]) != 0)
+      return -1;
+
+  return 0;
+}
+
+/*
+ * sweep_check
+ *
+ * the check value carried in a probe, so that a response to a probe
+ * sent by an earlier sweep, or to another target, is not mistaken for
+ * a response to this sweep.
+ */
+static uint8_t sweep_check(const sweep_state_t *state, uint32_t addr)
+{
+  return sweep_mix(addr ^ state->check) & 0xff;
+}
+
+static void sweep_dst_free(sweep_dst_t *dst, uint8_t ttlc)
+{
+  int i;
+  if(dst->hops != NULL)
+    {
+      for(i=0; i<ttlc; i++)
+	if(dst->hops[i] != NULL)
+	  scamper_trace_hop_free(dst->hops[i]);
+      free(dst->hops);
+    }
+  free(dst);
+  return;
+}
+
+static void sweep_block_free(sweep_block_t *blk, uint8_t ttlc)
+{
+  uint32_t i;
+  if(blk->dsts != NULL)
+    {
+      for(i=0; i<blk->tc; i++)
+	if(blk->dsts[i] != NULL)
+	  sweep_dst_free(blk->dsts[i], ttlc);
+      free(blk->dsts);
+    }
+  free(blk);
+  return;
+}
+
+static sweep_block_t *sweep_block_alloc(const sweep_t *sweep,
+					const sweep_state_t *state,
+					uint32_t id)
+{
+  sweep_block_t *blk = NULL;
+  uint32_t tc = state->perm.n - (id * sweep->block);
+
+  if(tc > sweep->block)
+    tc = sweep->block;
+
+  if((blk = malloc_zero(sizeof(sweep_block_t))) == NULL ||
+     (blk->dsts = malloc_zero(sizeof(sweep_dst_t *) * tc)) == NULL)
+    {
+      printerror(__func__, "could not alloc block");
+      goto err;
+    }
+  blk->id = id;
+  blk->tc = tc;
+
+  if(sweep_perm_init(&blk->perm, tc * state->ttlc) != 0)
+    {
+      printerror(__func__, "could not init perm");
+      goto err;
+    }
+
+  return blk;
+
+ err:
+  if(blk != NULL) sweep_block_free(blk, state->ttlc);
+  return NULL;
+}
+
+/*
+ * sweep_trace
+ *
+ * build a trace record from the hops collected for a target.  hops
+ * after the first response from the target are discarded.
+ */
+static scamper_trace_t *sweep_trace(const sweep_t *sweep,
+				    const sweep_state_t *state,
+				    const sweep_block_t *blk, uint32_t slot)
+{
+  sweep_dst_t *dst = blk->dsts[slot];
+  scamper_trace_hop_t *hop;
+  scamper_trace_t *trace = NULL;
+  struct in_addr in;
+  uint32_t idx;
+  int i, hopc = 0;
+
+  idx = sweep_perm(&state->perm, (blk->id * sweep->block) + slot);
+  in.s_addr = htonl(state->net + (idx << 8) + sweep->offset);
+
+  if((trace = scamper_trace_alloc()) == NULL ||
+     (trace->dst = scamper_addrcache_get_ipv4(addrcache, &in)) == NULL ||
+     scamper_trace_hops_alloc(trace, sweep->hoplimit) != 0)
+    {
+      printerror(__func__, "could not alloc trace");
+      goto err;
+    }
+
+  trace->list       = scamper_list_use(sweep->list);
+  trace->cycle      = scamper_cycle_use(sweep->cycle);
+  trace->src        = scamper_addr_use(sweep->src);
+  trace->userid     = sweep->userid;
+  trace->type       = sweep->type;
+  trace->attempts   = 1;
+  trace->squeries   = 1;
+  trace->firsthop   = sweep->firsthop;
+  trace->hoplimit   = sweep->hoplimit;
+  trace->wait       = sweep->wait;
+  trace->sport      = sweep->sport;
+  trace->dport      = sweep->dport;
+  trace->probe_size = 30;
+  trace->probec     = state->ttlc;
+  trace->stop_reason = SCAMPER_TRACE_STOP_HOPLIMIT;
+  timeval_cpy(&trace->start, &blk->start);
+  if(sweep->type == SCAMPER_TRACE_TYPE_ICMP_ECHO_PARIS)
+    trace->flags |= SCAMPER_TRACE_FLAG_ICMPCSUMDP;
+
+  for(i=0; i<state->ttlc; i++)
+    {
+      if((hop = dst->hops[i]) == NULL)
+	continue;
+      dst->hops[i] = NULL;
+      if(hopc != 0 && trace->stop_reason != SCAMPER_TRACE_STOP_HOPLIMIT)
+	{
+	  scamper_trace_hop_free(hop);
+	  continue;
+	}
+
+      trace->hops[hop->hop_probe_ttl-1] = hop;
+      hopc = hop->hop_probe_ttl;
+
+      if(scamper_addr_cmp(hop->hop_addr, trace->dst) == 0 &&
+	 (SCAMPER_TRACE_HOP_IS_ICMP_ECHO_REPLY(hop) ||
+	  SCAMPER_TRACE_HOP_IS_ICMP_UNREACH_PORT(hop)))
+	{
+	  trace->stop_reason = SCAMPER_TRACE_STOP_COMPLETED;
+	}
+      else if(SCAMPER_TRACE_HOP_IS_ICMP_UNREACH(hop))
+	{
+	  trace->stop_reason = SCAMPER_TRACE_STOP_UNREACH;
+	  trace->stop_data = hop->hop_icmp_code;
+	}
+    }
+  trace->hop_count = hopc;
+
+  return trace;
+
+ err:
+  if(trace != NULL) scamper_trace_free(trace);
+  return NULL;
+}
+
+/*
+ * sweep_block_write
+ *
+ * write a trace record for each target in the block that had a
+ * response, and free the block.
+ */
+static void sweep_block_write(scamper_task_t *task, scamper_file_t *sf,
+			      sweep_block_t *blk)
+{
+  sweep_t *sweep = sweep_getdata(task);
+  sweep_state_t *state = sweep_getstate(task);
+  scamper_trace_t *trace;
+  uint32_t i;
+
+  for(i=0; i<blk->tc; i++)
+    {
+      if(blk->dsts[i] == NULL)
+	continue;
+      if(sf != NULL &&
+	 (trace = sweep_trace(sweep, state, blk, i)) != NULL)
+	{
+	  scamper_file_write_trace(sf, trace);
+	  scamper_trace_free(trace);
+	}
+      sweep_dst_free(blk->dsts[i], state->ttlc);
+      blk->dsts[i] = NULL;
+    }
+
+  sweep_block_free(blk, state->ttlc);
+  return;
+}
+
+static void do_sweep_handle_icmp(scamper_task_t *task, scamper_icmp_resp_t *ir)
+{
+  sweep_t *sweep = sweep_getdata(task);
+  sweep_state_t *state = sweep_getstate(task);
+  scamper_trace_hop_t *hop = NULL;
+  scamper_addr_t addr;
+  sweep_block_t *blk;
+  sweep_dst_t *dst;
+  struct timeval tv;
+  uint32_t a, pos, slot;
+  uint16_t seq, ms;
+  uint8_t ttl;
+  int rtt;
+
+  if(state == NULL || ir->ir_af != AF_INET)
+    return;
+
+  /* figure out which probe the response is for */
+  if(SCAMPER_ICMP_RESP_IS_ECHO_REPLY(ir))
+    {
+      if(sweep->type != SCAMPER_TRACE_TYPE_ICMP_ECHO_PARIS)
+	return;
+      a = ntohl(ir->ir_ip_src.v4.s_addr);
+      ms = ir->ir_icmp_id;
+      seq = ir->ir_icmp_seq;
+    }
+  else if(SCAMPER_ICMP_RESP_INNER_IS_SET(ir) &&
+	  (SCAMPER_ICMP_RESP_IS_TTL_EXP(ir) || SCAMPER_ICMP_RESP_IS_UNREACH(ir)))
+    {
+      a = ntohl(ir->ir_inner_ip_dst.v4.s_addr);
+      if(sweep->type == SCAMPER_TRACE_TYPE_ICMP_ECHO_PARIS)
+	{
+	  if(SCAMPER_ICMP_RESP_INNER_IS_ICMP_ECHO_REQ(ir) == 0)
+	    return;
+	  ms = ir->ir_inner_icmp_id;
+	  seq = ir->ir_inner_icmp_seq;
+	}
+      else
+	{
+	  if(SCAMPER_ICMP_RESP_INNER_IS_UDP(ir) == 0 ||
+	     ir->ir_inner_udp_sport != sweep->sport ||
+	     ir->ir_inner_udp_dport != sweep->dport)
+	    return;
+	  ms = ir->ir_inner_ip_id;
+	  seq = ntohs(ir->ir_inner_udp_sum);
+	}
+    }
+  else return;
+
+  /* check the probe was for a target of this sweep */
+  ttl = seq & 0xff;
+  if((a & 0xff) != sweep->offset || (seq >> 8) != sweep_check(state, a) ||
+     ttl < sweep->firsthop || ttl > sweep->hoplimit)
+    return;
+  a -= state->net + sweep->offset;
+  if((a >> 8) >= state->perm.n)
+    return;
+
+  /* find the block the target is in, if it is still being collected */
+  pos = sweep_perm_inv(&state->perm, a >> 8);
+  slot = pos % sweep->block;
+  if(state->cur != NULL && state->cur->id == pos / sweep->block)
+    blk = state->cur;
+  else if(state->drain != NULL && state->drain->id == pos / sweep->block)
+    blk = state->drain;
+  else
+    return;
+
+  if((dst = blk->dsts[slot]) == NULL)
+    {
+      if((dst = malloc_zero(sizeof(sweep_dst_t))) == NULL ||
+	 (dst->hops = malloc_zero(sizeof(scamper_trace_hop_t *) *
+				  state->ttlc)) == NULL)
+	{
+	  printerror(__func__, "could not alloc dst");
+	  if(dst != NULL) free(dst);
+	  return;
+	}
+      blk->dsts[slot] = dst;
+    }
+
+  /* only the first response to a probe is kept */
+  if(dst->hops[ttl - sweep->firsthop] != NULL)
+    return;
+
+  if(scamper_icmp_resp_src(ir, &addr) != 0 ||
+     (hop = scamper_trace_hop_alloc()) == NULL ||
+     (hop->hop_addr = scamper_addrcache_get(addrcache, addr.type,
+					    addr.addr)) == NULL)
+    {
+      printerror(__func__, "could not alloc hop");
+      goto err;
+    }
+
+  /* the time the probe was sent is recovered from the response */
+  rtt = (timeval_diff_ms(&state->start, &ir->ir_rx) - ms) & 0xffff;
+  if(rtt > sweep->wait * 1000)
+    goto err;
+  tv.tv_sec = rtt / 1000;
+  tv.tv_usec = (rtt % 1000) * 1000;
+  timeval_cpy(&hop->hop_rtt, &tv);
+  timeval_sub_us(&hop->hop_tx, &ir->ir_rx, rtt * 1000);
+
+  hop->hop_probe_ttl  = ttl;
+  hop->hop_probe_size = 30;
+  hop->hop_reply_size = ir->ir_ip_size;
+  hop->hop_reply_ipid = ir->ir_ip_id;
+  hop->hop_reply_tos  = ir->ir_ip_tos;
+  hop->hop_icmp_type  = ir->ir_icmp_type;
+  hop->hop_icmp_code  = ir->ir_icmp_code;
+  if(ir->ir_ip_ttl != -1)
+    {
+      hop->hop_reply_ttl = (uint8_t)ir->ir_ip_ttl;
+      hop->hop_flags |= SCAMPER_TRACE_HOP_FLAG_REPLY_TTL;
+    }
+  if(ir->ir_flags & SCAMPER_ICMP_RESP_FLAG_KERNRX)
+    hop->hop_flags |= SCAMPER_TRACE_HOP_FLAG_TS_SOCK_RX;
+  if(SCAMPER_ICMP_RESP_INNER_IS_SET(ir))
+    {
+      hop->hop_icmp_q_ttl = ir->ir_inner_ip_ttl;
+      hop->hop_icmp_q_ipl = ir->ir_inner_ip_size;
+      hop->hop_icmp_q_tos = ir->ir_inner_ip_tos;
+    }
+  if(ir->ir_ext != NULL &&
+     scamper_icmpext_parse(&hop->hop_icmpext, ir->ir_ext, ir->ir_extlen) != 0)
+    goto err;
+
+  dst->hops[ttl - sweep->firsthop] = hop;
+  return;
+
+ err:
+  if(hop != NULL) scamper_trace_hop_free(hop);
+  return;
+}
+
+static void sweep_state_free(sweep_state_t *state)
+{
+  if(state->cur != NULL)
+    sweep_block_free(state->cur, state->ttlc);
+  if(state->drain != NULL)
+    sweep_block_free(state->drain, state->ttlc);
+  free(state);
+  return;
+}
+
+static int sweep_state_alloc(scamper_task_t *task)
+{
+  sweep_t *sweep = sweep_getdata(task);
+  sweep_state_t *state = NULL;
+
+  if((state = malloc_zero(sizeof(sweep_state_t))) == NULL)
+    {
+      printerror(__func__, "could not malloc state");
+      goto err;
+    }
+  scamper_task_setstate(task, state);
+
+  state->net = ntohl(((struct in_addr *)sweep->pfx->addr)->s_addr);
+  state->ttlc = sweep->hoplimit - sweep->firsthop + 1;
+  if(sweep_perm_init(&state->perm, 1 << (24 - sweep->plen)) != 0 ||
+     random_u32(&state->check) != 0)
+    {
+      printerror(__func__, "could not init perm");
+      goto err;
+    }
+  state->blockc = ((state->perm.n - 1) / sweep->block) + 1;
+
+  if(sweep->src == NULL)
+    {
+      if((sweep->src = scamper_getsrc(sweep->pfx, 0)) == NULL)
+	goto err;
+    }
+
+  if(scamper_task_fd_icmp4(task, sweep->src->addr) == NULL)
+    goto err;
+  if(sweep->type == SCAMPER_TRACE_TYPE_UDP_PARIS)
+    state->probe = scamper_task_fd_udp4(task, sweep->src->addr, sweep->sport);
+  else
+    state->probe = scamper_task_fd_icmp4(task, sweep->src->addr);
+  if(state->probe == NULL)
+    goto err;
+
+  gettimeofday_wrap(&state->start);
+  if((state->cur = sweep_block_alloc(sweep, state, 0)) == NULL)
+    goto err;
+  timeval_cpy(&state->cur->start, &state->start);
+
+  return 0;
+
+ err:
+  return -1;
+}
+
+static void do_sweep_probe(scamper_task_t *task)
+{
+  sweep_t *sweep = sweep_getdata(task);
+  sweep_state_t *state = sweep_getstate(task);
+  sweep_block_t *blk;
+  scamper_probe_t probe;
+  scamper_addr_t dst;
+  struct in_addr in;
+  struct timeval tv;
+  uint32_t j, slot, idx;
+  uint16_t u16, ms;
+  uint8_t buf[2], ttl;
+
+  if(state == NULL)
+    {
+      if(sweep_state_alloc(task) != 0)
+	goto err;
+      state = sweep_getstate(task);
+    }
+  blk = state->cur;
+  assert(blk != NULL);
+  assert(blk->pos < blk->perm.n);
+
+  gettimeofday_wrap(&tv);
+
+  /* write the previous block out once its responses have had time */
+  if(state->drain != NULL && timeval_cmp(&tv, &state->drain->finish) >= 0)
+    {
+      sweep_block_write(task, scamper_task_getfile(task), state->drain);
+      state->drain = NULL;
+    }
+
+  /* the next (target, TTL) pair to probe, skipping reserved targets */
+  dst.type = SCAMPER_ADDR_TYPE_IPV4;
+  dst.addr = &in;
+  for(;;)
+    {
+      j = sweep_perm(&blk->perm, blk->pos);
+      slot = j % blk->tc;
+      ttl = sweep->firsthop + (j / blk->tc);
+      idx = sweep_perm(&state->perm, (blk->id * sweep->block) + slot);
+      in.s_addr = htonl(state->net + (idx << 8) + sweep->offset);
+      if(scamper_addr_isreserved(&dst) == 0)
+	break;
+      if(++blk->pos == blk->perm.n)
+	goto block_done;
+    }
+
+  ms = timeval_diff_ms(&state->start, &tv) & 0xffff;
+  u16 = (sweep_check(state, ntohl(in.s_addr)) << 8) | ttl;
+
+  memset(&probe, 0, sizeof(probe));
+  probe.pr_ip_src = sweep->src;
+  probe.pr_ip_dst = &dst;
+  probe.pr_ip_ttl = ttl;
+  probe.pr_ip_off = IP_DF;
+  probe.pr_data   = buf;
+  probe.pr_len    = sizeof(buf);
+  probe.pr_fd     = scamper_fd_fd_get(state->probe);
+
+  if(sweep->type == SCAMPER_TRACE_TYPE_UDP_PARIS)
+    {
+      /* swap the value we want in the checksum into the payload */
+      probe.pr_ip_proto  = IPPROTO_UDP;
+      probe.pr_ip_id     = ms;
+      probe.pr_udp_sport = sweep->sport;
+      probe.pr_udp_dport = sweep->dport;
+      bytes_htons(buf, u16);
+      u16 = scamper_udp4_cksum(&probe);
+      memcpy(buf, &u16, 2);
+    }
+  else
+    {
+      /* keep the ICMP checksum constant, as paris traceroute does */
+      SCAMPER_PROBE_ICMP_ECHO(&probe, ms, u16);
+      probe.pr_icmp_sum = htons(sweep->dport);
+      u16 = htons(sweep->dport);
+      memcpy(buf, &u16, 2);
+      u16 = scamper_icmp4_cksum(&probe);
+      memcpy(buf, &u16, 2);
+    }
+
+  if(scamper_probe(&probe) != 0)
+    {
+      errno = probe.pr_errno;
+      printerror(__func__, "could not send probe");
+    }
+
+  /*
+   * once the block has been probed, wait for its responses while the
+   * next block is probed.  if the previous block is still waiting, it
+   * is written out now, and any responses still to come are not kept.
+   */
+  if(++blk->pos < blk->perm.n)
+    {
+      scamper_task_queue_probe(task);
+      return;
+    }
+
+ block_done:
+  timeval_add_s(&blk->finish, &tv, sweep->wait);
+  if(state->drain != NULL)
+    sweep_block_write(task, scamper_task_getfile(task), state->drain);
+  state->drain = blk;
+  state->cur = NULL;
+
+  if(blk->id + 1 < state->blockc)
+    {
+      if((state->cur = sweep_block_alloc(sweep, state, blk->id + 1)) == NULL)
+	goto err;
+      timeval_cpy(&state->cur->start, &tv);
+      scamper_task_queue_probe(task);
+    }
+  else
+    {
+      scamper_task_queue_wait_tv(task, &blk->finish);
+    }
+  return;
+
+ err:
+  scamper_task_queue_done(task, 0);
+  return;
+}
+
+static void do_sweep_handle_timeout(scamper_task_t *task)
+{
+  scamper_task_queue_done(task, 0);
+  return;
+}
+
+static void do_sweep_halt(scamper_task_t *task)
+{
+  scamper_task_queue_done(task, 0);
+  return;
+}
+
+/*
+ * do_sweep_write
+ *
+ * write out the blocks that have not been written yet.
+ */
+static void do_sweep_write(scamper_file_t *sf, scamper_task_t *task)
+{
+  sweep_state_t *state = sweep_getstate(task);
+
+  if(state == NULL)
+    return;
+  if(state->drain != NULL)
+    {
+      sweep_block_write(task, sf, state->drain);
+      state->drain = NULL;
+    }
+  if(state->cur != NULL)
+    {
+      sweep_block_write(task, sf, state->cur);
+      state->cur = NULL;
+    }
+
+  return;
+}
+
+static void sweep_free(sweep_t *sweep)
+{
+  if(sweep->list != NULL) scamper_list_free(sweep->list);
+  if(sweep->cycle != NULL) scamper_cycle_free(sweep->cycle);
+  if(sweep->src != NULL) scamper_addr_free(sweep->src);
+  if(sweep->pfx != NULL) scamper_addr_free(sweep->pfx);
+  free(sweep);
+  return;
+}
+
+static void do_sweep_free(scamper_task_t *task)
+{
+  sweep_t *sweep;
+  sweep_state_t *state;
+
+  if((state = sweep_getstate(task)) != NULL)
+    sweep_state_free(state);
+
+  if((sweep = sweep_getdata(task)) != NULL)
+    sweep_free(sweep);
+
+  return;
+}
+
+static int sweep_arg_param_validate(int optid, char *param, long long *out)
+{
+  long tmp = 0;
+
+  switch(optid)
+    {
+    case SWEEP_OPT_SRCADDR:
+      break;
+
+    case SWEEP_OPT_METHOD:
+      if(strcasecmp(param, "icmp-paris") == 0)
+	tmp = SCAMPER_TRACE_TYPE_ICMP_ECHO_PARIS;
+      else if(strcasecmp(param, "udp-paris") == 0)
+	tmp = SCAMPER_TRACE_TYPE_UDP_PARIS;
+      else
+	goto err;
+      break;
+
+    case SWEEP_OPT_BLOCK:
+      if(string_tolong(param, &tmp) != 0 || tmp < 1 || tmp > 65536)
+	goto err;
+      break;
+
+    case SWEEP_OPT_DPORT:
+    case SWEEP_OPT_SPORT:
+      if(string_tolong(param, &tmp) != 0 || tmp < 1 || tmp > 65535)
+	goto err;
+      break;
+
+    case SWEEP_OPT_FIRSTHOP:
+    case SWEEP_OPT_HOPLIMIT:
+      if(string_tolong(param, &tmp) != 0 || tmp < 1 || tmp > 255)
+	goto err;
+      break;
+
+    case SWEEP_OPT_OFFSET:
+      if(string_tolong(param, &tmp) != 0 || tmp < 0 || tmp > 255)
+	goto err;
+      break;
+
+    case SWEEP_OPT_USERID:
+      if(string_tolong(param, &tmp) != 0 || tmp < 0)
+	goto err;
+      break;
+
+    case SWEEP_OPT_WAIT:
+      if(string_tolong(param, &tmp) != 0 || tmp < 1 || tmp > 60)
+	goto err;
+      break;
+
+    default:
+      return -1;
+    }
+
+  if(out != NULL)
+    *out = (long long)tmp;
+  return 0;
+
+ err:
+  return -1;
+}
+
+int scamper_do_sweep_arg_validate(int argc, char *argv[], int *stop)
+{
+  return scamper_options_validate(opts, opts_cnt, argc, argv, stop,
+				  sweep_arg_param_validate);
+}
+
+void *scamper_do_sweep_alloc(char *str)
+{
+  scamper_option_out_t *opts_out = NULL, *opt;
+  sweep_t *sweep = NULL;
+  struct in_addr in;
+  uint32_t userid = 0, block = 4096;
+  uint16_t sport = scamper_sport_default(), dport = 33435;
+  uint8_t type = SCAMPER_TRACE_TYPE_ICMP_ECHO_PARIS;
+  uint8_t firsthop = 1, hoplimit = 32, offset = 1, wait = 5;
+  char *addr = NULL, *plen_str = NULL, *src = NULL;
+  long long tmp = 0;
+  long plen;
+
+  /* try and parse the string passed in */
+  if(scamper_options_parse(str, opts, opts_cnt, &opts_out, &addr) != 0)
+    goto err;
+
+  if(addr == NULL)
+    {
+      scamper_debug(__func__, "no prefix to sweep");
+      goto err;
+    }
+
+  /* parse the options, do preliminary sanity checks */
+  for(opt = opts_out; opt != NULL; opt = opt->next)
+    {
+      if(opt->type != SCAMPER_OPTION_TYPE_NULL &&
+	 sweep_arg_param_validate(opt->id, opt->str, &tmp) != 0)
+	{
+	  scamper_debug(__func__, "validation of optid %d failed", opt->id);
+	  goto err;
+	}
+
+      switch(opt->id)
+	{
+	case SWEEP_OPT_BLOCK:
+	  block = (uint32_t)tmp;
+	  break;
+
+	case SWEEP_OPT_DPORT:
+	  dport = (uint16_t)tmp;
+	  break;
+
+	case SWEEP_OPT_FIRSTHOP:
+	  firsthop = (uint8_t)tmp;
+	  break;
+
+	case SWEEP_OPT_HOPLIMIT:
+	  hoplimit = (uint8_t)tmp;
+	  break;
+
+	case SWEEP_OPT_OFFSET:
+	  offset = (uint8_t)tmp;
+	  break;
+
+	case SWEEP_OPT_METHOD:
+	  type = (uint8_t)tmp;
+	  break;
+
+	case SWEEP_OPT_SPORT:
+	  sport = (uint16_t)tmp;
+	  break;
+
+	case SWEEP_OPT_SRCADDR:
+	  src = opt->str;
+	  break;
+
+	case SWEEP_OPT_USERID:
+	  userid = (uint32_t)tmp;
+	  break;
+
+	case SWEEP_OPT_WAIT:
+	  wait = (uint8_t)tmp;
+	  break;
+	}
+    }
+  scamper_options_free(opts_out); opts_out = NULL;
+
+  if(firsthop > hoplimit)
+    {
+      scamper_debug(__func__, "firsthop %u > maxttl %u", firsthop, hoplimit);
+      goto err;
+    }
+
+  /* the prefix is an IPv4 prefix no longer than a /24 */
+  string_nullterm_char(addr, '/', &plen_str);
+  if(plen_str == NULL || string_tolong(plen_str, &plen) != 0 ||
+     plen < 0 || plen > 24)
+    {
+      scamper_debug(__func__, "expected a prefix of /24 or shorter");
+      goto err;
+    }
+
+  if((sweep = malloc_zero(sizeof(sweep_t))) == NULL)
+    goto err;
+
+  if((sweep->pfx = scamper_addrcache_resolve(addrcache,AF_INET,addr)) == NULL)
+    {
+      scamper_debug(__func__, "could not resolve %s", addr);
+      goto err;
+    }
+  in.s_addr = ((struct in_addr *)sweep->pfx->addr)->s_addr;
+  if(plen > 0 && (ntohl(in.s_addr) << plen) != 0)
+    {
+      scamper_debug(__func__, "%s is not a network address", addr);
+      goto err;
+    }
+
+  if(src != NULL &&
+     (sweep->src = scamper_addrcache_resolve(addrcache,AF_INET,src)) == NULL)
+    {
+      scamper_debug(__func__, "could not resolve %s", src);
+      goto err;
+    }
+
+  sweep->plen     = (uint8_t)plen;
+  sweep->block    = block;
+  sweep->userid   = userid;
+  sweep->sport    = sport;
+  sweep->dport    = dport;
+  sweep->type     = type;
+  sweep->firsthop = firsthop;
+  sweep->hoplimit = hoplimit;
+  sweep->offset   = offset;
+  sweep->wait     = wait;
+
+  return sweep;
+
+ err:
+  if(sweep != NULL) sweep_free(sweep);
+  if(opts_out != NULL) scamper_options_free(opts_out);
+  return NULL;
+}
+
+scamper_task_t *scamper_do_sweep_alloctask(void *data, scamper_list_t *list,
+					   scamper_cycle_t *cycle)
+{
+  sweep_t *sweep = (sweep_t *)data;
+  scamper_task_t *task = NULL;
+  scamper_task_sig_t *sig = NULL;
+
+  /* allocate a task structure and store the sweep with it */
+  if((task = scamper_task_alloc(sweep, &sweep_funcs)) == NULL)
+    goto err;
+
+  /* task signature */
+  if((sig = scamper_task_sig_alloc(SCAMPER_TASK_SIG_TYPE_SWEEP)) == NULL)
+    goto err;
+  sig->sig_sweep_pfx = scamper_addr_use(sweep->pfx);
+  sig->sig_sweep_plen = sweep->plen;
+  if(scamper_task_sig_add(task, sig) != 0)
+    goto err;
+  sig = NULL;
+
+  /* associate the list and cycle with the sweep */
+  sweep->list  = scamper_list_use(list);
+  sweep->cycle = scamper_cycle_use(cycle);
+
+  return task;
+
+ err:
+  if(sig != NULL) scamper_task_sig_free(sig);
+  if(task != NULL)
+    {
+      scamper_task_setdatanull(task);
+      scamper_task_free(task);
+    }
+  return NULL;
+}
+
+void scamper_do_sweep_free(void *data)
+{
+  sweep_free((sweep_t *)data);
+  return;
+}
+
+void scamper_do_sweep_cleanup()
+{
+  return;
+}
+
+int scamper_do_sweep_init()
+{
+  sweep_funcs.probe          = do_sweep_probe;
+  sweep_funcs.handle_icmp    = do_sweep_handle_icmp;
+  sweep_funcs.handle_timeout = do_sweep_handle_timeout;
+  sweep_funcs.write          = do_sweep_write;
+  sweep_funcs.task_free      = do_sweep_free;
+  sweep_funcs.name           = "sweep";
+  sweep_funcs.halt           = do_sweep_halt;
+
+  return 0;
+}
@@ -0,0 +1,42 @@
+/*
+ * scamper_sweep_do.h
+ *
+ * $Id$
+ *
+ * Copyright (C) 2026 Matthew Luckie
+ * Author: Matthew Luckie
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __SCAMPER_DO_SWEEP_H
+#define __SCAMPER_DO_SWEEP_H
+
+const char *scamper_do_sweep_usage(void);
+
+void *scamper_do_sweep_alloc(char *str);
+
+void scamper_do_sweep_free(void *data);
+
+scamper_task_t *scamper_do_sweep_alloctask(void *data,
+					   scamper_list_t *list,
+					   scamper_cycle_t *cycle);
+
+int scamper_do_sweep_arg_validate(int argc, char *argv[], int *stop);
+
+void scamper_do_sweep_cleanup(void);
+int scamper_do_sweep_init(void);
+
+#endif /*__SCAMPER_DO_SWEEP_H */
@@ -36,8 +36,11 @@
 #include "scamper_list.h"
 #include "scamper_icmpext.h"
 #include "scamper_trace.h"
+#include "scamper_slab.h"
 #include "utils.h"
 
+static scamper_slab_t *hop_slab = NULL;
+
 int scamper_trace_pmtud_alloc(scamper_trace_t *trace)
 {
   if((trace->pmtud = malloc_zero(sizeof(scamper_trace_pmtud_t))) == NULL)
@@ -218,13 +221,13 @@ void scamper_trace_hop_free(scamper_trace_hop_t *hop)
     free(hop->hop_name);
   scamper_icmpext_free(hop->hop_icmpext);
   scamper_addr_free(hop->hop_addr);
-  free(hop);
+  scamper_slab_put(&hop_slab, hop);
   return;
 }
 
 scamper_trace_hop_t *scamper_trace_hop_alloc()
 {
-  return malloc_zero(sizeof(struct scamper_trace_hop));
+  return scamper_slab_get(&hop_slab, sizeof(struct scamper_trace_hop));
 }
 
 int scamper_trace_hop_count(const scamper_trace_t *trace)
@@ -56,6 +56,7 @@ struct scamper_addr;
 #define SCAMPER_TRACE_FLAG_CONSTPAYLOAD 0x40 /* do not hack payload for csum */
 #define SCAMPER_TRACE_FLAG_RXERR        0x80 /* used rxerr socket */
 #define SCAMPER_TRACE_FLAG_PTR          0x100 /* do ptr lookups */
+#define SCAMPER_TRACE_FLAG_ADAPTIVE     0x200 /* predict path length */
 
 #define SCAMPER_TRACE_TYPE_ICMP_ECHO       0x01 /* ICMP echo requests */
 #define SCAMPER_TRACE_TYPE_UDP             0x02 /* UDP to unused ports */
@@ -166,6 +167,9 @@ struct scamper_addr;
 #define SCAMPER_TRACE_IS_ALLATTEMPTS(trace) (			\
  (trace)->flags & SCAMPER_TRACE_FLAG_ALLATTEMPTS)
 
+#define SCAMPER_TRACE_IS_ADAPTIVE(trace) (			\
+ (trace)->flags & SCAMPER_TRACE_FLAG_ADAPTIVE)
+
 #define SCAMPER_TRACE_IS_CONSTPAYLOAD(trace)(			\
  (trace)->flags & SCAMPER_TRACE_FLAG_CONSTPAYLOAD)
 
@@ -307,9 +311,11 @@ typedef struct scamper_trace_dtree
   scamper_addr_t **gss;
   scamper_addr_t  *gss_stop;
   scamper_addr_t  *lss_stop;
+  uint32_t         gss_ver;  /* version of the shared stop set consulted */
 } scamper_trace_dtree_t;
 
 #define SCAMPER_TRACE_DTREE_FLAG_NOBACK 0x01
+#define SCAMPER_TRACE_DTREE_FLAG_SHARED 0x02
 
 /*
  * scamper_trace:
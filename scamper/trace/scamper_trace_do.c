@@ -51,6 +51,7 @@
 #include "scamper_debug.h"
 #include "scamper_trace_do.h"
 #include "scamper_addr2mac.h"
+#include "scamper_slab.h"
 #include "scamper_options.h"
 #include "scamper_icmp4.h"
 #include "scamper_icmp6.h"
@@ -59,6 +60,7 @@
 #include "scamper_udp6.h"
 #include "scamper_if.h"
 #include "scamper_osinfo.h"
+#include "scamper_stopset.h"
 #include "host/scamper_host_do.h"
 #include "mjl_splaytree.h"
 #include "mjl_list.h"
@@ -171,6 +173,20 @@ typedef struct trace_lss
   splaytree_node_t *node;
 } trace_lss_t;
 
+/*
+ * trace_plen
+ *
+ * the number of hops to the destination observed by the most recent
+ * adaptive traceroute towards an address in the prefix.
+ */
+typedef struct trace_plen
+{
+  uint8_t           type;
+  uint8_t           pfx[16];
+  uint8_t           len;
+  dlist_node_t     *node;
+} trace_plen_t;
+
 /*
  * trace_probe
  *
@@ -241,6 +257,8 @@ typedef struct trace_state
   uint8_t              attempt;       /* attempt number at the current probe */
   uint8_t              loopc;         /* count of loops so far */
   uint8_t              max_ttl;       /* max TTL that got a response */
+  uint8_t              plen;          /* predicted length of path */
+  uint8_t              stop_ttl;      /* TTL an adaptive trace stopped at */
   uint16_t             ttl;           /* ttl to set in the probe packet */
   uint16_t             alloc_hops;    /* number of trace->hops allocated */
   uint16_t             payload_size;  /* how much payload to include */
@@ -323,6 +341,9 @@ static const uint8_t MODE_PARALLEL_FINISH  = 12;
 /* the callback functions registered with the trace task */
 static scamper_task_funcs_t trace_funcs;
 
+/* slab that trace_probe_t records are allocated from */
+static scamper_slab_t *tp_slab = NULL;
+
 /* address cache used to avoid reallocating the same address multiple times */
 extern scamper_addrcache_t *addrcache;
 
@@ -333,6 +354,17 @@ static size_t   pktbuf_len = 0;
 /* local stop sets */
 static splaytree_t *lsses = NULL;
 
+/* the path lengths that adaptive traceroutes predict from */
+static splaytree_t *plens = NULL;
+static dlist_t *plen_lru = NULL;
+
+/* the prefix lengths that path lengths are recorded with */
+#define TRACE_PLEN_PREFIX4 24
+#define TRACE_PLEN_PREFIX6 48
+
+/* the number of prefixes that path lengths are kept for */
+#define TRACE_PLEN_MAX 65536
+
 /* is this running on sunos */
 static int sunos = 0;
 
@@ -574,6 +606,166 @@ static trace_host_t *trace_host_alloc(scamper_trace_hop_t *hop)
   return NULL;
 }
 
+static int trace_plen_cmp(const trace_plen_t *a, const trace_plen_t *b)
+{
+  if(a->type < b->type) return -1;
+  if(a->type > b->type) return  1;
+  return memcmp(a->pfx, b->pfx, sizeof(a->pfx));
+}
+
+static int trace_plen_key(trace_plen_t *key, const scamper_addr_t *dst)
+{
+  int plen;
+
+  if(SCAMPER_ADDR_TYPE_IS_IPV4(dst))
+    plen = TRACE_PLEN_PREFIX4;
+  else if(SCAMPER_ADDR_TYPE_IS_IPV6(dst))
+    plen = TRACE_PLEN_PREFIX6;
+  else
+    return -1;
+
+  memset(key, 0, sizeof(trace_plen_t));
+  key->type = dst->type;
+  memcpy(key->pfx, dst->addr, plen / 8);
+  return 0;
+}
+
+/*
+ * trace_plen_get
+ *
+ * return the path length observed towards the destination's prefix, or
+ * zero if there is no observation to predict from.
+ */
+static uint8_t trace_plen_get(const scamper_addr_t *dst)
+{
+  trace_plen_t findme, *plen;
+
+  if(plens == NULL || trace_plen_key(&findme, dst) != 0 ||
+     (plen = splaytree_find(plens, &findme)) == NULL)
+    return 0;
+  dlist_node_eject(plen_lru, plen->node);
+  dlist_node_head_push(plen_lru, plen->node);
+  return plen->len;
+}
+
+/*
+ * trace_plen_set
+ *
+ * record the path length towards the destination's prefix.  once
+ * TRACE_PLEN_MAX prefixes are held, the least recently used one is
+ * forgotten to make room.
+ */
+static void trace_plen_set(const scamper_addr_t *dst, uint8_t len)
+{
+  trace_plen_t findme, *plen;
+
+  if(trace_plen_key(&findme, dst) != 0)
+    return;
+
+  if(plens == NULL &&
+     ((plens = splaytree_alloc((splaytree_cmp_t)trace_plen_cmp)) == NULL ||
+      (plen_lru = dlist_alloc()) == NULL))
+    {
+      printerror(__func__, "could not allocate plens");
+      return;
+    }
+
+  if((plen = splaytree_find(plens, &findme)) != NULL)
+    {
+      dlist_node_eject(plen_lru, plen->node);
+      dlist_node_head_push(plen_lru, plen->node);
+      plen->len = len;
+      return;
+    }
+
+  if(splaytree_count(plens) >= TRACE_PLEN_MAX)
+    {
+      plen = dlist_tail_pop(plen_lru);
+      splaytree_remove_item(plens, plen);
+      free(plen);
+    }
+
+  if((plen = memdup(&findme, sizeof(findme))) == NULL ||
+     (plen->node = dlist_head_push(plen_lru, plen)) == NULL)
+    goto err;
+  if(splaytree_insert(plens, plen) == NULL)
+    {
+      dlist_node_pop(plen_lru, plen->node);
+      goto err;
+    }
+  plen->len = len;
+  return;
+
+ err:
+  if(plen != NULL) free(plen);
+  printerror(__func__, "could not add plen");
+  return;
+}
+
+/*
+ * trace_plen_learn
+ *
+ * record the smallest TTL at which an adaptive traceroute reached its
+ * destination, so that later traceroutes to the prefix can probe that
+ * far at once.
+ */
+static void trace_plen_learn(const scamper_trace_t *trace)
+{
+  scamper_trace_hop_t *hop;
+  uint16_t i;
+
+  for(i=0; i<trace->hop_count; i++)
+    for(hop = trace->hops[i]; hop != NULL; hop = hop->hop_next)
+      if(scamper_addr_cmp(hop->hop_addr, trace->dst) == 0)
+	{
+	  trace_plen_set(trace->dst, hop->hop_probe_ttl);
+	  return;
+	}
+
+  return;
+}
+
+/*
+ * dtree_gss_share
+ *
+ * add the interfaces the trace observed to the stop set shared with
+ * other monitors, so that their traces towards this destination can
+ * stop when they reach one of them.
+ */
+static void dtree_gss_share(const scamper_trace_t *trace)
+{
+  scamper_trace_hop_t *hop;
+  uint16_t i;
+
+  for(i=0; i<trace->hop_count; i++)
+    for(hop = trace->hops[i]; hop != NULL; hop = hop->hop_next)
+      scamper_stopset_add(hop->hop_addr, trace->dst);
+
+  return;
+}
+
+/*
+ * trace_queue_done
+ *
+ * the trace has finished.  share what it learned with later traces
+ * before queueing the task to be written out.
+ */
+static void trace_queue_done(scamper_task_t *task)
+{
+  scamper_trace_t *trace = trace_getdata(task);
+
+  if(trace->dtree != NULL &&
+     (trace->dtree->flags & SCAMPER_TRACE_DTREE_FLAG_SHARED) != 0)
+    dtree_gss_share(trace);
+
+  if(SCAMPER_TRACE_IS_ADAPTIVE(trace) &&
+     trace->stop_reason == SCAMPER_TRACE_STOP_COMPLETED)
+    trace_plen_learn(trace);
+
+  scamper_task_queue_done(task, 0);
+  return;
+}
+
 /*
  * trace_queue
  *
@@ -632,6 +824,11 @@ static int trace_queue(scamper_task_t *task, const struct timeval *now)
 	     (trace->hoplimit == 0 ? 255 : trace->hoplimit) >= state->ttl &&
 	     state->ttl - state->max_ttl <= trace->gaplimit)
 	    goto probe;
+
+	  /* probe all TTLs up to the predicted path length at once */
+	  if(state->ttl <= state->plen &&
+	     (trace->hoplimit == 0 ? 255 : trace->hoplimit) >= state->ttl)
+	    goto probe;
 	}
       else if(state->mode == MODE_PARALLEL_FINISH)
 	{
@@ -704,7 +901,7 @@ static int trace_queue(scamper_task_t *task, const struct timeval *now)
   return scamper_task_queue_wait_tv(task, &next_tx);
 
  done:
-  scamper_task_queue_done(task, 0);
+  trace_queue_done(task);
   return 0;
 }
 
@@ -1119,7 +1316,7 @@ static int pmtud_L2_search_end(scamper_task_t *task)
       if(!SCAMPER_TRACE_HOP_IS_ICMP_PTB(hop))
 	{
 	  trace->pmtud->pmtu = hop->hop_probe_size;
-	  scamper_task_queue_done(task, 0);
+	  trace_queue_done(task);
 	  return 1;
 	}
     }
@@ -1132,6 +1329,92 @@ static int pmtud_L2_search_end(scamper_task_t *task)
   return 0;
 }
 
+/*
+ * trace_parallel_trim
+ *
+ * an adaptive traceroute probes beyond the hop it stops at when the
+ * path is shorter than predicted.  stop waiting for, and retrying,
+ * those probes.
+ */
+static void trace_parallel_trim(trace_state_t *state, uint8_t ttl)
+{
+  trace_hop_state_t *hs;
+  dlist_node_t *dn, *next;
+  int i, c;
+
+  dn = dlist_head_node(state->window);
+  while(dn != NULL)
+    {
+      next = dlist_node_next(dn);
+      hs = dlist_node_item(dn);
+      if(hs->ttl > ttl)
+	{
+	  dlist_node_pop(state->window, dn);
+	  free(hs);
+	}
+      dn = next;
+    }
+
+  c = slist_count(state->probeq);
+  for(i=0; i<c; i++)
+    {
+      hs = slist_head_pop(state->probeq);
+      if(hs->ttl > ttl || slist_tail_push(state->probeq, hs) == NULL)
+	free(hs);
+    }
+
+  return;
+}
+
+/*
+ * trace_parallel_restop
+ *
+ * an adaptive trace found the destination at a smaller TTL than the one
+ * it stopped at.  discard the hops recorded beyond the new stop hop.
+ */
+static void trace_parallel_restop(scamper_trace_t *trace,
+				  trace_state_t *state, uint8_t ttl)
+{
+  scamper_trace_hop_t *hop, *tmp;
+  trace_host_t fm, *th;
+  uint16_t i;
+  int j, c;
+
+  for(i=ttl; i<trace->hop_count; i++)
+    {
+      while((hop = trace->hops[i]) != NULL)
+	{
+	  trace->hops[i] = hop->hop_next;
+
+	  /* the hop might be waiting for its name to be looked up */
+	  fm.addr = hop->hop_addr;
+	  if(state->ths != NULL &&
+	     (th = splaytree_find(state->ths, &fm)) != NULL &&
+	     th->hops != NULL)
+	    {
+	      c = slist_count(th->hops);
+	      for(j=0; j<c; j++)
+		{
+		  tmp = slist_head_pop(th->hops);
+		  if(tmp != hop)
+		    slist_tail_push(th->hops, tmp);
+		}
+	    }
+
+	  scamper_trace_hop_free(hop);
+	}
+    }
+
+  trace->hop_count = ttl;
+  trace->stop_reason = SCAMPER_TRACE_STOP_COMPLETED;
+  trace->stop_data = 0;
+  state->stop_ttl = ttl;
+  if(state->max_ttl > ttl)
+    state->max_ttl = ttl;
+  trace_parallel_trim(state, ttl);
+  return;
+}
+
 static int dtree_lss_add(trace_state_t *state, scamper_addr_t *iface)
 {
   assert(state != NULL && state->lsst != NULL);
@@ -1151,6 +1434,23 @@ static int dtree_lss_in(trace_state_t *state, scamper_addr_t *iface)
   return 0;
 }
 
+/*
+ * dtree_gss_in
+ *
+ * determine if the interface is in the trace's global stop set, or in
+ * the stop set shared with other monitors for the trace's destination.
+ */
+static int dtree_gss_in(const scamper_trace_t *trace,
+			const scamper_addr_t *iface)
+{
+  if(scamper_trace_dtree_gss_find(trace, iface) != NULL)
+    return 1;
+  if((trace->dtree->flags & SCAMPER_TRACE_DTREE_FLAG_SHARED) != 0 &&
+     scamper_stopset_find(iface, trace->dst) != 0)
+    return 1;
+  return 0;
+}
+
 static int state_lss_in(trace_state_t *state, scamper_addr_t *iface)
 {
   if(array_find((void **)state->lss, state->lssc, iface,
@@ -1333,10 +1633,34 @@ static void trace_hopins(scamper_trace_hop_t **hops, scamper_trace_hop_t *hop)
 static int trace_handleerror(scamper_task_t *task, const int error)
 {
   trace_stop_error(trace_getdata(task), error);
-  scamper_task_queue_done(task, 0);
+  trace_queue_done(task);
   return 0;
 }
 
+/*
+ * trace_probe_txcb
+ *
+ * a probe that was queued to be sent in a batch has been sent.  record
+ * when it was actually sent, or stop the trace if it could not be.
+ */
+static void trace_probe_txcb(void *param, uint32_t id,
+			     const struct timeval *tx, int error)
+{
+  scamper_task_t *task = param;
+  trace_state_t *state = trace_getstate(task);
+
+  if(error != 0)
+    {
+      trace_handleerror(task, error);
+      return;
+    }
+
+  if(state != NULL && id < state->id_next && state->probes[id] != NULL)
+    timeval_cpy(&state->probes[id]->tx_tv, tx);
+
+  return;
+}
+
 static void trace_hop_ptr_cb(void *param, const char *name)
 {
   trace_host_t *th = param;
@@ -1424,7 +1748,7 @@ static int trace_hop_ptr(const scamper_task_t *task, scamper_trace_hop_t *hop)
  * the probe structure copied in, as well as an address based on the details
  * passed in
  */
-static scamper_trace_hop_t *trace_hop(const scamper_task_t *task,
+static scamper_trace_hop_t *trace_hop(scamper_task_t *task,
 				      const trace_probe_t *probe,
 				      const int af, const void *addr)
 {
@@ -1455,6 +1779,7 @@ static scamper_trace_hop_t *trace_hop(const scamper_task_t *task,
   if(probe->flags & TRACE_PROBE_FLAG_DL_TX)
     hop->hop_flags |= SCAMPER_TRACE_HOP_FLAG_TS_DL_TX;
 
+  scamper_task_mem_add(task, sizeof(scamper_trace_hop_t));
   return hop;
 
  err:
@@ -1468,7 +1793,7 @@ static scamper_trace_hop_t *trace_hop(const scamper_task_t *task,
  * given a trace probe and an ICMP response, allocate and initialise a
  * scamper_trace_hop record.
  */
-static scamper_trace_hop_t *trace_icmp_hop(const scamper_task_t *task,
+static scamper_trace_hop_t *trace_icmp_hop(scamper_task_t *task,
 					   trace_probe_t *probe,
 					   scamper_icmp_resp_t *ir)
 {
@@ -1680,7 +2005,7 @@ static void trace_next_mode(scamper_task_t *task, const struct timeval *now)
     }
 
  done:
-  scamper_task_queue_done(task, 0);
+  trace_queue_done(task);
   return;
 }
 
@@ -1764,7 +2089,7 @@ static void trace_stop_reason(scamper_trace_t *trace, scamper_trace_hop_t *hop,
       *stop_data   = 0;
     }
   else if(SCAMPER_TRACE_IS_DOUBLETREE(trace) &&
-	  scamper_trace_dtree_gss_find(trace, hop->hop_addr) != NULL)
+	  dtree_gss_in(trace, hop->hop_addr) != 0)
     {
       *stop_reason = SCAMPER_TRACE_STOP_GSS;
       *stop_data   = 0;
@@ -2064,7 +2389,7 @@ static int handleicmp_dtree_first(scamper_task_t *task,
       trace_stop_reason(trace, hop, state, &stop_reason, &stop_data);
       assert(stop_reason != SCAMPER_TRACE_STOP_NONE);
       trace_stop(trace, stop_reason, stop_data);
-      scamper_task_queue_done(task, 0);
+      trace_queue_done(task);
       return 0;
     }
 
@@ -2072,7 +2397,7 @@ static int handleicmp_dtree_first(scamper_task_t *task,
    * if the response comes from an address not in the global stop set,
    * then probe forward
    */
-  if(scamper_trace_dtree_gss_find(trace, hop->hop_addr) == NULL)
+  if(dtree_gss_in(trace, hop->hop_addr) == 0)
     {
       state->ttl  = hop->hop_probe_ttl + 1;
       state->mode = MODE_DTREE_FWD;
@@ -2088,7 +2413,7 @@ static int handleicmp_dtree_first(scamper_task_t *task,
   if(trace->firsthop == 1 ||
      (trace->dtree->flags & SCAMPER_TRACE_DTREE_FLAG_NOBACK) != 0)
     {
-      scamper_task_queue_done(task, 0);
+      trace_queue_done(task);
       return 0;
     }
 
@@ -2128,7 +2453,7 @@ static int handleicmp_lastditch(scamper_task_t *task,
 	return -1;
       trace_hopins(&trace->lastditch, hop);
       trace_stop_gaplimit(trace);
-      scamper_task_queue_done(task, 0);
+      trace_queue_done(task);
     }
 
   return 0;
@@ -2183,7 +2508,7 @@ static int handleicmp_pmtud_default(scamper_task_t *task,
 	{
 	  /* stop if the PTB has an MTU that is too small to be probed */
 	  note->type = SCAMPER_TRACE_PMTUD_N_TYPE_PTB_BAD;
-	  scamper_task_queue_done(task, 0);
+	  trace_queue_done(task);
 	}
       else
 	{
@@ -2199,7 +2524,7 @@ static int handleicmp_pmtud_default(scamper_task_t *task,
 	  SCAMPER_ICMP_RESP_IS_ECHO_REPLY(ir))
     {
       trace->pmtud->pmtu = probe->size;
-      scamper_task_queue_done(task, 0);
+      trace_queue_done(task);
     }
 
   return 0;
@@ -2262,7 +2587,7 @@ static int handleicmp_pmtud_silent_L2(scamper_task_t *task,
 	}
       else
 	{
-	  scamper_task_queue_done(task, 0);
+	  trace_queue_done(task);
 	  return 0;
 	}
     }
@@ -2415,6 +2740,10 @@ static int handleicmp_parallel(scamper_task_t *task,
   if(MODE_IS_PARALLEL(state->mode) == 0)
     return 0;
 
+  /* ignore replies to probes sent beyond where an adaptive trace stopped */
+  if(state->stop_ttl != 0 && probe->ttl > state->stop_ttl)
+    return 0;
+
   /* create a hop record and insert it into the trace */
   if((hop = trace_icmp_hop(task, probe, ir)) == NULL)
     return -1;
@@ -2449,14 +2778,30 @@ static int handleicmp_parallel(scamper_task_t *task,
 	{
 	  /* did we get a stop condition out of all that? */
 	  trace_stop(trace, stop_reason, stop_data);
+	  if(SCAMPER_TRACE_IS_ADAPTIVE(trace))
+	    {
+	      state->stop_ttl = hop->hop_probe_ttl;
+	      trace_parallel_trim(state, state->stop_ttl);
+	    }
 	  goto next_mode;
 	}
     }
+  else if(state->stop_ttl != 0 && probe->ttl < state->stop_ttl)
+    {
+      /*
+       * the destination replied to a probe with a smaller TTL after a
+       * reply at a larger TTL stopped the trace.  the path is shorter,
+       * so stop the trace here instead.
+       */
+      trace_stop_reason(trace, hop, state, &stop_reason, &stop_data);
+      if(stop_reason == SCAMPER_TRACE_STOP_COMPLETED)
+	trace_parallel_restop(trace, state, probe->ttl);
+    }
 
   if(state->mode == MODE_PARALLEL_FINISH &&
      slist_count(state->probeq) == 0 && dlist_count(state->window) == 0)
     {
-      scamper_task_queue_done(task, 0);
+      trace_queue_done(task);
       return 0;
     }
 
@@ -2874,7 +3219,7 @@ static void timeout_lastditch(scamper_task_t *task)
 {
   /* we received no responses to any of the last-ditch probes */
   trace_stop_gaplimit(trace_getdata(task));
-  scamper_task_queue_done(task, 0);
+  trace_queue_done(task);
   return;
 }
 
@@ -2910,7 +3255,7 @@ static void timeout_pmtud_silent_L2(scamper_task_t *task)
    */
   if(state->pmtud->L2->idx == 0)
     {
-      scamper_task_queue_done(task, 0);
+      trace_queue_done(task);
       return;
     }
 
@@ -2930,7 +3275,7 @@ static void timeout_pmtud_silent_L2(scamper_task_t *task)
       if(pmtud_TTL_init(task) == 1)
 	state->mode = MODE_PMTUD_SILENT_TTL;
       else
-	scamper_task_queue_done(task, 0);
+	trace_queue_done(task);
     }
 
   return;
@@ -3122,7 +3467,7 @@ static int handletp_trace(scamper_task_t *task, scamper_dl_rec_t *dl,
     }
 
   trace_stop_completed(trace);
-  scamper_task_queue_done(task, 0);
+  trace_queue_done(task);
 
   return 0;
 
@@ -3160,7 +3505,7 @@ static int handletp_lastditch(scamper_task_t *task, scamper_dl_rec_t *dl,
       trace_stop_completed(trace);
     }
 
-  scamper_task_queue_done(task, 0);
+  trace_queue_done(task);
   return 0;
 }
 
@@ -3583,7 +3928,7 @@ static void trace_handle_dlhdr(scamper_dlhdr_t *dlhdr)
 
   if(dlhdr->error != 0)
     {
-      scamper_task_queue_done(task, 0);
+      trace_queue_done(task);
       return;
     }
 
@@ -3726,7 +4071,7 @@ static void trace_state_free(trace_state_t *state)
       for(i=0; i<state->id_next; i++)
 	{
 	  probe = state->probes[i];
-	  free(probe);
+	  scamper_slab_put(&tp_slab, probe);
 	}
       free(state->probes);
     }
@@ -3784,6 +4129,8 @@ static int trace_state_alloc(scamper_task_t *task)
 	  printerror(__func__, "could not alloc probeq");
 	  goto err;
 	}
+      if(SCAMPER_TRACE_IS_ADAPTIVE(trace))
+	state->plen = trace_plen_get(trace->dst);
     }
 
   /* allocate memory to record hops */
@@ -3802,6 +4149,11 @@ static int trace_state_alloc(scamper_task_t *task)
 	goto err;
     }
 
+  /* record the version of the shared stop set the trace begins with */
+  if(trace->dtree != NULL &&
+     (trace->dtree->flags & SCAMPER_TRACE_DTREE_FLAG_SHARED) != 0)
+    trace->dtree->gss_ver = scamper_stopset_version();
+
   if(scamper_trace_hops_alloc(trace, state->alloc_hops) == -1)
     {
       printerror(__func__, "could not malloc hops");
@@ -3913,7 +4265,7 @@ static void do_trace_halt(scamper_task_t *task)
 {
   scamper_trace_t *trace = trace_getdata(task);
   trace->stop_reason = SCAMPER_TRACE_STOP_HALTED;
-  scamper_task_queue_done(task, 0);
+  trace_queue_done(task);
   return;
 }
 
@@ -4246,13 +4598,16 @@ static void do_trace_probe(scamper_task_t *task)
    * as there is no point sending something into the wild that we can't
    * record
    */
-  if((tp = malloc_zero(sizeof(trace_probe_t))) == NULL)
+  if((tp = scamper_slab_get(&tp_slab, sizeof(trace_probe_t))) == NULL)
     {
       printerror(__func__, "could not malloc trace_probe_t");
       goto err;
     }
 
-  /* send the probe */
+  /* send the probe, which might be sent later in a batch */
+  probe.pr_txcb       = trace_probe_txcb;
+  probe.pr_txcb_param = task;
+  probe.pr_txcb_id    = state->id_next;
   if(scamper_probe(&probe) == -1)
     {
       errno = probe.pr_errno;
@@ -4275,7 +4630,8 @@ static void do_trace_probe(scamper_task_t *task)
       hs->attempt++;
       hs->id = state->id_next;
       tp->attempt = hs->attempt;
-      assert(trace->hop_count + trace->squeries + 1 >= state->ttl);
+      assert(trace->hop_count + trace->squeries + 1 >= state->ttl ||
+	     state->plen + 1 >= state->ttl);
     }
   else
     {
@@ -4285,6 +4641,7 @@ static void do_trace_probe(scamper_task_t *task)
 
   state->probes[state->id_next] = tp;
   state->id_next++;
+  scamper_task_mem_add(task, sizeof(trace_probe_t) + sizeof(trace_probe_t *));
 
   timeval_cpy(&state->last_tx, &probe.pr_tx);
 
@@ -4292,7 +4649,7 @@ static void do_trace_probe(scamper_task_t *task)
   return;
 
  err:
-  if(tp != NULL) free(tp);
+  if(tp != NULL) scamper_slab_put(&tp_slab, tp);
   trace_handleerror(task, errno);
   return;
 }
@@ -4361,6 +4718,8 @@ static int trace_arg_param_validate(int optid, char *param, long long *out)
       if(strcasecmp(param, "dl") != 0 &&
 	 strcasecmp(param, "const-payload") != 0 &&
 	 strcasecmp(param, "dtree-noback") != 0 &&
+	 strcasecmp(param, "dtree-shared") != 0 &&
+	 strcasecmp(param, "adaptive") != 0 &&
 	 strcasecmp(param, "ptr") != 0)
 	goto err;
       break;
@@ -4486,55 +4845,98 @@ static int trace_arg_param_validate(int optid, char *param, long long *out)
 }
 
 /*
- * scamper_do_trace_alloc
+ * trace_tmpl
  *
- * given a string representing a traceroute task, parse the parameters and
- * assemble a trace.  return the trace structure so that it is all ready to
- * go.
+ * the parameters of a trace command, parsed and checked as far as they
+ * can be without knowing the destination.  a template is built once
+ * for a command that is run against many destinations.
  */
-void *scamper_do_trace_alloc(char *str)
+typedef struct trace_tmpl
+{
+  uint8_t   type;
+  uint32_t  flags;
+  uint8_t   attempts;
+  uint8_t   firsthop;
+  uint8_t   gaplimit;
+  uint8_t   gapaction;
+  uint8_t   hoplimit;
+  uint8_t   squeries;
+  uint8_t   tos;
+  uint8_t   wait;
+  uint8_t   wait_probe;
+  uint8_t   loops;
+  uint8_t   confidence;
+  uint8_t   dtree_flags;
+  uint16_t  sport;
+  uint16_t  dport;
+  uint16_t  offset;
+  uint8_t  *payload;
+  uint16_t  payload_len;
+  uint32_t  userid;
+  uint32_t  optids;
+  char     *lss;
+  char     *src;
+  char     *rtr;
+  char    **gss;
+  int       gssc;
+} trace_tmpl_t;
+
+static void trace_tmpl_free(trace_tmpl_t *tmpl)
+{
+  int i;
+  if(tmpl->payload != NULL) free(tmpl->payload);
+  if(tmpl->lss != NULL) free(tmpl->lss);
+  if(tmpl->src != NULL) free(tmpl->src);
+  if(tmpl->rtr != NULL) free(tmpl->rtr);
+  if(tmpl->gss != NULL)
+    {
+      for(i=0; i<tmpl->gssc; i++)
+	if(tmpl->gss[i] != NULL)
+	  free(tmpl->gss[i]);
+      free(tmpl->gss);
+    }
+  free(tmpl);
+  return;
+}
+
+/*
+ * trace_tmpl_parse
+ *
+ * parse the options in the string.  addr is set to the address that
+ * follows the options, if any.
+ */
+static trace_tmpl_t *trace_tmpl_parse(char *str, char **addr)
 {
-  /* default values of various trace parameters */
-  uint8_t  type        = SCAMPER_TRACE_TYPE_UDP_PARIS;
-  uint32_t flags       = 0;
-  uint8_t  attempts    = SCAMPER_DO_TRACE_ATTEMPTS_DEF;
-  uint8_t  firsthop    = SCAMPER_DO_TRACE_FIRSTHOP_DEF;
-  uint8_t  gaplimit    = SCAMPER_DO_TRACE_GAPLIMIT_DEF;
-  uint8_t  gapaction   = SCAMPER_DO_TRACE_GAPACTION_DEF;
-  uint8_t  hoplimit    = SCAMPER_DO_TRACE_HOPLIMIT_DEF;
-  uint8_t  squeries    = SCAMPER_DO_TRACE_SQUERIES_DEF;
-  uint8_t  tos         = SCAMPER_DO_TRACE_TOS_DEF;
-  uint8_t  wait        = SCAMPER_DO_TRACE_WAIT_DEF;
-  uint8_t  wait_probe  = SCAMPER_DO_TRACE_WAITPROBE_DEF;
-  uint8_t  loops       = SCAMPER_DO_TRACE_LOOPS_DEF;
-  uint8_t  confidence  = 0;
-  uint8_t  dtree_flags = 0;
-  uint16_t sport       = scamper_sport_default();
-  uint16_t dport       = SCAMPER_DO_TRACE_DPORT_DEF;
-  uint16_t offset      = SCAMPER_DO_TRACE_OFFSET_DEF;
-  uint8_t *payload     = NULL;
-  uint16_t payload_len = 0;
-  uint32_t userid      = 0;
-  char    *lss         = NULL;
-  slist_t *gss         = NULL;
-  size_t   i, len;
   scamper_option_out_t *opts_out = NULL, *opt;
-  scamper_trace_t *trace = NULL;
-  splaytree_t *gss_tree = NULL;
-  scamper_addr_t *sa;
-  char *addr;
+  trace_tmpl_t *tmpl = NULL;
+  size_t i, len;
   long long tmp = 0;
-  char *src = NULL, *rtr = NULL;
-  int af, x;
-  uint32_t optids = 0;
 
   /* try and parse the string passed in */
-  if(scamper_options_parse(str, opts, opts_cnt, &opts_out, &addr) != 0)
+  if(scamper_options_parse(str, opts, opts_cnt, &opts_out, addr) != 0)
     goto err;
 
-  /* if there is no IP address after the options string, then stop now */
-  if(addr == NULL)
-    goto err;
+  if((tmpl = malloc_zero(sizeof(trace_tmpl_t))) == NULL)
+    {
+      printerror(__func__, "could not malloc tmpl");
+      goto err;
+    }
+
+  /* default values of various trace parameters */
+  tmpl->type        = SCAMPER_TRACE_TYPE_UDP_PARIS;
+  tmpl->attempts    = SCAMPER_DO_TRACE_ATTEMPTS_DEF;
+  tmpl->firsthop    = SCAMPER_DO_TRACE_FIRSTHOP_DEF;
+  tmpl->gaplimit    = SCAMPER_DO_TRACE_GAPLIMIT_DEF;
+  tmpl->gapaction   = SCAMPER_DO_TRACE_GAPACTION_DEF;
+  tmpl->hoplimit    = SCAMPER_DO_TRACE_HOPLIMIT_DEF;
+  tmpl->squeries    = SCAMPER_DO_TRACE_SQUERIES_DEF;
+  tmpl->tos         = SCAMPER_DO_TRACE_TOS_DEF;
+  tmpl->wait        = SCAMPER_DO_TRACE_WAIT_DEF;
+  tmpl->wait_probe  = SCAMPER_DO_TRACE_WAITPROBE_DEF;
+  tmpl->loops       = SCAMPER_DO_TRACE_LOOPS_DEF;
+  tmpl->sport       = scamper_sport_default();
+  tmpl->dport       = SCAMPER_DO_TRACE_DPORT_DEF;
+  tmpl->offset      = SCAMPER_DO_TRACE_OFFSET_DEF;
 
   /* parse the options, do preliminary sanity checks */
   for(opt = opts_out; opt != NULL; opt = opt->next)
@@ -4546,154 +4948,212 @@ void *scamper_do_trace_alloc(char *str)
 	  goto err;
 	}
 
-      optids |= (0x1 << opt->id);
+      tmpl->optids |= (0x1 << opt->id);
 
       switch(opt->id)
 	{
 	case TRACE_OPT_DPORT:
-	  dport = (uint16_t)tmp;
+	  tmpl->dport = (uint16_t)tmp;
 	  break;
 
 	case TRACE_OPT_FIRSTHOP:
-	  firsthop = (uint8_t)tmp;
+	  tmpl->firsthop = (uint8_t)tmp;
 	  break;
 
 	case TRACE_OPT_GAPLIMIT:
-	  gaplimit = (uint8_t)tmp;
+	  tmpl->gaplimit = (uint8_t)tmp;
 	  break;
 
 	case TRACE_OPT_GAPACTION:
-	  gapaction = (uint8_t)tmp;
+	  tmpl->gapaction = (uint8_t)tmp;
 	  break;
 
 	case TRACE_OPT_LOOPS:
-	  loops = (uint8_t)tmp;
+	  tmpl->loops = (uint8_t)tmp;
 	  break;
 
 	case TRACE_OPT_MAXTTL:
-	  hoplimit = (uint8_t)tmp;
+	  tmpl->hoplimit = (uint8_t)tmp;
 	  break;
 
 	case TRACE_OPT_OFFSET:
-	  offset = (uint16_t)tmp;
+	  tmpl->offset = (uint16_t)tmp;
 	  break;
 
 	case TRACE_OPT_OPTION:
 	  if(strcasecmp(opt->str, "dl") == 0)
-	    flags |= SCAMPER_TRACE_FLAG_DL;
+	    tmpl->flags |= SCAMPER_TRACE_FLAG_DL;
+	  else if(strcasecmp(opt->str, "adaptive") == 0)
+	    tmpl->flags |= SCAMPER_TRACE_FLAG_ADAPTIVE;
 	  else if(strcasecmp(opt->str, "const-payload") == 0)
-	    flags |= SCAMPER_TRACE_FLAG_CONSTPAYLOAD;
+	    tmpl->flags |= SCAMPER_TRACE_FLAG_CONSTPAYLOAD;
 	  else if(strcasecmp(opt->str, "dtree-noback") == 0)
-	    dtree_flags |= SCAMPER_TRACE_DTREE_FLAG_NOBACK;
+	    tmpl->dtree_flags |= SCAMPER_TRACE_DTREE_FLAG_NOBACK;
+	  else if(strcasecmp(opt->str, "dtree-shared") == 0)
+	    tmpl->dtree_flags |= SCAMPER_TRACE_DTREE_FLAG_SHARED;
 	  else if(strcasecmp(opt->str, "ptr") == 0)
-	    flags |= SCAMPER_TRACE_FLAG_PTR;
+	    tmpl->flags |= SCAMPER_TRACE_FLAG_PTR;
 	  break;
 
 	case TRACE_OPT_PAYLOAD:
+	  if(tmpl->payload != NULL)
+	    free(tmpl->payload);
 	  len = strlen(opt->str);
-	  payload_len = len/2;
-	  if((payload = malloc_zero(payload_len)) == NULL)
+	  tmpl->payload_len = len/2;
+	  if((tmpl->payload = malloc_zero(tmpl->payload_len)) == NULL)
 	    {
 	      printerror(__func__, "could not malloc payload");
 	      goto err;
 	    }
 	  for(i=0; i<len; i+=2)
-	    payload[i/2] = hex2byte(opt->str[i], opt->str[i+1]);
+	    tmpl->payload[i/2] = hex2byte(opt->str[i], opt->str[i+1]);
 	  break;
 
 	case TRACE_OPT_PMTUD:
-	  flags |= SCAMPER_TRACE_FLAG_PMTUD;
+	  tmpl->flags |= SCAMPER_TRACE_FLAG_PMTUD;
 	  break;
 
 	case TRACE_OPT_PROTOCOL:
-	  type = (uint8_t)tmp;
+	  tmpl->type = (uint8_t)tmp;
 	  break;
 
 	case TRACE_OPT_ATTEMPTS:
-	  attempts = (uint8_t)tmp;
+	  tmpl->attempts = (uint8_t)tmp;
 	  break;
 
 	case TRACE_OPT_ALLATTEMPTS:
-	  flags |= SCAMPER_TRACE_FLAG_ALLATTEMPTS;
+	  tmpl->flags |= SCAMPER_TRACE_FLAG_ALLATTEMPTS;
 	  break;
 
 	case TRACE_OPT_SPORT:
-	  sport = (uint16_t)tmp;
+	  tmpl->sport = (uint16_t)tmp;
 	  break;
 
 	case TRACE_OPT_SQUERIES:
-	  squeries = (uint8_t)tmp;
+	  tmpl->squeries = (uint8_t)tmp;
 	  break;
 
 	case TRACE_OPT_TOS:
-	  tos = (uint8_t)tmp;
+	  tmpl->tos = (uint8_t)tmp;
 	  break;
 
 	case TRACE_OPT_TTLDST:
-	  flags |= SCAMPER_TRACE_FLAG_IGNORETTLDST;
+	  tmpl->flags |= SCAMPER_TRACE_FLAG_IGNORETTLDST;
 	  break;
 
 	case TRACE_OPT_WAIT:
-	  wait = (uint8_t)tmp;
+	  tmpl->wait = (uint8_t)tmp;
 	  break;
 
 	case TRACE_OPT_RTRADDR:
-	  if(rtr != NULL)
+	  if(tmpl->rtr != NULL || (tmpl->rtr = strdup(opt->str)) == NULL)
 	    goto err;
-	  rtr = opt->str;
 	  break;
 
 	case TRACE_OPT_SRCADDR:
-	  if(src != NULL)
+	  if(tmpl->src != NULL || (tmpl->src = strdup(opt->str)) == NULL)
 	    goto err;
-	  src = opt->str;
 	  break;
 
 	case TRACE_OPT_CONFIDENCE:
-	  confidence = (uint8_t)tmp;
+	  tmpl->confidence = (uint8_t)tmp;
 	  break;
 
 	case TRACE_OPT_USERID:
-	  userid = (uint32_t)tmp;
+	  tmpl->userid = (uint32_t)tmp;
 	  break;
 
 	case TRACE_OPT_WAITPROBE:
-	  wait_probe = (uint8_t)tmp;
+	  tmpl->wait_probe = (uint8_t)tmp;
 	  break;
 
 	case TRACE_OPT_LSSNAME:
-	  lss = opt->str;
+	  if(tmpl->lss != NULL)
+	    free(tmpl->lss);
+	  if((tmpl->lss = strdup(opt->str)) == NULL)
+	    goto err;
 	  break;
 
 	case TRACE_OPT_GSSENTRY:
-	  if((gss == NULL && (gss = slist_alloc()) == NULL) ||
-	     slist_tail_push(gss, opt->str) == NULL)
-	    {
-	      goto err;
-	    }
+	  len = sizeof(char *) * (tmpl->gssc + 1);
+	  if(realloc_wrap((void **)&tmpl->gss, len) != 0 ||
+	     (tmpl->gss[tmpl->gssc++] = strdup(opt->str)) == NULL)
+	    goto err;
 	  break;
 	}
     }
   scamper_options_free(opts_out); opts_out = NULL;
 
   /* sanity check that we don't begin beyond our probe hoplimit */
-  if(firsthop > hoplimit && hoplimit != 0)
+  if(tmpl->firsthop > tmpl->hoplimit && tmpl->hoplimit != 0)
     goto err;
 
   /* can't really do pmtud properly without all of the path */
-  if((flags & SCAMPER_TRACE_FLAG_PMTUD) != 0 &&
-     (firsthop > 1 || gss != NULL || lss != NULL))
+  if((tmpl->flags & SCAMPER_TRACE_FLAG_PMTUD) != 0 &&
+     (tmpl->firsthop > 1 || tmpl->gss != NULL || tmpl->lss != NULL ||
+      (tmpl->dtree_flags & SCAMPER_TRACE_DTREE_FLAG_SHARED) != 0))
+    goto err;
+
+  /* the shared stop set has to have been given to scamper */
+  if((tmpl->dtree_flags & SCAMPER_TRACE_DTREE_FLAG_SHARED) != 0 &&
+     scamper_stopset_isopen() == 0)
     goto err;
 
   /* cannot specify both a confidence value and tell it to send all attempts */
-  if(confidence != 0 && (flags & SCAMPER_TRACE_FLAG_ALLATTEMPTS))
+  if(tmpl->confidence != 0 && (tmpl->flags & SCAMPER_TRACE_FLAG_ALLATTEMPTS))
     goto err;
 
   /* can't really do pmtud properly without a UDP traceroute method */
-  if((flags & SCAMPER_TRACE_FLAG_PMTUD) != 0 &&
-     type != SCAMPER_TRACE_TYPE_UDP && type != SCAMPER_TRACE_TYPE_UDP_PARIS)
+  if((tmpl->flags & SCAMPER_TRACE_FLAG_PMTUD) != 0 &&
+     tmpl->type != SCAMPER_TRACE_TYPE_UDP &&
+     tmpl->type != SCAMPER_TRACE_TYPE_UDP_PARIS)
+    goto err;
+
+  /* don't allow tcptraceroute to have a payload */
+  if(SCAMPER_TRACE_TYPE_IS_TCP(tmpl) && tmpl->payload_len > 0)
+    goto err;
+
+  /*
+   * an adaptive traceroute keeps as many probes outstanding beyond the
+   * last responsive hop as the gaplimit allows, unless told otherwise.
+   * it probes from the first hop, so it is not used with doubletree.
+   */
+  if((tmpl->flags & SCAMPER_TRACE_FLAG_ADAPTIVE) != 0)
+    {
+      if((tmpl->optids & (0x1 << TRACE_OPT_SQUERIES)) == 0)
+	tmpl->squeries = tmpl->gaplimit;
+      if(tmpl->squeries < 2 || (tmpl->flags & SCAMPER_TRACE_FLAG_PMTUD) ||
+	 tmpl->firsthop > 1 || tmpl->gss != NULL || tmpl->lss != NULL ||
+	 tmpl->dtree_flags != 0)
+	goto err;
+    }
+
+  /* do not allow more outstanding probes than gaplimit allows */
+  if(tmpl->squeries > tmpl->gaplimit)
     goto err;
 
+  return tmpl;
+
+ err:
+  if(tmpl != NULL) trace_tmpl_free(tmpl);
+  if(opts_out != NULL) scamper_options_free(opts_out);
+  return NULL;
+}
+
+/*
+ * trace_tmpl_trace
+ *
+ * build a trace to the destination from the template, and do the
+ * checks that depend on the destination.
+ */
+static scamper_trace_t *trace_tmpl_trace(const trace_tmpl_t *tmpl,
+					 const char *addr)
+{
+  scamper_trace_t *trace = NULL;
+  splaytree_t *gss_tree = NULL;
+  scamper_addr_t *sa;
+  int af, i, x;
+
   if((trace = scamper_trace_alloc()) == NULL)
     {
       printerror(__func__, "could not alloc trace");
@@ -4702,41 +5162,39 @@ void *scamper_do_trace_alloc(char *str)
   if((trace->dst= scamper_addrcache_resolve(addrcache,AF_UNSPEC,addr)) == NULL)
     goto err;
 
-  trace->type        = type;
-  trace->flags       = flags;
-  trace->attempts    = attempts;
-  trace->hoplimit    = hoplimit;
-  trace->squeries    = squeries;
-  trace->gaplimit    = gaplimit;
-  trace->gapaction   = gapaction;
-  trace->firsthop    = firsthop;
-  trace->tos         = tos;
-  trace->wait        = wait;
-  trace->loops       = loops;
-  trace->sport       = sport;
-  trace->dport       = dport;
-  trace->payload     = payload; payload = NULL;
-  trace->payload_len = payload_len;
-  trace->confidence  = confidence;
-  trace->wait_probe  = wait_probe;
-  trace->offset      = offset;
-  trace->userid      = userid;
+  trace->type        = tmpl->type;
+  trace->flags       = tmpl->flags;
+  trace->attempts    = tmpl->attempts;
+  trace->hoplimit    = tmpl->hoplimit;
+  trace->squeries    = tmpl->squeries;
+  trace->gaplimit    = tmpl->gaplimit;
+  trace->gapaction   = tmpl->gapaction;
+  trace->firsthop    = tmpl->firsthop;
+  trace->tos         = tmpl->tos;
+  trace->wait        = tmpl->wait;
+  trace->loops       = tmpl->loops;
+  trace->sport       = tmpl->sport;
+  trace->dport       = tmpl->dport;
+  trace->payload_len = tmpl->payload_len;
+  trace->confidence  = tmpl->confidence;
+  trace->wait_probe  = tmpl->wait_probe;
+  trace->offset      = tmpl->offset;
+  trace->userid      = tmpl->userid;
+
+  if(tmpl->payload_len > 0 &&
+     (trace->payload = memdup(tmpl->payload, tmpl->payload_len)) == NULL)
+    {
+      printerror(__func__, "could not dup payload");
+      goto err;
+    }
 
   /* to start with, we are this far into the path */
-  trace->hop_count = firsthop - 1;
-
-  /* don't allow tcptraceroute to have a payload */
-  if(SCAMPER_TRACE_TYPE_IS_TCP(trace) && trace->payload_len > 0)
-    goto err;
+  trace->hop_count = tmpl->firsthop - 1;
 
   /* don't allow fragment traceroute with IPv4 for now */
   if(trace->offset != 0 && trace->dst->type == SCAMPER_ADDR_TYPE_IPV4)
     goto err;
 
-  /* do not allow more outstanding probes than gaplimit allows */
-  if(trace->squeries > trace->gaplimit)
-    goto err;
-
   switch(trace->dst->type)
     {
     case SCAMPER_ADDR_TYPE_IPV4:
@@ -4765,12 +5223,12 @@ void *scamper_do_trace_alloc(char *str)
   if(af != AF_INET && af != AF_INET6)
     goto err;
 
-  if(src != NULL &&
-     (trace->src = scamper_addrcache_resolve(addrcache, af, src)) == NULL)
+  if(tmpl->src != NULL &&
+     (trace->src = scamper_addrcache_resolve(addrcache, af, tmpl->src)) == NULL)
     goto err;
 
-  if(rtr != NULL &&
-     (trace->rtr = scamper_addrcache_resolve(addrcache, af, rtr)) == NULL)
+  if(tmpl->rtr != NULL &&
+     (trace->rtr = scamper_addrcache_resolve(addrcache, af, tmpl->rtr)) == NULL)
     goto err;
 
   /*
@@ -4780,36 +5238,43 @@ void *scamper_do_trace_alloc(char *str)
   if(trace->type == SCAMPER_TRACE_TYPE_ICMP_ECHO_PARIS)
     {
       trace->flags |= SCAMPER_TRACE_FLAG_ICMPCSUMDP;
-      if((optids & (0x1 << TRACE_OPT_DPORT)) == 0)
+      if((tmpl->optids & (0x1 << TRACE_OPT_DPORT)) == 0)
 	trace->dport = scamper_sport_default();
     }
 
   /* add the nodes to the global stop set for this trace */
-  if(gss != NULL || lss != NULL)
+  if(tmpl->gss != NULL || tmpl->lss != NULL ||
+     (tmpl->dtree_flags & SCAMPER_TRACE_DTREE_FLAG_SHARED) != 0)
     {
       if(scamper_trace_dtree_alloc(trace) != 0)
 	goto err;
       trace->flags |= SCAMPER_TRACE_FLAG_DOUBLETREE;
       trace->dtree->firsthop = trace->firsthop;
-      trace->dtree->flags = dtree_flags;
+      trace->dtree->flags = tmpl->dtree_flags;
     }
 
-  if(lss != NULL && scamper_trace_dtree_lss(trace, lss) != 0)
+  if(tmpl->lss != NULL && scamper_trace_dtree_lss(trace, tmpl->lss) != 0)
     goto err;
 
-  if(gss != NULL)
+  if(tmpl->gss != NULL)
     {
       if((gss_tree=splaytree_alloc((splaytree_cmp_t)scamper_addr_cmp)) == NULL)
 	goto err;
-      while((addr = slist_head_pop(gss)) != NULL)
+      for(i=0; i<tmpl->gssc; i++)
 	{
-	  if((sa = scamper_addrcache_resolve(addrcache, af, addr)) == NULL ||
-	     (splaytree_find(gss_tree, sa) == NULL &&
-	      splaytree_insert(gss_tree, sa) == NULL))
+	  if((sa = scamper_addrcache_resolve(addrcache,af,tmpl->gss[i])) == NULL)
 	    goto err;
+	  if(splaytree_find(gss_tree, sa) != NULL)
+	    {
+	      scamper_addr_free(sa);
+	      continue;
+	    }
+	  if(splaytree_insert(gss_tree, sa) == NULL)
+	    {
+	      scamper_addr_free(sa);
+	      goto err;
+	    }
 	}
-      slist_free(gss);
-      gss = NULL;
 
       if((x = splaytree_count(gss_tree)) >= 65535 ||
 	 scamper_trace_dtree_gss_alloc(trace, x) != 0)
@@ -4823,15 +5288,62 @@ void *scamper_do_trace_alloc(char *str)
   return trace;
 
  err:
-  if(payload != NULL) free(payload);
-  if(gss != NULL) slist_free(gss);
   if(gss_tree != NULL)
     splaytree_free(gss_tree, (splaytree_free_t)scamper_addr_free);
   if(trace != NULL) scamper_trace_free(trace);
-  if(opts_out != NULL) scamper_options_free(opts_out);
   return NULL;
 }
 
+/*
+ * scamper_do_trace_alloc
+ *
+ * given a string representing a traceroute task, parse the parameters and
+ * assemble a trace.  return the trace structure so that it is all ready to
+ * go.
+ */
+void *scamper_do_trace_alloc(char *str)
+{
+  scamper_trace_t *trace = NULL;
+  trace_tmpl_t *tmpl;
+  char *addr;
+
+  if((tmpl = trace_tmpl_parse(str, &addr)) == NULL)
+    return NULL;
+
+  /* if there is no IP address after the options string, then stop now */
+  if(addr != NULL)
+    trace = trace_tmpl_trace(tmpl, addr);
+
+  trace_tmpl_free(tmpl);
+  return trace;
+}
+
+void *scamper_do_trace_tmpl_alloc(char *str)
+{
+  trace_tmpl_t *tmpl;
+  char *addr;
+
+  /* a template does not have an address */
+  if((tmpl = trace_tmpl_parse(str, &addr)) != NULL && addr != NULL)
+    {
+      trace_tmpl_free(tmpl);
+      tmpl = NULL;
+    }
+
+  return tmpl;
+}
+
+void *scamper_do_trace_tmpl_data(const void *tmpl, const char *addr)
+{
+  return trace_tmpl_trace(tmpl, addr);
+}
+
+void scamper_do_trace_tmpl_free(void *tmpl)
+{
+  trace_tmpl_free(tmpl);
+  return;
+}
+
 int scamper_do_trace_arg_validate(int argc, char *argv[], int *stop)
 {
   return scamper_options_validate(opts, opts_cnt, argc, argv, stop,
@@ -4911,6 +5423,18 @@ void scamper_do_trace_cleanup(void)
       lsses = NULL;
     }
 
+  if(plens != NULL)
+    {
+      splaytree_free(plens, free);
+      plens = NULL;
+    }
+
+  if(plen_lru != NULL)
+    {
+      dlist_free(plen_lru);
+      plen_lru = NULL;
+    }
+
   return;
 }
 
@@ -4924,6 +5448,7 @@ int scamper_do_trace_init(void)
   trace_funcs.handle_timeout = do_trace_handle_timeout;
   trace_funcs.write          = do_trace_write;
   trace_funcs.task_free      = do_trace_free;
+  trace_funcs.name           = "trace";
   trace_funcs.halt           = do_trace_halt;
 
   osinfo = scamper_osinfo_get();
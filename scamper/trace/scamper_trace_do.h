@@ -27,6 +27,11 @@
 
 void *scamper_do_trace_alloc(char *str);
 
+/* parse a command without an address once, to build traces from later */
+void *scamper_do_trace_tmpl_alloc(char *str);
+void *scamper_do_trace_tmpl_data(const void *tmpl, const char *addr);
+void scamper_do_trace_tmpl_free(void *tmpl);
+
 scamper_task_t *scamper_do_trace_alloctask(void *data,
 					   scamper_list_t *list,
 					   scamper_cycle_t *cycle);
@@ -165,6 +165,7 @@ static const warts_var_t pmtud_n_vars[] =
 #define WARTS_TRACE_DTREE_GSS_STOP     5 /* gss stop address */
 #define WARTS_TRACE_DTREE_LSS_NAME     6 /* lss name */
 #define WARTS_TRACE_DTREE_FLAGS        7 /* flags */
+#define WARTS_TRACE_DTREE_GSS_VER      8 /* shared stop set version */
 static const warts_var_t trace_dtree_vars[] =
 {
   {WARTS_TRACE_DTREE_LSS_STOP_GID,  4, -1},
@@ -174,6 +175,7 @@ static const warts_var_t trace_dtree_vars[] =
   {WARTS_TRACE_DTREE_GSS_STOP,     -1, -1},
   {WARTS_TRACE_DTREE_LSS_NAME,     -1, -1},
   {WARTS_TRACE_DTREE_FLAGS,         1, -1},
+  {WARTS_TRACE_DTREE_GSS_VER,       4, -1},
 };
 #define trace_dtree_vars_mfb WARTS_VAR_MFB(trace_dtree_vars)
 
@@ -1105,7 +1107,9 @@ static int warts_trace_dtree_params(const scamper_file_t *sf,
       if((var->id == WARTS_TRACE_DTREE_LSS_STOP && dtree->lss_stop == NULL) ||
 	 (var->id == WARTS_TRACE_DTREE_LSS_NAME && dtree->lss == NULL) ||
 	 (var->id == WARTS_TRACE_DTREE_GSS_STOP && dtree->gss_stop == NULL) ||
-	 (var->id == WARTS_TRACE_DTREE_FLAGS    && dtree->flags == 0))
+	 (var->id == WARTS_TRACE_DTREE_FLAGS    && dtree->flags == 0) ||
+	 (var->id == WARTS_TRACE_DTREE_GSS_VER  &&
+	  (dtree->flags & SCAMPER_TRACE_DTREE_FLAG_SHARED) == 0))
 	continue;
 
       flag_set(state->flags, var->id, &max_id);
@@ -1153,6 +1157,7 @@ static void warts_trace_dtree_write(const scamper_trace_t *trace,
     {trace->dtree->gss_stop,  (wpw_t)insert_addr,   table},
     {trace->dtree->lss,       (wpw_t)insert_string, NULL},
     {&trace->dtree->flags,    (wpw_t)insert_byte,   NULL},
+    {&trace->dtree->gss_ver,  (wpw_t)insert_uint32, NULL},
   };
   const int handler_cnt = sizeof(handlers)/sizeof(warts_param_writer_t);
 
@@ -1168,6 +1173,7 @@ static int warts_trace_dtree_read(scamper_trace_t *trace, warts_state_t *state,
 {
   scamper_addr_t *lss_stop = NULL, *gss_stop = NULL;
   uint8_t firsthop = 0, flags = 0;
+  uint32_t gss_ver = 0;
   char *lss = NULL;
 
   warts_param_reader_t handlers[] = {
@@ -1178,6 +1184,7 @@ static int warts_trace_dtree_read(scamper_trace_t *trace, warts_state_t *state,
     {&gss_stop, (wpr_t)extract_addr,     table},
     {&lss,      (wpr_t)extract_string,   NULL},
     {&flags,    (wpr_t)extract_byte,     NULL},
+    {&gss_ver,  (wpr_t)extract_uint32,   NULL},
   };
   const int handler_cnt = sizeof(handlers)/sizeof(warts_param_reader_t);
 
@@ -1195,6 +1202,7 @@ static int warts_trace_dtree_read(scamper_trace_t *trace, warts_state_t *state,
   trace->dtree->firsthop = firsthop;
   trace->dtree->lss      = lss;
   trace->dtree->flags    = flags;
+  trace->dtree->gss_ver  = gss_ver;
   return 0;
 }
 
@@ -1345,14 +1353,12 @@ int scamper_file_warts_trace_read(scamper_file_t *sf, const warts_hdr_t *hdr,
 
  done:
   warts_addrtable_free(table);
-  free(buf);
   *trace_out = trace;
   return 0;
 
  err:
   if(table != NULL) warts_addrtable_free(table);
   if(hops != NULL) free(hops);
-  if(buf != NULL) free(buf);
   if(trace != NULL) scamper_trace_free(trace);
   return -1;
 }
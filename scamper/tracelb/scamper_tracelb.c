@@ -36,8 +36,11 @@
 #include "scamper_list.h"
 #include "scamper_icmpext.h"
 #include "scamper_tracelb.h"
+#include "scamper_slab.h"
 #include "utils.h"
 
+static scamper_slab_t *reply_slab = NULL;
+
 typedef struct tracelb_fwdpathc
 {
   int pathc;
@@ -511,7 +514,8 @@ scamper_tracelb_reply_t *scamper_tracelb_reply_alloc(scamper_addr_t *addr)
 {
   scamper_tracelb_reply_t *reply;
 
-  if((reply = malloc_zero(sizeof(scamper_tracelb_reply_t))) == NULL)
+  reply = scamper_slab_get(&reply_slab, sizeof(scamper_tracelb_reply_t));
+  if(reply == NULL)
     return NULL;
 
   if(addr != NULL)
@@ -531,7 +535,7 @@ void scamper_tracelb_reply_free(scamper_tracelb_reply_t *reply)
   if((reply->reply_flags & SCAMPER_TRACELB_REPLY_FLAG_TCP) == 0)
     scamper_icmpext_free(reply->reply_icmp_ext);
 
-  free(reply);
+  scamper_slab_put(&reply_slab, reply);
   return;
 }
 
@@ -56,6 +56,7 @@ typedef struct scamper_tracelb_probeset_summary scamper_tracelb_probeset_summary
  * some meaning.
  */
 #define SCAMPER_TRACELB_FLAG_PTR            0x01 /* do ptr lookups */
+#define SCAMPER_TRACELB_FLAG_LITE           0x02 /* mda-lite stopping */
 
 /*
  * these values give the 'flags' member of a scamper_tracelb_node_t
@@ -258,6 +259,9 @@ typedef struct scamper_tracelb
    * probec:
    *  count of probes sent.  includes retries.
    *
+   * probec_saved:
+   *  count of hop probes that -O lite did not send but MDA would have.
+   *
    * error:
    *  if non-zero, something went wrong.
    */
@@ -266,6 +270,7 @@ typedef struct scamper_tracelb
   scamper_tracelb_link_t   **links;
   uint16_t                   linkc;
   uint32_t                   probec;
+  uint32_t                   probec_saved;
   uint8_t                    error;
 } scamper_tracelb_t;
 
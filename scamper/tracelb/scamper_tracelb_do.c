@@ -93,6 +93,10 @@
 #define SCAMPER_DO_TRACELB_WAITTIMEOUT_DEF 5
 #define SCAMPER_DO_TRACELB_WAITTIMEOUT_MAX 10
 
+/* memory accounted to the task for each reply recorded */
+#define TRACELB_REPLY_MEM \
+  (sizeof(scamper_tracelb_reply_t) + sizeof(scamper_tracelb_reply_t *))
+
 static const uint8_t MODE_RTSOCK     = 0; /* need to determine outgoing if */
 static const uint8_t MODE_DLHDR      = 1; /* need to determine datalink hdr */
 static const uint8_t MODE_FIRSTADDR  = 2; /* probing for the first address */
@@ -151,6 +155,25 @@ struct tracelb_path
    */
   int                      visited;
   int                      distance;
+
+  /*
+   * these fields are used with -O lite
+   *
+   * the 'uniform' field says flows were spread evenly over the fwd paths
+   * the 'lite' field says a fwd path is sharing (1) or has shared (2) the
+   *   probes of its hop with the other fwd paths
+   * the 'lite_probec' field counts probes the fwd paths have sent
+   * the 'nexts' field records the addresses the fwd paths have found
+   * the 'held' field keeps the branches of fwd paths that stopped with
+   *   their share of the probes, until the other fwd paths are done
+   */
+  uint8_t                  uniform;
+  uint8_t                  lite;
+  int                      lite_probec;
+  scamper_addr_t         **nexts;
+  int                      nextc;
+  struct tracelb_branch  **held;
+  int                      heldc;
 };
 
 /*
@@ -265,6 +288,7 @@ typedef struct tracelb_state
   tracelb_path_t         **paths;        /* paths established */
   int                      pathc;        /* count of paths */
   dlist_t                 *ths;          /* tracelb_host_t */
+  scamper_task_t          *task;         /* task to account memory to */
 } tracelb_state_t;
 
 /* temporary buffer shared amongst traceroutes */
@@ -274,6 +298,9 @@ static size_t               pktbuf_len = 0;
 /* the callback functions registered with the tracelb task */
 static scamper_task_funcs_t funcs;
 
+/* forward declare */
+static void tracelb_lite_flush(scamper_task_t *task);
+
 #define TRACE_OPT_CONFIDENCE   1
 #define TRACE_OPT_DPORT        2
 #define TRACE_OPT_FIRSTHOP     3
@@ -1082,6 +1109,9 @@ static tracelb_link_t *tracelb_link_alloc(tracelb_state_t *state,
       return NULL;;
     }
 
+  scamper_task_mem_add(state->task, sizeof(tracelb_link_t) +
+		       sizeof(scamper_tracelb_link_t) +
+		       sizeof(tracelb_link_t *));
   return tlbl;
 }
 
@@ -1210,6 +1240,10 @@ static int tracelb_probe_add(tracelb_state_t *state, tracelb_branch_t *br,
     }
   pr->branch = br;
 
+  scamper_task_mem_add(state->task, sizeof(tracelb_probe_t) +
+		       sizeof(scamper_tracelb_probe_t) +
+		       sizeof(tracelb_probe_t *) * 2);
+
   return 0;
 }
 
@@ -1287,9 +1321,19 @@ static int tracelb_path_add_back(tracelb_path_t *path, tracelb_path_t *back)
 
 static void tracelb_path_free(tracelb_path_t *path)
 {
+  int i;
+
   if(path == NULL)
     return;
 
+  if(path->nexts != NULL)
+    {
+      for(i=0; i<path->nextc; i++)
+	scamper_addr_free(path->nexts[i]);
+      free(path->nexts);
+    }
+
+  if(path->held  != NULL) free(path->held);
   if(path->back  != NULL) free(path->back);
   if(path->fwd   != NULL) free(path->fwd);
   if(path->links != NULL) free(path->links);
@@ -1330,6 +1374,8 @@ static tracelb_path_t *tracelb_path_alloc(tracelb_state_t *state, int linkc)
       goto err;
     }
 
+  scamper_task_mem_add(state->task, sizeof(tracelb_path_t) + len +
+		       sizeof(tracelb_path_t *));
   return path;
 
  err:
@@ -1722,6 +1768,7 @@ static void tracelb_queue(scamper_task_t *task)
       /* check to see if we're permitted to send another probe */
       if(trace->probec >= trace->probec_max)
 	{
+	  tracelb_lite_flush(task);
 	  scamper_task_queue_done(task, 0);
 	  return;
 	}
@@ -1798,6 +1845,108 @@ static int tracelb_node_ptr(scamper_task_t *task, scamper_tracelb_node_t *node)
   return -1;
 }
 
+/*
+ * tracelb_node_add
+ *
+ * add the node to the trace, looking up its name if asked to, and
+ * account for the memory it holds.
+ */
+static int tracelb_node_add(scamper_task_t *task, scamper_tracelb_node_t *node)
+{
+  if(tracelb_node_ptr(task, node) != 0 ||
+     scamper_tracelb_node_add(tracelb_getdata(task), node) != 0)
+    return -1;
+  scamper_task_mem_add(task, sizeof(scamper_tracelb_node_t) +
+		       sizeof(scamper_tracelb_node_t *));
+  return 0;
+}
+
+/*
+ * tracelb_branch_k
+ *
+ * return the number of probes the branch should send to the hop it is
+ * probing.  with -O lite, a branch following a divergence where flows
+ * were spread evenly shares the probes the hop needs to rule out
+ * another node with the other branches of the divergence, rather than
+ * sending enough on its own.  a branch that finds a second node falls
+ * back to MDA.
+ */
+static int tracelb_branch_k(tracelb_state_t *state, const tracelb_branch_t *br)
+{
+  const tracelb_path_t *path = br->path, *div;
+  int i, n, need, waiting = 0, full = k(state, br->n);
+
+  if(br->mode != MODE_HOPPROBE || path->lite != 1 || br->newnodec > 1 ||
+     path->backc != 1 || path->linkc != 1 || path->back[0]->uniform == 0)
+    return full;
+  div = path->back[0];
+
+  /* count the branches that are yet to finish probing the hop */
+  for(i=0; i<div->fwdc; i++)
+    if(div->fwd[i]->lite == 1)
+      waiting++;
+  assert(waiting > 0);
+
+  /* count the nodes found at the hop so far */
+  n = div->nextc;
+  if(br->newnodec == 1)
+    {
+      for(i=0; i<div->nextc; i++)
+	if(scamper_addr_cmp(div->nexts[i], br->newnodes[0]->node->addr) == 0)
+	  break;
+      if(i == div->nextc)
+	n++;
+    }
+  if(n < 1)
+    n = 1;
+  n = TRACELB_CONFIDENCE_NLIMIT(n+1);
+
+  /* the probes left for the hop are split among the remaining branches */
+  need = k(state, n) - div->lite_probec;
+  need = (need + waiting - 1) / waiting;
+  if(need < 1)
+    need = 1;
+  if(need > full)
+    need = full;
+
+  return need;
+}
+
+/*
+ * tracelb_branch_mda
+ *
+ * a branch of the divergence found flows were not spread evenly, so the
+ * rest of the hop is probed with MDA.  the branches held after stopping
+ * with their share of the probes go back to probing the hop until they
+ * have sent as many probes as MDA would.
+ */
+static void tracelb_branch_mda(scamper_task_t *task, tracelb_path_t *div)
+{
+  scamper_tracelb_t *trace = tracelb_getdata(task);
+  tracelb_state_t *state = tracelb_getstate(task);
+  tracelb_branch_t *br;
+  int i;
+
+  div->uniform = 0;
+
+  for(i=0; i<div->heldc; i++)
+    {
+      br = div->held[i];
+      timeval_add_cs(&br->next_tx, &br->last_tx, trace->wait_probe);
+      if(tracelb_branch_waiting(state, br) != 0)
+	tracelb_branch_free(state, br);
+    }
+
+  if(div->held != NULL)
+    {
+      free(div->held);
+      div->held = NULL;
+      div->heldc = 0;
+    }
+
+  return;
+}
+
 static int tracelb_process_hops(scamper_task_t *task, tracelb_branch_t *br)
 {
   scamper_tracelb_t *trace = tracelb_getdata(task);
@@ -1812,10 +1961,19 @@ static int tracelb_process_hops(scamper_task_t *task, tracelb_branch_t *br)
   tracelb_probe_t *pr;
   uint16_t flowid;
   slist_t *flowids = NULL;
-  int i, j, k, splice, record, timxceed;
+  int i, j, k, splice, record, timxceed, lite = 0;
+  int flowc, flowmin = -1, flowtot = 0;
 
   assert(br->probec > 0);
 
+  /*
+   * with -O lite, the branches following a divergence can share the
+   * probes for the next hop if the flows were spread evenly.
+   */
+  if((trace->flags & SCAMPER_TRACELB_FLAG_LITE) != 0 &&
+     br->mode == MODE_PERPACKET && br->newnodec > 1)
+    lite = 1;
+
   /*
    * get the from node.  the algorithm to obtain it depends on exactly what
    * happened prior to reaching here.
@@ -1836,8 +1994,7 @@ static int tracelb_process_hops(scamper_task_t *task, tracelb_branch_t *br)
       if(to == NULL)
 	{
 	  to = br->newnodes[i]->node;
-	  if(tracelb_node_ptr(task, to) != 0 ||
-	     scamper_tracelb_node_add(trace, to) != 0)
+	  if(tracelb_node_add(task, to) != 0)
 	    goto err;
 	  splice = 0;
 	}
@@ -2029,6 +2186,11 @@ static int tracelb_process_hops(scamper_task_t *task, tracelb_branch_t *br)
 	  tracelb_paths_sort(state);
 	}
 
+      flowc = slist_count(flowids);
+      if(flowmin == -1 || flowc < flowmin)
+	flowmin = flowc;
+      flowtot += flowc;
+
       tracelb_link_flowids_add_list(tlbl, flowids);
       flowids = NULL;
 
@@ -2041,6 +2203,8 @@ static int tracelb_process_hops(scamper_task_t *task, tracelb_branch_t *br)
 	    {
 	      goto err;
 	    }
+	  if(lite != 0)
+	    newp->lite = 1;
 	}
       else
 	{
@@ -2051,6 +2215,10 @@ static int tracelb_process_hops(scamper_task_t *task, tracelb_branch_t *br)
 	}
     }
 
+  /* each node has to have received at least a third of an even share */
+  if(lite != 0 && flowmin * 3 * br->newnodec >= flowtot)
+    path0->uniform = 1;
+
   tracelb_branch_free(state, br);
   tracelb_paths_assert(state);
   return 0;
@@ -2059,6 +2227,130 @@ static int tracelb_process_hops(scamper_task_t *task, tracelb_branch_t *br)
   return -1;
 }
 
+/*
+ * tracelb_lite_release
+ *
+ * process the links found by the branches held at the divergence.  if
+ * all of its branches finished the hop with flows spread evenly, count
+ * the probes that MDA would have also sent.
+ */
+static void tracelb_lite_release(scamper_task_t *task, tracelb_path_t *div,
+				 int saved)
+{
+  scamper_tracelb_t *trace = tracelb_getdata(task);
+  tracelb_state_t *state = tracelb_getstate(task);
+  tracelb_branch_t *br;
+  int i;
+
+  for(i=0; i<div->heldc; i++)
+    {
+      br = div->held[i];
+      if(saved != 0)
+	trace->probec_saved += k(state, br->n) - (br->k + br->l);
+      tracelb_process_hops(task, br);
+    }
+
+  if(div->held != NULL)
+    {
+      free(div->held);
+      div->held = NULL;
+      div->heldc = 0;
+    }
+
+  return;
+}
+
+/*
+ * tracelb_branch_lite
+ *
+ * the branch has finished probing its hop with -O lite.  record what it
+ * found with the divergence so the other branches can share the probes
+ * for the hop.  a branch that stopped with its share of the probes is
+ * held until every branch of the divergence is done, as a later branch
+ * may find flows are not spread evenly.  returns one if the branch was
+ * held, and zero if the caller should process it.
+ */
+static int tracelb_branch_lite(scamper_task_t *task, tracelb_branch_t *br,
+			       uint8_t mode)
+{
+  scamper_tracelb_t *trace = tracelb_getdata(task);
+  tracelb_state_t *state = tracelb_getstate(task);
+  tracelb_path_t *path = br->path, *div;
+  scamper_addr_t *addr;
+  int i, held = 0, waiting = 0, probec = br->k + br->l;
+
+  path->lite = 2;
+
+  if(path->backc != 1 || path->linkc != 1)
+    return 0;
+  div = path->back[0];
+  div->lite_probec += probec;
+
+  /*
+   * if the branch found more than one node, or something other than a
+   * single reply for each flow, then the rest of the hop is probed with
+   * MDA.
+   */
+  if(div->uniform == 0 || mode != MODE_HOPPROBE || br->newnodec != 1)
+    {
+      tracelb_branch_mda(task, div);
+      return 0;
+    }
+
+  addr = br->newnodes[0]->node->addr;
+  for(i=0; i<div->nextc; i++)
+    if(scamper_addr_cmp(div->nexts[i], addr) == 0)
+      break;
+  if(i == div->nextc)
+    {
+      if(array_insert((void ***)&div->nexts, &div->nextc, addr, NULL) != 0)
+	{
+	  tracelb_branch_mda(task, div);
+	  return 0;
+	}
+      scamper_addr_use(addr);
+    }
+
+  for(i=0; i<div->fwdc; i++)
+    if(div->fwd[i]->lite == 1)
+      waiting++;
+
+  /* hold the branch if it stopped short of what MDA would send */
+  if(probec < k(state, br->n) && scamper_addr_cmp(addr, trace->dst) != 0)
+    {
+      if(array_insert((void ***)&div->held, &div->heldc, br, NULL) != 0)
+	{
+	  tracelb_branch_mda(task, div);
+	  return 0;
+	}
+      held = 1;
+    }
+
+  /* the last branch of the divergence to finish releases the others */
+  if(waiting == 0)
+    tracelb_lite_release(task, div, 1);
+
+  return held;
+}
+
+/*
+ * tracelb_lite_flush
+ *
+ * the trace is over before every branch of a divergence finished its
+ * hop, so process the links the held branches found.
+ */
+static void tracelb_lite_flush(scamper_task_t *task)
+{
+  tracelb_state_t *state = tracelb_getstate(task);
+  int i;
+
+  for(i=0; i<state->pathc; i++)
+    if(state->paths[i]->heldc > 0)
+      tracelb_lite_release(task, state->paths[i], 0);
+
+  return;
+}
+
 static int tracelb_process_clump(scamper_task_t *task, tracelb_branch_t *br)
 {
   scamper_tracelb_t *trace = tracelb_getdata(task);
@@ -2429,6 +2721,14 @@ static void tracelb_process_probes(scamper_task_t *task, tracelb_branch_t *br)
 	}
     }
 
+  if(br->mode == MODE_HOPPROBE && br->path->lite == 1 &&
+     tracelb_branch_lite(task, br, mode) != 0)
+    {
+      tracelb_paths_dump(state);
+      tracelb_queue(task);
+      return;
+    }
+
   if(mode == MODE_HOPPROBE)
     tracelb_process_hops(task, br);
   else if(mode == MODE_CLUMP)
@@ -2775,8 +3075,7 @@ static void handleicmp_firstaddr(scamper_task_t *task, scamper_icmp_resp_t *ir,
 
   /* record the details of the first hop */
   if((node = scamper_tracelb_node_alloc(from)) == NULL ||
-     tracelb_node_ptr(task, node) != 0 ||
-     scamper_tracelb_node_add(trace, node) != 0)
+     tracelb_node_add(task, node) != 0)
     {
       printerror(__func__, "could not alloc node");
       goto err;
@@ -2827,6 +3126,7 @@ static int hopprobe_handlereply(scamper_task_t *task, tracelb_probe_t *pr,
       scamper_tracelb_reply_free(reply);
       return -1;
     }
+  scamper_task_mem_add(task, TRACELB_REPLY_MEM);
 
   /*
    * if this was not the most recent probe to be sent, or it was not the first
@@ -2863,7 +3163,7 @@ static int hopprobe_handlereply(scamper_task_t *task, tracelb_probe_t *pr,
   if(branch->n >= TRACELB_CONFIDENCE_MAX_N ||
      (scamper_addr_cmp(reply->reply_from, trace->dst) == 0 &&
       branch->newnodec < 2) ||
-     branch->k >= k(state, branch->n))
+     branch->k >= tracelb_branch_k(state, branch))
     {
       tracelb_process_probes(task, branch);
     }
@@ -2936,6 +3236,7 @@ static void handleicmp_perpacket(scamper_task_t *task, scamper_icmp_resp_t *ir,
       scamper_tracelb_reply_free(reply);
       goto err;
     }
+  scamper_task_mem_add(task, TRACELB_REPLY_MEM);
 
   if(pr->probe->rxc == 1)
     branch->k++;
@@ -3001,6 +3302,7 @@ static void handleicmp_bringfwd(scamper_task_t *task, scamper_icmp_resp_t *ir,
       scamper_tracelb_reply_free(reply);
       goto err;
     }
+  scamper_task_mem_add(task, TRACELB_REPLY_MEM);
 
   /*
    * check that the reply is for the current flowid/ttl combination, and
@@ -3314,8 +3616,7 @@ static void handletimeout_firstaddr(scamper_task_t *task, tracelb_branch_t *br)
   heap_delete(state->active, br->heapnode);
 
   if((node = scamper_tracelb_node_alloc(NULL)) == NULL ||
-     tracelb_node_ptr(task, node) != 0 ||
-     scamper_tracelb_node_add(trace, node) != 0)
+     tracelb_node_add(task, node) != 0)
     {
       printerror(__func__, "could not alloc node");
       goto err;
@@ -3373,7 +3674,7 @@ static void handletimeout_hopprobe(scamper_task_t *task, tracelb_branch_t *br)
    * stop probing the link when the number of replies and the number of
    * lost probes reach the required confidence level
    */
-  if((br->k + br->l) >= k(state, br->n))
+  if((br->k + br->l) >= tracelb_branch_k(state, br))
     {
       tracelb_process_probes(task, br);
     }
@@ -3495,13 +3796,12 @@ static void do_tracelb_handle_timeout(scamper_task_t *task)
 static void handletcp_firstaddr(scamper_task_t *task, scamper_dl_rec_t *dl,
 				tracelb_probe_t *pr, scamper_addr_t *from)
 {
-  scamper_tracelb_t *trace = tracelb_getdata(task);
   tracelb_state_t *state = tracelb_getstate(task);
   scamper_tracelb_node_t *node = NULL;
   tracelb_branch_t *br = pr->branch;
 
-  assert(pr->probe->ttl == trace->firsthop);
-  assert(trace->nodes == NULL);
+  assert(pr->probe->ttl == tracelb_getdata(task)->firsthop);
+  assert(tracelb_getdata(task)->nodes == NULL);
 
   /* don't need the branch any more */
   if(br->heapnode != NULL)
@@ -3510,8 +3810,7 @@ static void handletcp_firstaddr(scamper_task_t *task, scamper_dl_rec_t *dl,
 
   /* record the details of the first hop */
   if((node = scamper_tracelb_node_alloc(from)) == NULL ||
-     tracelb_node_ptr(task, node) != 0 ||
-     scamper_tracelb_node_add(trace, node) != 0)
+     tracelb_node_add(task, node) != 0)
     {
       printerror(__func__, "could not alloc node");
       goto err;
@@ -3778,7 +4077,7 @@ static void tracelb_state_free(scamper_tracelb_t *trace,tracelb_state_t *state)
   tracelb_branch_t *br;
   tracelb_probe_t *pr;
   tracelb_host_t *th;
-  int i;
+  int i, j;
 
   tracelb_paths_dump(state);
   tracelb_links_dump(state);
@@ -3834,7 +4133,11 @@ static void tracelb_state_free(scamper_tracelb_t *trace,tracelb_state_t *state)
   if(state->paths != NULL)
     {
       for(i=0; i<state->pathc; i++)
-	tracelb_path_free(state->paths[i]);
+	{
+	  for(j=0; j<state->paths[i]->heldc; j++)
+	    tracelb_branch_free(state, state->paths[i]->held[j]);
+	  tracelb_path_free(state->paths[i]);
+	}
       free(state->paths);
     }
 
@@ -3925,6 +4228,8 @@ static int tracelb_state_alloc(scamper_task_t *task)
       printerror(__func__, "could not malloc state");
       goto err;
     }
+  state->task = task;
+  scamper_task_mem_add(task, sizeof(tracelb_state_t));
 
   switch(trace->confidence)
     {
@@ -4386,7 +4691,7 @@ static int tracelb_arg_param_validate(int optid, char *param, long long *out)
       break;
 
     case TRACE_OPT_OPTION:
-      if(strcasecmp(param, "ptr") != 0)
+      if(strcasecmp(param, "ptr") != 0 && strcasecmp(param, "lite") != 0)
 	goto err;
       break;
 
@@ -4543,6 +4848,8 @@ void *scamper_do_tracelb_alloc(char *str)
 	case TRACE_OPT_OPTION:
 	  if(strcasecmp(opt->str, "ptr") == 0)
 	    flags |= SCAMPER_TRACELB_FLAG_PTR;
+	  else if(strcasecmp(opt->str, "lite") == 0)
+	    flags |= SCAMPER_TRACELB_FLAG_LITE;
 	  else
 	    {
 	      scamper_debug(__func__, "unknown option %s", opt->str);
@@ -4726,6 +5033,7 @@ int scamper_do_tracelb_init(void)
   funcs.handle_timeout = do_tracelb_handle_timeout;
   funcs.write          = do_tracelb_write;
   funcs.task_free      = do_tracelb_free;
+  funcs.name           = "tracelb";
   funcs.halt           = do_tracelb_halt;
 
   return 0;
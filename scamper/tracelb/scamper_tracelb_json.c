@@ -79,6 +79,9 @@ static char *header_tostr(const scamper_tracelb_t *trace)
   string_concat(buf, sizeof(buf), &off,
 		", \"probec\":%u, \"probec_max\":%u",
 		trace->probec, trace->probec_max);
+  if(trace->flags & SCAMPER_TRACELB_FLAG_LITE)
+    string_concat(buf, sizeof(buf), &off, ", \"probec_saved\":%u",
+		  trace->probec_saved);
   string_concat(buf, sizeof(buf), &off,
 		", \"nodec\":%u, \"linkc\":%u",
 		trace->nodec, trace->linkc);
@@ -65,6 +65,7 @@
 #define WARTS_TRACELB_USERID       23       /* user id */
 #define WARTS_TRACELB_FLAGS        24       /* flags */
 #define WARTS_TRACELB_ADDR_RTR     25       /* rtr address */
+#define WARTS_TRACELB_PROBEC_SAVED 26       /* probes saved by -O lite */
 
 static const warts_var_t tracelb_vars[] =
 {
@@ -93,6 +94,7 @@ static const warts_var_t tracelb_vars[] =
   {WARTS_TRACELB_USERID,       4, -1},
   {WARTS_TRACELB_FLAGS,        1, -1},
   {WARTS_TRACELB_ADDR_RTR,    -1, -1},
+  {WARTS_TRACELB_PROBEC_SAVED, 4, -1},
 };
 #define tracelb_vars_mfb WARTS_VAR_MFB(tracelb_vars)
 
@@ -243,7 +245,8 @@ static void warts_tracelb_params(const scamper_tracelb_t *trace,
 	 var->id == WARTS_TRACELB_ADDR_DST_GID ||
 	 (var->id == WARTS_TRACELB_USERID && trace->userid == 0) ||
 	 (var->id == WARTS_TRACELB_FLAGS && trace->flags == 0) ||
-	 (var->id == WARTS_TRACELB_ADDR_RTR && trace->rtr == NULL))
+	 (var->id == WARTS_TRACELB_ADDR_RTR && trace->rtr == NULL) ||
+	 (var->id == WARTS_TRACELB_PROBEC_SAVED && trace->probec_saved == 0))
 	{
 	  continue;
 	}
@@ -305,6 +308,7 @@ static int warts_tracelb_params_read(scamper_tracelb_t *trace,
     {&trace->userid,       (wpr_t)extract_uint32,    NULL},
     {&trace->flags,        (wpr_t)extract_byte,      NULL},
     {&trace->rtr,          (wpr_t)extract_addr_static, NULL},
+    {&trace->probec_saved, (wpr_t)extract_uint32,    NULL},
   };
   const int handler_cnt = sizeof(handlers)/sizeof(warts_param_reader_t);
   int rc;
@@ -352,6 +356,7 @@ static int warts_tracelb_params_write(const scamper_tracelb_t *trace,
     {&trace->userid,       (wpw_t)insert_uint32,  NULL},
     {&trace->flags,        (wpw_t)insert_byte,    NULL},
     {trace->rtr,           (wpw_t)insert_addr_static, NULL},
+    {&trace->probec_saved, (wpw_t)insert_uint32,  NULL},
   };
   const int handler_cnt = sizeof(handlers)/sizeof(warts_param_writer_t);
 
@@ -1112,9 +1117,6 @@ int scamper_file_warts_tracelb_read(scamper_file_t *sf, const warts_hdr_t *hdr,
 	}
     }
 
-  /* don't need the buf any more */
-  free(buf); buf = NULL;
-
   /*
    * add the links to their respective nodes.
    */
@@ -1162,7 +1164,6 @@ int scamper_file_warts_tracelb_read(scamper_file_t *sf, const warts_hdr_t *hdr,
 
  err:
   if(table != NULL) warts_addrtable_free(table);
-  if(buf != NULL) free(buf);
   if(nlc != NULL) free(nlc);
   if(trace != NULL) scamper_tracelb_free(trace);
   return -1;
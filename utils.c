@@ -878,6 +878,21 @@ void timeval_cpy(struct timeval *dst, const struct timeval *src)
   return;
 }
 
+/*
+ * timeval_cpy_ts
+ *
+ * copy a timespec, such as one supplied in a SCM_TIMESTAMPNS control
+ * message, into a timeval.  the source may not be aligned.
+ */
+void timeval_cpy_ts(struct timeval *dst, const struct timespec *src)
+{
+  struct timespec ts;
+  memcpy(&ts, src, sizeof(ts));
+  dst->tv_sec  = ts.tv_sec;
+  dst->tv_usec = ts.tv_nsec / 1000;
+  return;
+}
+
 int timeval_inrange_us(const struct timeval *a, const struct timeval *b, int c)
 {
   struct timeval tv;
@@ -2252,6 +2267,148 @@ int uuencode(const uint8_t *in, size_t ilen, uint8_t **out, size_t *olen)
   return 0;
 }
 
+/*
+ * attach_reader
+ *
+ * state for splitting the replies of a scamper process in attach mode
+ * into lines and the bytes of each DATA block.
+ *
+ * line:      a partial line held until the rest of it arrives
+ * data_left: the number of bytes of the current DATA block not yet read
+ * binary:    DATA blocks are raw bytes, rather than uuencoded lines
+ */
+struct attach_reader
+{
+  attach_line_t  linef;
+  attach_data_t  dataf;
+  void          *param;
+  char          *line;
+  size_t         line_len;
+  size_t         data_left;
+  int            binary;
+};
+
+attach_reader_t *attach_reader_alloc(attach_line_t linef, attach_data_t dataf,
+				     void *param)
+{
+  attach_reader_t *ar;
+  if((ar = malloc_zero(sizeof(attach_reader_t))) == NULL)
+    return NULL;
+  ar->linef = linef;
+  ar->dataf = dataf;
+  ar->param = param;
+  return ar;
+}
+
+void attach_reader_binary(attach_reader_t *ar, int binary)
+{
+  ar->binary = binary;
+  return;
+}
+
+void attach_reader_free(attach_reader_t *ar)
+{
+  if(ar->line != NULL) free(ar->line);
+  free(ar);
+  return;
+}
+
+/*
+ * attach_reader_line
+ *
+ * handle a single complete line, which is either part of a uuencoded
+ * DATA block, the header of a DATA block, or a reply to pass on.
+ */
+static int attach_reader_line(attach_reader_t *ar, char *line, size_t len)
+{
+  uint8_t uu[64];
+  size_t uus;
+  long l;
+
+  /* the data includes the newline, which is not in the line */
+  if(ar->data_left > 0)
+    {
+      uus = sizeof(uu);
+      if(uudecode_line(line, len, uu, &uus) != 0)
+	return -1;
+      if(uus != 0 && ar->dataf(ar->param, uu, uus) != 0)
+	return -1;
+      if(ar->data_left > len + 1)
+	ar->data_left -= len + 1;
+      else
+	ar->data_left = 0;
+      return 0;
+    }
+
+  if(len > 5 && strncasecmp(line, "DATA ", 5) == 0)
+    {
+      if(string_isnumber(line+5) == 0 || string_tolong(line+5, &l) != 0 ||
+	 l < 0)
+	return -1;
+      ar->data_left = (size_t)l;
+      return 0;
+    }
+
+  return ar->linef(ar->param, line, len);
+}
+
+/*
+ * attach_reader_handle
+ *
+ * process bytes read from the scamper process.  the bytes of a binary
+ * DATA block are passed on as they arrive; lines are passed on when
+ * they are complete, with empty lines and \r of \r\n dropped.
+ */
+int attach_reader_handle(attach_reader_t *ar, const uint8_t *buf, size_t len)
+{
+  const uint8_t *nl;
+  size_t off = 0, x, ll;
+  char *line;
+
+  while(off < len)
+    {
+      if(ar->binary != 0 && ar->data_left > 0)
+	{
+	  x = len - off;
+	  if(x > ar->data_left)
+	    x = ar->data_left;
+	  if(ar->dataf(ar->param, buf + off, x) != 0)
+	    return -1;
+	  ar->data_left -= x;
+	  off += x;
+	  continue;
+	}
+
+      /* hold a partial line until the rest of it arrives */
+      if((nl = memchr(buf + off, '\n', len - off)) == NULL)
+	{
+	  x = len - off;
+	  if(realloc_wrap((void **)&ar->line, ar->line_len + x + 1) != 0)
+	    return -1;
+	  memcpy(ar->line + ar->line_len, buf + off, x);
+	  ar->line_len += x;
+	  return 0;
+	}
+
+      x = nl - (buf + off);
+      if(realloc_wrap((void **)&ar->line, ar->line_len + x + 1) != 0)
+	return -1;
+      memcpy(ar->line + ar->line_len, buf + off, x);
+      ll = ar->line_len + x;
+      ar->line_len = 0;
+      off += x + 1;
+
+      line = ar->line;
+      if(ll > 0 && line[ll-1] == '\r')
+	ll--;
+      line[ll] = '\0';
+      if(ll > 0 && attach_reader_line(ar, line, ll) != 0)
+	return -1;
+    }
+
+  return 0;
+}
+
 uint16_t byteswap16(const uint16_t word)
 {
   return ((word >> 8) | (word << 8));
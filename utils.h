@@ -47,6 +47,7 @@ void timeval_add_tv3(struct timeval *out, const struct timeval *a,
 void timeval_add_s(struct timeval *out, const struct timeval *in, int s);
 void timeval_sub_us(struct timeval *out, const struct timeval *in, int us);
 void timeval_cpy(struct timeval *dst, const struct timeval *src);
+void timeval_cpy_ts(struct timeval *dst, const struct timespec *src);
 int timeval_inrange_us(const struct timeval *a,const struct timeval *b,int c);
 char *timeval_tostr_us(const struct timeval *rtt, char *str, size_t len);
 
@@ -227,6 +228,21 @@ size_t uuencode_bytes(const uint8_t *in, size_t len, size_t *off,
 void *uudecode(const char *in, size_t len);
 int uudecode_line(const char *in, size_t ilen, uint8_t *out, size_t *olen);
 
+/*
+ * Functions for reading the replies of a scamper process in attach mode.
+ * The bytes of each DATA block are passed to the data callback, whether
+ * scamper sent them uuencoded or raw (attach encoding binary); all other
+ * replies are passed to the line callback.
+ */
+typedef struct attach_reader attach_reader_t;
+typedef int (*attach_line_t)(void *param, char *line, size_t len);
+typedef int (*attach_data_t)(void *param, const uint8_t *data, size_t len);
+attach_reader_t *attach_reader_alloc(attach_line_t linef, attach_data_t dataf,
+				     void *param);
+void attach_reader_binary(attach_reader_t *ar, int binary);
+int attach_reader_handle(attach_reader_t *ar, const uint8_t *buf, size_t len);
+void attach_reader_free(attach_reader_t *ar);
+
 /* swap bytes in a 16 bit word */
 uint16_t byteswap16(const uint16_t word);
 uint32_t byteswap32(const uint32_t word);
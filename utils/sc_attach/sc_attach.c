@@ -51,6 +51,10 @@
 #define FLAG_RANDOM     0x0001
 #define FLAG_IMPATIENT  0x0002
 
+#define ATTACH_STATE_DONE   0 /* attached, or not attaching */
+#define ATTACH_STATE_BINARY 1 /* waiting for reply to attach encoding binary */
+#define ATTACH_STATE_UU     2 /* waiting for reply to attach */
+
 static uint32_t               options       = 0;
 static uint8_t                flags         = 0;
 static char                  *infile_name   = NULL;
@@ -60,14 +64,14 @@ static char                  *unix_name     = NULL;
 static uint32_t               priority      = 1;
 static int                    scamper_fd    = -1;
 static scamper_writebuf_t    *scamper_wb    = NULL;
-static scamper_linepoll_t    *scamper_lp    = NULL;
+static attach_reader_t       *scamper_ar    = NULL;
 static int                    stdin_fd      = -1;
 static scamper_linepoll_t    *stdin_lp      = NULL;
 static int                    stdout_fd     = -1;
 static scamper_writebuf_t    *stdout_wb     = NULL;
 static char                  *outfile_name  = NULL;
 static int                    outfile_fd    = -1;
-static int                    data_left     = 0;
+static int                    attach_state  = ATTACH_STATE_DONE;
 static int                    more          = 0;
 static int                    error         = 0;
 static slist_t               *commands      = NULL;
@@ -106,10 +110,10 @@ static void cleanup(void)
       scamper_wb = NULL;
     }
 
-  if(scamper_lp != NULL)
+  if(scamper_ar != NULL)
     {
-      scamper_linepoll_free(scamper_lp, 0);
-      scamper_lp = NULL;
+      attach_reader_free(scamper_ar);
+      scamper_ar = NULL;
     }
 
   if(stdin_lp != NULL)
@@ -428,38 +432,60 @@ static int do_stdinread(void)
   return -1;
 }
 
-static int do_scamperread_line(void *param, uint8_t *buf, size_t linelen)
+/*
+ * do_attach
+ *
+ * ask scamper to attach this connection, with warts sent as raw bytes
+ * unless scamper has already said it cannot do that.
+ */
+static int do_attach(int state)
 {
-  char *head = (char *)buf;
-  uint8_t uu[64];
-  size_t uus;
-  long l;
-
-  /* skip empty lines */
-  if(head[0] == '\0')
-    return 0;
+  char buf[256];
+  size_t off = 0;
 
-  /* if currently decoding data, then pass it to uudecode */
-  if(data_left > 0)
+  string_concat(buf, sizeof(buf), &off, "attach");
+  if(state == ATTACH_STATE_BINARY)
+    string_concat(buf, sizeof(buf), &off, " encoding binary");
+  if((options & OPT_PRIORITY) != 0)
+    string_concat(buf, sizeof(buf), &off, " priority %d", priority);
+  string_concat(buf, sizeof(buf), &off, "\n");
+  if(scamper_writebuf_send(scamper_wb, buf, off) != 0)
     {
-      uus = sizeof(uu);
-      if(uudecode_line(head, linelen, uu, &uus) != 0)
-	{
-	  fprintf(stderr, "could not uudecode_line\n");
-	  error = 1;
-	  return -1;
-	}
+      fprintf(stderr, "%s: could not attach to scamper process: %s\n",
+	      __func__, strerror(errno));
+      return -1;
+    }
+
+  attach_state = state;
+  return 0;
+}
+
+static int do_scamperread_data(void *param, const uint8_t *data, size_t len)
+{
+  if(outfile_fd != -1)
+    write_wrap(outfile_fd, data, NULL, len);
+  if(stdout_fd != -1)
+    scamper_writebuf_send(stdout_wb, data, len);
+  return 0;
+}
 
-      if(uus != 0)
+static int do_scamperread_line(void *param, char *head, size_t linelen)
+{
+  /* the reply to the attach command */
+  if(attach_state != ATTACH_STATE_DONE)
+    {
+      if(linelen >= 2 && strncasecmp(head, "OK", 2) == 0)
 	{
-	  if(outfile_fd != -1)
-	    write_wrap(outfile_fd, uu, NULL, uus);
-	  if(stdout_fd != -1)
-	    scamper_writebuf_send(stdout_wb, uu, uus);
+	  if(attach_state == ATTACH_STATE_BINARY)
+	    attach_reader_binary(scamper_ar, 1);
+	  attach_state = ATTACH_STATE_DONE;
+	  return 0;
 	}
 
-      data_left -= (linelen + 1);
-      return 0;
+      /* an older scamper cannot send raw warts, so take it uuencoded */
+      if(linelen >= 3 && strncasecmp(head, "ERR", 3) == 0 &&
+	 attach_state == ATTACH_STATE_BINARY)
+	return do_attach(ATTACH_STATE_UU);
     }
 
   /* feedback letting us know that the command was accepted */
@@ -475,19 +501,6 @@ static int do_scamperread_line(void *param, uint8_t *buf, size_t linelen)
       return 0;
     }
 
-  /* new piece of data */
-  if(linelen > 5 && strncasecmp(head, "DATA ", 5) == 0)
-    {
-      if(string_isnumber(head+5) == 0 || string_tolong(head+5, &l) != 0)
-	{
-	  fprintf(stderr, "could not parse %s\n", head);
-	  error = 1;
-	  return -1;
-	}
-      data_left = l;
-      return 0;
-    }
-
   /* feedback letting us know that the command was not accepted */
   if(linelen >= 3 && strncasecmp(head, "ERR", 3) == 0)
     {
@@ -514,7 +527,13 @@ static int do_scamperread(void)
 
   if((rc = read(scamper_fd, buf, sizeof(buf))) > 0)
     {
-      scamper_linepoll_handle(scamper_lp, buf, rc);
+      if(attach_reader_handle(scamper_ar, buf, rc) != 0)
+	{
+	  fprintf(stderr, "%s: could not process data from scamper\n",
+		  __func__);
+	  error = 1;
+	  return -1;
+	}
       return 0;
     }
   else if(rc == 0)
@@ -559,8 +578,6 @@ static int do_scamperconnect(void)
   struct sockaddr_storage sas;
   struct sockaddr *sa = (struct sockaddr *)&sas;
   struct in_addr in;
-  char buf[256];
-  size_t off = 0;
 
   if(options & OPT_PORT)
     {
@@ -621,7 +638,8 @@ static int do_scamperconnect(void)
       return -1;
     }
 
-  if((scamper_lp = scamper_linepoll_alloc(do_scamperread_line,NULL)) == NULL ||
+  if((scamper_ar = attach_reader_alloc(do_scamperread_line,
+					do_scamperread_data, NULL)) == NULL ||
      (scamper_wb = scamper_writebuf_alloc()) == NULL)
     {
       fprintf(stderr, "%s: could not alloc wb/lp: %s\n",
@@ -629,19 +647,9 @@ static int do_scamperconnect(void)
       return -1;
     }
 
-  if(options & (OPT_PORT|OPT_UNIX))
-    {
-      string_concat(buf, sizeof(buf), &off, "attach");
-      if((options & OPT_PRIORITY) != 0)
-	string_concat(buf, sizeof(buf), &off, " priority %d", priority);
-      string_concat(buf, sizeof(buf), &off, "\n");
-      if(scamper_writebuf_send(scamper_wb, buf, off) != 0)
-	{
-	  fprintf(stderr, "%s: could not attach to scamper process: %s\n",
-		  __func__, strerror(errno));
-	  return -1;
-	}
-    }
+  if((options & (OPT_PORT|OPT_UNIX)) != 0 &&
+     do_attach(ATTACH_STATE_BINARY) != 0)
+    return -1;
 
   return 0;
 }
@@ -40,21 +40,13 @@
 #include "scamper_list.h"
 #include "ping/scamper_ping.h"
 #include "dealias/scamper_dealias.h"
+#include "dealias/scamper_dealias_ipidseq.h"
 #include "scamper_file.h"
 #include "mjl_list.h"
 #include "mjl_heap.h"
 #include "mjl_splaytree.h"
 #include "utils.h"
 
-typedef struct sc_ipid
-{
-  scamper_dealias_probedef_t *def;
-  uint32_t                    seq;
-  struct timeval              tx;
-  struct timeval              rx;
-  uint32_t                    ipid;
-} sc_ipid_t;
-
 /*
  * sc_addrset
  *
@@ -1621,49 +1613,26 @@ static int do_scamperconnect(void)
   return -1;
 }
 
-static int sc_ipid_tx_cmp(const void *va, const void *vb)
-{
-  const sc_ipid_t *a = va;
-  const sc_ipid_t *b = vb;
-  return timeval_cmp(&a->tx, &b->tx);
-}
-
-static int inseq(scamper_dealias_radargun_t *rg,
-		 sc_ipid_t *pts, int ptc, uint32_t limit)
-{
-  int i;
-
-  for(i=0; i<ptc-1; i++)
-    {
-      if(pts[i+1].seq > limit)
-	break;
-
-      /* adjacent samples are for the same probedef. */
-      if(pts[i].def == pts[i+1].def)
-	continue;
-
-      /* in sequence */
-      if(pts[i].ipid < pts[i+1].ipid)
-	continue;
-
-      /* not in sequence, but within a fudge factor and overlapping in time */
-      if((fudge == 0 || pts[i].ipid < pts[i+1].ipid + fudge) &&
-	 timeval_cmp(&pts[i+1].tx, &pts[i].rx) <= 0)
-	continue;
-
-      return 0;
-    }
-
-  return 1;
-}
-
-static int points_add(scamper_dealias_t *dealias, sc_ipid_t *points,
-		      uint32_t *p, scamper_dealias_probedef_t *def)
+/*
+ * ipidseq_get
+ *
+ * collect the IPID values that the probedef's target replied with, in
+ * the order they were sent.  we need at least 25% of replies to make a
+ * reasonable comparison, so return NULL in *out if there are fewer.
+ */
+static int ipidseq_get(scamper_dealias_t *dealias,
+		       scamper_dealias_probedef_t *def,
+		       scamper_dealias_ipidseq_t **out)
 {
   scamper_dealias_radargun_t *rg = dealias->data;
+  scamper_dealias_ipidseq_t *seq;
   scamper_dealias_probe_t *probe;
   scamper_dealias_reply_t *reply;
-  uint32_t k, f=0, i=0;
+  uint32_t k;
+
+  *out = NULL;
+  if((seq = scamper_dealias_ipidseq_alloc(rg->attempts)) == NULL)
+    return -1;
 
   for(k=0; k<rg->attempts; k++)
     {
@@ -1673,53 +1642,22 @@ static int points_add(scamper_dealias_t *dealias, sc_ipid_t *points,
       reply = probe->replies[0];
       if(SCAMPER_DEALIAS_REPLY_FROM_TARGET(probe, reply) == 0)
 	continue;
-
-      points[*p+i].def  = def;
-      points[*p+i].seq  = probe->seq;
-      points[*p+i].ipid = f + reply->ipid;
-      timeval_cpy(&points[*p+i].tx, &probe->tx);
-      timeval_cpy(&points[*p+i].rx, &reply->rx);
-
-      if(i > 0 && points[*p+i].ipid < points[*p+i-1].ipid)
+      if(scamper_dealias_ipidseq_add(seq, reply->ipid, 0xFFFF,
+				     &probe->tx, &reply->rx) != 0)
 	{
-	  points[*p+i].ipid += 0x10000;
-	  f += 0x10000;
+	  scamper_dealias_ipidseq_free(seq);
+	  return -1;
 	}
-
-      i++;
     }
 
-  /* need at least 25% of replies to make a reasonable comparison */
-  if(i * 4 < rg->attempts)
-    return 0;
-
-  *p += i;
-  return i;
-}
-
-static void initialwrap(sc_ipid_t *pts, int ptc)
-{
-  scamper_dealias_probedef_t *def;
-  int i;
-
-  for(i=0; i<ptc-1; i++)
-    if(pts[i].def != pts[i+1].def)
-      break;
-
-  if(i == ptc-1 || pts[i].ipid <= pts[i+1].ipid)
-    return;
-
-  i++;
-  def = pts[i].def;
-
-  while(i < ptc)
+  if(seq->len * 4 < rg->attempts)
     {
-      if(pts[i].def == def)
-	pts[i].ipid += 0x10000;
-      i++;
+      scamper_dealias_ipidseq_free(seq);
+      return 0;
     }
 
-  return;
+  *out = seq;
+  return 0;
 }
 
 static int sc_addr2set_cmp(const sc_addr2set_t *a, const sc_addr2set_t *b)
@@ -1796,43 +1734,47 @@ static int sc_addrset_cmp(const sc_addrset_t *a, const sc_addrset_t *b)
 static int process_dealias_1(scamper_dealias_t *dealias)
 {
   scamper_dealias_radargun_t *rg;
-  sc_ipid_t *points = NULL;
+  scamper_dealias_ipidseq_t **seqs = NULL;
   splaytree_t *tree = NULL;
   dlist_t *list = NULL;
   dlist_node_t *dn;
   slist_node_t *sn;
   sc_addrset_t *addrset;
   sc_addr2set_t *a2s_a, *a2s_b, *a2s;
-  uint32_t i, j, p;
+  uint32_t i, j;
   char a[32], b[32];
 
   if(!SCAMPER_DEALIAS_METHOD_IS_RADARGUN(dealias))
     return 0;
   rg = dealias->data;
 
-  if((points = malloc(sizeof(sc_ipid_t) * rg->attempts * 2)) == NULL)
+  /*
+   * build the series for each probedef once, rather than for each pair
+   * of probedefs it is compared with.
+   */
+  if((seqs = malloc_zero(sizeof(scamper_dealias_ipidseq_t *) *
+			 rg->probedefc)) == NULL)
     goto err;
+  scamper_dealias_probes_sort_def(dealias);
+  for(i=0; i<rg->probedefc; i++)
+    if(ipidseq_get(dealias, &rg->probedefs[i], &seqs[i]) != 0)
+      goto err;
 
   if((flags & FLAG_TC) != 0 &&
      ((list = dlist_alloc()) == NULL ||
       (tree = splaytree_alloc((splaytree_cmp_t)sc_addr2set_cmp)) == NULL))
     goto err;
 
-  scamper_dealias_probes_sort_def(dealias);
   for(i=0; i<rg->probedefc; i++)
     {
+      if(seqs[i] == NULL)
+	continue;
       for(j=i+1; j<rg->probedefc; j++)
 	{
-	  p = 0;
-	  if(points_add(dealias, points, &p, &rg->probedefs[i]) == 0)
-	    break;
-	  if(points_add(dealias, points, &p, &rg->probedefs[j]) == 0)
+	  if(seqs[j] == NULL)
 	    continue;
-	  qsort(points, p, sizeof(sc_ipid_t), sc_ipid_tx_cmp);
-
-	  initialwrap(points, p);
-
-	  if(inseq(rg, points, p, rg->attempts) != 0)
+	  if(scamper_dealias_ipidseq_mbt(seqs[i], seqs[j],
+					 0x10000, fudge) != 0)
 	    {
 	      if((flags & FLAG_TC) == 0)
 		{
@@ -1909,14 +1851,21 @@ static int process_dealias_1(scamper_dealias_t *dealias)
 
   if(tree != NULL)
     splaytree_free(tree, NULL);
-  free(points);
+  for(i=0; i<rg->probedefc; i++)
+    scamper_dealias_ipidseq_free(seqs[i]);
+  free(seqs);
 
   return 0;
 
  err:
   if(tree != NULL) splaytree_free(tree, NULL);
   if(list != NULL) dlist_free_cb(list, (dlist_free_t)sc_addrset_free);
-  if(points != NULL) free(points);
+  if(seqs != NULL)
+    {
+      for(i=0; i<rg->probedefc; i++)
+	scamper_dealias_ipidseq_free(seqs[i]);
+      free(seqs);
+    }
   return -1;
 }
 
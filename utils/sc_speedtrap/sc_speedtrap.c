@@ -37,6 +37,7 @@
 #include "scamper_list.h"
 #include "ping/scamper_ping.h"
 #include "dealias/scamper_dealias.h"
+#include "dealias/scamper_dealias_ipidseq.h"
 #include "scamper_linepoll.h"
 #include "scamper_writebuf.h"
 #include "scamper_file.h"
@@ -552,30 +553,16 @@ static int uint32_find(uint32_t *a, size_t len, uint32_t u32)
   return 0;
 }
 
-static int ipid_inseq3(uint64_t a, uint64_t b, uint64_t c)
+static int ipid_inseq3(uint32_t a, uint32_t b, uint32_t c)
 {
-  if(a == b || b == c || a == c)
-    return 0;
-  if(a > b)
-    b += 0x100000000ULL;
-  if(a > c)
-    c += 0x100000000ULL;
-  if(a > b || b > c)
-    return 0;
-  if(fudge != 0 && (b - a > fudge || c - b > fudge))
-    return 0;
-  return 1;
+  return scamper_dealias_ipidseq_inseq3(a, b, c, 0xFFFFFFFF, fudge);
 }
 
 static int ipid_incr(uint32_t *ipids, int ipidc)
 {
-  int i;
   if(ipidc < 3)
     return 0;
-  for(i=2; i<ipidc; i++)
-    if(ipid_inseq3(ipids[i-2], ipids[i-1], ipids[i]) == 0)
-      return 0;
-  return 1;
+  return scamper_dealias_ipidseq_inseq(ipids, ipidc, 0xFFFFFFFF, fudge);
 }
 
 static int sc_addr2router_human_cmp(sc_addr2router_t *a, sc_addr2router_t *b)
@@ -32,6 +32,7 @@
 #include "scamper_addr.h"
 #include "scamper_list.h"
 #include "ping/scamper_ping.h"
+#include "dealias/scamper_dealias_ipidseq.h"
 #include "scamper_file.h"
 #include "scamper_writebuf.h"
 #include "scamper_linepoll.h"
@@ -620,38 +621,10 @@ static int do_method(void)
   return 0;
 }
 
-static int ipid_inseq2(uint64_t a, uint64_t b)
+static int ipid_inseq2(uint32_t a, uint32_t b)
 {
   assert(fudge > 0);
-  if(a == b)
-    return 0;
-  if(a > b)
-    b += 0x100000000ULL;
-  if(b - a > fudge)
-    return 0;
-  return 1;
-}
-
-static int ipid_inseq3(uint64_t a, uint64_t b, uint64_t c)
-{
-  if(a == b || b == c || a == c)
-    return 0;
-  if(a > b)
-    b += 0x100000000ULL;
-  if(a > c)
-    c += 0x100000000ULL;
-
-  if(fudge != 0)
-    {
-      if(b - a > fudge || c - b > fudge)
-	return 0;
-    }
-  else
-    {
-      if(a > b || b > c)
-	return 0;
-    }
-  return 1;
+  return scamper_dealias_ipidseq_inseq2(a, b, 0xFFFFFFFF, fudge);
 }
 
 static int ipid_incr(sc_sample_t *ipids, int ipidc)
@@ -660,7 +633,8 @@ static int ipid_incr(sc_sample_t *ipids, int ipidc)
   if(ipidc < 3)
     return 0;
   for(i=2; i<ipidc; i++)
-    if(ipid_inseq3(ipids[i-2].ipid, ipids[i-1].ipid, ipids[i].ipid) == 0)
+    if(scamper_dealias_ipidseq_inseq3(ipids[i-2].ipid, ipids[i-1].ipid,
+				      ipids[i].ipid, 0xFFFFFFFF, fudge) == 0)
       return 0;
   return 1;
 }
@@ -48,7 +48,7 @@
 
 static void usage()
 {
-  fprintf(stderr, "usage: sc_wartsdump <file>\n");
+  fprintf(stderr, "usage: sc_wartsdump [-a dst] <file>\n");
   return;
 }
 
@@ -334,6 +334,8 @@ static void dump_trace(scamper_trace_t *trace)
       if(trace->dtree->gss_stop != NULL)
 	printf(", gss-stop: %s",
 	       scamper_addr_tostr(trace->dtree->gss_stop, buf, sizeof(buf)));
+      if(trace->dtree->flags & SCAMPER_TRACE_DTREE_FLAG_SHARED)
+	printf(", shared-gss-ver: %u", trace->dtree->gss_ver);
       printf("\n");
     }
 
@@ -378,6 +380,8 @@ static void dump_trace(scamper_trace_t *trace)
 	printf(" rxerr");
       if(trace->flags & SCAMPER_TRACE_FLAG_PTR)
 	printf(" ptr");
+      if(trace->flags & SCAMPER_TRACE_FLAG_ADAPTIVE)
+	printf(" adaptive");
       printf(" )");
     }
   printf("\n");
@@ -563,7 +567,7 @@ static void dump_tracelb_probe(scamper_tracelb_t *trace,
 static void dump_tracelb(scamper_tracelb_t *trace)
 {
   static const char *flags[] = {
-    "ptr"
+    "ptr", "lite"
   };
   scamper_tracelb_link_t *link;
   scamper_tracelb_node_t *node;
@@ -625,11 +629,13 @@ static void dump_tracelb(scamper_tracelb_t *trace)
 	 trace->probe_size, trace->wait_probe * 10, trace->wait_timeout);
   printf(" nodec: %d, linkc: %d, probec: %d, probec_max: %d\n",
 	 trace->nodec, trace->linkc, trace->probec, trace->probec_max);
+  if(trace->flags & SCAMPER_TRACELB_FLAG_LITE)
+    printf(" probec_saved: %d\n", trace->probec_saved);
   if(trace->flags != 0)
     {
       printf(" flags:");
       l = 0;
-      for(i=0; i<1; i++)
+      for(i=0; i<2; i++)
 	{
 	  if((trace->flags & (0x1 << i)) == 0)
 	    continue;
@@ -805,6 +811,7 @@ static void dump_ping(scamper_ping_t *ping)
     "nosrc",
   };
   scamper_ping_reply_t *reply;
+  scamper_ping_train_t *train;
   char buf[256];
   uint32_t u32;
   int i;
@@ -846,6 +853,9 @@ static void dump_ping(scamper_ping_t *ping)
       printf(".%u", u32);
     }
   printf(", ttl: %u\n", ping->probe_ttl);
+  if(ping->train_size != 0)
+    printf(" train-size: %u, train-gap: %uus\n",
+	   ping->train_size, ping->train_gap);
 
   if(ping->flags != 0)
     {
@@ -950,6 +960,18 @@ static void dump_ping(scamper_ping_t *ping)
 	}
     }
 
+  for(i=0; i<ping->trainc; i++)
+    {
+      train = &ping->trains[i];
+      printf(" train %d: probe-id: %u, probes: %u", i, train->probe_id,
+	     train->probec);
+      printf(", gap min/mean/max: %u/%u/%u, jitter: %u",
+	     train->gap_min, train->gap_mean, train->gap_max, train->jitter);
+      if((train->flags & SCAMPER_PING_TRAIN_FLAG_DLTX) != 0)
+	printf(", dltx");
+      printf("\n");
+    }
+
   printf("\n");
 
   scamper_ping_free(ping);
@@ -1016,6 +1038,7 @@ static void dump_dealias(scamper_dealias_t *dealias)
   scamper_dealias_radargun_t *radargun = dealias->data;
   scamper_dealias_ally_t *ally = dealias->data;
   scamper_dealias_bump_t *bump = dealias->data;
+  scamper_dealias_midar_t *midar = dealias->data;
   scamper_dealias_probe_t *probe;
   scamper_dealias_reply_t *reply;
   struct timeval rtt;
@@ -1132,6 +1155,19 @@ static void dump_dealias(scamper_dealias_t *dealias)
       for(i=0; i<ps->probedefc; i++)
 	dump_dealias_probedef(&ps->probedefs[i]);
     }
+  else if(dealias->method == SCAMPER_DEALIAS_METHOD_MIDAR)
+    {
+      printf("midar, wait-probe: %dms, wait-timeout: %ds, attempts: %d\n"
+	     "  window: %d, fudge: %d, probedefc: %d, sets: %d\n",
+	     midar->wait_probe, midar->wait_timeout, midar->attempts,
+	     midar->window, midar->fudge, midar->probedefc, midar->setc);
+      for(i=0; i<midar->probedefc; i++)
+	{
+	  dump_dealias_probedef(&midar->probedefs[i]);
+	  if(midar->sets != NULL && midar->sets[i] != 0)
+	    printf("  set: %d\n", midar->sets[i]);
+	}
+    }
   else
     {
       printf("%d\n", dealias->method);
@@ -2046,6 +2082,97 @@ static void dump_addr(scamper_addr_t *addr)
   return;
 }
 
+static void dump_obj(uint16_t type, void *data)
+{
+  switch(type)
+    {
+    case SCAMPER_FILE_OBJ_ADDR:
+      dump_addr(data);
+      break;
+
+    case SCAMPER_FILE_OBJ_TRACE:
+      dump_trace(data);
+      break;
+
+    case SCAMPER_FILE_OBJ_PING:
+      dump_ping(data);
+      break;
+
+    case SCAMPER_FILE_OBJ_TRACELB:
+      dump_tracelb(data);
+      break;
+
+    case SCAMPER_FILE_OBJ_DEALIAS:
+      dump_dealias(data);
+      break;
+
+    case SCAMPER_FILE_OBJ_NEIGHBOURDISC:
+      dump_neighbourdisc(data);
+      break;
+
+    case SCAMPER_FILE_OBJ_TBIT:
+      dump_tbit(data);
+      break;
+
+    case SCAMPER_FILE_OBJ_STING:
+      dump_sting(data);
+      break;
+
+    case SCAMPER_FILE_OBJ_SNIFF:
+      dump_sniff(data);
+      break;
+
+    case SCAMPER_FILE_OBJ_HOST:
+      dump_host(data);
+      break;
+
+    case SCAMPER_FILE_OBJ_LIST:
+      dump_list(data);
+      break;
+
+    case SCAMPER_FILE_OBJ_CYCLE_START:
+      dump_cycle(data, "start");
+      break;
+
+    case SCAMPER_FILE_OBJ_CYCLE_STOP:
+      dump_cycle(data, "stop");
+      break;
+
+    case SCAMPER_FILE_OBJ_CYCLE_DEF:
+      dump_cycle(data, "def");
+      break;
+    }
+  return;
+}
+
+/*
+ * dump_idx
+ *
+ * use the index of the file to dump only the records for a destination.
+ */
+static int dump_idx(scamper_file_t *file, scamper_file_filter_t *filter,
+		    scamper_addr_t *dst)
+{
+  const scamper_file_idx_t *idx;
+  uint32_t i, c = scamper_file_idx_count(file);
+  uint16_t type;
+  void *data;
+
+  for(i=0; i<c; i++)
+    {
+      idx = scamper_file_idx_get(file, i);
+      if(idx->dst == NULL || scamper_addr_cmp(idx->dst, dst) != 0 ||
+	 scamper_file_filter_isset(filter, idx->type) == 0)
+	continue;
+      if(scamper_file_idx_seek(file, i) != 0 ||
+	 scamper_file_read(file, filter, &type, &data) != 0 || data == NULL)
+	return -1;
+      dump_obj(type, data);
+    }
+
+  return 0;
+}
+
 int main(int argc, char *argv[])
 {
   scamper_file_t        *file;
@@ -2066,9 +2193,10 @@ int main(int argc, char *argv[])
     SCAMPER_FILE_OBJ_HOST,
   };
   uint16_t filter_cnt = sizeof(filter_types)/sizeof(uint16_t);
+  scamper_addr_t *dst = NULL;
   void     *data;
   uint16_t  type;
-  int       f;
+  int       f, ch;
 
 #ifdef _WIN32
   WSADATA wsaData;
@@ -2079,6 +2207,20 @@ int main(int argc, char *argv[])
   free(malloc(1));
 #endif
 
+  while((ch = getopt(argc, argv, "a:")) != -1)
+    {
+      if(ch != 'a' || dst != NULL ||
+	 (dst = scamper_addr_resolve(AF_UNSPEC, optarg)) == NULL)
+	{
+	  usage();
+	  return -1;
+	}
+    }
+
+  /* leave argv[0] in place, so that argv[1] is the first file */
+  argc -= (optind - 1);
+  argv += (optind - 1);
+
   if((filter = scamper_file_filter_alloc(filter_types, filter_cnt)) == NULL)
     {
       usage();
@@ -2093,6 +2235,13 @@ int main(int argc, char *argv[])
 	  if(argc > 1)
 	    continue;
 
+	  /* the index can only be used with a file */
+	  if(dst != NULL)
+	    {
+	      usage();
+	      return -1;
+	    }
+
 	  if((file=scamper_file_openfd(STDIN_FILENO,"-",'r',"warts")) == NULL)
 	    {
 	      usage();
@@ -2102,7 +2251,8 @@ int main(int argc, char *argv[])
 	}
       else
 	{
-	  if((file = scamper_file_open(argv[f], 'r', NULL)) == NULL)
+	  if((file = scamper_file_open(argv[f], dst != NULL ? 'm' : 'r',
+				       NULL)) == NULL)
 	    {
 	      usage();
 	      fprintf(stderr, "could not open %s\n", argv[f]);
@@ -2110,70 +2260,19 @@ int main(int argc, char *argv[])
 	    }
 	}
 
+      if(dst != NULL)
+	{
+	  if(dump_idx(file, filter, dst) != 0)
+	    fprintf(stderr, "could not read %s\n", argv[f]);
+	  goto done;
+	}
+
       while(scamper_file_read(file, filter, &type, &data) == 0)
 	{
 	  /* hit eof */
 	  if(data == NULL)
 	    goto done;
-
-	  switch(type)
-	    {
-	    case SCAMPER_FILE_OBJ_ADDR:
-	      dump_addr(data);
-	      break;
-
-	    case SCAMPER_FILE_OBJ_TRACE:
-	      dump_trace(data);
-	      break;
-
-	    case SCAMPER_FILE_OBJ_PING:
-	      dump_ping(data);
-	      break;
-
-	    case SCAMPER_FILE_OBJ_TRACELB:
-	      dump_tracelb(data);
-	      break;
-
-	    case SCAMPER_FILE_OBJ_DEALIAS:
-	      dump_dealias(data);
-	      break;
-
-	    case SCAMPER_FILE_OBJ_NEIGHBOURDISC:
-	      dump_neighbourdisc(data);
-	      break;
-
-	    case SCAMPER_FILE_OBJ_TBIT:
-	      dump_tbit(data);
-	      break;
-
-	    case SCAMPER_FILE_OBJ_STING:
-	      dump_sting(data);
-	      break;
-
-	    case SCAMPER_FILE_OBJ_SNIFF:
-	      dump_sniff(data);
-	      break;
-
-	    case SCAMPER_FILE_OBJ_HOST:
-	      dump_host(data);
-	      break;
-
-	    case SCAMPER_FILE_OBJ_LIST:
-	      dump_list(data);
-	      break;
-
-	    case SCAMPER_FILE_OBJ_CYCLE_START:
-	      dump_cycle(data, "start");
-	      break;
-
-	    case SCAMPER_FILE_OBJ_CYCLE_STOP:
-	      dump_cycle(data, "stop");
-	      break;
-
-	    case SCAMPER_FILE_OBJ_CYCLE_DEF:
-	      dump_cycle(data, "def");
-	      break;
-	    }
+	  dump_obj(type, data);
 	}
 
     done:
@@ -2184,5 +2283,6 @@ int main(int argc, char *argv[])
     }
 
   scamper_file_filter_free(filter);
+  if(dst != NULL) scamper_addr_free(dst);
   return 0;
 }
@@ -298,7 +298,14 @@ static int check_options(int argc, char *argv[])
     }
   else
     {
-      if((infile = scamper_file_open(opt_infile, 'r', "warts")) == NULL)
+      /*
+       * when filtering by destination, use the file's index to skip
+       * records that do not match without reading them.
+       */
+      if(addrc > 0 && check_hops == 0)
+	infile = scamper_file_open(opt_infile, 'm', "warts");
+      if(infile == NULL &&
+	 (infile = scamper_file_open(opt_infile, 'r', "warts")) == NULL)
 	{
 	  fprintf(stderr, "could not open %s\n", opt_infile);
 	  goto err;
@@ -360,6 +367,7 @@ static void process_dealias(scamper_dealias_t *dealias)
   scamper_dealias_ally_t *ally;
   scamper_dealias_radargun_t *rg;
   scamper_dealias_prefixscan_t *pfs;
+  scamper_dealias_midar_t *midar;
   uint32_t i;
 
   if(addrc > 0)
@@ -395,6 +403,15 @@ static void process_dealias(scamper_dealias_t *dealias)
 	  if(i == pfs->probedefc)
 	    goto done;
 	}
+      else if(SCAMPER_DEALIAS_METHOD_IS_MIDAR(dealias))
+	{
+	  midar = dealias->data;
+	  for(i=0; i<midar->probedefc; i++)
+	    if(addr_matched(midar->probedefs[i].dst) != 0)
+	      break;
+	  if(i == midar->probedefc)
+	    goto done;
+	}
       else goto done;
     }
   scamper_file_write_dealias(outfile, dealias);
@@ -524,6 +541,52 @@ static int process_tracelb(scamper_tracelb_t *tracelb)
   return 0;
 }
 
+static void process(uint16_t type, void *data)
+{
+  if(type == SCAMPER_FILE_OBJ_DEALIAS)
+    process_dealias(data);
+  else if(type == SCAMPER_FILE_OBJ_PING)
+    process_ping(data);
+  else if(type == SCAMPER_FILE_OBJ_TRACE)
+    process_trace(data);
+  else if(type == SCAMPER_FILE_OBJ_TBIT)
+    process_tbit(data);
+  else if(type == SCAMPER_FILE_OBJ_TRACELB)
+    process_tracelb(data);
+  return;
+}
+
+/*
+ * process_idx
+ *
+ * read the records whose destination in the index matches, and the
+ * records that do not have a destination in the index.
+ */
+static int process_idx(void)
+{
+  const scamper_file_idx_t *idx;
+  uint32_t i, c = scamper_file_idx_count(infile);
+  uint16_t type;
+  void *data;
+
+  for(i=0; i<c; i++)
+    {
+      idx = scamper_file_idx_get(infile, i);
+      if(scamper_file_filter_isset(filter, idx->type) == 0 ||
+	 (idx->dst != NULL && addr_matched(idx->dst) == 0))
+	continue;
+      if(scamper_file_idx_seek(infile, i) != 0 ||
+	 scamper_file_read(infile, filter, &type, &data) != 0 || data == NULL)
+	{
+	  fprintf(stderr, "%s: could not read record %u\n", __func__, i);
+	  return -1;
+	}
+      process(type, data);
+    }
+
+  return 0;
+}
+
 static void cleanup(void)
 {
   if(infile != NULL)
@@ -580,21 +643,18 @@ int main(int argc, char *argv[])
   if(check_options(argc, argv) != 0)
     goto err;
 
+  if(scamper_file_idx_count(infile) > 0)
+    {
+      if(process_idx() != 0)
+	goto err;
+      return 0;
+    }
+
   while(scamper_file_read(infile, filter, &type, (void *)&data) == 0)
     {
       if(data == NULL)
 	break; /* EOF */
-
-      if(type == SCAMPER_FILE_OBJ_DEALIAS)
-	process_dealias(data);
-      else if(type == SCAMPER_FILE_OBJ_PING)
-	process_ping(data);
-      else if(type == SCAMPER_FILE_OBJ_TRACE)
-	process_trace(data);
-      else if(type == SCAMPER_FILE_OBJ_TBIT)
-	process_tbit(data);
-      else if(type == SCAMPER_FILE_OBJ_TRACELB)
-	process_tracelb(data);
+      process(type, data);
     }
 
   return 0;